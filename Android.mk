@@ -12,7 +12,6 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/include            \
                     $(LOCAL_PATH)/source/ops/cpu/ref \
                     $(LOCAL_PATH)/source/ops/cpu/ \
                     $(LOCAL_PATH)/source/ops/gpu/ \
-                    $(LOCAL_PATH)/3rd_party/openmp/include \
                     $(LOCAL_PATH)/3rd_party/opencl \
                     $(call intermediates-dir-for, SHARED_LIBRARIES, $(LOCAL_MODULE))/proto
 
@@ -26,9 +25,9 @@ LOCAL_SRC_FILES := $(call all-cpp-files-under,\
 	source/ops/cpu/neon)
 
 LOCAL_MULTILIB := 64
-LOCAL_STATIC_LIBRARIES := libomp_static libprofiling_static
+LOCAL_STATIC_LIBRARIES := libprofiling_static
 
-LOCAL_CFLAGS += -std=c++11 -fopenmp -O3
+LOCAL_CFLAGS += -std=c++11 -O3
 LOCAL_CFLAGS += -DMAI_NEON_ENABLED
 
 include $(BUILD_SHARED_LIBRARY)
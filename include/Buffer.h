@@ -26,6 +26,9 @@ public:
 
     virtual void setBufferAddr(const uint8* buffer, uint32 offset = 0) = 0;
     virtual void setBufferAddr(uint8* buffer, uint32 offset = 0) = 0;
+    // Binds the buffer to size bytes of memory owned elsewhere(e.g. a slot of
+    // a MemoryArena), later resizes within size keep using it.
+    virtual void setBufferAddr(uint8* buffer, uint32 offset, uint64 size) = 0;
     virtual void copy(const uint8* src, int32 offset, int64 len) = 0;
 
     virtual const uint8* data() = 0;
@@ -34,6 +37,11 @@ public:
     virtual uint64 size() = 0;
     virtual void zero() = 0;
 
+    // Drops the backing memory but keeps the buffer(and its size), so that
+    // tensors sharing it stay valid until it is bound to memory elsewhere
+    // with setBufferAddr.
+    virtual void release() = 0;
+
     //template<typename T = uint8>
     //const T* data() {
     //    return reinterpret_cast<const T*>(mBufferPtr + mOffset);
@@ -0,0 +1,123 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NeuralNetwork.h"
+
+namespace MAI {
+
+template<typename T>
+class MPMCQueue;
+
+// Batching front-end of NeuralNetwork.
+//
+// Single-sample requests from any thread go into a lock-free queue. Each
+// network(e.g. a network and its sessions) has a dispatcher thread which
+// collects up to maxBatchSize requests, packs them along dim 0(N) of the
+// model inputs, runs once and scatters dim 0 of the model outputs back to
+// the futures of the requests.
+//
+// Before a run dim 0 of the model inputs is resized(resizeInputs) to the
+// smallest of batchSizes which holds the batch, the unused samples are zero.
+// A few sizes keep the memory plans of the network cached, dim 0 of every
+// model output must follow dim 0 of the inputs.
+class DynamicBatcher {
+public:
+    struct Options {
+        int32 maxBatchSize;
+        // How long the first request of a batch waits for more requests.
+        int64 maxWaitMicros;
+        // Target of queueing + running time of one request, the wait is cut
+        // short by the recent running time of a batch. 0 means no budget.
+        int64 latencyBudgetMicros;
+        // Size of the request queue, a power of 2. Requests submitted to a
+        // full queue fail.
+        uint32 queueCapacity;
+        // Dim 0 sizes the model inputs are resized to, the largest one must
+        // be at least maxBatchSize. Empty means the powers of 2 below
+        // maxBatchSize and maxBatchSize itself.
+        std::vector<int32> batchSizes;
+
+        Options() : maxBatchSize(8), maxWaitMicros(2000), latencyBudgetMicros(0),
+            queueCapacity(1024) {}
+    };
+
+    struct Stats {
+        uint64 requests;
+        uint64 batches;
+        double averageBatchSize;
+        double averageQueueDelayMicros;
+        uint64 maxQueueDelayMicros;
+    };
+
+    // One buffer per model output, holding one sample.
+    typedef std::vector<std::vector<uint8> > Outputs;
+
+    DynamicBatcher(const std::vector<NeuralNetwork*>& networks, const Options& options = Options());
+    ~DynamicBatcher();
+
+    // inputs holds one sample for each model input in the order of
+    // getModelInputs(), the data is copied before submit returns. get() of
+    // the future throws std::runtime_error if running the batch failed, or
+    // right away if queueCapacity requests are queued already(the request is
+    // dropped, submit never blocks).
+    std::future<Outputs> submit(const std::vector<const void*>& inputs);
+
+    Stats stats() const;
+
+private:
+    struct Request {
+        std::vector<std::vector<uint8> > inputs;
+        std::promise<Outputs> promise;
+        uint64 enqueueMicros;
+    };
+
+    void dispatchLoop(NeuralNetwork* network);
+    bool collectBatch(std::vector<Request*>& batch);
+    bool waitForRequest(uint64 deadlineMicros);
+    void runBatch(NeuralNetwork* network, std::vector<Request*>& batch);
+    void failBatch(std::vector<Request*>& batch, const char* reason);
+    int32 paddedBatchSize(int32 batchSize) const;
+    static uint64 nowMicros();
+
+private:
+    Options mOptions;
+    std::vector<std::string> mModelInputs;
+    std::vector<std::string> mModelOutputs;
+    std::vector<uint64> mInputSampleSizes;// bytes of one sample of each model input
+    std::vector<std::vector<shape_t> > mInputShapes;
+    std::vector<int32> mBatchSizes;// ascending
+    std::unique_ptr<MPMCQueue<Request*> > mQueue;
+    std::atomic<int32> mQueuedRequests;
+    std::atomic<int32> mSleepingDispatchers;
+    std::atomic<bool> mStop;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::thread> mDispatchers;
+
+    std::atomic<uint64> mBatchRunMicros;// moving average of running one batch
+    std::atomic<uint64> mRequestCount;
+    std::atomic<uint64> mBatchCount;
+    std::atomic<uint64> mTotalQueueDelayMicros;
+    std::atomic<uint64> mMaxQueueDelayMicros;
+};
+
+} // namespace MAI
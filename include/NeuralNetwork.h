@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <functional>
+#include <future>
+#include <map>
 #include "include/Type.h"
 #include "include/Operator.h"
 #include "include/Tensor.h"
@@ -24,12 +27,14 @@ namespace MAI {
 namespace Profiling {
 class Profiler;
 }
+class ConstantCache;
 class NeuralNetwork {
 public:
     enum OptimizerRule {
         FOLD_BN_INTO_CONV2D,
         FOLD_ACTIVATION_INTO_CONV2D,
         CONSTANT_FOLD,
+        OPTIMIZER_RULE_COUNT,// keep it last
     };
 
     enum NetworkFormat {
@@ -38,10 +43,22 @@ public:
         MAI,
     };
 
+    // Invoked with the status of an asynchronous run, on the thread which
+    // finished it.
+    typedef std::function<void(MAI_STATUS)> RunCallback;
+
 public:
     static std::unique_ptr<NeuralNetwork> getNeuralNetwork(
             const NetworkFormat networkFormat, const std::string& modelPath);
 
+    // getNeuralNetwork() optimized by all rules, the optimized graph and the
+    // constants operators derive in their first run are kept in a sidecar
+    // ConstantCache at cachePath. Later calls with the same model, engine and
+    // CPU map them back instead of parsing and optimizing again.
+    static std::unique_ptr<NeuralNetwork> getOptimizedNeuralNetwork(
+            const NetworkFormat networkFormat, const std::string& modelPath,
+            const std::string& cachePath);
+
     NeuralNetwork() : mProfiler(NULL) {}
     virtual ~NeuralNetwork() = default;
 
@@ -61,22 +78,53 @@ public:
         return mDevice;
     }
 
+    // Where operators keep the constants they derive(e.g. packed weights),
+    // saved after the first run. NULL if there is none.
+    inline void setConstantCache(const std::shared_ptr<ConstantCache>& cache) {
+        mConstantCache = cache;
+    }
+
+    inline ConstantCache* getConstantCache() {
+        return mConstantCache.get();
+    }
+
+    // Keeps memory that tensors point into(e.g. a mapped model file) alive
+    // as long as the network.
+    inline void holdResource(const std::shared_ptr<void>& resource) {
+        mResources.push_back(resource);
+    }
+
     virtual MAI_STATUS init() = 0;
     virtual MAI_STATUS run() = 0;
     virtual MAI_STATUS run(Context* context) = 0;
+    // Starts a run and returns at once, callback is invoked when the last
+    // operator finishes. The network must not be run or changed until then,
+    // concurrent requests go to sessions(see createSession()), which share
+    // the inter-op threads, so the early operators of one request run while
+    // the tail of another is still running. See RunAwaiter.h for co_await.
+    virtual void runAsync(RunCallback callback) = 0;
+    virtual std::future<MAI_STATUS> runAsync();
     virtual MAI_STATUS addOperator(std::unique_ptr<Operator>& op) = 0;
     virtual MAI_STATUS removeOperator(const std::string& opName) = 0;
     virtual MAI_STATUS addTensor(std::unique_ptr<Tensor>& tensor) = 0;
     virtual Tensor* getTensor(const std::string& name) = 0;
+    // Tensor names are interned into a table, the handle of a name never
+    // changes, so operators resolve it once and skip string lookups in run().
+    virtual int32 getTensorHandle(const std::string& name) = 0;
+    virtual Tensor* getTensorByHandle(int32 handle) = 0;
     virtual int32 getTensorInDegree(const std::string& name) = 0;
     virtual int32 getTensorOutDegree(const std::string& name) = 0;
     virtual std::vector<std::string> getTensorNames() = 0;
     virtual MAI_STATUS removeTensor(const std::string& tensorName) = 0;
     virtual Operator* getOperator(const std::string& name) = 0;
     virtual std::vector<std::string> getOperatorNames() = 0;
+    // Operators in the order they run.
+    virtual std::vector<Operator*> getOperators() = 0;
 
     virtual void addOptimizer(std::unique_ptr<Optimizer> optimizer);
     virtual void addOptimizer(OptimizerRule rule);
+    // Adds the optimizers of all rules in the order of OptimizerRule.
+    virtual void addAllOptimizers();
     virtual Optimizer* createOptimizer(OptimizerRule rule);
     virtual void startOptimize();
     virtual void builGraph() = 0;
@@ -87,11 +135,50 @@ public:
             DataType dataType, DataFormat dataFormat,
             const std::vector<shape_t>& inputShape) = 0;
     virtual void addModelOutput(const std::string& outputName) = 0;
+
+    // Changes the shapes of model inputs. Operators downstream of a changed
+    // input derive their shapes and cached state again in the next run,
+    // buffers are only reallocated when they grow. Memory plans of recently
+    // used input shapes are cached, switching back to one of them is free.
+    virtual MAI_STATUS resizeInputs(
+            const std::map<std::string, std::vector<shape_t> >& inputShapes) = 0;
+
+    // Binds size bytes of caller-owned memory to a model input or output, so
+    // inputs are read from and outputs are written into it without copies.
+    // The memory must be aligned to the element size and outlive the binding,
+    // run() checks that it is large enough for the tensor. NULL unbinds.
+    virtual MAI_STATUS bindInput(const std::string& name, void* data, uint64 size) = 0;
+    virtual MAI_STATUS bindOutput(const std::string& name, void* data, uint64 size) = 0;
+
+    // Activation footprint in bytes, valid after the first run. Naive is one
+    // buffer per tensor, planned is the arena shared by all activations.
+    virtual uint64 getNaiveMemorySize() = 0;
+    virtual uint64 getPlannedMemorySize() = 0;
+
+    // Number of threads running one operator(intra-op), including the thread
+    // calling run(), the number of cores by default. The threads belong to
+    // this network and its sessions, if pinThreads each one is pinned to a
+    // core. Must be called before createSession().
+    virtual void setNumThreads(int32 numThreads, bool pinThreads = false) = 0;
+
+    // Number of threads running independent operators at the same time, 1 runs
+    // the operators one after another(default). Must be called before init().
+    virtual void setNumInterOpThreads(int32 numThreads) = 0;
+
+    // Creates a lightweight network which runs the same operators on its own
+    // activations, so one loaded model can serve concurrent requests. Const
+    // tensors are shared with this network and operator params are copied
+    // from it, this network must outlive its sessions and must not be
+    // changed(e.g. optimized) after that. Each session is used by one thread
+    // at a time.
+    virtual std::unique_ptr<NeuralNetwork> createSession() = 0;
 private:
     std::vector<std::unique_ptr<Optimizer> > mOptimizers;
+    std::vector<std::shared_ptr<void> > mResources;
     Profiling::Profiler* mProfiler;
 protected:
     std::shared_ptr<Device> mDevice;
+    std::shared_ptr<ConstantCache> mConstantCache;
 };
 
 } // namespace MAI
@@ -14,7 +14,10 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <type_traits>
+#include <vector>
 #include "Tensor.h"
 #include "Type.h"
 #include "Log.h"
@@ -22,12 +25,57 @@
 
 namespace MAI {
 
+// Reads or writes the fields of a param one after another(e.g. from or to
+// a MAI model file), the same function serves both directions.
+class ParamArchive {
+public:
+    virtual ~ParamArchive() = default;
+    virtual void io(int32& value) = 0;
+    virtual void io(float& value) = 0;
+    virtual void io(bool& value) = 0;
+    virtual void io(std::vector<int32>& values) = 0;
+
+    template<typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type io(T& value) {
+        int32 intValue = static_cast<int32>(value);
+        io(intValue);
+        value = static_cast<T>(intValue);
+    }
+
+    inline void fields() {}
+
+    template<typename T, typename... Rest>
+    void fields(T& first, Rest&... rest) {
+        io(first);
+        fields(rest...);
+    }
+};
+
 struct Param {
+    virtual ~Param() = default;
+    // Deep copy with the real type of the param.
+    virtual Param* clone() const {
+        return new Param(*this);
+    }
+    virtual void serialize(ParamArchive& /*archive*/) {}
 };
 
+#define MAI_PARAM_CLONE(CLASSNAME)                  \
+    Param* clone() const override {                 \
+        return new CLASSNAME(*this);                \
+    }
+
+// Fields in the order they are serialized, append new fields at the end.
+#define MAI_PARAM_FIELDS(...)                       \
+    void serialize(ParamArchive& archive) override {\
+        archive.fields(__VA_ARGS__);                \
+    }
+
 class NeuralNetwork;
+class ConstantCache;
 class Operator {
 public:
+    Operator();
     virtual ~Operator() = default;
     virtual MAI_STATUS init() = 0;
     virtual MAI_STATUS run() = 0;
@@ -48,10 +96,14 @@ public:
 
     void setName(const std::string& name);
 
-    std::string name() const;
+    const std::string& name() const;
     void setType(MAIOperator opType);
     MAIOperator type() const;
 
+    // The context the operator was created with by OperatorRegister.
+    void setOpContext(const OpContext& opContext);
+    const OpContext& opContext() const;
+
     std::vector<std::string> inputNames() const;
     std::vector<std::string>& inputNames();
 
@@ -63,65 +115,148 @@ public:
 
     void setNeuralNetwork(NeuralNetwork* network);
 
+    // Resolve input/output names to tensor handles once, getInputTensor and
+    // getOutputTensor then just index the tensor table of the network.
+    void bindTensors();
+
     Tensor* getTensor(const std::string& inputName);
 
     Tensor* getInputTensor(int inputIdx);
 
     Tensor* getOutputTensor(int outputIdx);
 
-    virtual void setParam(Param* param);
+    // Keeps a copy of param before the operator takes it, operators may
+    // change or delete their param, the copy is used to create the same
+    // operator again(e.g. NeuralNetwork::createSession).
+    void setParam(Param* param);
     virtual Param* getParam();
+
+    // Untouched copy of the param passed to setParam(), NULL if none.
+    const Param* paramPrototype() const;
+
+    // Drops what run() derived from the shapes of the inputs(output shapes,
+    // kernel choice, paddings...), the next run() derives it again.
+    void invalidate();
+
+    // Whether run() writes the outputs only in the first run after init() or
+    // invalidate()(e.g. Shape). Such outputs keep their own buffers, the
+    // memory planner never lets other tensors reuse them.
+    virtual bool writesOutputsOnce() const {
+        return false;
+    }
+
+protected:
+    virtual void onSetParam(Param* param);
+
+    // Cache of the network for constants derived in the first run(e.g.
+    // packed weights), keyed by name() and what they are. NULL if none.
+    ConstantCache* constantCache() const;
+
+    // A constant of size elements derived from the constants of the operator
+    // (suffix tells which one, e.g. a packed filter): found in the constant
+    // cache, or made by fill into storage once and put there. The network
+    // and its sessions share the copy in the cache, storage only holds it
+    // without a cache(or if the cache has another one of that name).
+    template<typename T>
+    const T* cachedConstant(const std::string& suffix, int64 size, std::vector<T>& storage,
+            const std::function<void(T*)>& fill) {
+        const uint8* cached = findCachedConstant(suffix, size * sizeof(T));
+        if (cached != NULL) {
+            return reinterpret_cast<const T*>(cached);
+        }
+        storage.resize(size);
+        fill(storage.data());
+        putCachedConstant(suffix, storage.data(), size * sizeof(T));
+        cached = findCachedConstant(suffix, size * sizeof(T));
+        if (cached != NULL) {
+            std::vector<T>().swap(storage);
+            return reinterpret_cast<const T*>(cached);
+        }
+        return storage.data();
+    }
+
+protected:
+    // Whether the state between MAI_OP_RUN_FIRST_START/END must be derived
+    bool mRunFirst;
+
+private:
+    void unbindTensors();
+    // NULL if the cache has no constant of size bytes called name() + suffix
+    const uint8* findCachedConstant(const std::string& suffix, uint64 size) const;
+    void putCachedConstant(const std::string& suffix, const void* data, uint64 size) const;
+
 private:
     NeuralNetwork* mNeuralNetwork;
     std::vector<std::string> mInputNames;
     std::vector<std::string> mOutputNames;
+    std::vector<int32> mInputHandles;
+    std::vector<int32> mOutputHandles;
     std::string mName;
     MAIOperator mOpType;
+    OpContext mOpContext;
+    std::unique_ptr<Param> mParamPrototype;
 };
 
 struct SqueezeParam : public Param {
 public:
+    MAI_PARAM_CLONE(SqueezeParam)
+    MAI_PARAM_FIELDS(squeezeDims)
     std::vector<int32> squeezeDims;
 };
 
 struct PadParam : public Param {
 public:
+    MAI_PARAM_CLONE(PadParam)
+    MAI_PARAM_FIELDS(constantValue, paddings)
     float constantValue;
     std::vector<int32> paddings;//dim0_begin, dim0_end, ...
 };
 
 struct SoftmaxParam : public Param {
 public:
+    MAI_PARAM_CLONE(SoftmaxParam)
+    MAI_PARAM_FIELDS(beta, axis)
     float beta; // default is 1.;
     int32 axis; // default is -1 or 0;
 };
 
 struct FusedBatchNormParam : public Param {
 public:
+    MAI_PARAM_CLONE(FusedBatchNormParam)
+    MAI_PARAM_FIELDS(epsilon)
     float epsilon;
 };
 
 struct ExpandDimsParam : public Param {
 public:
+    MAI_PARAM_CLONE(ExpandDimsParam)
+    MAI_PARAM_FIELDS(axes)
     std::vector<int32> axes;
 };
 
 struct SplitParam : public Param {
 public:
+    MAI_PARAM_CLONE(SplitParam)
+    MAI_PARAM_FIELDS(numSplit)
     int32 numSplit;
 };
 
 struct Conv2DParam : public Param {
 public:
+    MAI_PARAM_CLONE(Conv2DParam)
+    MAI_PARAM_FIELDS(dilations, strides, paddings, paddingMode, group, activation)
     std::vector<int32> dilations;//4-d TOP-BOTTON-LEFT-RIGHT
     std::vector<int32> strides;//4-d format associated with input format(NHWC or NCHW)
     std::vector<int32> paddings;//4-d TOP-BOTTON-LEFT-RIGHT
     PaddingMode paddingMode;
     int32 group;//default is 1
+    FusedActivation activation;//folded from a following Relu/Relu6, default is none
 };
 
 struct TransposeConv2dParam : public Param {
 public:
+    MAI_PARAM_CLONE(TransposeConv2dParam)
+    MAI_PARAM_FIELDS(dilations, strides, paddings, paddingMode)
     std::vector<int32> dilations;//4-d TOP-BOTTON-LEFT-RIGHT
     std::vector<int32> strides;//4-d format associated with input format(NHWC or NCHW)
     std::vector<int32> paddings;//4-d TOP-BOTTON-LEFT-RIGHT
@@ -130,14 +265,19 @@ public:
 
 struct DepthwiseConv2dParam : public Param {
 public:
+    MAI_PARAM_CLONE(DepthwiseConv2dParam)
+    MAI_PARAM_FIELDS(dilations, strides, paddings, paddingMode, activation)
     std::vector<int32> dilations;//4-d TOP-BOTTON-LEFT-RIGHT
     std::vector<int32> strides;//4-d format associated with input format(NHWC or NCHW)
     std::vector<int32> paddings;//4-d TOP-BOTTON-LEFT-RIGHT
     PaddingMode paddingMode;
+    FusedActivation activation;//folded from a following Relu/Relu6, default is none
 };
 
 struct PoolParam : public Param {
 public:
+    MAI_PARAM_CLONE(PoolParam)
+    MAI_PARAM_FIELDS(kernelSizes, strides, paddings, paddingMode)
     std::vector<int32> kernelSizes;//4-d format associated with input format(NHWC or NCHW)
     std::vector<int32> strides;//4-d format associated with input format(NHWC or NCHW)
     std::vector<int32> paddings;//4-d TOP-BOTTON-LEFT-RIGHT
@@ -146,18 +286,24 @@ public:
 
 struct ConcatParam : public Param {
 public:
+    MAI_PARAM_CLONE(ConcatParam)
+    MAI_PARAM_FIELDS(num, axis)
     int32 num;
     int32 axis;//[-rank, rank - 1]
 };
 
 struct PackParam : public Param {
 public:
+    MAI_PARAM_CLONE(PackParam)
+    MAI_PARAM_FIELDS(num, axis)
     int32 num;
     int32 axis;//[-rank-1, rank]
 };
 
 struct GemmParam : public Param {
 public:
+    MAI_PARAM_CLONE(GemmParam)
+    MAI_PARAM_FIELDS(alpha, beta, transA, transB)
     float alpha;
     float beta;
     bool transA;
@@ -166,11 +312,15 @@ public:
 
 struct GatherParam : public Param {
 public:
+    MAI_PARAM_CLONE(GatherParam)
+    MAI_PARAM_FIELDS(axis)
     int32 axis;
 };
 
 struct StridedSliceParam : public Param {
 public:
+    MAI_PARAM_CLONE(StridedSliceParam)
+    MAI_PARAM_FIELDS(beginMask, endMask, shrinkAxisMask)
     int32 beginMask;
     int32 endMask;
     int32 shrinkAxisMask;
@@ -178,21 +328,29 @@ public:
 
 struct LeakyReluParam : public Param {
 public:
+    MAI_PARAM_CLONE(LeakyReluParam)
+    MAI_PARAM_FIELDS(alpha)
     float alpha;
 };
 
 struct ArgMaxParam : public Param {
 public:
+    MAI_PARAM_CLONE(ArgMaxParam)
+    MAI_PARAM_FIELDS(keepDim)
     bool keepDim;
 };
 
 struct ArgMinParam : public Param {
 public:
+    MAI_PARAM_CLONE(ArgMinParam)
+    MAI_PARAM_FIELDS(keepDim)
     bool keepDim;
 };
 
 struct ReduceParam : public Param {
 public:
+    MAI_PARAM_CLONE(ReduceParam)
+    MAI_PARAM_FIELDS(axes, keepDim)
     std::vector<int32> axes;
     bool keepDim;
 };
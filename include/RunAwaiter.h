@@ -0,0 +1,57 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "NeuralNetwork.h"
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+
+namespace MAI {
+
+// Awaitable run of a network for C++20 coroutines:
+//
+//     MAI_STATUS status = co_await RunAwaiter(network);
+//
+// The coroutine resumes on the thread which finished the run.
+class RunAwaiter {
+public:
+    explicit RunAwaiter(NeuralNetwork* network) : mNetwork(network), mStatus(MAI_SUCCESS) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        mNetwork->runAsync([this, handle](MAI_STATUS status) {
+            mStatus = status;
+            handle.resume();
+        });
+    }
+
+    MAI_STATUS await_resume() const noexcept {
+        return mStatus;
+    }
+
+private:
+    NeuralNetwork* mNetwork;
+    MAI_STATUS mStatus;
+};
+
+} // namespace MAI
+
+#endif
+#endif
@@ -83,6 +83,10 @@ public:
     virtual uint64 elementSize() const;
     virtual uint64 size() const;
     virtual void reuse(const Tensor* tensor);
+    // Uses size bytes of memory owned by the caller as the buffer, later
+    // resizes within size keep using it. NULL goes back to memory of the
+    // allocator.
+    virtual void bindMemory(void* data, uint64 size);
     virtual void reshape(const std::vector<shape_t>& tensor);
     virtual void release();
     virtual void toFile(const std::string& dir, const std::string& file = "");
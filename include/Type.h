@@ -150,6 +150,39 @@ inline std::string getNameFromDeviceType(DeviceType deviceType) {
     }
 }
 
+// ISA extensions a kernel variant needs, OR-ed into OpContext::cpuFeatures.
+enum CpuFeature {
+    CPU_FEATURE_SSE4_2 = 1 << 0,
+    CPU_FEATURE_AVX = 1 << 1,
+    CPU_FEATURE_AVX2 = 1 << 2,
+    CPU_FEATURE_FMA = 1 << 3,
+    CPU_FEATURE_AVX512F = 1 << 4,
+    CPU_FEATURE_AVX512BW = 1 << 5,
+    CPU_FEATURE_AVX512_VNNI = 1 << 6,
+    CPU_FEATURE_NEON = 1 << 7,
+};
+
+inline std::string getNameFromCpuFeatures(uint32 cpuFeatures) {
+    static const std::pair<CpuFeature, const char*> kNames[] = {
+        {CPU_FEATURE_SSE4_2, "sse4.2"},
+        {CPU_FEATURE_AVX, "avx"},
+        {CPU_FEATURE_AVX2, "avx2"},
+        {CPU_FEATURE_FMA, "fma"},
+        {CPU_FEATURE_AVX512F, "avx512f"},
+        {CPU_FEATURE_AVX512BW, "avx512bw"},
+        {CPU_FEATURE_AVX512_VNNI, "avx512vnni"},
+        {CPU_FEATURE_NEON, "neon"},
+    };
+    std::string name;
+    for (const auto& feature : kNames) {
+        if (cpuFeatures & feature.first) {
+            name += name.empty() ? "" : "+";
+            name += feature.second;
+        }
+    }
+    return name.empty() ? "generic" : name;
+}
+
 inline std::string getNameFromDataType(DataType dataType) {
     switch(dataType) {
     case DT_INVALID:return "DT_INVALID";
@@ -273,6 +306,13 @@ DATA_FORMAT_INDEX(HWOI,-1,0,1,-1,3,2);
 DATA_FORMAT_INDEX(OIHW,-1,2,3,-1,1,0);
 DATA_FORMAT_INDEX(IOHW,-1,2,3,-1,0,1);
 
+// Activation an operator applies to its output before storing it.
+enum FusedActivation {
+    FUSED_ACTIVATION_NONE,
+    FUSED_ACTIVATION_RELU,
+    FUSED_ACTIVATION_RELU6,
+};
+
 enum PaddingMode {
     PADDING_INVALID,
     PADDING_VALID,
@@ -285,6 +325,9 @@ struct OpContext {
     DataType dataType;
     DeviceType deviceType;
     std::string extraInfo;
+    // Required by the kernel variant, 0 if it runs on any CPU. OperatorRegister
+    // picks the widest variant the running CPU supports.
+    uint32 cpuFeatures;
 
     bool operator < (const OpContext& opContext) const {
 #define COMPARE(value) \
@@ -296,6 +339,7 @@ struct OpContext {
         COMPARE(deviceType)
         COMPARE(dataType)
         COMPARE(extraInfo)
+        COMPARE(cpuFeatures)
 #undef COMPARE
         return false;
     }
@@ -310,6 +354,8 @@ struct OpContext {
            << getNameFromDeviceType(deviceType)
            << ", ExtraInfo:"
            << extraInfo
+           << ", CpuFeatures:"
+           << getNameFromCpuFeatures(cpuFeatures)
            << "}";
         return ss.str();
     }
@@ -322,6 +368,7 @@ public:
         mOpContext.dataType = DT_INVALID;
         mOpContext.deviceType = DEVICE_CPU;
         mOpContext.extraInfo = "";
+        mOpContext.cpuFeatures = 0;
     }
 
     inline OpContextBuilder& setOperatorType(MAIOperator op) {
@@ -344,6 +391,11 @@ public:
         return *this;
     }
 
+    inline OpContextBuilder& setCpuFeatures(uint32 cpuFeatures) {
+        mOpContext.cpuFeatures = cpuFeatures;
+        return *this;
+    }
+
     inline OpContext build() {
         return mOpContext;
     }
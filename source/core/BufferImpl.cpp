@@ -24,14 +24,12 @@ SimpleBuffer::SimpleBuffer(Allocator* allocator) :
     mOffset(0),
     mBufferPtr(NULL),
     mIsConst(false),
+    mIsExternal(false),
     mSize(0) {
 }
 
 SimpleBuffer::~SimpleBuffer(){
-    if (mBufferPtr) {
-        mAllocator->deallocate(memoryInfo);
-        mBufferPtr = NULL;
-    }
+    release();
 }
 
 MAI_STATUS SimpleBuffer::allocate(int64 bytes) {
@@ -39,7 +37,10 @@ MAI_STATUS SimpleBuffer::allocate(int64 bytes) {
     MAI_CHECK(mBufferPtr == NULL, "Buffer has been allocated");
     memoryInfo = mAllocator->allocate(bytes);
     mBufferPtr = memoryInfo.ptr;
-    MAI_CHECK(mBufferPtr != NULL, "allocate buffer failed, sizes:%d", bytes);
+    MAI_CHECK(bytes == 0 || mBufferPtr != NULL, "allocate buffer failed, sizes:%d", bytes);
+    mOffset = 0;
+    mIsConst = false;
+    mIsExternal = false;
     mSize = bytes;
     return MAI_SUCCESS;
 }
@@ -47,6 +48,7 @@ MAI_STATUS SimpleBuffer::allocate(int64 bytes) {
 void SimpleBuffer::setBufferAddr(const uint8* buffer, uint32 offset) {
     MAI_CHECK(mBufferPtr == NULL, "Buffer has been allocated");
     mIsConst = true;
+    mIsExternal = true;
     mBufferPtr = const_cast<uint8*>(buffer);
     mOffset = offset;
 }
@@ -54,29 +56,36 @@ void SimpleBuffer::setBufferAddr(const uint8* buffer, uint32 offset) {
 void SimpleBuffer::setBufferAddr(uint8* buffer, uint32 offset) {
     MAI_CHECK(mBufferPtr == NULL, "Buffer has been allocated");
     mIsConst = false;
+    mIsExternal = true;
     mBufferPtr = buffer;
     mOffset = offset;
 }
 
+void SimpleBuffer::setBufferAddr(uint8* buffer, uint32 offset, uint64 size) {
+    setBufferAddr(buffer, offset);
+    mSize = size;
+}
+
 void SimpleBuffer::copy(const uint8* src, int32 offset, int64 len) {
     MAI_CHECK(mBufferPtr != NULL, "Buffer is null");
-    memcpy(mBufferPtr, src + offset, len);
+    memcpy(mBufferPtr + mOffset, src + offset, len);
 }
 
 const uint8* SimpleBuffer::data() {
-    return mBufferPtr;
+    return mBufferPtr == NULL ? NULL : mBufferPtr + mOffset;
 }
 
 uint8* SimpleBuffer::mutableData() {
     MAI_CHECK(!mIsConst, "Buffer is not mutable");
-    return mBufferPtr;
+    return mBufferPtr == NULL ? NULL : mBufferPtr + mOffset;
 }
 
 void SimpleBuffer::resize(uint64 len) {
-    if (mSize != len) {
-        delete mBufferPtr;
-        mBufferPtr = NULL;
+    if (mBufferPtr != NULL && (mSize == len || (mIsExternal && len <= mSize))) {
+        // arena or caller bound memory is kept while it is big enough
+        return;
     }
+    release();
     allocate(len);
 }
 
@@ -85,7 +94,16 @@ uint64 SimpleBuffer::size() {
 }
 
 void SimpleBuffer::zero() {
-    memset(mBufferPtr, 0, mSize);
+    memset(mBufferPtr + mOffset, 0, mSize);
+}
+
+void SimpleBuffer::release() {
+    if (mBufferPtr != NULL && !mIsExternal) {
+        mAllocator->deallocate(memoryInfo);
+    }
+    mBufferPtr = NULL;
+    mOffset = 0;
+    mIsExternal = false;
 }
 
 } //namespace MAI
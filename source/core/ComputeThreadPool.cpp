@@ -0,0 +1,187 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include "ComputeThreadPool.h"
+#include "util/MAIType.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace MAI {
+
+static thread_local ComputeThreadPool* tCurrentPool = NULL;
+
+// Spinning covers the gap between two operators of one run(well below a
+// millisecond), longer waits park the thread.
+static const int32 kSpinCount = 2000;
+static const int64 kChunksPerThread = 4;
+
+static inline void cpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+static void pinToCore(int32 core) {
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        ALOGW("Cannot pin thread to core %d", core);
+    }
+#endif
+}
+
+ComputeThreadPool::ComputeThreadPool(int32 numThreads, bool pinThreads) :
+    mBusy(false),
+    mGeneration(0),
+    mActiveWorkers(0),
+    mParkedWorkers(0),
+    mNextChunk(0),
+    mChunkCount(0),
+    mChunkSize(0),
+    mBegin(0),
+    mEnd(0),
+    mFunction(NULL),
+    mStop(false) {
+    MAI_CHECK(numThreads > 0, "Invalid thread number:%d", numThreads);
+    for (int32 i = 1; i < numThreads; ++i) {
+        mWorkers.emplace_back(&ComputeThreadPool::workerLoop, this, i, pinThreads);
+    }
+}
+
+ComputeThreadPool::~ComputeThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop.store(true);
+    }
+    mCondition.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+int32 ComputeThreadPool::getNumCPUCores() {
+    int32 cores = static_cast<int32>(std::thread::hardware_concurrency());
+    return cores > 0 ? cores : 1;
+}
+
+ComputeThreadPool* ComputeThreadPool::current() {
+    return tCurrentPool;
+}
+
+ComputeThreadPool::Scope::Scope(ComputeThreadPool* pool) : mPrevious(tCurrentPool) {
+    tCurrentPool = pool;
+}
+
+ComputeThreadPool::Scope::~Scope() {
+    tCurrentPool = mPrevious;
+}
+
+void ComputeThreadPool::parallelFor(int64 begin, int64 end, int64 grain, const RangeFunction& fn) {
+    const int64 total = end - begin;
+    if (total <= 0) {
+        return;
+    }
+    grain = grain > 0 ? grain : 1;
+    if (mWorkers.empty() || total <= grain || mBusy.exchange(true)) {
+        fn(begin, end);
+        return;
+    }
+    const int64 maxChunks = numThreads() * kChunksPerThread;
+    mChunkSize = std::max(grain, (total + maxChunks - 1) / maxChunks);
+    mChunkCount = (total + mChunkSize - 1) / mChunkSize;
+    mBegin = begin;
+    mEnd = end;
+    mFunction = &fn;
+    mNextChunk.store(0);
+    mActiveWorkers.store(static_cast<int32>(mWorkers.size()));
+    mGeneration.fetch_add(1);
+    if (mParkedWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondition.notify_all();
+    }
+
+    runChunks();
+    // the loop state is reused by the next loop, so wait for every worker to leave
+    for (int32 spins = 0; mActiveWorkers.load() > 0; ++spins) {
+        if (spins < kSpinCount) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    mFunction = NULL;
+    mBusy.store(false);
+}
+
+void ComputeThreadPool::runChunks() {
+    // loops started from inside a chunk find the pool busy and run inline
+    Scope scope(this);
+    for (;;) {
+        const int64 chunk = mNextChunk.fetch_add(1);
+        if (chunk >= mChunkCount) {
+            break;
+        }
+        const int64 chunkBegin = mBegin + chunk * mChunkSize;
+        (*mFunction)(chunkBegin, std::min(mEnd, chunkBegin + mChunkSize));
+    }
+}
+
+void ComputeThreadPool::workerLoop(int32 index, bool pinThread) {
+    if (pinThread) {
+        pinToCore(index % getNumCPUCores());
+    }
+    uint64 seen = 0;
+    for (;;) {
+        int32 spins = 0;
+        while (mGeneration.load() == seen && !mStop.load()) {
+            if (++spins < kSpinCount) {
+                cpuRelax();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mMutex);
+            mParkedWorkers.fetch_add(1);
+            mCondition.wait(lock, [this, seen]() {
+                return mGeneration.load() != seen || mStop.load();
+            });
+            mParkedWorkers.fetch_sub(1);
+        }
+        if (mStop.load()) {
+            return;
+        }
+        seen = mGeneration.load();
+        runChunks();
+        mActiveWorkers.fetch_sub(1);
+    }
+}
+
+void parallelFor(int64 begin, int64 end, int64 grain,
+        const ComputeThreadPool::RangeFunction& fn) {
+    ComputeThreadPool* pool = ComputeThreadPool::current();
+    if (pool == NULL) {
+        if (end > begin) {
+            fn(begin, end);
+        }
+        return;
+    }
+    pool->parallelFor(begin, end, grain, fn);
+}
+
+} // namespace MAI
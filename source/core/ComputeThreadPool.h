@@ -0,0 +1,98 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+
+// Fork-join threads which run one loop at a time(intra-op parallelism).
+//
+// The thread calling parallelFor takes part in the loop, so a pool of n
+// threads starts n - 1 workers. Between loops the workers spin for a while,
+// operators follow each other closely, and park on a condition variable
+// after that. A pool belongs to one network(and its sessions) instead of
+// the process, two networks never share or resize each other's threads.
+// A loop started while the pool is running another one(e.g. by a concurrent
+// inter-op thread or from inside a loop) runs on the calling thread.
+class ComputeThreadPool {
+public:
+    typedef std::function<void(int64 begin, int64 end)> RangeFunction;
+
+    // Threads are pinned to one core each if pinThreads.
+    ComputeThreadPool(int32 numThreads, bool pinThreads = false);
+    ~ComputeThreadPool();
+
+    void parallelFor(int64 begin, int64 end, int64 grain, const RangeFunction& fn);
+
+    inline int32 numThreads() const {
+        return static_cast<int32>(mWorkers.size()) + 1;
+    }
+
+    static int32 getNumCPUCores();
+
+    // The pool parallelFor() of the calling thread goes to.
+    static ComputeThreadPool* current();
+
+    // Makes pool the current one of the calling thread in its scope.
+    class Scope {
+    public:
+        explicit Scope(ComputeThreadPool* pool);
+        ~Scope();
+    private:
+        ComputeThreadPool* mPrevious;
+    };
+
+private:
+    void workerLoop(int32 index, bool pinThread);
+    void runChunks();
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::atomic<bool> mBusy;
+    std::atomic<uint64> mGeneration;// bumped by every loop
+    std::atomic<int32> mActiveWorkers;// workers which have not left the current loop
+    std::atomic<int32> mParkedWorkers;
+    std::atomic<int64> mNextChunk;
+    int64 mChunkCount;
+    int64 mChunkSize;
+    int64 mBegin;
+    int64 mEnd;
+    const RangeFunction* mFunction;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::atomic<bool> mStop;
+};
+
+// Runs fn over chunks of [begin, end) on the current pool of the calling
+// thread, each chunk has at least grain indexes. Runs fn(begin, end) inline
+// if there is no pool or the range is not larger than grain, so small
+// operators do not pay for waking threads up.
+void parallelFor(int64 begin, int64 end, int64 grain,
+        const ComputeThreadPool::RangeFunction& fn);
+
+// Grain of a loop whose indexes cost about cost elements of work each.
+inline int64 grainSize(int64 cost) {
+    const int64 kMinElementsPerChunk = 16384;
+    return cost >= kMinElementsPerChunk ? 1 : kMinElementsPerChunk / (cost > 0 ? cost : 1);
+}
+
+} // namespace MAI
@@ -0,0 +1,263 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include "ConstantCache.h"
+#include "core/CpuFeatures.h"
+#include "source/util/MAIUtil.h"
+
+namespace MAI {
+
+namespace {
+
+const char kConstantCacheMagic[8] = {'M', 'A', 'I', 'C', 'A', 'C', 'H', 'E'};
+const uint64 kConstantCacheAlignment = 64;
+
+// The table(key, names, offsets and sizes of entries) follows the header,
+// the blobs follow the table.
+struct ConstantCacheHeader {
+    char magic[8];
+    uint32 version;
+    uint32 entryCount;
+    uint64 tableSize;
+    uint8 padding[40];
+};
+
+static_assert(sizeof(ConstantCacheHeader) == kConstantCacheAlignment, "Header must keep the blobs aligned");
+
+inline uint64 alignUp(uint64 value) {
+    return (value + kConstantCacheAlignment - 1) / kConstantCacheAlignment * kConstantCacheAlignment;
+}
+
+template<typename T>
+void appendValue(std::string& bytes, T value) {
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendString(std::string& bytes, const std::string& value) {
+    appendValue<uint32>(bytes, value.size());
+    bytes.append(value);
+}
+
+template<typename T>
+bool readValue(const uint8*& current, const uint8* end, T& value) {
+    if (static_cast<uint64>(end - current) < sizeof(T)) {
+        return false;
+    }
+    memcpy(&value, current, sizeof(T));
+    current += sizeof(T);
+    return true;
+}
+
+bool readString(const uint8*& current, const uint8* end, std::string& value) {
+    uint32 size = 0;
+    if (!readValue(current, end, size) || static_cast<uint64>(end - current) < size) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(current), size);
+    current += size;
+    return true;
+}
+
+// Packed constants follow the kernels, which follow the ISA
+std::string cpuTarget() {
+#if defined(__x86_64__) || defined(__i386__)
+    std::string arch = "x86";
+#elif defined(__aarch64__)
+    std::string arch = "arm64";
+#elif defined(__arm__)
+    std::string arch = "arm";
+#else
+    std::string arch = "generic";
+#endif
+    return arch + "+" + getNameFromCpuFeatures(cpuFeatures());
+}
+
+} // namespace
+
+ConstantCache::ConstantCache(const std::string& path, const std::string& key)
+    : mPath(path), mKey(key), mMapping(NULL), mMappingSize(0), mDirty(false) {
+}
+
+ConstantCache::~ConstantCache() {
+    if (mMapping != NULL) {
+        unmapFile(mMapping, mMappingSize);
+    }
+}
+
+/*static*/
+std::string ConstantCache::makeKey(const std::string& modelPath) {
+    uint64 size = 0;
+    const uint8* data = mapFile<uint8>(modelPath, size);
+    if (data == NULL) {
+        return "";
+    }
+    // FNV-1a
+    uint64 hash = 14695981039346656037ULL;
+    for (uint64 i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    unmapFile(data, size);
+    std::stringstream ss;
+    ss << std::hex << hash << "-" << std::dec << size
+       << ";mai-" << kMaiVersion << "." << kConstantCacheVersion
+       << ";" << cpuTarget();
+    return ss.str();
+}
+
+bool ConstantCache::load() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    MAI_CHECK(mMapping == NULL, "Cache is loaded already");
+    if (mKey.empty()) {
+        return false;
+    }
+    uint64 size = 0;
+    uint8* data = mapFile<uint8>(mPath, size);
+    if (data == NULL) {
+        return false;
+    }
+    ConstantCacheHeader header;
+    bool valid = size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, data, sizeof(header));
+        valid = memcmp(header.magic, kConstantCacheMagic, sizeof(header.magic)) == 0
+            && header.version == kConstantCacheVersion
+            && header.tableSize <= size - sizeof(header);
+    }
+    std::string key;
+    const uint8* current = data + sizeof(header);
+    const uint8* end = valid ? current + header.tableSize : current;
+    valid = valid && readString(current, end, key) && key == mKey;
+    std::map<std::string, Entry> entries;
+    for (uint32 i = 0; valid && i < header.entryCount; ++i) {
+        std::string name;
+        uint64 offset = 0;
+        Entry entry = {NULL, 0};
+        valid = readString(current, end, name) && readValue(current, end, offset)
+            && readValue(current, end, entry.size)
+            && offset <= size && entry.size <= size - offset;
+        entry.data = data + offset;
+        entries[name] = entry;
+    }
+    if (!valid) {
+        ALOGI("Cache %s is stale or corrupted, ignored", mPath.c_str());
+        unmapFile(data, size);
+        return false;
+    }
+    mMapping = data;
+    mMappingSize = size;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        // entries put before loading win
+        mEntries.insert(*it);
+    }
+    return true;
+}
+
+uint8* ConstantCache::find(const std::string& name, uint64* size) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(name);
+    if (it == mEntries.end()) {
+        return NULL;
+    }
+    if (size != NULL) {
+        *size = it->second.size;
+    }
+    return it->second.data;
+}
+
+void ConstantCache::put(const std::string& name, const void* data, uint64 size) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mEntries.find(name) != mEntries.end()) {
+        // find() may have handed the entry out already(e.g. two sessions
+        // missed on the same constant), its bytes must stay untouched
+        return;
+    }
+    // aligned like the entries in the file
+    std::string& bytes = mPendingEntries[name];
+    bytes.assign(size + kConstantCacheAlignment, '\0');
+    uint8* alignedData = reinterpret_cast<uint8*>(alignUp(reinterpret_cast<uintptr_t>(&bytes[0])));
+    memcpy(alignedData, data, size);
+    Entry entry = {alignedData, size};
+    mEntries.insert(std::make_pair(name, entry));
+    mDirty = !mKey.empty();
+}
+
+bool ConstantCache::isDirty() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDirty;
+}
+
+MAI_STATUS ConstantCache::save() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mKey.empty()) {
+        return MAI_FAILED;
+    }
+    std::string table;
+    appendString(table, mKey);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        appendString(table, it->first);
+        appendValue<uint64>(table, 0);// offset, patched below
+        appendValue<uint64>(table, it->second.size);
+    }
+    ConstantCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kConstantCacheMagic, sizeof(header.magic));
+    header.version = kConstantCacheVersion;
+    header.entryCount = mEntries.size();
+    header.tableSize = table.size();
+
+    uint64 offset = alignUp(sizeof(header) + table.size());
+    uint64 tablePosition = sizeof(uint32) + mKey.size();
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        tablePosition += sizeof(uint32) + it->first.size();
+        memcpy(&table[tablePosition], &offset, sizeof(offset));
+        tablePosition += sizeof(uint64) * 2;
+        offset = alignUp(offset + it->second.size);
+    }
+
+    // written aside and renamed over the old file, so readers(and our own
+    // mapping) never see a half written cache
+    std::stringstream ss;
+    ss << mPath << ".tmp" << getpid();
+    const std::string tmpPath = ss.str();
+    std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+        ALOGE("Cannot open %s", tmpPath.c_str());
+        return MAI_FAILED;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(table.data(), table.size());
+    uint64 position = sizeof(header) + table.size();
+    const std::string padding(kConstantCacheAlignment, '\0');
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        out.write(padding.data(), alignUp(position) - position);
+        position = alignUp(position);
+        out.write(reinterpret_cast<const char*>(it->second.data), it->second.size);
+        position += it->second.size;
+    }
+    out.close();
+    if (!out || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        ALOGE("Cannot write %s", mPath.c_str());
+        remove(tmpPath.c_str());
+        return MAI_FAILED;
+    }
+    mDirty = false;
+    return MAI_SUCCESS;
+}
+
+} // namespace MAI
@@ -0,0 +1,93 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "include/Type.h"
+
+namespace MAI {
+
+// Sidecar file of constants derived from a model at init time(the optimized
+// graph, weights packed for a kernel...), so later starts map them back
+// instead of deriving them again.
+//
+// A cache belongs to one key: the content of the model, the engine version
+// and the features of the CPU(see makeKey()). A file with another key is
+// ignored and replaced by the next save(), so a changed model, a new engine
+// or another CPU never sees stale constants.
+//
+// Entries are named blobs, 64-byte aligned in the file. find() returns a
+// 64-byte aligned pointer into the mapped file(a private mapping, writes are
+// not saved), it stays valid as long as the cache, as do entries put() in
+// memory. Thread safe.
+//
+// A cache with an empty key lives in memory only, it is never saved. The
+// network creates one if none is set, so its sessions share the derived
+// constants instead of deriving them again.
+//
+// Bump kConstantCacheVersion when the layout of an entry changes.
+const uint32 kConstantCacheVersion = 1;
+const char* const kMaiVersion = "0.1.0";
+
+class ConstantCache {
+public:
+    ConstantCache(const std::string& path, const std::string& key);
+    ~ConstantCache();
+
+    // Hash of the content of the model with the engine version and the CPU
+    // features, empty if the model cannot be read.
+    static std::string makeKey(const std::string& modelPath);
+
+    // Maps the file, true if it holds the entries of the key of this cache.
+    bool load();
+    inline bool isLoaded() const {
+        return mMapping != NULL;
+    }
+
+    // NULL if there is no entry called name.
+    uint8* find(const std::string& name, uint64* size = NULL);
+    // Adds an entry called name with a copy of data. An existing entry
+    // is kept as it is, the first one put or loaded wins.
+    void put(const std::string& name, const void* data, uint64 size);
+
+    // Whether entries were put after the last save(), always false for a
+    // cache in memory.
+    bool isDirty();
+    // Writes all entries to the file. The new file replaces the old one in
+    // one step, entries found before stay valid.
+    MAI_STATUS save();
+
+private:
+    struct Entry {
+        uint8* data;
+        uint64 size;
+    };
+
+private:
+    std::string mPath;
+    std::string mKey;
+    std::mutex mMutex;
+    std::map<std::string, Entry> mEntries;
+    // entries put since the last save(), entries points into them
+    std::map<std::string, std::string> mPendingEntries;
+    uint8* mMapping;
+    uint64 mMappingSize;
+    bool mDirty;
+};
+
+} // namespace MAI
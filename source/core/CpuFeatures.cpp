@@ -0,0 +1,105 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#include "core/CpuFeatures.h"
+
+namespace MAI {
+
+namespace {
+
+#if defined(__x86_64__) || defined(__i386__)
+// cpuid leaf 1
+const uint32 kEcxSse42 = 1u << 20;
+const uint32 kEcxFma = 1u << 12;
+const uint32 kEcxOsxsave = 1u << 27;
+const uint32 kEcxAvx = 1u << 28;
+// cpuid leaf 7, subleaf 0
+const uint32 kEbxAvx2 = 1u << 5;
+const uint32 kEbxAvx512f = 1u << 16;
+const uint32 kEbxAvx512bw = 1u << 30;
+const uint32 kEcxAvx512Vnni = 1u << 11;
+// XCR0
+const uint64 kXcr0Ymm = 0x6;// sse + avx state
+const uint64 kXcr0Zmm = 0xe6;// + opmask, zmm0-15 upper, zmm16-31
+
+uint64 xgetbv0() {
+    uint32 eax = 0;
+    uint32 edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64>(edx) << 32) | eax;
+}
+#endif
+
+uint32 detectCpuFeatures() {
+    uint32 features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    uint32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+        return features;
+    }
+    if (ecx & kEcxSse42) {
+        features |= CPU_FEATURE_SSE4_2;
+    }
+    const uint64 xcr0 = (ecx & kEcxOsxsave) ? xgetbv0() : 0;
+    const bool ymm = (xcr0 & kXcr0Ymm) == kXcr0Ymm;
+    const bool zmm = (xcr0 & kXcr0Zmm) == kXcr0Zmm;
+    if (ymm && (ecx & kEcxAvx)) {
+        features |= CPU_FEATURE_AVX;
+    }
+    if (ymm && (ecx & kEcxFma)) {
+        features |= CPU_FEATURE_FMA;
+    }
+    if (__get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ymm && (ebx & kEbxAvx2)) {
+            features |= CPU_FEATURE_AVX2;
+        }
+        if (zmm && (ebx & kEbxAvx512f)) {
+            features |= CPU_FEATURE_AVX512F;
+            if (ebx & kEbxAvx512bw) {
+                features |= CPU_FEATURE_AVX512BW;
+            }
+            if (ecx & kEcxAvx512Vnni) {
+                features |= CPU_FEATURE_AVX512_VNNI;
+            }
+        }
+    }
+#elif defined(MAI_NEON_ENABLED) || defined(__aarch64__)
+    features |= CPU_FEATURE_NEON;
+#endif
+    return features;
+}
+
+std::atomic<uint32> gCpuFeatureMask(~0u);
+
+} // namespace
+
+uint32 cpuFeatures() {
+    static const uint32 detected = detectCpuFeatures();
+    return detected & gCpuFeatureMask.load(std::memory_order_relaxed);
+}
+
+bool cpuSupports(uint32 features) {
+    return (cpuFeatures() & features) == features;
+}
+
+void setCpuFeatureMask(uint32 mask) {
+    gCpuFeatureMask.store(mask, std::memory_order_relaxed);
+}
+
+} // namespace MAI
@@ -0,0 +1,34 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "include/Type.h"
+
+namespace MAI {
+
+// CpuFeature bits of the running CPU: cpuid on x86, with the AVX/AVX-512
+// ones only if the OS saves the ymm/zmm state, NEON if it is compiled in.
+// Detected once, then restricted by setCpuFeatureMask().
+uint32 cpuFeatures();
+
+// Whether the running CPU has all of features.
+bool cpuSupports(uint32 features);
+
+// Hides the features not in mask from cpuFeatures(), e.g. to run the
+// kernels of an older CPU. ~0u shows all of them again. Operators created
+// before keep the kernels they were created with.
+void setCpuFeatureMask(uint32 mask);
+
+} // namespace MAI
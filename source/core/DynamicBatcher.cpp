@@ -0,0 +1,264 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string.h>
+#include "include/DynamicBatcher.h"
+#include "MPMCQueue.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+
+DynamicBatcher::DynamicBatcher(const std::vector<NeuralNetwork*>& networks, const Options& options)
+    : mOptions(options),
+      mQueue(new MPMCQueue<Request*>(options.queueCapacity)),
+      mQueuedRequests(0),
+      mSleepingDispatchers(0),
+      mStop(false),
+      mBatchRunMicros(0),
+      mRequestCount(0),
+      mBatchCount(0),
+      mTotalQueueDelayMicros(0),
+      mMaxQueueDelayMicros(0) {
+    MAI_CHECK(!networks.empty(), "DynamicBatcher needs at least one network");
+    MAI_CHECK(options.maxBatchSize > 0, "Invalid max batch size:%d", options.maxBatchSize);
+    mBatchSizes = options.batchSizes;
+    if (mBatchSizes.empty()) {
+        for (int32 size = 1; size < options.maxBatchSize; size *= 2) {
+            mBatchSizes.push_back(size);
+        }
+        mBatchSizes.push_back(options.maxBatchSize);
+    }
+    std::sort(mBatchSizes.begin(), mBatchSizes.end());
+    MAI_CHECK(mBatchSizes.front() > 0, "Invalid batch size:%d", mBatchSizes.front());
+    MAI_CHECK(mBatchSizes.back() >= options.maxBatchSize,
+            "Largest batch size:%d is smaller than max batch size:%d",
+            mBatchSizes.back(), options.maxBatchSize);
+    mModelInputs = networks[0]->getModelInputs();
+    mModelOutputs = networks[0]->getModelOutputs();
+    MAI_CHECK(!mModelInputs.empty() && !mModelOutputs.empty(), "Model inputs and outputs must be set");
+    for (NeuralNetwork* network : networks) {
+        for (const std::string& name : mModelInputs) {
+            Tensor* tensor = network->getTensor(name);
+            MAI_CHECK(tensor != NULL && tensor->dimSize() > 0 && tensor->dim(0) > 0,
+                    "Model input(%s) has no shape", name.c_str());
+            if (network == networks[0]) {
+                mInputSampleSizes.push_back(tensor->size() / tensor->dim(0));
+                mInputShapes.push_back(tensor->shape());
+            }
+        }
+    }
+    for (NeuralNetwork* network : networks) {
+        mDispatchers.emplace_back(&DynamicBatcher::dispatchLoop, this, network);
+    }
+}
+
+DynamicBatcher::~DynamicBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    for (std::thread& dispatcher : mDispatchers) {
+        dispatcher.join();
+    }
+}
+
+uint64 DynamicBatcher::nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::future<DynamicBatcher::Outputs> DynamicBatcher::submit(const std::vector<const void*>& inputs) {
+    MAI_CHECK(inputs.size() == mModelInputs.size(), "Request has %d inputs but model has %d",
+            static_cast<int32>(inputs.size()), static_cast<int32>(mModelInputs.size()));
+    Request* request = new Request();
+    request->inputs.resize(inputs.size());
+    for (int32 i = 0; i < static_cast<int32>(inputs.size()); ++i) {
+        const uint8* data = reinterpret_cast<const uint8*>(inputs[i]);
+        request->inputs[i].assign(data, data + mInputSampleSizes[i]);
+    }
+    std::future<Outputs> future = request->promise.get_future();
+    request->enqueueMicros = nowMicros();
+    if (!mQueue->push(request)) {
+        // the dispatchers fall behind, the caller decides whether to retry
+        request->promise.set_exception(std::make_exception_ptr(
+                    std::runtime_error("DynamicBatcher: queue full")));
+        delete request;
+        return future;
+    }
+    mQueuedRequests.fetch_add(1);
+    if (mSleepingDispatchers.load() > 0) {
+        // pairs with the predicate check of waitForRequest, no wakeup is lost
+        { std::lock_guard<std::mutex> lock(mMutex); }
+        mCondition.notify_one();
+    }
+    return future;
+}
+
+bool DynamicBatcher::waitForRequest(uint64 deadlineMicros) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mSleepingDispatchers.fetch_add(1);
+    auto ready = [this]() {return mQueuedRequests.load() > 0 || mStop.load();};
+    if (deadlineMicros == 0) {
+        mCondition.wait(lock, ready);
+    } else {
+        uint64 now = nowMicros();
+        if (deadlineMicros > now) {
+            mCondition.wait_for(lock, std::chrono::microseconds(deadlineMicros - now), ready);
+        }
+    }
+    mSleepingDispatchers.fetch_sub(1);
+    return mQueuedRequests.load() > 0;
+}
+
+bool DynamicBatcher::collectBatch(std::vector<Request*>& batch) {
+    Request* request = NULL;
+    while (!mQueue->pop(request)) {
+        if (!waitForRequest(0) && mStop.load()) {
+            return false;
+        }
+    }
+    mQueuedRequests.fetch_sub(1);
+    batch.push_back(request);
+
+    uint64 waitMicros = static_cast<uint64>(mOptions.maxWaitMicros);
+    if (mOptions.latencyBudgetMicros > 0) {
+        uint64 budget = static_cast<uint64>(mOptions.latencyBudgetMicros);
+        uint64 runMicros = mBatchRunMicros.load();
+        waitMicros = std::min(waitMicros, budget > runMicros ? budget - runMicros : 0);
+    }
+    const uint64 deadline = request->enqueueMicros + waitMicros;
+    while (static_cast<int32>(batch.size()) < mOptions.maxBatchSize) {
+        if (mQueue->pop(request)) {
+            mQueuedRequests.fetch_sub(1);
+            batch.push_back(request);
+            continue;
+        }
+        if (mStop.load() || nowMicros() >= deadline) {
+            break;
+        }
+        waitForRequest(deadline);
+    }
+    return true;
+}
+
+int32 DynamicBatcher::paddedBatchSize(int32 batchSize) const {
+    return *std::lower_bound(mBatchSizes.begin(), mBatchSizes.end(), batchSize);
+}
+
+void DynamicBatcher::failBatch(std::vector<Request*>& batch, const char* reason) {
+    ALOGE("%s, batch of %d requests failed", reason, static_cast<int32>(batch.size()));
+    std::exception_ptr error = std::make_exception_ptr(
+            std::runtime_error(std::string("DynamicBatcher: ") + reason));
+    for (Request* request : batch) {
+        request->promise.set_exception(error);
+        delete request;
+    }
+}
+
+void DynamicBatcher::runBatch(NeuralNetwork* network, std::vector<Request*>& batch) {
+    const int32 batchSize = static_cast<int32>(batch.size());
+    const shape_t paddedSize = static_cast<shape_t>(paddedBatchSize(batchSize));
+    if (network->getTensor(mModelInputs[0])->dim(0) != paddedSize) {
+        std::map<std::string, std::vector<shape_t> > inputShapes;
+        for (int32 i = 0; i < static_cast<int32>(mModelInputs.size()); ++i) {
+            std::vector<shape_t> shape = mInputShapes[i];
+            shape[0] = paddedSize;
+            inputShapes[mModelInputs[i]] = shape;
+        }
+        if (network->resizeInputs(inputShapes) != MAI_SUCCESS) {
+            failBatch(batch, "resizing the model inputs failed");
+            return;
+        }
+    }
+    for (int32 i = 0; i < static_cast<int32>(mModelInputs.size()); ++i) {
+        Tensor* tensor = network->getTensor(mModelInputs[i]);
+        uint8* data = tensor->mutableData<uint8>();
+        const uint64 sampleSize = mInputSampleSizes[i];
+        for (int32 b = 0; b < batchSize; ++b) {
+            memcpy(data + b * sampleSize, batch[b]->inputs[i].data(), sampleSize);
+        }
+        memset(data + batchSize * sampleSize, 0, tensor->size() - batchSize * sampleSize);
+    }
+
+    const uint64 beginMicros = nowMicros();
+    const MAI_STATUS status = network->run();
+    const uint64 runMicros = nowMicros() - beginMicros;
+    if (status != MAI_SUCCESS) {
+        failBatch(batch, "running the batch failed");
+        return;
+    }
+    uint64 averageMicros = mBatchRunMicros.load();
+    mBatchRunMicros.store(averageMicros == 0 ? runMicros : (averageMicros * 7 + runMicros) / 8);
+
+    std::vector<Outputs> outputs(batchSize, Outputs(mModelOutputs.size()));
+    for (int32 i = 0; i < static_cast<int32>(mModelOutputs.size()); ++i) {
+        Tensor* tensor = network->getTensor(mModelOutputs[i]);
+        if (tensor->dimSize() == 0 || tensor->dim(0) < batchSize) {
+            ALOGE("Dim 0 of model output(%s) is smaller than batch size:%d",
+                    mModelOutputs[i].c_str(), batchSize);
+            failBatch(batch, "a model output does not follow the batch dimension");
+            return;
+        }
+        const uint8* data = tensor->data<uint8>();
+        const uint64 sampleSize = tensor->size() / tensor->dim(0);
+        for (int32 b = 0; b < batchSize; ++b) {
+            outputs[b][i].assign(data + b * sampleSize, data + (b + 1) * sampleSize);
+        }
+    }
+
+    for (int32 b = 0; b < batchSize; ++b) {
+        const uint64 delay = beginMicros > batch[b]->enqueueMicros ? beginMicros - batch[b]->enqueueMicros : 0;
+        mTotalQueueDelayMicros.fetch_add(delay);
+        uint64 maxDelay = mMaxQueueDelayMicros.load();
+        while (delay > maxDelay && !mMaxQueueDelayMicros.compare_exchange_weak(maxDelay, delay)) {
+        }
+    }
+    mRequestCount.fetch_add(batchSize);
+    mBatchCount.fetch_add(1);
+    for (int32 b = 0; b < batchSize; ++b) {
+        batch[b]->promise.set_value(std::move(outputs[b]));
+        delete batch[b];
+    }
+}
+
+void DynamicBatcher::dispatchLoop(NeuralNetwork* network) {
+    std::vector<Request*> batch;
+    batch.reserve(mOptions.maxBatchSize);
+    for (;;) {
+        batch.clear();
+        if (!collectBatch(batch)) {
+            return;
+        }
+        runBatch(network, batch);
+    }
+}
+
+DynamicBatcher::Stats DynamicBatcher::stats() const {
+    Stats stats;
+    stats.requests = mRequestCount.load();
+    stats.batches = mBatchCount.load();
+    stats.averageBatchSize = stats.batches == 0 ? 0.
+        : static_cast<double>(stats.requests) / stats.batches;
+    stats.averageQueueDelayMicros = stats.requests == 0 ? 0.
+        : static_cast<double>(mTotalQueueDelayMicros.load()) / stats.requests;
+    stats.maxQueueDelayMicros = mMaxQueueDelayMicros.load();
+    return stats;
+}
+
+} // namespace MAI
@@ -0,0 +1,65 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include "Graph.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+
+void Graph::reset(int32 nodeSize) {
+    mSuccessors.assign(nodeSize, std::vector<int32>());
+    mInDegrees.assign(nodeSize, 0);
+    mRoots.clear();
+    mReachable.clear();
+}
+
+void Graph::addEdge(int32 from, int32 to) {
+    MAI_CHECK(from >= 0 && from < to && to < size(), "Invalid edge:%d -> %d", from, to);
+    mSuccessors[from].push_back(to);
+}
+
+void Graph::finalize() {
+    const int32 nodeSize = size();
+    for (int32 i = 0; i < nodeSize; ++i) {
+        std::vector<int32>& successors = mSuccessors[i];
+        std::sort(successors.begin(), successors.end());
+        successors.erase(std::unique(successors.begin(), successors.end()), successors.end());
+        for (int32 successor : successors) {
+            ++mInDegrees[successor];
+        }
+    }
+    for (int32 i = 0; i < nodeSize; ++i) {
+        if (mInDegrees[i] == 0) {
+            mRoots.push_back(i);
+        }
+    }
+
+    // edges only go forward, so every successor is finished before its predecessors here
+    mReachable.assign(nodeSize, std::vector<bool>(nodeSize, false));
+    for (int32 i = nodeSize - 1; i >= 0; --i) {
+        std::vector<bool>& reachable = mReachable[i];
+        for (int32 successor : mSuccessors[i]) {
+            reachable[successor] = true;
+            const std::vector<bool>& transitive = mReachable[successor];
+            for (int32 j = successor + 1; j < nodeSize; ++j) {
+                if (transitive[j]) {
+                    reachable[j] = true;
+                }
+            }
+        }
+    }
+}
+
+} // namespace MAI
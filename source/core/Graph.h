@@ -0,0 +1,65 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+
+// Dependency DAG of operators, a node is the index of an operator in the
+// network. Edges must point from an earlier operator to a later one, so the
+// insertion order of the network is always a valid topological order.
+class Graph {
+public:
+    Graph() = default;
+    ~Graph() = default;
+
+    void reset(int32 nodeSize);
+    void addEdge(int32 from, int32 to);
+    // Removes duplicated edges and computes the reachability of all nodes,
+    // must be called after the last addEdge().
+    void finalize();
+
+    inline int32 size() const {
+        return static_cast<int32>(mSuccessors.size());
+    }
+
+    inline const std::vector<int32>& successors(int32 node) const {
+        return mSuccessors[node];
+    }
+
+    // Number of distinct predecessors of node.
+    inline int32 inDegree(int32 node) const {
+        return mInDegrees[node];
+    }
+
+    inline const std::vector<int32>& roots() const {
+        return mRoots;
+    }
+
+    // Whether node a must have finished before node b starts.
+    inline bool happensBefore(int32 a, int32 b) const {
+        return mReachable[a][b];
+    }
+
+private:
+    std::vector<std::vector<int32> > mSuccessors;
+    std::vector<int32> mInDegrees;
+    std::vector<int32> mRoots;
+    std::vector<std::vector<bool> > mReachable;
+};
+
+} // namespace MAI
@@ -0,0 +1,110 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "include/Type.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+
+// Bounded lock-free multi-producer multi-consumer queue(D. Vyukov's
+// algorithm). Every cell carries a sequence number which tells producers and
+// consumers whether the cell is free for the lap they are in, so push/pop
+// only need one CAS on the shared position.
+template<typename T>
+class MPMCQueue {
+public:
+    // capacity must be a power of 2
+    MPMCQueue(uint32 capacity) : mCells(new Cell[capacity]), mMask(capacity - 1),
+        mEnqueuePos(0), mDequeuePos(0) {
+        MAI_CHECK(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+                "Capacity(%d) must be a power of 2", capacity);
+        for (uint32 i = 0; i < capacity; ++i) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // Returns false if the queue is full.
+    bool push(const T& value) {
+        Cell* cell;
+        uint64 pos = mEnqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &mCells[pos & mMask];
+            uint64 sequence = cell->sequence.load(std::memory_order_acquire);
+            int64 diff = static_cast<int64>(sequence) - static_cast<int64>(pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty.
+    bool pop(T& value) {
+        Cell* cell;
+        uint64 pos = mDequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &mCells[pos & mMask];
+            uint64 sequence = cell->sequence.load(std::memory_order_acquire);
+            int64 diff = static_cast<int64>(sequence) - static_cast<int64>(pos + 1);
+            if (diff == 0) {
+                if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->value;
+        cell->sequence.store(pos + mMask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr int32 kCacheLineSize = 64;
+
+    struct Cell {
+        std::atomic<uint64> sequence;
+        T value;
+    };
+
+    // The positions are a cache line apart from each other and from the
+    // read-only fields. Padded instead of alignas, so a plain new works
+    // without over-aligned allocation(C++11).
+    std::unique_ptr<Cell[]> mCells;
+    const uint64 mMask;
+    char mPadding0[kCacheLineSize];
+    std::atomic<uint64> mEnqueuePos;
+    char mPadding1[kCacheLineSize - sizeof(std::atomic<uint64>)];
+    std::atomic<uint64> mDequeuePos;
+    char mPadding2[kCacheLineSize - sizeof(std::atomic<uint64>)];
+};
+
+} // namespace MAI
@@ -0,0 +1,625 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include "MaiModel.h"
+#include "include/Device.h"
+#include "source/core/OperatorRegister.h"
+#include "source/util/MAIUtil.h"
+
+namespace MAI {
+
+namespace {
+
+const char kMaiModelMagic[8] = {'M', 'A', 'I', 'M', 'O', 'D', 'E', 'L'};
+
+struct MaiModelHeader {
+    char magic[8];
+    uint32 version;
+    uint32 reserved;
+    uint64 graphOffset;
+    uint64 graphSize;
+    uint64 weightsOffset;
+    uint64 weightsSize;
+    uint8 padding[16];
+};
+
+static_assert(sizeof(MaiModelHeader) == kMaiModelAlignment, "Header must keep the sections aligned");
+
+inline uint64 alignUp(uint64 value) {
+    return (value + kMaiModelAlignment - 1) / kMaiModelAlignment * kMaiModelAlignment;
+}
+
+class GraphWriter : public ParamArchive {
+public:
+    template<typename T>
+    void put(T value) {
+        mBytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const std::string& value) {
+        put<uint32>(value.size());
+        mBytes.append(value);
+    }
+
+    void putStrings(const std::vector<std::string>& values) {
+        put<uint32>(values.size());
+        for (const std::string& value : values) {
+            putString(value);
+        }
+    }
+
+    void putShape(const std::vector<shape_t>& shape) {
+        put<uint32>(shape.size());
+        for (shape_t dim : shape) {
+            put<int64>(dim);
+        }
+    }
+
+    void io(int32& value) override {
+        put<int32>(value);
+    }
+
+    void io(float& value) override {
+        put<float>(value);
+    }
+
+    void io(bool& value) override {
+        put<uint8>(value ? 1 : 0);
+    }
+
+    void io(std::vector<int32>& values) override {
+        put<uint32>(values.size());
+        for (int32 value : values) {
+            put<int32>(value);
+        }
+    }
+
+    inline const std::string& bytes() const {
+        return mBytes;
+    }
+
+private:
+    std::string mBytes;
+};
+
+// Reads past the end of the graph section return zeros and mark the reader
+// failed, callers check ok() once they are done.
+class GraphReader : public ParamArchive {
+public:
+    GraphReader(const uint8* data, uint64 size)
+        : mCurrent(data), mEnd(data + size), mFailed(false) {}
+
+    template<typename T>
+    T get() {
+        T value = T();
+        if (!has(sizeof(T))) {
+            return value;
+        }
+        memcpy(&value, mCurrent, sizeof(T));
+        mCurrent += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32 size = get<uint32>();
+        if (!has(size)) {
+            return "";
+        }
+        std::string value(reinterpret_cast<const char*>(mCurrent), size);
+        mCurrent += size;
+        return value;
+    }
+
+    std::vector<std::string> getStrings() {
+        std::vector<std::string> values;
+        uint32 count = get<uint32>();
+        for (uint32 i = 0; i < count && ok(); ++i) {
+            values.emplace_back(getString());
+        }
+        return values;
+    }
+
+    std::vector<shape_t> getShape() {
+        std::vector<shape_t> shape;
+        uint32 rank = get<uint32>();
+        if (!has(static_cast<uint64>(rank) * sizeof(int64))) {
+            return shape;
+        }
+        for (uint32 i = 0; i < rank; ++i) {
+            shape.push_back(get<int64>());
+        }
+        return shape;
+    }
+
+    void io(int32& value) override {
+        value = get<int32>();
+    }
+
+    void io(float& value) override {
+        value = get<float>();
+    }
+
+    void io(bool& value) override {
+        value = get<uint8>() != 0;
+    }
+
+    void io(std::vector<int32>& values) override {
+        uint32 count = get<uint32>();
+        values.clear();
+        if (!has(static_cast<uint64>(count) * sizeof(int32))) {
+            return;
+        }
+        for (uint32 i = 0; i < count; ++i) {
+            values.push_back(get<int32>());
+        }
+    }
+
+    // uint32 size and the bytes, NULL if truncated
+    const uint8* getBlob(uint32& size) {
+        size = get<uint32>();
+        if (!has(size)) {
+            size = 0;
+            return NULL;
+        }
+        const uint8* blob = mCurrent;
+        mCurrent += size;
+        return blob;
+    }
+
+    inline bool ok() const {
+        return !mFailed;
+    }
+
+    inline bool atEnd() const {
+        return mCurrent == mEnd;
+    }
+
+private:
+    bool has(uint64 size) {
+        if (mFailed || size > static_cast<uint64>(mEnd - mCurrent)) {
+            mFailed = true;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const uint8* mCurrent;
+    const uint8* mEnd;
+    bool mFailed;
+};
+
+// Fields past the end of a param were appended after the model was written,
+// they keep their defaults.
+class ParamReader : public GraphReader {
+public:
+    ParamReader(const uint8* data, uint64 size) : GraphReader(data, size) {}
+
+    void io(int32& value) override {
+        if (!atEnd()) {
+            GraphReader::io(value);
+        }
+    }
+
+    void io(float& value) override {
+        if (!atEnd()) {
+            GraphReader::io(value);
+        }
+    }
+
+    void io(bool& value) override {
+        if (!atEnd()) {
+            GraphReader::io(value);
+        }
+    }
+
+    void io(std::vector<int32>& values) override {
+        if (!atEnd()) {
+            GraphReader::io(values);
+        }
+    }
+};
+
+// Enums read from the file are checked before they reach code which
+// assumes a known value(e.g. getSizeFromDataType)
+inline bool isValidDataType(int32 value) {
+    DataType dataType = static_cast<DataType>(value);
+    return dataType == DT_INVALID || getNameFromDataType(dataType) != "DT_INVALID";
+}
+
+inline bool isValidDataFormat(int32 value) {
+    return value >= NHWC && value <= IOHW;
+}
+
+inline bool isValidDeviceType(int32 value) {
+    return value >= DEVICE_CPU && value <= DEVICE_NPU;
+}
+
+#undef DEFINE_OP_NAME
+#undef DEFINE_OP_NAME_INDEX
+#define DEFINE_OP_NAME(name) name,
+#define DEFINE_OP_NAME_INDEX(name, index) name,
+
+const MAIOperator kOperatorTypes[] = {
+    #include "include/OperatorType.def"
+};
+
+#undef DEFINE_OP_NAME
+#undef DEFINE_OP_NAME_INDEX
+
+// Checked before the cast, out-of-range values are not MAIOperator values
+inline bool isValidOperatorType(int32 value) {
+    for (MAIOperator opType : kOperatorTypes) {
+        if (opType != INVALID && static_cast<int32>(opType) == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/*static*/
+MAI_STATUS MaiModelWriter::write(NeuralNetwork* network, std::string& bytes) {
+    std::vector<std::string> modelInputs = network->getModelInputs();
+    std::vector<Operator*> operators = network->getOperators();
+    std::vector<std::string> modelOutputs = network->getModelOutputs();
+    std::set<std::string> producedTensors;
+    std::set<std::string> usedTensors(modelOutputs.begin(), modelOutputs.end());
+    for (Operator* op : operators) {
+        producedTensors.insert(op->outputNames().begin(), op->outputNames().end());
+        usedTensors.insert(op->outputNames().begin(), op->outputNames().end());
+        usedTensors.insert(op->inputNames().begin(), op->inputNames().end());
+    }
+
+    // Model inputs are created by addModelInput() when loading, tensors no
+    // operator uses(e.g. left behind by optimizers) are dropped
+    std::vector<Tensor*> tensors;
+    for (const std::string& name : network->getTensorNames()) {
+        Tensor* tensor = network->getTensor(name);
+        if (tensor != NULL && usedTensors.find(name) != usedTensors.end()
+                && std::find(modelInputs.begin(), modelInputs.end(), name) == modelInputs.end()) {
+            tensors.push_back(tensor);
+        }
+    }
+
+    GraphWriter graph;
+    std::string weights;
+    graph.put<uint32>(tensors.size());
+    for (Tensor* tensor : tensors) {
+        // activations are derived again at run time, only weights are stored
+        bool hasData = tensor->data<uint8>() != NULL
+            && (tensor->isConst() || producedTensors.find(tensor->name()) == producedTensors.end());
+        graph.putString(tensor->name());
+        graph.put<int32>(tensor->dataType());
+        graph.put<int32>(tensor->getDataFormat());
+        graph.put<uint8>(tensor->isConst() ? 1 : 0);
+        graph.put<uint8>(hasData ? 1 : 0);
+        if (hasData) {
+            weights.resize(alignUp(weights.size()), '\0');
+            graph.putShape(tensor->shape());
+            graph.put<uint64>(weights.size());
+            graph.put<uint64>(tensor->size());
+            weights.append(tensor->data<char>(), tensor->size());
+        }
+    }
+
+    graph.put<uint32>(modelInputs.size());
+    for (const std::string& name : modelInputs) {
+        Tensor* tensor = network->getTensor(name);
+        MAI_CHECK_NULL(tensor);
+        graph.putString(name);
+        graph.put<int32>(tensor->dataType());
+        graph.put<int32>(tensor->getDataFormat());
+        graph.putShape(tensor->shape());
+    }
+
+    graph.putStrings(modelOutputs);
+
+    graph.put<uint32>(operators.size());
+    for (Operator* op : operators) {
+        const OpContext& opContext = op->opContext();
+        graph.put<int32>(opContext.opType);
+        graph.put<int32>(opContext.dataType);
+        graph.put<int32>(opContext.deviceType);
+        graph.putString(opContext.extraInfo);
+        graph.putString(op->name());
+        graph.putStrings(op->inputNames());
+        graph.putStrings(op->outputNames());
+        const Param* param = op->paramPrototype();
+        graph.put<uint8>(param != NULL ? 1 : 0);
+        if (param != NULL) {
+            std::unique_ptr<Param> typeCheck(MaiModelParser::createParam(opContext.opType));
+            if (!typeCheck) {
+                ALOGE("Param of %s cannot be serialized", getNameFromOperator(opContext.opType).c_str());
+                return MAI_FAILED;
+            }
+            std::unique_ptr<Param> copy(param->clone());
+            GraphWriter paramWriter;
+            copy->serialize(paramWriter);
+            graph.putString(paramWriter.bytes());
+        }
+    }
+
+    MaiModelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMaiModelMagic, sizeof(header.magic));
+    header.version = kMaiModelVersion;
+    header.graphOffset = sizeof(header);
+    header.graphSize = graph.bytes().size();
+    header.weightsOffset = alignUp(header.graphOffset + header.graphSize);
+    header.weightsSize = weights.size();
+
+    std::string padding(header.weightsOffset - header.graphOffset - header.graphSize, '\0');
+    bytes.clear();
+    bytes.reserve(header.weightsOffset + header.weightsSize);
+    bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes.append(graph.bytes());
+    bytes.append(padding);
+    bytes.append(weights);
+    return MAI_SUCCESS;
+}
+
+/*static*/
+MAI_STATUS MaiModelWriter::write(NeuralNetwork* network, const std::string& path) {
+    std::string bytes;
+    if (write(network, bytes) != MAI_SUCCESS) {
+        return MAI_FAILED;
+    }
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+        ALOGE("Cannot open %s", path.c_str());
+        return MAI_FAILED;
+    }
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if (!out) {
+        ALOGE("Cannot write %s", path.c_str());
+        return MAI_FAILED;
+    }
+    return MAI_SUCCESS;
+}
+
+MaiModelParser::MaiModelParser(NeuralNetwork* network) : mNetwork(network) {
+}
+
+/*static*/
+Param* MaiModelParser::createParam(MAIOperator opType) {
+    switch (opType) {
+    case OP_ARG_MAX:
+        return new ArgMaxParam();
+    case ARG_MIN:
+        return new ArgMinParam();
+    case CONCAT:
+        return new ConcatParam();
+    case CONV2D:
+        return new Conv2DParam();
+    case DEPTHWISE_CONV2D:
+        return new DepthwiseConv2dParam();
+    case EXPAND_DIMS:
+        return new ExpandDimsParam();
+    case FUSED_BATCH_NORM:
+        return new FusedBatchNormParam();
+    case GATHER:
+        return new GatherParam();
+    case GEMM:
+        return new GemmParam();
+    case LEAKY_RELU:
+        return new LeakyReluParam();
+    case PACK:
+        return new PackParam();
+    case PAD:
+        return new PadParam();
+    case AVG_POOL:
+    case GLOBAL_AVG_POOL:
+    case MAX_POOL:
+        return new PoolParam();
+    case ALL:
+    case ANY:
+    case SUM:
+        return new ReduceParam();
+    case SOFTMAX:
+    case LOG_SOFTMAX:
+        return new SoftmaxParam();
+    case SPLIT:
+        return new SplitParam();
+    case SQUEEZE:
+        return new SqueezeParam();
+    case STRIDED_SLICE:
+        return new StridedSliceParam();
+    case TRANSPOSE_CONV2D:
+        return new TransposeConv2dParam();
+    default:
+        return NULL;
+    }
+}
+
+MAI_STATUS MaiModelParser::parse(const std::string& path) {
+    uint64 fileSize = 0;
+    uint8* data = mapFile<uint8>(path, fileSize);
+    if (data == NULL) {
+        ALOGE("Cannot map %s", path.c_str());
+        return MAI_FAILED;
+    }
+    // tensors point into the mapping, it lives as long as the network
+    std::shared_ptr<void> mapping(data, [fileSize](void* ptr) {unmapFile(ptr, fileSize);});
+    mNetwork->holdResource(mapping);
+    if (parse(data, fileSize) != MAI_SUCCESS) {
+        ALOGE("Cannot load %s", path.c_str());
+        return MAI_FAILED;
+    }
+    return MAI_SUCCESS;
+}
+
+MAI_STATUS MaiModelParser::parse(uint8* data, uint64 size) {
+    MAI_CHECK(mNetwork->getDevice() != NULL, "Device of the network cannot be null");
+    MaiModelHeader header;
+    if (size < sizeof(header)) {
+        ALOGE("Not a MAI model");
+        return MAI_FAILED;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kMaiModelMagic, sizeof(header.magic)) != 0) {
+        ALOGE("Not a MAI model");
+        return MAI_FAILED;
+    }
+    if (header.version > kMaiModelVersion) {
+        ALOGE("Model version %u is newer than %u", header.version, kMaiModelVersion);
+        return MAI_FAILED;
+    }
+    if (header.version < kMaiModelMinVersion) {
+        ALOGE("Model version %u is no longer supported, convert the model again", header.version);
+        return MAI_FAILED;
+    }
+    if (header.graphOffset > size || header.graphSize > size - header.graphOffset
+            || header.weightsOffset > size || header.weightsSize > size - header.weightsOffset
+            || header.weightsOffset % kMaiModelAlignment != 0
+            || reinterpret_cast<uintptr_t>(data) % kMaiModelAlignment != 0) {
+        ALOGE("Model is truncated or corrupted");
+        return MAI_FAILED;
+    }
+
+    uint8* weights = data + header.weightsOffset;
+    Allocator* allocator = mNetwork->getDevice()->allocator();
+    GraphReader reader(data + header.graphOffset, header.graphSize);
+    uint32 tensorCount = reader.get<uint32>();
+    for (uint32 i = 0; i < tensorCount && reader.ok(); ++i) {
+        std::string name = reader.getString();
+        int32 dataTypeValue = reader.get<int32>();
+        int32 dataFormatValue = reader.get<int32>();
+        bool isConst = reader.get<uint8>() != 0;
+        bool hasData = reader.get<uint8>() != 0;
+        if (!reader.ok()) {
+            break;
+        }
+        if (!isValidDataType(dataTypeValue) || !isValidDataFormat(dataFormatValue)
+                || (hasData && getSizeFromDataType(static_cast<DataType>(dataTypeValue)) <= 0)) {
+            ALOGE("Tensor %s has an invalid data type(%d) or format(%d)",
+                    name.c_str(), dataTypeValue, dataFormatValue);
+            return MAI_FAILED;
+        }
+        DataType dataType = static_cast<DataType>(dataTypeValue);
+        DataFormat dataFormat = static_cast<DataFormat>(dataFormatValue);
+        std::unique_ptr<Tensor> tensor(new Tensor(dataType, allocator));
+        tensor->setName(name);
+        tensor->setDataFormat(dataFormat);
+        if (hasData) {
+            std::vector<shape_t> shape = reader.getShape();
+            uint64 offset = reader.get<uint64>();
+            uint64 size = reader.get<uint64>();
+            uint64 expectedSize = getSizeFromDataType(dataType);
+            for (shape_t dim : shape) {
+                expectedSize *= dim;
+            }
+            if (!reader.ok() || offset > header.weightsSize || size > header.weightsSize - offset
+                    || expectedSize > size) {
+                ALOGE("Data of %s is corrupted", name.c_str());
+                return MAI_FAILED;
+            }
+            // no copy: the buffer is the mapped page, resize() keeps it as it is large enough
+            tensor->bindMemory(weights + offset, size);
+            tensor->resize(shape);
+        }
+        tensor->setConst(isConst);
+        mNetwork->addTensor(tensor);
+    }
+
+    uint32 inputCount = reader.get<uint32>();
+    for (uint32 i = 0; i < inputCount && reader.ok(); ++i) {
+        std::string name = reader.getString();
+        int32 dataType = reader.get<int32>();
+        int32 dataFormat = reader.get<int32>();
+        std::vector<shape_t> shape = reader.getShape();
+        if (!reader.ok()) {
+            break;
+        }
+        if (!isValidDataType(dataType) || !isValidDataFormat(dataFormat)) {
+            ALOGE("Model input %s has an invalid data type(%d) or format(%d)",
+                    name.c_str(), dataType, dataFormat);
+            return MAI_FAILED;
+        }
+        mNetwork->addModelInput(name, static_cast<DataType>(dataType),
+                static_cast<DataFormat>(dataFormat), shape);
+    }
+
+    std::vector<std::string> outputs = reader.getStrings();
+    for (const std::string& output : outputs) {
+        mNetwork->addModelOutput(output);
+    }
+
+    uint32 opCount = reader.get<uint32>();
+    for (uint32 i = 0; i < opCount && reader.ok(); ++i) {
+        int32 opType = reader.get<int32>();
+        int32 dataType = reader.get<int32>();
+        int32 deviceType = reader.get<int32>();
+        std::string extraInfo = reader.getString();
+        std::string name = reader.getString();
+        std::vector<std::string> inputNames = reader.getStrings();
+        std::vector<std::string> outputNames = reader.getStrings();
+        bool hasParam = reader.get<uint8>() != 0;
+        if (!reader.ok()) {
+            break;
+        }
+        if (!isValidOperatorType(opType) || !isValidDataType(dataType) || !isValidDeviceType(deviceType)) {
+            ALOGE("Operator %s has an invalid type(%d), data type(%d) or device type(%d)",
+                    name.c_str(), opType, dataType, deviceType);
+            return MAI_FAILED;
+        }
+        OpContext opContext = OpContextBuilder()
+            .setOperatorType(static_cast<MAIOperator>(opType))
+            .setDataType(static_cast<DataType>(dataType))
+            .setDeviceType(static_cast<DeviceType>(deviceType))
+            .setExtraInfo(extraInfo)
+            .build();
+        // unknown operator types have no variant registered
+        std::unique_ptr<Operator> op = OperatorRegister::getInstance()->findOperator(opContext);
+        if (!op) {
+            ALOGE("Operator %s(type:%d, data type:%d) is not supported", name.c_str(), opType, dataType);
+            return MAI_FAILED;
+        }
+        op->setName(name);
+        op->addInputNames(inputNames);
+        op->addOutputNames(outputNames);
+        if (hasParam) {
+            Param* param = createParam(opContext.opType);
+            if (param == NULL) {
+                ALOGE("Operator %s has an unknown param", name.c_str());
+                return MAI_FAILED;
+            }
+            uint32 paramSize = 0;
+            const uint8* paramData = reader.getBlob(paramSize);
+            ParamReader paramReader(paramData, paramSize);
+            param->serialize(paramReader);
+            if (!reader.ok() || !paramReader.ok()) {
+                delete param;
+                ALOGE("Param of %s is corrupted", name.c_str());
+                return MAI_FAILED;
+            }
+            op->setParam(param);
+        }
+        mNetwork->addOperator(op);
+    }
+
+    if (!reader.ok()) {
+        ALOGE("Graph is truncated or corrupted");
+        return MAI_FAILED;
+    }
+    return MAI_SUCCESS;
+}
+
+} // namespace MAI
@@ -0,0 +1,66 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include "include/NeuralNetwork.h"
+
+namespace MAI {
+
+// Native model format of MAI.
+//
+// A file is a 64-byte header, a compact graph section and the weights:
+//   header  : magic "MAIMODEL", version, offset/size of graph and weights
+//   graph   : tensors, model inputs, model outputs and operators(op context,
+//             names and param fields, see MAI_PARAM_FIELDS), strings and
+//             params are a uint32 length followed by the bytes, param
+//             fields appended later keep their defaults in older models
+//   weights : data of const tensors, every blob starts at a multiple of 64
+//             bytes from the start of the file
+// Numbers are stored in the byte order of the host(little endian on all
+// supported targets).
+//
+// Loading maps the file and points const tensors straight at the mapped
+// pages, nothing is copied. The mapping is private, so optimizers may still
+// change weights in place(only the touched pages are copied by the kernel).
+// 2: length prefixed params
+const uint32 kMaiModelVersion = 2;
+const uint32 kMaiModelMinVersion = 2;
+const uint32 kMaiModelAlignment = 64;
+
+class MaiModelWriter {
+public:
+    // Serializes network as it is now(e.g. after startOptimize()), it may be
+    // initialized and run before. Tensors no operator uses are left out.
+    static MAI_STATUS write(NeuralNetwork* network, const std::string& path);
+    static MAI_STATUS write(NeuralNetwork* network, std::string& bytes);
+};
+
+class MaiModelParser {
+public:
+    MaiModelParser(NeuralNetwork* network);
+    MAI_STATUS parse(const std::string& path);
+    // Model in memory, it must be aligned to kMaiModelAlignment and outlive
+    // the network as const tensors point into it.
+    MAI_STATUS parse(uint8* data, uint64 size);
+
+    // Param of the type operators of opType take, NULL if they take none.
+    static Param* createParam(MAIOperator opType);
+
+private:
+    NeuralNetwork* mNetwork;
+};
+
+} // namespace MAI
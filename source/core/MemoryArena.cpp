@@ -0,0 +1,72 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "MemoryArena.h"
+#include "Allocator.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+
+MemoryArena::MemoryArena(Allocator* allocator) :
+    mAllocator(allocator),
+    mData(NULL),
+    mSize(0) {
+    mMemoryInfo.ptr = NULL;
+    mMemoryInfo.offset = 0;
+    mMemoryInfo.size = 0;
+}
+
+MemoryArena::~MemoryArena() {
+    release();
+}
+
+MAI_STATUS MemoryArena::reserve(uint64 bytes) {
+    MAI_CHECK_NULL(mAllocator);
+    MAI_CHECK(mData == NULL, "MemoryArena has been reserved(%llu bytes)", mSize);
+    if (bytes == 0) {
+        return MAI_SUCCESS;
+    }
+    mMemoryInfo = mAllocator->allocate(bytes + kAlignment);
+    MAI_CHECK(mMemoryInfo.ptr != NULL, "reserve arena failed, sizes:%llu", bytes);
+    uint64 addr = reinterpret_cast<uint64>(mMemoryInfo.ptr);
+    mData = mMemoryInfo.ptr + ((kAlignment - (addr % kAlignment)) % kAlignment);
+    mSize = bytes;
+    return MAI_SUCCESS;
+}
+
+MemoryInfo MemoryArena::allocate(int64 offset, uint64 bytes) {
+    MAI_CHECK(offset >= 0 && offset + bytes <= mSize,
+            "[%lld, %lld) is out of arena(%llu bytes)", offset, offset + bytes, mSize);
+    MemoryInfo memInfo;
+    memInfo.ptr = mData + offset;
+    memInfo.offset = offset;
+    memInfo.size = bytes;
+    return memInfo;
+}
+
+void MemoryArena::deallocate(const MemoryInfo& memInfo) {
+    MAI_UNUSED(memInfo);
+    // slices are owned by the arena
+}
+
+void MemoryArena::release() {
+    if (mMemoryInfo.ptr != NULL) {
+        mAllocator->deallocate(mMemoryInfo);
+        mMemoryInfo.ptr = NULL;
+    }
+    mData = NULL;
+    mSize = 0;
+}
+
+} // namespace MAI
@@ -24,15 +24,30 @@ struct MemoryInfo {
     uint64 size;
 };
 
-// TODO:(gavinchen)
+class Allocator;
+// One contiguous block which is handed out by offset. The offsets are decided
+// ahead of time by MemoryPlanner, so allocate/deallocate never call the
+// allocator after reserve().
 class MemoryArena {
 public:
-    MemoryArena();
-    virtual ~MemoryArena() {}
-    virtual MemoryInfo allocate(uint64 bytes) = 0;
-    virtual void deallocate(const MemoryInfo& memInfo) = 0;
+    static constexpr uint64 kAlignment = 64;
+
+    MemoryArena(Allocator* allocator);
+    virtual ~MemoryArena();
+    virtual MAI_STATUS reserve(uint64 bytes);
+    virtual MemoryInfo allocate(int64 offset, uint64 bytes);
+    virtual void deallocate(const MemoryInfo& memInfo);
+    virtual void release();
+
+    inline uint64 size() const {
+        return mSize;
+    }
+
 private:
-    std::unique_ptr<char[]> mData;
+    Allocator* mAllocator;
+    MemoryInfo mMemoryInfo;
+    uint8* mData;// aligned to kAlignment
+    uint64 mSize;
 };
 
 } // namespace MAI
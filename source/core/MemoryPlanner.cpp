@@ -0,0 +1,338 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string.h>
+#include "MemoryPlanner.h"
+#include "include/NeuralNetwork.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+
+static inline uint64 alignSize(uint64 size) {
+    return (size + MemoryArena::kAlignment - 1) / MemoryArena::kAlignment * MemoryArena::kAlignment;
+}
+
+MemoryPlanner::MemoryPlanner() :
+    mNeuralNetwork(NULL),
+    mGraph(NULL),
+    mOperatorSize(0),
+    mUseCount(0),
+    mNaiveSize(0),
+    mPlannedSize(0),
+    mPlanned(false) {
+}
+
+void MemoryPlanner::reset() {
+    mLiveRanges.clear();
+    mProducedRanges.clear();
+    mDyingRanges.clear();
+    mBlocks.clear();
+    mBlockIndexes.clear();
+    mPinnedBuffers.clear();
+    mPlans.clear();
+    mPlanKey.clear();
+    mNaiveSize = 0;
+    mPlannedSize = 0;
+    mPlanned = false;
+}
+
+void MemoryPlanner::computeLiveRanges(NeuralNetwork* network,
+        const std::vector<std::unique_ptr<Operator> >& operators) {
+    reset();
+    mNeuralNetwork = network;
+    const int32 opSize = static_cast<int32>(operators.size());
+    mOperatorSize = opSize;
+    std::vector<std::string> modelInputs = network->getModelInputs();
+    std::vector<std::string> modelOutputs = network->getModelOutputs();
+    std::map<std::string, int32> rangeIndexes;
+    std::vector<bool> consumed;
+    std::vector<bool> valid;
+    for (int32 i = 0; i < opSize; ++i) {
+        Operator* op = operators[i].get();
+        for (const std::string& name : op->inputNames()) {
+            auto it = rangeIndexes.find(name);
+            if (it != rangeIndexes.end()) {
+                mLiveRanges[it->second].last = i;
+                mLiveRanges[it->second].users.push_back(i);
+                consumed[it->second] = true;
+            }
+        }
+        for (const std::string& name : op->outputNames()) {
+            Tensor* tensor = network->getTensor(name);
+            if (tensor == NULL || tensor->isConst()
+                    || std::find(modelInputs.begin(), modelInputs.end(), name) != modelInputs.end()) {
+                continue;
+            }
+            if (rangeIndexes.find(name) != rangeIndexes.end()) {
+                // written by more than one operator, leave it alone
+                valid[rangeIndexes[name]] = false;
+                continue;
+            }
+            rangeIndexes[name] = mLiveRanges.size();
+            LiveRange liveRange = {tensor, i, i, std::vector<int32>(1, i), op->writesOutputsOnce()};
+            mLiveRanges.emplace_back(liveRange);
+            consumed.push_back(false);
+            valid.push_back(true);
+        }
+    }
+    // tensors consumed before they are produced come from outside the graph
+    for (int32 i = 0; i < opSize; ++i) {
+        for (const std::string& name : operators[i]->inputNames()) {
+            auto it = rangeIndexes.find(name);
+            if (it != rangeIndexes.end() && mLiveRanges[it->second].first >= i) {
+                valid[it->second] = false;
+            }
+        }
+    }
+
+    mProducedRanges.resize(opSize);
+    mDyingRanges.resize(opSize);
+    for (int32 i = 0; i < static_cast<int32>(mLiveRanges.size()); ++i) {
+        LiveRange& liveRange = mLiveRanges[i];
+        if (!valid[i]) {
+            liveRange.tensor = NULL;
+            continue;
+        }
+        const std::string name = liveRange.tensor->name();
+        if (!consumed[i] || std::find(modelOutputs.begin(), modelOutputs.end(), name)
+                != modelOutputs.end()) {
+            liveRange.last = opSize;
+        }
+        mProducedRanges[liveRange.first].push_back(i);
+        if (liveRange.last < opSize) {
+            mDyingRanges[liveRange.last].push_back(i);
+        }
+    }
+}
+
+void MemoryPlanner::setGraph(const Graph* graph) {
+    MAI_CHECK(!mPlanned, "Graph must be set before planning");
+    mGraph = graph;
+}
+
+void MemoryPlanner::onRunStart(const std::set<Buffer*>& externalBuffers) {
+    MAI_CHECK_NULL(mNeuralNetwork);
+    mBlocks.clear();
+    mBlockIndexes.clear();
+    mPinnedBuffers = externalBuffers;
+    // buffers of weights and model inputs must never be moved into the arena
+    std::set<Tensor*> activations;
+    for (const LiveRange& liveRange : mLiveRanges) {
+        if (liveRange.tensor != NULL) {
+            activations.insert(liveRange.tensor);
+        }
+    }
+    for (const std::string& name : mNeuralNetwork->getTensorNames()) {
+        Tensor* tensor = mNeuralNetwork->getTensor(name);
+        if (tensor != NULL && tensor->buffer() != NULL
+                && activations.find(tensor) == activations.end()) {
+            mPinnedBuffers.insert(tensor->buffer());
+        }
+    }
+}
+
+void MemoryPlanner::onOperatorFinished(int32 opIndex) {
+    for (int32 rangeIndex : mProducedRanges[opIndex]) {
+        LiveRange& liveRange = mLiveRanges[rangeIndex];
+        if (liveRange.tensor == NULL) {
+            continue;
+        }
+        Buffer* buffer = liveRange.tensor->buffer();
+        if (buffer == NULL) {
+            liveRange.tensor = NULL;
+            continue;
+        }
+        if (liveRange.pinned) {
+            // tensors reusing the buffer later(e.g. Reshape) are pinned too
+            mPinnedBuffers.insert(buffer);
+        }
+        auto it = mBlockIndexes.find(buffer);
+        if (it == mBlockIndexes.end()) {
+            Block block = {buffer, liveRange.tensor->size(), liveRange.first, liveRange.last, liveRange.users, -1,
+                mPinnedBuffers.find(buffer) == mPinnedBuffers.end(), false};
+            mBlockIndexes[buffer] = mBlocks.size();
+            mBlocks.emplace_back(block);
+        } else {
+            // tensor reuses the buffer of its input(e.g. Reshape)
+            Block& block = mBlocks[it->second];
+            block.first = std::min(block.first, liveRange.first);
+            block.last = std::max(block.last, liveRange.last);
+            block.size = std::max(block.size, liveRange.tensor->size());
+            block.users.insert(block.users.end(), liveRange.users.begin(), liveRange.users.end());
+            block.plannable = block.plannable && !liveRange.pinned;
+        }
+    }
+
+    for (int32 rangeIndex : mDyingRanges[opIndex]) {
+        LiveRange& liveRange = mLiveRanges[rangeIndex];
+        if (liveRange.tensor == NULL || liveRange.tensor->buffer() == NULL) {
+            continue;
+        }
+        auto it = mBlockIndexes.find(liveRange.tensor->buffer());
+        if (it == mBlockIndexes.end()) {
+            continue;
+        }
+        Block& block = mBlocks[it->second];
+        if (block.plannable && !block.released && block.last <= opIndex) {
+            block.buffer->release();
+            block.released = true;
+        }
+    }
+}
+
+bool MemoryPlanner::finishesBefore(const Block& a, const Block& b) const {
+    if (a.last >= mOperatorSize) {
+        return false;
+    }
+    for (int32 user : a.users) {
+        if (!mGraph->happensBefore(user, b.first)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MemoryPlanner::isOverlapped(const Block& a, const Block& b) const {
+    if (mGraph == NULL) {
+        return a.first <= b.last && b.first <= a.last;
+    }
+    return !finishesBefore(a, b) && !finishesBefore(b, a);
+}
+
+void MemoryPlanner::assignOffsets(std::vector<Block*>& blocks) {
+    // Greedy by size: place the largest buffer first, each one goes to the
+    // smallest gap left by the placed buffers whose live ranges overlap.
+    std::stable_sort(blocks.begin(), blocks.end(), [](const Block* a, const Block* b) {
+        return a->size > b->size;
+    });
+    std::vector<Block*> placed;
+    for (Block* block : blocks) {
+        std::vector<Block*> overlapped;
+        for (Block* other : placed) {
+            if (isOverlapped(*block, *other)) {
+                overlapped.push_back(other);
+            }
+        }
+        std::sort(overlapped.begin(), overlapped.end(), [](const Block* a, const Block* b) {
+            return a->offset < b->offset;
+        });
+        const uint64 size = alignSize(block->size);
+        int64 bestOffset = -1;
+        int64 bestGap = 0;
+        int64 prevEnd = 0;
+        for (Block* other : overlapped) {
+            int64 gap = other->offset - prevEnd;
+            if (gap >= static_cast<int64>(size) && (bestOffset == -1 || gap < bestGap)) {
+                bestOffset = prevEnd;
+                bestGap = gap;
+            }
+            prevEnd = std::max(prevEnd, static_cast<int64>(other->offset + alignSize(other->size)));
+        }
+        block->offset = bestOffset == -1 ? prevEnd : bestOffset;
+        mPlannedSize = std::max(mPlannedSize, block->offset + size);
+        placed.push_back(block);
+    }
+}
+
+MAI_STATUS MemoryPlanner::plan(Allocator* allocator) {
+    MAI_CHECK_NULL(allocator);
+    std::vector<Block*> blocks;
+    mNaiveSize = 0;
+    mPlannedSize = 0;
+    for (Block& block : mBlocks) {
+        if (block.plannable && block.size > 0) {
+            blocks.push_back(&block);
+            mNaiveSize += alignSize(block.size);
+        }
+    }
+    assignOffsets(blocks);
+
+    Plan& plan = mPlans[mPlanKey];
+    plan.arena.reset(new MemoryArena(allocator));
+    plan.arena->reserve(mPlannedSize);
+    plan.slots.clear();
+    plan.naiveSize = mNaiveSize;
+    plan.plannedSize = mPlannedSize;
+    plan.lastUse = ++mUseCount;
+    for (Block* block : blocks) {
+        MemoryInfo memInfo = plan.arena->allocate(block->offset, block->size);
+        if (!block->released) {
+            // still live at the end of the run(e.g. model outputs)
+            memcpy(memInfo.ptr, block->buffer->data(), block->size);
+            block->buffer->release();
+            block->released = true;
+        }
+        block->buffer->setBufferAddr(memInfo.ptr, 0, block->size);
+        Slot slot = {block->buffer, block->offset, block->size};
+        plan.slots.push_back(slot);
+    }
+    mPlanned = true;
+    evictPlans();
+    ALOGI("Memory plan: %d buffers, naive:%llu bytes, planned:%llu bytes",
+            static_cast<int32>(blocks.size()), mNaiveSize, mPlannedSize);
+    return MAI_SUCCESS;
+}
+
+void MemoryPlanner::bindPlan(Plan& plan) {
+    for (const Slot& slot : plan.slots) {
+        MemoryInfo memInfo = plan.arena->allocate(slot.offset, slot.size);
+        slot.buffer->release();
+        slot.buffer->setBufferAddr(memInfo.ptr, 0, slot.size);
+    }
+    plan.lastUse = ++mUseCount;
+    mNaiveSize = plan.naiveSize;
+    mPlannedSize = plan.plannedSize;
+}
+
+void MemoryPlanner::evictPlans() {
+    while (static_cast<int32>(mPlans.size()) > kMaxCachedPlans) {
+        auto oldest = mPlans.end();
+        for (auto it = mPlans.begin(); it != mPlans.end(); ++it) {
+            if (it->first != mPlanKey
+                    && (oldest == mPlans.end() || it->second.lastUse < oldest->second.lastUse)) {
+                oldest = it;
+            }
+        }
+        mPlans.erase(oldest);
+    }
+}
+
+void MemoryPlanner::switchPlan(const std::string& key) {
+    if (key == mPlanKey && mPlanned) {
+        return;
+    }
+    mPlanKey = key;
+    auto it = mPlans.find(key);
+    if (it != mPlans.end()) {
+        bindPlan(it->second);
+        mPlanned = true;
+    } else {
+        // buffers keep the slots of the old plan(same live ranges, so still
+        // disjoint) until the next run plans again, slots too small are
+        // reallocated by the run.
+        mPlanned = false;
+    }
+}
+
+void MemoryPlanner::detachBuffer(Buffer* buffer) {
+    for (auto it = mPlans.begin(); it != mPlans.end(); ++it) {
+        std::vector<Slot>& slots = it->second.slots;
+        slots.erase(std::remove_if(slots.begin(), slots.end(), [buffer](const Slot& slot) {
+            return slot.buffer == buffer;
+        }), slots.end());
+    }
+}
+
+} // namespace MAI
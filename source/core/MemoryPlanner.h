@@ -0,0 +1,149 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <memory>
+#include <vector>
+#include "include/Operator.h"
+#include "MemoryArena.h"
+#include "Graph.h"
+
+namespace MAI {
+
+class Allocator;
+class NeuralNetwork;
+
+// Static memory planner of activations.
+//
+// A tensor is live from the operator which produces it to the last operator
+// which consumes it(model outputs and sinks live to the end). Shapes are only
+// known after the first run, so the first run allocates buffers as usual but
+// releases each one as soon as it is dead, and records its size. plan() then
+// assigns every buffer an offset in one MemoryArena(greedy by size), so later
+// runs never call the allocator.
+//
+// Live ranges are ordered by operator index, which is only right when the
+// operators run one after another. With a Graph two buffers share memory only
+// if every user of one happens before the producer of the other.
+//
+// Outputs of operators which write them only in the first run(see
+// Operator::writesOutputsOnce) are pinned to their own buffers, a later run
+// would read whatever the arena slot holds by then.
+//
+// Plans are cached by a key of the input shapes(a few buckets), switching
+// back to a planned shape rebinds the buffers without planning or allocating.
+class MemoryPlanner {
+public:
+    MemoryPlanner();
+    ~MemoryPlanner() = default;
+
+    void computeLiveRanges(NeuralNetwork* network,
+            const std::vector<std::unique_ptr<Operator> >& operators);
+    // The graph the operators are scheduled by, NULL if they run in order.
+    void setGraph(const Graph* graph);
+    // Buffers in externalBuffers are bound to memory owned by the caller and
+    // stay out of the plan.
+    void onRunStart(const std::set<Buffer*>& externalBuffers = std::set<Buffer*>());
+    void onOperatorFinished(int32 opIndex);
+    // Plans the buffers recorded by the last run and caches the plan by the
+    // key of the last switchPlan().
+    MAI_STATUS plan(Allocator* allocator);
+    void reset();
+
+    // The input shapes are changed: binds the buffers to the plan cached for
+    // key, or leaves the buffers where they are and lets the next run plan.
+    void switchPlan(const std::string& key);
+
+    // The buffer is bound to memory owned by the caller: drops its slots from
+    // the cached plans, so switching plans never moves it back into an arena.
+    void detachBuffer(Buffer* buffer);
+
+    inline bool isPlanned() const {
+        return mPlanned;
+    }
+
+    // Sum of all activation buffers when each one is allocated on its own.
+    inline uint64 naiveSize() const {
+        return mNaiveSize;
+    }
+
+    // Size of the arena which holds all activation buffers.
+    inline uint64 plannedSize() const {
+        return mPlannedSize;
+    }
+
+private:
+    struct LiveRange {
+        Tensor* tensor;
+        int32 first;// index of the producer
+        int32 last;// index of the last consumer
+        std::vector<int32> users;// producer and consumers
+        bool pinned;// written only by the first run, never planned
+    };
+
+    struct Block {
+        Buffer* buffer;// shared by tensors which reuse one another
+        uint64 size;
+        int32 first;
+        int32 last;
+        std::vector<int32> users;
+        int64 offset;
+        bool plannable;
+        bool released;
+    };
+
+    struct Slot {
+        Buffer* buffer;
+        int64 offset;
+        uint64 size;
+    };
+
+    struct Plan {
+        std::unique_ptr<MemoryArena> arena;
+        std::vector<Slot> slots;
+        uint64 naiveSize;
+        uint64 plannedSize;
+        uint64 lastUse;
+    };
+
+    static constexpr int32 kMaxCachedPlans = 4;
+
+    void bindPlan(Plan& plan);
+    void evictPlans();
+    bool finishesBefore(const Block& a, const Block& b) const;
+    bool isOverlapped(const Block& a, const Block& b) const;
+    void assignOffsets(std::vector<Block*>& blocks);
+
+private:
+    NeuralNetwork* mNeuralNetwork;
+    const Graph* mGraph;
+    int32 mOperatorSize;
+    std::vector<LiveRange> mLiveRanges;
+    std::vector<std::vector<int32> > mProducedRanges;// op index -> live ranges
+    std::vector<std::vector<int32> > mDyingRanges;// op index -> live ranges
+    std::vector<Block> mBlocks;
+    std::map<Buffer*, int32> mBlockIndexes;
+    std::set<Buffer*> mPinnedBuffers;
+    std::map<std::string, Plan> mPlans;// input shapes -> plan
+    std::string mPlanKey;
+    uint64 mUseCount;
+    uint64 mNaiveSize;
+    uint64 mPlannedSize;
+    bool mPlanned;
+};
+
+} // namespace MAI
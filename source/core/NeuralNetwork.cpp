@@ -13,8 +13,12 @@
 // limitations under the License.
 
 #include "NeuralNetwork.h"
+#include "include/Device.h"
 #include "source/util/MAIType.h"
 #include "source/core/SimpleNeuralNetwork.h"
+#include "source/core/MaiModel.h"
+#include "source/core/ConstantCache.h"
+#include "source/core/optimizers/ActivationConvOptimizer.h"
 #include "source/core/optimizers/BNConvOptimizer.h"
 #include "source/core/optimizers/ConstFoldOptimizer.h"
 
@@ -35,6 +39,7 @@ std::unique_ptr<NeuralNetwork> NeuralNetwork::getNeuralNetwork(
 #ifdef MAI_TENSORFLOW_ENABLED
     case TENSORFLOW: {
         std::unique_ptr<NeuralNetwork> network(new SimpleNeuralNetwork());
+        network->setDevice(Device::createDevice(DEVICE_CPU));
         Converter::Tensorflow::TensorflowParser parser(network.get());
         parser.parse(modelPath);
         return network;
@@ -43,24 +48,83 @@ std::unique_ptr<NeuralNetwork> NeuralNetwork::getNeuralNetwork(
 #ifdef MAI_ONNX_ENABLED
     case ONNX: {
         std::unique_ptr<NeuralNetwork> network(new SimpleNeuralNetwork());
+        network->setDevice(Device::createDevice(DEVICE_CPU));
         Converter::ONNX::OnnxParser parser(network.get());
         parser.parse(modelPath);
         return network;
     }
 #endif
-    case MAI:
+    case MAI: {
+        std::unique_ptr<NeuralNetwork> network(new SimpleNeuralNetwork());
+        network->setDevice(Device::createDevice(DEVICE_CPU));
+        MaiModelParser parser(network.get());
+        if (parser.parse(modelPath) != MAI_SUCCESS) {
+            return NULL;
+        }
+        return network;
+    }
     default:
         MAI_ABORT("Unsupported network format:%d", networkFormat);
         return NULL;
     }
 }
 
+/*static*/
+std::unique_ptr<NeuralNetwork> NeuralNetwork::getOptimizedNeuralNetwork(
+        const NetworkFormat networkFormat, const std::string& modelPath,
+        const std::string& cachePath) {
+    const std::string kGraphEntry = "graph";
+    std::shared_ptr<ConstantCache> cache(new ConstantCache(cachePath, ConstantCache::makeKey(modelPath)));
+    std::unique_ptr<NeuralNetwork> network;
+    uint64 graphSize = 0;
+    uint8* graph = cache->load() ? cache->find(kGraphEntry, &graphSize) : NULL;
+    if (graph != NULL) {
+        network.reset(new SimpleNeuralNetwork());
+        network->setDevice(Device::createDevice(DEVICE_CPU));
+        MaiModelParser parser(network.get());
+        if (parser.parse(graph, graphSize) != MAI_SUCCESS) {
+            network.reset();
+        }
+    }
+    if (!network) {
+        network = getNeuralNetwork(networkFormat, modelPath);
+        if (!network) {
+            return NULL;
+        }
+        network->addAllOptimizers();
+        network->startOptimize();
+        std::string bytes;
+        if (MaiModelWriter::write(network.get(), bytes) == MAI_SUCCESS) {
+            cache->put(kGraphEntry, bytes.data(), bytes.size());
+            cache->save();
+        }
+    }
+    network->setConstantCache(cache);
+    return network;
+}
+
+std::future<MAI_STATUS> NeuralNetwork::runAsync() {
+    std::shared_ptr<std::promise<MAI_STATUS> > promise(new std::promise<MAI_STATUS>());
+    std::future<MAI_STATUS> future = promise->get_future();
+    runAsync([promise](MAI_STATUS status) {promise->set_value(status);});
+    return future;
+}
+
 void NeuralNetwork::addOptimizer(std::unique_ptr<Optimizer> optimizer) {
     mOptimizers.emplace_back(std::move(optimizer));
 }
 
 void NeuralNetwork::addOptimizer(OptimizerRule rule) {
-    mOptimizers.emplace_back(createOptimizer(rule));
+    Optimizer* optimizer = createOptimizer(rule);
+    if (optimizer != NULL) {
+        mOptimizers.emplace_back(optimizer);
+    }
+}
+
+void NeuralNetwork::addAllOptimizers() {
+    for (int32 rule = 0; rule < OPTIMIZER_RULE_COUNT; ++rule) {
+        addOptimizer(static_cast<OptimizerRule>(rule));
+    }
 }
 
 Optimizer* NeuralNetwork::createOptimizer(OptimizerRule rule) {
@@ -68,9 +132,11 @@ Optimizer* NeuralNetwork::createOptimizer(OptimizerRule rule) {
     case FOLD_BN_INTO_CONV2D:
         return new BNConvOptimizer(this);
     case FOLD_ACTIVATION_INTO_CONV2D:
-        return NULL;
+        return new ActivationConvOptimizer(this);
     case CONSTANT_FOLD:
         return new ConstFoldOptimizer(this);
+    default:
+        return NULL;
     }
     return NULL;
 }
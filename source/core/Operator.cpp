@@ -12,12 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "ConstantCache.h"
 #include "NeuralNetwork.h"
 #include "Operator.h"
 #include "util/MAIUtil.h"
 
 namespace MAI {
 
+Operator::Operator() :
+    mRunFirst(true),
+    mNeuralNetwork(NULL),
+    mOpType(INVALID) {
+}
+
 void Operator::setType(MAIOperator opType) {
     mOpType = opType;
 }
@@ -26,23 +33,36 @@ MAIOperator Operator::type() const {
     return mOpType;
 }
 
+void Operator::setOpContext(const OpContext& opContext) {
+    mOpContext = opContext;
+}
+
+const OpContext& Operator::opContext() const {
+    return mOpContext;
+}
+
 void Operator::addInputName(const std::string& name) {
+    unbindTensors();
     mInputNames.push_back(name);
 }
 
 void Operator::addOutputName(const std::string& name) {
+    unbindTensors();
     mOutputNames.push_back(name);
 }
 
 void Operator::addInputNames(const std::vector<std::string>& names) {
+    unbindTensors();
     mInputNames.insert(mInputNames.end(), names.begin(), names.end());
 }
 
 void Operator::addOutputNames(const std::vector<std::string>& names) {
+    unbindTensors();
     mOutputNames.insert(mOutputNames.end(), names.begin(), names.end());
 }
 
 void Operator::replaceInputName(const std::string& oriName, const std::string& dstName) {
+    unbindTensors();
     for (auto it = mInputNames.begin(); it != mInputNames.end(); ++it) {
         if ((*it) == oriName) {
             (*it) = dstName;
@@ -51,6 +71,7 @@ void Operator::replaceInputName(const std::string& oriName, const std::string& d
 }
 
 void Operator::replaceOutputName(const std::string& oriName, const std::string& dstName) {
+    unbindTensors();
     for (auto it = mOutputNames.begin(); it != mOutputNames.end(); ++it) {
         if ((*it) == oriName) {
             (*it) = dstName;
@@ -90,7 +111,7 @@ void Operator::setName(const std::string& name) {
     mName = name;
 }
 
-std::string Operator::name() const {
+const std::string& Operator::name() const {
     return mName;
 }
 
@@ -98,26 +119,81 @@ void Operator::setNeuralNetwork(NeuralNetwork* network) {
     mNeuralNetwork = network;
 }
 
+void Operator::bindTensors() {
+    MAI_CHECK_NULL(mNeuralNetwork);
+    mInputHandles.resize(mInputNames.size());
+    for (size_t i = 0; i < mInputNames.size(); ++i) {
+        mInputHandles[i] = mNeuralNetwork->getTensorHandle(mInputNames[i]);
+    }
+    mOutputHandles.resize(mOutputNames.size());
+    for (size_t i = 0; i < mOutputNames.size(); ++i) {
+        mOutputHandles[i] = mNeuralNetwork->getTensorHandle(mOutputNames[i]);
+    }
+}
+
+void Operator::unbindTensors() {
+    mInputHandles.clear();
+    mOutputHandles.clear();
+}
+
 Tensor* Operator::getTensor(const std::string& inputName) {
     return mNeuralNetwork->getTensor(inputName);
 }
 
 Tensor* Operator::getInputTensor(int inputIdx) {
-    if (inputIdx >= mInputNames.size()) {
+    if (inputIdx < 0 || inputIdx >= static_cast<int>(mInputNames.size())) {
         return NULL;
     }
+    // the slot of a removed tensor is NULL, never a dangling pointer
+    if (inputIdx < static_cast<int>(mInputHandles.size())) {
+        return mNeuralNetwork->getTensorByHandle(mInputHandles[inputIdx]);
+    }
     return mNeuralNetwork->getTensor(mInputNames[inputIdx]);
 }
 
 Tensor* Operator::getOutputTensor(int outputIdx) {
-    if (outputIdx >= mOutputNames.size()) {
-        ALOGE("getOutputTensor %d out of index(%d)", outputIdx, mOutputNames.size());
+    if (outputIdx < 0 || outputIdx >= static_cast<int>(mOutputNames.size())) {
+        ALOGE("getOutputTensor %d out of index(%d)", outputIdx, static_cast<int>(mOutputNames.size()));
         return NULL;
     }
+    if (outputIdx < static_cast<int>(mOutputHandles.size())) {
+        return mNeuralNetwork->getTensorByHandle(mOutputHandles[outputIdx]);
+    }
     return mNeuralNetwork->getTensor(mOutputNames[outputIdx]);
 }
 
+ConstantCache* Operator::constantCache() const {
+    return mNeuralNetwork != NULL ? mNeuralNetwork->getConstantCache() : NULL;
+}
+
+const uint8* Operator::findCachedConstant(const std::string& suffix, uint64 size) const {
+    ConstantCache* cache = constantCache();
+    uint64 cachedSize = 0;
+    const uint8* cached = cache == NULL ? NULL : cache->find(mName + suffix, &cachedSize);
+    return cachedSize == size ? cached : NULL;
+}
+
+void Operator::putCachedConstant(const std::string& suffix, const void* data, uint64 size) const {
+    ConstantCache* cache = constantCache();
+    if (cache != NULL) {
+        cache->put(mName + suffix, data, size);
+    }
+}
+
 void Operator::setParam(Param* param) {
+    mParamPrototype.reset(param != NULL ? param->clone() : NULL);
+    onSetParam(param);
+}
+
+const Param* Operator::paramPrototype() const {
+    return mParamPrototype.get();
+}
+
+void Operator::invalidate() {
+    mRunFirst = true;
+}
+
+void Operator::onSetParam(Param* param) {
     MAI_UNUSED(param);
     // do nothing
 }
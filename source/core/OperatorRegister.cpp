@@ -14,9 +14,30 @@
 
 #include "core/OperatorRegister.h"
 #include "util/MAIType.h"
+#include "core/CpuFeatures.h"
 
 namespace MAI {
 
+namespace {
+
+// ISA tier of a variant, CpuFeature bits are declared in ISA order so it is
+// the highest bit set(AVX512F alone outranks AVX2|FMA)
+int isaLevel(uint32 features) {
+    return features == 0 ? 0 : 32 - __builtin_clz(features);
+}
+
+// The higher ISA tier, or more features if on the same tier
+bool isWider(uint32 features, uint32 than) {
+    int level = isaLevel(features);
+    int thanLevel = isaLevel(than);
+    if (level != thanLevel) {
+        return level > thanLevel;
+    }
+    return __builtin_popcount(features) > __builtin_popcount(than);
+}
+
+} // namespace
+
 OperatorRegister* OperatorRegister::getInstance() {
     static OperatorRegister instance;
     return &instance;
@@ -29,43 +50,63 @@ void OperatorRegister::registerOperator(const OpContext opContext, const Operato
 }
 
 std::unique_ptr<Operator> OperatorRegister::createOperator(const OpContext& opContext) {
+    std::unique_ptr<Operator> op = findOperator(opContext);
+    MAI_CHECK(op, "Operator(%s) is not registered", opContext.toString().c_str());
+    return op;
+}
+
+std::unique_ptr<Operator> OperatorRegister::findOperator(const OpContext& opContext) {
 #define COMPARE(value) \
     if (it->first.value != opContext.value) { \
         continue; \
     }
 
+    // exact(dataType and extraInfo) variants first, compatible ones otherwise,
+    // the widest the running CPU supports among them
+    const uint32 supported = cpuFeatures();
     auto find = mOps.end();
+    bool findExactly = false;
     for(auto it = mOps.begin(); it != mOps.end(); ++it) {
         COMPARE(opType)
         COMPARE(deviceType)
 
-        if (it->first.dataType == opContext.dataType
-                && it->first.extraInfo == opContext.extraInfo) {
-            // find exactly
-            find = it;
-            break;
-        }
-
-        if (find != mOps.end()) {
+        if ((it->first.cpuFeatures & supported) != it->first.cpuFeatures) {
             continue;
         }
 
-        if (it->first.dataType != DT_INVALID && it->first.dataType != opContext.dataType) {
-            continue;
+        bool exactly = it->first.dataType == opContext.dataType
+                && it->first.extraInfo == opContext.extraInfo;
+        if (!exactly) {
+            if (findExactly) {
+                continue;
+            }
+
+            if (it->first.dataType != DT_INVALID && it->first.dataType != opContext.dataType) {
+                continue;
+            }
+
+            if (it->first.extraInfo != "" && it->first.extraInfo != opContext.extraInfo) {
+                continue;
+            }
         }
 
-        if (it->first.extraInfo != "" && it->first.extraInfo != opContext.extraInfo) {
+        if (find != mOps.end() && exactly == findExactly
+                && !isWider(it->first.cpuFeatures, find->first.cpuFeatures)) {
             continue;
         }
-
-        // find compatible
         find = it;
+        findExactly = exactly;
     }
 #undef COMPARE
 
-    MAI_CHECK(find != mOps.end(), "Operator(%s) is not registered", opContext.toString().c_str());
+    if (find == mOps.end()) {
+        return std::unique_ptr<Operator>();
+    }
     auto op = find->second();
     op->setType(opContext.opType);
+    OpContext createdContext = opContext;
+    createdContext.cpuFeatures = find->first.cpuFeatures;
+    op->setOpContext(createdContext);
     return op;
 }
 
@@ -34,8 +34,15 @@ public:
 
     void registerOperator(const OpContext opContext, const OperatorCreator creator);
 
+    // Picks the registered variant matching opContext, preferring exact
+    // dataType/extraInfo matches, then the widest cpuFeatures the running CPU
+    // supports(opContext.cpuFeatures is ignored). The created operator gets
+    // opContext with the cpuFeatures of the variant.
     std::unique_ptr<Operator> createOperator(const OpContext& opContext);
 
+    // Same as createOperator, but returns NULL if no variant matches.
+    std::unique_ptr<Operator> findOperator(const OpContext& opContext);
+
 private:
     OperatorRegister() = default;
 
@@ -13,26 +13,43 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <set>
+#include <string.h>
 #include "core/SimpleNeuralNetwork.h"
-#include "source/core/OpenMP.h"
 #include "include/Device.h"
 #include "Allocator.h"
+#include "ConstantCache.h"
+#include "OperatorRegister.h"
 #include "util/MAIType.h"
+#include "util/MAIUtil.h"
 #include "source/ops/cpu/CPURegister.h"
 #include "tools/profiling/Profiler.h"
 
 namespace MAI {
 
-SimpleNeuralNetwork::SimpleNeuralNetwork() {
+SimpleNeuralNetwork::SimpleNeuralNetwork()
+    : mPendingOperators(0), mRunStatus(MAI_SUCCESS), mGraphDone(true), mRunFirst(true) {
     Op::CPU::CPURegister::getInstance();
-
-    OpenMP::setNumThreads(OpenMP::getNumCPUCores());
 }
 
 MAI_STATUS SimpleNeuralNetwork::init() {
+    if (!mComputePool) {
+        mComputePool.reset(new ComputeThreadPool(ComputeThreadPool::getNumCPUCores()));
+    }
+    if (!mConstantCache) {
+        // in memory, createSession() hands it to the sessions
+        mConstantCache.reset(new ConstantCache("", ""));
+    }
     for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
+        (*it)->bindTensors();
         (*it)->init();
     }
+    builGraph();
+    if (!mMemoryPlanner.isPlanned()) {
+        mMemoryPlanner.setGraph(mThreadPool ? &mGraph : NULL);
+        mMemoryPlanner.computeLiveRanges(this, mOperators);
+    }
+    mRunFirst = true;
     return MAI_SUCCESS;
 }
 
@@ -50,15 +67,190 @@ MAI_STATUS SimpleNeuralNetwork::run() {
         }
     }
 #else
-    for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
-        //ALOGI("run %s", (*it)->name().c_str());
-        SCOPED_OPERATOR_PROFILE(getProfiler(), (*it)->name(), getNameFromOperator((*it)->type()));
-        (*it)->run();
+    // The first run always goes in order: it decides the shapes and runs the
+    // one-time setup of the operators, activations are moved into one arena after it.
+    MAI_STATUS status = MAI_SUCCESS;
+    if (mThreadPool && !mRunFirst) {
+        status = runGraph();
+    } else {
+        status = runInOrder();
     }
+    if (status != MAI_SUCCESS) {
+        return status;
+    }
+    finishRun();
 #endif
     return MAI_SUCCESS;
 }
 
+void SimpleNeuralNetwork::finishRun() {
+    finishOutputBindings();
+    if (mConstantCache && mConstantCache->isDirty()) {
+        // keep what the operators derived for the next start
+        mConstantCache->save();
+    }
+}
+
+MAI_STATUS SimpleNeuralNetwork::runInOrder() {
+    ComputeThreadPool::Scope scope(mComputePool.get());
+    const bool planMemory = !mMemoryPlanner.isPlanned() && mDevice;
+    if (planMemory) {
+        std::set<Buffer*> externalBuffers;
+        for (auto it = mOutputBindings.begin(); it != mOutputBindings.end(); ++it) {
+            externalBuffers.insert(getTensor(it->first)->buffer());
+        }
+        mMemoryPlanner.switchPlan(inputShapeKey());
+        mMemoryPlanner.onRunStart(externalBuffers);
+    }
+    for (int32 i = 0; i < static_cast<int32>(mOperators.size()); ++i) {
+        const std::unique_ptr<Operator>& op = mOperators[i];
+        //ALOGI("run %s", op->name().c_str());
+        MAI_STATUS status = MAI_SUCCESS;
+        if (getProfiler() != NULL) {
+            SCOPED_OPERATOR_PROFILE(getProfiler(), op->name(), getNameFromOperator(op->type()));
+            status = op->run();
+        } else {
+            status = op->run();
+        }
+        if (status != MAI_SUCCESS) {
+            // stays a first run, so the next run goes in order again
+            ALOGE("Run operator(%s) failed", op->name().c_str());
+            return status;
+        }
+        if (planMemory) {
+            mMemoryPlanner.onOperatorFinished(i);
+        }
+    }
+    if (planMemory) {
+        mMemoryPlanner.plan(mDevice->allocator());
+    }
+    mRunFirst = false;
+    return MAI_SUCCESS;
+}
+
+MAI_STATUS SimpleNeuralNetwork::runGraph() {
+    if (mOperators.empty()) {
+        return MAI_SUCCESS;
+    }
+    startGraph(RunCallback());
+    // finishGraph() sets mGraphDone and notifies under the lock, so the
+    // network may be destroyed as soon as this returns
+    std::unique_lock<std::mutex> lock(mRunMutex);
+    mRunCondition.wait(lock, [this]() {return mGraphDone;});
+    return mRunStatus.load();
+}
+
+void SimpleNeuralNetwork::startGraph(RunCallback callback) {
+    const int32 opSize = static_cast<int32>(mOperators.size());
+    for (int32 i = 0; i < opSize; ++i) {
+        mPendingInputs[i].store(mGraph.inDegree(i), std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        mRunCallback = std::move(callback);
+        mGraphDone = false;
+    }
+    mRunStatus.store(MAI_SUCCESS);
+    mPendingOperators.store(opSize);
+    const std::vector<int32>& roots = mGraph.roots();
+    for (int32 root : roots) {
+        mThreadPool->schedule([this, root]() {runOperatorFrom(root);});
+    }
+}
+
+void SimpleNeuralNetwork::runAsync(RunCallback callback) {
+    MAI_CHECK(callback, "Callback cannot be empty");
+    if (mThreadPool && !mRunFirst && !mOperators.empty()) {
+        // no thread waits for the graph, the last operator completes the run
+        startGraph([this, callback](MAI_STATUS status) {
+            if (status == MAI_SUCCESS) {
+                finishRun();
+            }
+            callback(status);
+        });
+        return;
+    }
+    // the first run goes in order on one thread
+    ThreadPool* executor = mThreadPool.get();
+    if (executor == NULL) {
+        if (!mAsyncThread) {
+            mAsyncThread.reset(new ThreadPool(1));
+        }
+        executor = mAsyncThread.get();
+    }
+    executor->schedule([this, callback]() {callback(run());});
+}
+
+void SimpleNeuralNetwork::runOperatorFrom(int32 opIndex) {
+    bool last = false;
+    {
+        // operators running at the same time take turns on the compute threads,
+        // the ones which find them busy run on this thread
+        ComputeThreadPool::Scope scope(mComputePool.get());
+        while (opIndex >= 0 && !last) {
+            // after a failure the rest of the graph is only counted down, not run
+            if (mRunStatus.load() == MAI_SUCCESS) {
+                MAI_STATUS status = runOperator(mOperators[opIndex].get());
+                if (status != MAI_SUCCESS) {
+                    ALOGE("Run operator(%s) failed", mOperators[opIndex]->name().c_str());
+                    // keeps the first failure
+                    MAI_STATUS expected = MAI_SUCCESS;
+                    mRunStatus.compare_exchange_strong(expected, status);
+                }
+            }
+            // the first successor which becomes ready runs on this thread, others go to the pool
+            int32 next = -1;
+            for (int32 successor : mGraph.successors(opIndex)) {
+                if (mPendingInputs[successor].fetch_sub(1) == 1) {
+                    if (next == -1) {
+                        next = successor;
+                    } else {
+                        mThreadPool->schedule([this, successor]() {runOperatorFrom(successor);});
+                    }
+                }
+            }
+            last = mPendingOperators.fetch_sub(1) == 1;
+            opIndex = next;
+        }
+    }
+    if (last) {
+        finishGraph();
+    }
+}
+
+void SimpleNeuralNetwork::finishGraph() {
+    RunCallback callback;
+    MAI_STATUS status = MAI_SUCCESS;
+    {
+        std::lock_guard<std::mutex> lock(mRunMutex);
+        status = mRunStatus.load();
+        if (!mRunCallback) {
+            // runGraph() may return and destroy the network once the lock is
+            // released, nothing is touched after it
+            mGraphDone = true;
+            mRunCondition.notify_all();
+            return;
+        }
+        // reset before the callback, which may start the next run
+        callback = std::move(mRunCallback);
+        mRunCallback = RunCallback();
+        mGraphDone = true;
+    }
+    callback(status);
+}
+
+MAI_STATUS SimpleNeuralNetwork::runOperator(Operator* op) {
+    if (getProfiler() == NULL) {
+        return op->run();
+    }
+    uint64 beginTime = nowMicros();
+    MAI_STATUS status = op->run();
+    uint64 endTime = nowMicros();
+    std::lock_guard<std::mutex> lock(mProfileMutex);
+    BASIC_OPERATOR_PROFILE(getProfiler(), op->name(), getNameFromOperator(op->type()), beginTime, endTime);
+    return status;
+}
+
 MAI_STATUS SimpleNeuralNetwork::run(Context* context) {
     ALOGI("SimpleNeuralNetwork::run with context");
     for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
@@ -119,6 +311,7 @@ MAI_STATUS SimpleNeuralNetwork::removeOperator(const std::string& opName) {
 MAI_STATUS SimpleNeuralNetwork::addTensor(std::unique_ptr<Tensor>& tensor) {
     MAI_CHECK(mTensors.find(tensor->name()) == mTensors.end(), "%s has exists", tensor->name().c_str());
     mTensorNames.emplace_back(tensor->name());
+    mTensorTable[getTensorHandle(tensor->name())] = tensor.get();
     mTensors.emplace(tensor->name(), std::move(tensor));
     return MAI_SUCCESS;
 }
@@ -133,6 +326,7 @@ MAI_STATUS SimpleNeuralNetwork::removeTensor(const std::string& tensorName) {
 
     for (auto it = mTensors.begin(); it != mTensors.end(); ++it) {
         if (it->first == tensorName) {
+            mTensorTable[getTensorHandle(tensorName)] = NULL;
             mTensorsInDegreeMap.erase(tensorName);
             mTensorsOutDegreeMap.erase(tensorName);
             mTensors.erase(it);
@@ -147,8 +341,26 @@ Tensor* SimpleNeuralNetwork::getTensor(const std::string& name) {
     return mTensors[name].get();
 }
 
+int32 SimpleNeuralNetwork::getTensorHandle(const std::string& name) {
+    auto it = mTensorHandles.find(name);
+    if (it != mTensorHandles.end()) {
+        return it->second;
+    }
+    int32 handle = static_cast<int32>(mTensorTable.size());
+    mTensorHandles.emplace(name, handle);
+    auto tensorIt = mTensors.find(name);
+    mTensorTable.emplace_back(tensorIt == mTensors.end() ? NULL : tensorIt->second.get());
+    return handle;
+}
+
+Tensor* SimpleNeuralNetwork::getTensorByHandle(int32 handle) {
+    MAI_CHECK(handle >= 0 && handle < static_cast<int32>(mTensorTable.size()),
+            "Invalid tensor handle:%d", handle);
+    return mTensorTable[handle];
+}
+
 std::vector<std::string> SimpleNeuralNetwork::getTensorNames() {
-    return mOperatorNames;
+    return mTensorNames;
 }
 
 int32 SimpleNeuralNetwork::getTensorInDegree(const std::string& name) {
@@ -172,6 +384,14 @@ std::vector<std::string> SimpleNeuralNetwork::getOperatorNames() {
     return mOperatorNames;
 }
 
+std::vector<Operator*> SimpleNeuralNetwork::getOperators() {
+    std::vector<Operator*> operators;
+    for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
+        operators.push_back(it->get());
+    }
+    return operators;
+}
+
 std::vector<std::string> SimpleNeuralNetwork::getModelInputs() {
     return mModelInputs;
 }
@@ -195,8 +415,222 @@ void SimpleNeuralNetwork::addModelOutput(const std::string& outputName) {
     mModelOutputs.emplace_back(outputName);
 }
 
+MAI_STATUS SimpleNeuralNetwork::resizeInputs(
+        const std::map<std::string, std::vector<shape_t> >& inputShapes) {
+    std::set<std::string> changedTensors;
+    for (auto it = inputShapes.begin(); it != inputShapes.end(); ++it) {
+        MAI_CHECK(std::find(mModelInputs.begin(), mModelInputs.end(), it->first) != mModelInputs.end(),
+                "%s is not a model input", it->first.c_str());
+        Tensor* tensor = getTensor(it->first);
+        if (tensor->shape() == it->second) {
+            continue;
+        }
+        auto bindingIt = mInputBindings.find(it->first);
+        MAI_CHECK(bindingIt == mInputBindings.end()
+                || static_cast<uint64>(shapeToSize(it->second) * getDataTypeSize(tensor->dataType()))
+                    <= bindingIt->second.size,
+                "Input %s is resized beyond its bound buffer", it->first.c_str());
+        tensor->resize(it->second);
+        changedTensors.insert(it->first);
+    }
+    if (changedTensors.empty()) {
+        return MAI_SUCCESS;
+    }
+
+    // Shape inference: operators are in topological order, so one pass marks
+    // every operator downstream of a changed input, they derive their output
+    // shapes again in the next run, which goes in order.
+    for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
+        bool changed = false;
+        for (const std::string& name : (*it)->inputNames()) {
+            if (changedTensors.find(name) != changedTensors.end()) {
+                changed = true;
+                break;
+            }
+        }
+        if (changed) {
+            (*it)->invalidate();
+            const std::vector<std::string>& outputNames = (*it)->outputNames();
+            changedTensors.insert(outputNames.begin(), outputNames.end());
+        }
+    }
+    mRunFirst = true;
+    if (mDevice) {
+        mMemoryPlanner.switchPlan(inputShapeKey());
+    }
+    return MAI_SUCCESS;
+}
+
+MAI_STATUS SimpleNeuralNetwork::bindInput(const std::string& name, void* data, uint64 size) {
+    MAI_CHECK(std::find(mModelInputs.begin(), mModelInputs.end(), name) != mModelInputs.end(),
+            "%s is not a model input", name.c_str());
+    MAI_CHECK(data == NULL || size >= getTensor(name)->size(),
+            "Input %s needs %llu bytes, bound buffer has %llu", name.c_str(),
+            getTensor(name)->size(), size);
+    bindMemory(mInputBindings, name, data, size);
+    return MAI_SUCCESS;
+}
+
+MAI_STATUS SimpleNeuralNetwork::bindOutput(const std::string& name, void* data, uint64 size) {
+    MAI_CHECK(std::find(mModelOutputs.begin(), mModelOutputs.end(), name) != mModelOutputs.end(),
+            "%s is not a model output", name.c_str());
+    bindMemory(mOutputBindings, name, data, size);
+    return MAI_SUCCESS;
+}
+
+void SimpleNeuralNetwork::bindMemory(std::map<std::string, Binding>& bindings,
+        const std::string& name, void* data, uint64 size) {
+    Tensor* tensor = getTensor(name);
+    MAI_CHECK_NULL(tensor);
+    const uint64 alignment = getDataTypeSize(tensor->dataType());
+    MAI_CHECK(reinterpret_cast<uintptr_t>(data) % alignment == 0,
+            "Buffer bound to %s must be aligned to %llu bytes", name.c_str(), alignment);
+    if (data == NULL) {
+        if (bindings.erase(name) > 0) {
+            tensor->bindMemory(NULL, 0);
+        }
+        return;
+    }
+    // The buffer may be in a slot of a cached plan, it leaves the arena for good.
+    if (tensor->buffer() != NULL) {
+        mMemoryPlanner.detachBuffer(tensor->buffer());
+    }
+    tensor->bindMemory(data, size);
+    Binding binding = {reinterpret_cast<uint8*>(data), size};
+    bindings[name] = binding;
+}
+
+void SimpleNeuralNetwork::finishOutputBindings() {
+    for (auto it = mOutputBindings.begin(); it != mOutputBindings.end(); ++it) {
+        Tensor* tensor = getTensor(it->first);
+        const Binding& binding = it->second;
+        MAI_CHECK(tensor->size() <= binding.size, "Output %s needs %llu bytes, bound buffer has %llu",
+                it->first.c_str(), tensor->size(), binding.size);
+        // The output shares the buffer of another tensor(e.g. Reshape), so the
+        // operator did not write it.
+        if (tensor->data<uint8>() != binding.data) {
+            memcpy(binding.data, tensor->data<uint8>(), tensor->size());
+        }
+    }
+}
+
+std::string SimpleNeuralNetwork::inputShapeKey() {
+    std::string key;
+    for (const std::string& name : mModelInputs) {
+        key += name + ":" + shapeToString(getTensor(name)->shape()) + ";";
+    }
+    return key;
+}
+
+uint64 SimpleNeuralNetwork::getNaiveMemorySize() {
+    return mMemoryPlanner.naiveSize();
+}
+
+uint64 SimpleNeuralNetwork::getPlannedMemorySize() {
+    return mMemoryPlanner.plannedSize();
+}
+
+void SimpleNeuralNetwork::setNumThreads(int32 numThreads, bool pinThreads) {
+    MAI_CHECK(numThreads > 0, "Invalid thread number:%d", numThreads);
+    mComputePool.reset(new ComputeThreadPool(numThreads, pinThreads));
+}
+
+void SimpleNeuralNetwork::setNumInterOpThreads(int32 numThreads) {
+    MAI_CHECK(numThreads > 0, "Invalid thread number:%d", numThreads);
+    MAI_CHECK(!mMemoryPlanner.isPlanned(), "Inter-op threads must be set before the first run");
+    mThreadPool.reset(numThreads > 1 ? new ThreadPool(numThreads) : NULL);
+}
+
+std::unique_ptr<NeuralNetwork> SimpleNeuralNetwork::createSession() {
+    std::unique_ptr<SimpleNeuralNetwork> session(new SimpleNeuralNetwork());
+    session->setDevice(mDevice);
+    // operators of all sessions go to the same inter-op threads
+    session->mThreadPool = mThreadPool;
+    session->mComputePool = mComputePool;
+    session->mConstantCache = mConstantCache;
+    session->mModelInputs = mModelInputs;
+    session->mModelOutputs = mModelOutputs;
+
+    std::set<std::string> writtenTensors;
+    for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
+        const std::vector<std::string>& outputNames = (*it)->outputNames();
+        writtenTensors.insert(outputNames.begin(), outputNames.end());
+    }
+    for (const std::string& name : mTensorNames) {
+        Tensor* tensor = getTensor(name);
+        const bool isModelInput = std::find(mModelInputs.begin(), mModelInputs.end(), name)
+            != mModelInputs.end();
+        // weights are never written by the operators, so they are shared
+        const bool isShared = tensor->buffer() != NULL && (tensor->isConst()
+                || (writtenTensors.find(name) == writtenTensors.end() && !isModelInput));
+        std::unique_ptr<Tensor> sessionTensor;
+        if (isShared) {
+            sessionTensor.reset(new Tensor(tensor, true));
+        } else {
+            sessionTensor.reset(new Tensor(tensor->dataType(),
+                    mDevice ? mDevice->allocator() : tensor->allocator()));
+            sessionTensor->setName(name);
+            sessionTensor->setDataFormat(tensor->getDataFormat());
+            if (isModelInput && tensor->buffer() != NULL) {
+                sessionTensor->allocateBuffer(tensor->shape());
+            }
+        }
+        session->addTensor(sessionTensor);
+    }
+
+    for (auto it = mOperators.begin(); it != mOperators.end(); ++it) {
+        std::unique_ptr<Operator> op =
+            OperatorRegister::getInstance()->createOperator((*it)->opContext());
+        op->setName((*it)->name());
+        op->addInputNames((*it)->inputNames());
+        op->addOutputNames((*it)->outputNames());
+        const Param* param = (*it)->paramPrototype();
+        if (param != NULL) {
+            op->setParam(param->clone());
+        }
+        session->addOperator(op);
+    }
+    session->init();
+    return std::unique_ptr<NeuralNetwork>(session.release());
+}
+
 void SimpleNeuralNetwork::builGraph() {
+    // Same edges as mTensorsInDegreeMap/mTensorsOutDegreeMap, but keyed by the
+    // operator index, operator names are not guaranteed to be unique.
+    const int32 opSize = static_cast<int32>(mOperators.size());
+    std::map<std::string, std::vector<int32> > writers;
+    std::map<std::string, std::vector<int32> > readers;
+    for (int32 i = 0; i < opSize; ++i) {
+        for (const std::string& name : mOperators[i]->inputNames()) {
+            readers[name].push_back(i);
+        }
+        for (const std::string& name : mOperators[i]->outputNames()) {
+            writers[name].push_back(i);
+        }
+    }
 
+    // Every tensor keeps the order its writers and readers have in mOperators,
+    // so running the graph gives the same result as running them in order.
+    mGraph.reset(opSize);
+    for (auto it = writers.begin(); it != writers.end(); ++it) {
+        const std::vector<int32>& tensorWriters = it->second;
+        const std::vector<int32>& tensorReaders = readers[it->first];
+        for (int32 i = 0; i < static_cast<int32>(tensorWriters.size()); ++i) {
+            const int32 writer = tensorWriters[i];
+            for (int32 reader : tensorReaders) {
+                if (writer != reader) {
+                    mGraph.addEdge(std::min(writer, reader), std::max(writer, reader));
+                }
+            }
+            for (int32 j = i + 1; j < static_cast<int32>(tensorWriters.size()); ++j) {
+                if (writer != tensorWriters[j]) {
+                    mGraph.addEdge(writer, tensorWriters[j]);
+                }
+            }
+        }
+    }
+    mGraph.finalize();
+    mPendingInputs.reset(new std::atomic<int32>[opSize]);
 }
 
 } // namespace MAI
@@ -14,9 +14,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <vector>
 #include <map>
+#include <mutex>
 #include "include/NeuralNetwork.h"
+#include "MemoryPlanner.h"
+#include "Graph.h"
+#include "ThreadPool.h"
+#include "ComputeThreadPool.h"
 
 namespace MAI {
 
@@ -27,16 +34,21 @@ public:
     virtual MAI_STATUS init();
     virtual MAI_STATUS run();
     virtual MAI_STATUS run(Context* context);
+    virtual void runAsync(RunCallback callback);
+    using NeuralNetwork::runAsync;
     virtual MAI_STATUS addOperator(std::unique_ptr<Operator>& op);
     virtual MAI_STATUS removeOperator(const std::string& opName);
     virtual MAI_STATUS addTensor(std::unique_ptr<Tensor>& tensor);
     virtual MAI_STATUS removeTensor(const std::string& tensorName);
     virtual Tensor* getTensor(const std::string& name);
+    virtual int32 getTensorHandle(const std::string& name);
+    virtual Tensor* getTensorByHandle(int32 handle);
     virtual int32 getTensorInDegree(const std::string& name);
     virtual int32 getTensorOutDegree(const std::string& name);
     virtual std::vector<std::string> getTensorNames();
     virtual Operator* getOperator(const std::string& name);
     virtual std::vector<std::string> getOperatorNames();
+    virtual std::vector<Operator*> getOperators();
     virtual std::vector<std::string> getModelInputs();
     virtual std::vector<std::string> getModelOutputs();
     virtual void builGraph();
@@ -44,16 +56,61 @@ public:
             DataType dataType, DataFormat dataFormat,
             const std::vector<shape_t>& inputShape);
     virtual void addModelOutput(const std::string& outputName);
+    virtual MAI_STATUS resizeInputs(
+            const std::map<std::string, std::vector<shape_t> >& inputShapes);
+    virtual MAI_STATUS bindInput(const std::string& name, void* data, uint64 size);
+    virtual MAI_STATUS bindOutput(const std::string& name, void* data, uint64 size);
+    virtual uint64 getNaiveMemorySize();
+    virtual uint64 getPlannedMemorySize();
+    virtual void setNumThreads(int32 numThreads, bool pinThreads);
+    virtual void setNumInterOpThreads(int32 numThreads);
+    virtual std::unique_ptr<NeuralNetwork> createSession();
+private:
+    struct Binding {
+        uint8* data;
+        uint64 size;
+    };
+
+    MAI_STATUS runInOrder();
+    MAI_STATUS runGraph();
+    void startGraph(RunCallback callback);
+    void bindMemory(std::map<std::string, Binding>& bindings, const std::string& name,
+            void* data, uint64 size);
+    void finishOutputBindings();
+    // after a successful run(): copies bound outputs out, saves new cache entries
+    void finishRun();
+    std::string inputShapeKey();
+    void runOperatorFrom(int32 opIndex);
+    // run by the thread which finished the last operator of the graph
+    void finishGraph();
+    MAI_STATUS runOperator(Operator* op);
 private:
     std::vector<std::unique_ptr<Operator> > mOperators;
     std::vector<std::string> mOperatorNames;
     std::map<std::string, std::unique_ptr<Tensor> > mTensors;
     std::vector<std::string> mTensorNames;
+    std::map<std::string, int32> mTensorHandles;
+    std::vector<Tensor*> mTensorTable;// handle -> tensor
     std::vector<std::string> mModelInputs;
     std::vector<std::string> mModelOutputs;
+    std::map<std::string, Binding> mInputBindings;// caller-owned memory of model inputs
+    std::map<std::string, Binding> mOutputBindings;// caller-owned memory of model outputs
     std::map<std::string, std::vector<std::string>> mTensorsOutDegreeMap;// Tensor's out-degree
     std::map<std::string, std::vector<std::string>> mTensorsInDegreeMap;// Tensor's in-degree
-
+    MemoryPlanner mMemoryPlanner;
+    Graph mGraph;
+    std::shared_ptr<ComputeThreadPool> mComputePool;// shared with sessions
+    std::shared_ptr<ThreadPool> mThreadPool;// NULL if operators run in order, shared with sessions
+    std::unique_ptr<ThreadPool> mAsyncThread;// runs runAsync() without mThreadPool
+    RunCallback mRunCallback;// of the running runAsync(), empty for run(), guarded by mRunMutex
+    std::unique_ptr<std::atomic<int32>[]> mPendingInputs;// op index -> unfinished predecessors
+    std::atomic<int32> mPendingOperators;
+    std::atomic<MAI_STATUS> mRunStatus;// first failure of the running graph
+    std::mutex mRunMutex;
+    std::condition_variable mRunCondition;
+    bool mGraphDone;// guarded by mRunMutex
+    std::mutex mProfileMutex;
+    bool mRunFirst;
 };
 
 } // namespace MAI
@@ -50,8 +50,9 @@ Tensor::Tensor(const Tensor* tensor, bool reuseBuffer) {
     mFlag = tensor->mFlag;
     mAllocator = tensor->mAllocator;
     if (reuseBuffer) {
-        MAI_CHECK(mBuffer != NULL, "Tensor(%s) cannot reuse buffer as buffer is null", mName.c_str());
+        MAI_CHECK(tensor->mBuffer != NULL, "Tensor(%s) cannot reuse buffer as buffer is null", mName.c_str());
         mBuffer = tensor->mBuffer;
+        mShape = tensor->mShape;
         mFlag &= ~MEMORY_OWNER;
     } else {
         mBuffer = NULL;
@@ -152,6 +153,9 @@ uint64 Tensor::size() const {
 }
 
 void Tensor::reuse(const Tensor* tensor) {
+    if ((mFlag & MEMORY_OWNER) && mBuffer != NULL && mBuffer != tensor->mBuffer) {
+        delete mBuffer;
+    }
     mFlag &= ~MEMORY_OWNER;
     mDataType = tensor->mDataType;
     mBuffer = tensor->mBuffer;
@@ -159,6 +163,21 @@ void Tensor::reuse(const Tensor* tensor) {
     mAllocator = tensor->mAllocator;
 }
 
+void Tensor::bindMemory(void* data, uint64 size) {
+    if (mBuffer == NULL) {
+        MAI_CHECK(mAllocator != NULL, "Allocator cannot be null");
+        mBuffer = mAllocator->allocateBuffer(0);
+        MAI_CHECK_NULL(mBuffer);
+        mFlag |= MEMORY_OWNER;
+    }
+    mBuffer->release();
+    if (data != NULL) {
+        mBuffer->setBufferAddr(reinterpret_cast<uint8*>(data), 0, size);
+    } else {
+        mBuffer->allocate(this->size());
+    }
+}
+
 void Tensor::reshape(const std::vector<shape_t>& shape) {
     //TODO (gavinchen) check accumulate size of shape and mShape is equal
     mShape = shape;
@@ -0,0 +1,62 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ThreadPool.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+
+ThreadPool::ThreadPool(int32 numThreads) : mStop(false) {
+    MAI_CHECK(numThreads > 0, "Invalid thread number:%d", numThreads);
+    for (int32 i = 0; i < numThreads; ++i) {
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::schedule(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.emplace_back(std::move(task));
+    }
+    mCondition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() {return mStop || !mTasks.empty();});
+            if (mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace MAI
@@ -0,0 +1,52 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+
+// A fixed set of worker threads which take tasks from one FIFO queue.
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+
+    ThreadPool(int32 numThreads);
+    ~ThreadPool();
+
+    void schedule(Task task);
+
+    inline int32 numThreads() const {
+        return static_cast<int32>(mWorkers.size());
+    }
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::deque<Task> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStop;
+};
+
+} // namespace MAI
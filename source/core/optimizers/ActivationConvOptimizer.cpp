@@ -0,0 +1,85 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <map>
+#include "ActivationConvOptimizer.h"
+#include "NeuralNetwork.h"
+
+namespace MAI {
+
+void ActivationConvOptimizer::optimize() {
+    std::vector<Operator*> operators = mNeuralNetwork->getOperators();
+    std::vector<std::string> modelOutputs = mNeuralNetwork->getModelOutputs();
+    std::map<std::string, std::vector<Operator*> > consumers;
+    for (Operator* op : operators) {
+        for (const std::string& inputName : op->inputNames()) {
+            consumers[inputName].push_back(op);
+        }
+    }
+
+    // found first, folding removes operators
+    std::vector<std::pair<Operator*, Operator*> > folds;
+    for (Operator* op : operators) {
+        if ((op->type() != CONV2D && op->type() != DEPTHWISE_CONV2D)
+                || op->paramPrototype() == NULL) {
+            continue;
+        }
+        const std::string& output = op->outputName(0);
+        const std::vector<Operator*>& outputConsumers = consumers[output];
+        if (outputConsumers.size() != 1
+                || std::find(modelOutputs.begin(), modelOutputs.end(), output) != modelOutputs.end()) {
+            continue;
+        }
+        Operator* nextOp = outputConsumers[0];
+        if (nextOp->type() == RELU || nextOp->type() == RELU6) {
+            folds.emplace_back(op, nextOp);
+        }
+    }
+    for (const auto& fold : folds) {
+        foldActivationIntoConv2d(fold.first, fold.second);
+    }
+}
+
+// A clone of prototype with activation, NULL if it already has one
+template<typename ParamType>
+static Param* cloneWithActivation(const Param* prototype, FusedActivation activation) {
+    if (reinterpret_cast<const ParamType*>(prototype)->activation != FUSED_ACTIVATION_NONE) {
+        return NULL;
+    }
+    ParamType* param = reinterpret_cast<ParamType*>(prototype->clone());
+    param->activation = activation;
+    return param;
+}
+
+void ActivationConvOptimizer::foldActivationIntoConv2d(
+        Operator* conv2d, Operator* activation) {
+    const FusedActivation fused = activation->type() == RELU
+        ? FUSED_ACTIVATION_RELU : FUSED_ACTIVATION_RELU6;
+    Param* param = conv2d->type() == CONV2D
+        ? cloneWithActivation<Conv2DParam>(conv2d->paramPrototype(), fused)
+        : cloneWithActivation<DepthwiseConv2dParam>(conv2d->paramPrototype(), fused);
+    if (param == NULL) {
+        return;
+    }
+    // through setParam() so the prototype(sessions, MAI models) has it too
+    conv2d->setParam(param);
+
+    std::string output = conv2d->outputName(0);
+    conv2d->replaceOutputName(output, activation->outputName(0));
+    mNeuralNetwork->removeOperator(activation->name());
+    mNeuralNetwork->removeTensor(output);
+}
+
+} // namespace MAI
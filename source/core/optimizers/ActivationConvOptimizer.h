@@ -14,19 +14,21 @@
 
 #pragma once
 
-#include <omp.h>
+#include "Optimizer.h"
+#include "Operator.h"
 
 namespace MAI {
 
-class OpenMP {
+// Folds a Relu/Relu6 which is the only consumer of a Conv2D or
+// DepthwiseConv2d output into the conv(activation of its param), the conv
+// applies it while storing.
+class ActivationConvOptimizer : public Optimizer {
 public:
-    inline static void setNumThreads(int32 numThread) {
-        omp_set_num_threads(numThread);
-    }
-
-    inline static int32 getNumCPUCores() {
-        return omp_get_num_procs();
-    }
+    ActivationConvOptimizer(NeuralNetwork* network) : Optimizer(network) {}
+    virtual ~ActivationConvOptimizer() = default;
+    void optimize();
+private:
+    void foldActivationIntoConv2d(Operator* conv2d, Operator* activation);
 };
 
 } // namespace MAI
@@ -55,14 +55,14 @@ void ConstFoldOptimizer::optimize() {
                 //ALOGI("addOperator:%s", node.name.c_str());
 
                 //FIXME: got a real data type
-                std::unique_ptr<Operator> op =
-                    OperatorRegister::getInstance()->createOperator({originalOperator->type(), DT_INT32});
+                std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator(
+                        OpContextBuilder().setOperatorType(originalOperator->type()).setDataType(DT_INT32).build());
                 op->addInputNames(originalOperator->inputNames());
                 op->addOutputNames(originalOperator->outputNames());
                 op->setName(originalOperator->name());
                 op->setType(originalOperator->type());
-                //FIXME: This param will be delete by twice
-                op->setParam(originalOperator->getParam());
+                const Param* param = originalOperator->paramPrototype();
+                op->setParam(param != NULL ? param->clone() : NULL);
                 subNetwork->addOperator(op);
                 //ALOGI("addOperator:%s end", node.name.c_str());
             }
@@ -12,51 +12,34 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "core/OperatorRegister.h"
-#include "util/MAIUtil.h"
 #include "Broadcast.h"
 
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 namespace MAI {
 namespace Op {
 namespace CPU {
 
-template<class T>
-class Add : public Broadcast<T, T> {
-public:
-    MAI_STATUS onCommonCompute(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) {
-        ALOGI("Add::onCommonCompute=============");
-        const T* inputAData = inputA->data<T>();
-        const T* inputBData = inputB->data<T>();
-        T* outputData = output->mutableData<T>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < output->elementSize(); ++i) {
-            outputData[i] = inputAData[i] + inputBData[i];
-        }
-        return MAI_SUCCESS;
-    }
+namespace {
 
-    MAI_STATUS onScalarCompute(const Tensor* input, const T inputScalar,
-            Tensor* output, bool convertInput) {
-        const T* inputData = input->data<T>();
-        T* outputData = output->mutableData<T>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < input->elementSize(); ++i) {
-            outputData[i] = inputData[i] + inputScalar;
-        }
-        return MAI_SUCCESS;
-    }
+struct AddFunctor {
+    static const int64 kCost = 1;
 
-    MAI_STATUS onBroadcastCompute() {
-        auto addFunc = [](const T* x, const T* y, T* o) {
-            *o = *x + *y;
-        };
-        return this->broadcastCompute(addFunc);
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& a, const V& b) const {
+        return a + b;
     }
 };
 
+} // namespace
+
+template<typename T> using Add = Broadcast<T, T, AddFunctor>;
+
 void registerAdd() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(ADD).build()), float, Add);
+    registerElementWise<Add, float, int32>(OpContextBuilder().setOperatorType(ADD).build());
 }
 
 } // namespace CPU
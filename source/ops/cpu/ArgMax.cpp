@@ -23,14 +23,14 @@ namespace CPU {
 template<typename T>
 class ArgMax : public Operator {
 public:
-    ArgMax() : mAxis(0), mOuterSize(1), mInnerSize(1), mParam(NULL), mRunFirst(true) {}
+    ArgMax() : mAxis(0), mOuterSize(1), mInnerSize(1), mParam(NULL) {}
     ~ArgMax() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<ArgMaxParam*>(param);
     }
 
@@ -96,6 +96,8 @@ public:
         }
         outputTensor->resize(outputShape);
         // compute mOuterSize & mInnerSize
+        mOuterSize = 1;
+        mInnerSize = 1;
         for (int32 i = 0; i < dimSize; ++i) {
             if (i < mAxis) {
                 mOuterSize *= inputTensor->dim(i);
@@ -120,7 +122,6 @@ private:
     int32 mOuterSize;
     int32 mInnerSize;
     ArgMaxParam* mParam;
-    bool mRunFirst;
 };
 
 void registerArgMax() {
@@ -23,14 +23,14 @@ namespace CPU {
 template<typename T>
 class ArgMin : public Operator {
 public:
-    ArgMin() : mAxis(0), mOuterSize(1), mInnerSize(1), mParam(NULL), mRunFirst(true) {}
+    ArgMin() : mAxis(0), mOuterSize(1), mInnerSize(1), mParam(NULL) {}
     ~ArgMin() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<ArgMinParam*>(param);
     }
 
@@ -96,6 +96,8 @@ public:
         }
         outputTensor->resize(outputShape);
         // compute mOuterSize & mInnerSize
+        mOuterSize = 1;
+        mInnerSize = 1;
         for (int32 i = 0; i < dimSize; ++i) {
             if (i < mAxis) {
                 mOuterSize *= inputTensor->dim(i);
@@ -120,7 +122,6 @@ private:
     int32 mOuterSize;
     int32 mInnerSize;
     ArgMinParam* mParam;
-    bool mRunFirst;
 };
 
 void registerArgMin() {
@@ -23,14 +23,14 @@ namespace CPU {
 template<typename T>
 class BiasAdd : public Operator {
 public:
-    BiasAdd() : mRunFirst(true) {}
+    BiasAdd() {}
     ~BiasAdd() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         MAI_ABORT("Unsupported setParam for BiasAdd");
     }
 
@@ -102,7 +102,6 @@ private:
     std::function<void(const T*, const std::vector<shape_t>&,
             const T*, const std::vector<shape_t>&,
             T*, const std::vector<shape_t>&)> mFunction;
-    bool mRunFirst;
 };
 
 void registerBiasAdd() {
@@ -0,0 +1,84 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Broadcast.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+namespace {
+
+struct CollapsedDim {
+    int64 size;
+    bool runA;// false if a is broadcast in it
+    bool runB;
+};
+
+} // namespace
+
+BroadcastPlan makeBroadcastPlan(const std::vector<shape_t>& shapeA,
+        const std::vector<shape_t>& shapeB) {
+    const size_t rank = std::max(shapeA.size(), shapeB.size());
+    const size_t deltaA = rank - shapeA.size();
+    const size_t deltaB = rank - shapeB.size();
+    BroadcastPlan plan;
+    plan.size = 1;
+    std::vector<CollapsedDim> dims;
+    for (size_t i = 0; i < rank; ++i) {
+        const int64 dimA = i >= deltaA ? shapeA[i - deltaA] : 1;
+        const int64 dimB = i >= deltaB ? shapeB[i - deltaB] : 1;
+        MAI_CHECK(dimA == dimB || dimA == 1 || dimB == 1, "Cannot broadcast %s and %s",
+                shapeToString(shapeA).c_str(), shapeToString(shapeB).c_str());
+        const int64 size = dimA == 1 ? dimB : dimA;
+        plan.size *= size;
+        if (size == 1) {
+            continue;
+        }
+        const CollapsedDim dim = {size, dimA != 1, dimB != 1};
+        if (!dims.empty() && dims.back().runA == dim.runA && dims.back().runB == dim.runB) {
+            dims.back().size *= size;
+        } else {
+            dims.push_back(dim);
+        }
+    }
+    if (dims.empty() || plan.size == 0) {
+        dims.assign(1, {1, true, true});
+    }
+
+    const CollapsedDim& row = dims.back();
+    plan.rowSize = row.size;
+    plan.row = !row.runA ? BROADCAST_ROW_SCALAR_VECTOR
+        : (!row.runB ? BROADCAST_ROW_VECTOR_SCALAR : BROADCAST_ROW_VECTOR_VECTOR);
+
+    const size_t outerSize = dims.size() - 1;
+    plan.outerDims.resize(outerSize);
+    plan.outerStrideA.resize(outerSize);
+    plan.outerStrideB.resize(outerSize);
+    int64 strideA = row.runA ? row.size : 1;
+    int64 strideB = row.runB ? row.size : 1;
+    for (int64 d = static_cast<int64>(outerSize) - 1; d >= 0; --d) {
+        plan.outerDims[d] = dims[d].size;
+        plan.outerStrideA[d] = dims[d].runA ? strideA : 0;
+        plan.outerStrideB[d] = dims[d].runB ? strideB : 0;
+        strideA *= dims[d].runA ? dims[d].size : 1;
+        strideB *= dims[d].runB ? dims[d].size : 1;
+    }
+    return plan;
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
@@ -12,115 +12,216 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "ElementWise.h"
+#include "Simd.h"
+#include "core/ComputeThreadPool.h"
 #include "core/OperatorRegister.h"
 #include "util/MAIUtil.h"
 
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 namespace MAI {
 namespace Op {
 namespace CPU {
 
-//static int computeOffset(const std::vector<shape_t>& dims, const std::vector<shape_t>& strides) {
-//    int offset = 0;
-//    for (int32 i = 0; i < dims.size(); ++i) {
-//        offset += dims[i] * strides[i];
-//    }
-//    ALOGI("computeOffset dims:%s strides:%s offset:%d", shapeToString(dims).c_str(), shapeToString(strides).c_str(), offset);
-//    return offset;
-//}
-
-template<class TI, class TO, int N, int I = 1>
-struct RecursiveFor {
-    using BinaryFunc = std::function<void(const TI* inputA, const TI* inputB, TO* output)>;
-    static void recursiveFor(
-            const TI* inputA, const std::vector<shape_t>& strideA,
-            const TI* inputB, const std::vector<shape_t>& strideB,
-            TO* output, const std::vector<shape_t>& strideO,
-            const std::vector<shape_t>& loopShape,
-            BinaryFunc func) {
-        for (int i = 0; i < loopShape[I - 1]; ++i) {
-            RecursiveFor<TI, TO, N, I + 1>::recursiveFor(
-                    inputA + i * strideA[I - 1], strideA,
-                    inputB + i * strideB[I - 1], strideB,
-                    output + i * strideO[I - 1], strideO, loopShape, func);
+// Binary element-wise operators with numpy broadcasting:
+// output[i] = f(a[i], b[i]) with a functor
+//
+//     struct F {
+//         static const int64 kCost = 1;// work of one element, see grainSize()
+//         template<typename V>
+//         MAI_SIMD_INLINE V operator()(const V& a, const V& b) const;
+//     };
+//
+// instantiated like the ones of ElementWise.h: for the data type and, if
+// input and output are float, for every Simd vector.
+//
+// The shapes are collapsed once: dimensions of size 1 go away and
+// neighbours merge if each input runs along both or is broadcast in both.
+// The innermost collapsed dimension is the row, which is one of
+//   vector-vector: both inputs run along it(also "same shape" and
+//                  row broadcasts like a bias, whose row offset stays 0)
+//   scalar-vector: a is one value per row, b runs along it
+//   vector-scalar: a runs along it, b is one value per row
+// so a row is a compile time specialized loop. The outer dimensions only
+// move the row offsets. The output elements are split in chunks of
+// grainSize(F::kCost) over the threads of the current ComputeThreadPool,
+// a chunk may start or end within a row.
+
+enum BroadcastRow {
+    BROADCAST_ROW_VECTOR_VECTOR,
+    BROADCAST_ROW_SCALAR_VECTOR,
+    BROADCAST_ROW_VECTOR_SCALAR,
+    BROADCAST_ROW_COUNT,
+};
+
+struct BroadcastPlan {
+    int64 size;// of the output
+    int64 rowSize;
+    BroadcastRow row;
+    // collapsed dimensions outside the row, outermost first, and the
+    // strides of a and b in them(0 if broadcast)
+    std::vector<int64> outerDims;
+    std::vector<int64> outerStrideA;
+    std::vector<int64> outerStrideB;
+};
+
+// Aborts if the shapes do not broadcast.
+BroadcastPlan makeBroadcastPlan(const std::vector<shape_t>& shapeA,
+        const std::vector<shape_t>& shapeB);
+
+// Position of a row in the outer dimensions and the offsets of a and b there
+struct BroadcastCursor {
+    BroadcastCursor(const BroadcastPlan& plan, int64 row) : mPlan(plan),
+            mIndex(plan.outerDims.size()), offsetA(0), offsetB(0) {
+        for (int64 d = static_cast<int64>(mIndex.size()) - 1; d >= 0; --d) {
+            mIndex[d] = row % plan.outerDims[d];
+            row /= plan.outerDims[d];
+            offsetA += mIndex[d] * plan.outerStrideA[d];
+            offsetB += mIndex[d] * plan.outerStrideB[d];
         }
     }
-};
 
-template<class TI, class TO, int N>
-struct RecursiveFor<TI, TO, N, N> {
-    using BinaryFunc = std::function<void(const TI* inputA, const TI* inputB, TO* output)>;
-    static void recursiveFor(
-            const TI* inputA, const std::vector<shape_t>& strideA,
-            const TI* inputB, const std::vector<shape_t>& strideB,
-            TO* output, const std::vector<shape_t>& strideO,
-            const std::vector<shape_t>& loopShape,
-            BinaryFunc func) {
-        constexpr int I = N - 1;
-        ALOGI("before last loop>>>>>>>>>>>>>>>");
-        for (int i = 0; i < loopShape[I]; ++i) {
-            //ALOGI("inputAData offset=%d, bOffset=%d, oOffset=%d\n", strideA[I] * i, strideB[I] * i, strideO[I] * i);
-            func(inputA + strideA[I] * i,
-                    inputB + strideB[I] * i,
-                    output + strideO[I] * i);
-            //for (int j = 0; j < dims.size(); j++) {
-            //ss << dims[j] << " ";
-            //}
-            //ss << i;
-            //printf("iterator:%s\n", ss.str().c_str());
+    void next() {
+        for (int64 d = static_cast<int64>(mIndex.size()) - 1; d >= 0; --d) {
+            offsetA += mPlan.outerStrideA[d];
+            offsetB += mPlan.outerStrideB[d];
+            if (++mIndex[d] < mPlan.outerDims[d]) {
+                return;
+            }
+            offsetA -= mIndex[d] * mPlan.outerStrideA[d];
+            offsetB -= mIndex[d] * mPlan.outerStrideB[d];
+            mIndex[d] = 0;
         }
-        ALOGI("after last loop<<<<<<<<<<<<");
     }
-};
 
-template<class TI, class TO>
-class Broadcast : public Operator {
+private:
+    const BroadcastPlan& mPlan;
+    std::vector<int64> mIndex;
+
 public:
-    using BinaryFunc = std::function<void(const TI* inputA, const TI* inputB, TO* output)>;
-    Broadcast() : mRunFirst(true) {}
-    ~Broadcast() {
+    int64 offsetA;
+    int64 offsetB;
+};
+
+template<typename TI, typename TO, typename F, bool ROW_A, bool ROW_B>
+void mapBinaryScalar(const F& f, const TI* a, const TI* b, int64 size, TO* output) {
+    for (int64 i = 0; i < size; ++i) {
+        output[i] = f(a[ROW_A ? i : 0], b[ROW_B ? i : 0]);
+    }
+}
+
+template<typename V, bool ROW_A, bool ROW_B, typename F>
+MAI_SIMD_INLINE void mapBinary(const F& f, const float* a, const float* b, int64 size, float* output) {
+    const V scalarA = Simd::splat<V>(a[0]);
+    const V scalarB = Simd::splat<V>(b[0]);
+    int64 i = 0;
+    for (; i + Simd::Lanes<V>::value <= size; i += Simd::Lanes<V>::value) {
+        Simd::store(output + i, f(ROW_A ? Simd::load<V>(a + i) : scalarA,
+                    ROW_B ? Simd::load<V>(b + i) : scalarB));
     }
+    for (; i < size; ++i) {
+        output[i] = f(a[ROW_A ? i : 0], b[ROW_B ? i : 0]);
+    }
+}
 
-    MAI_STATUS init() override {
-        return MAI_SUCCESS;
+#define MAI_BINARY_KERNEL(SUFFIX, TARGET, V)                                          \
+    template<typename F, bool ROW_A, bool ROW_B>                                      \
+    TARGET void mapBinary##SUFFIX(const F& f, const float* a, const float* b,         \
+            int64 size, float* output) {                                              \
+        mapBinary<V, ROW_A, ROW_B>(f, a, b, size, output);                            \
     }
 
-    virtual MAI_STATUS onCommonCompute(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) = 0;
+MAI_BINARY_KERNEL(Generic, , Simd::Float4)
+#ifdef MAI_SIMD_X86
+MAI_BINARY_KERNEL(Avx2, MAI_SIMD_TARGET_AVX2, Simd::Float8)
+MAI_BINARY_KERNEL(Avx512, MAI_SIMD_TARGET_AVX512, Simd::Float16)
+#endif
 
-    virtual MAI_STATUS onScalarCompute(const Tensor* input, const TI inputScalar,
-            Tensor* output, bool convertInput = false) = 0;
+#undef MAI_BINARY_KERNEL
 
-    virtual MAI_STATUS onBroadcastCompute() = 0;
+template<typename TI, typename TO, typename F>
+struct BinaryKernel {
+    typedef void (*Row)(const F& f, const TI* a, const TI* b, int64 size, TO* output);
 
-    MAI_STATUS broadcastCompute(BinaryFunc func) {
-        const Tensor* inputA = getInputTensor(0);
-        const Tensor* inputB = getInputTensor(1);
-        Tensor* output = getOutputTensor(0);
-        std::function<void(const TI* inputA, const std::vector<shape_t>& strideA,
-            const TI* inputB, const std::vector<shape_t>& strideB,
-            TO* output, const std::vector<shape_t>& strideO,
-            const std::vector<shape_t>& loopShape,
-            BinaryFunc func)> RecursiveForFunc;
-
-        if (output->dimSize() == 4) {
-            RecursiveForFunc = RecursiveFor<TI, TO, 4>::recursiveFor;
-        } else if (output->dimSize() == 3) {
-            RecursiveForFunc = RecursiveFor<TI, TO, 3>::recursiveFor;
-        } else if (output->dimSize() == 2) {
-            RecursiveForFunc = RecursiveFor<TI, TO, 2>::recursiveFor;
-        } else if (output->dimSize() == 1) {
-            RecursiveForFunc = RecursiveFor<TI, TO, 1>::recursiveFor;
-        } else {
-            MAI_ABORT("Unsupport dimSize:%d", output->dimSize());
+    uint32 cpuFeatures;
+    Row rows[BROADCAST_ROW_COUNT];// by BroadcastRow
+};
+
+// Scalar loops for the other data types
+template<typename TI, typename TO, typename F>
+struct BinaryKernels {
+    static const BinaryKernel<TI, TO, F>& select(uint32 /*cpuFeatures*/) {
+        static const BinaryKernel<TI, TO, F> kernel = {0, {mapBinaryScalar<TI, TO, F, true, true>,
+            mapBinaryScalar<TI, TO, F, false, true>, mapBinaryScalar<TI, TO, F, true, false>}};
+        return kernel;
+    }
+};
+
+template<typename F>
+struct BinaryKernels<float, float, F> {
+    static const BinaryKernel<float, float, F>& select(uint32 cpuFeatures) {
+#define MAI_BINARY_ROWS(MAP) {MAP<F, true, true>, MAP<F, false, true>, MAP<F, true, false>}
+        // widest first
+        static const BinaryKernel<float, float, F> kernels[] = {
+#ifdef MAI_SIMD_X86
+            {CPU_FEATURE_AVX512F, MAI_BINARY_ROWS(mapBinaryAvx512)},
+            {CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, MAI_BINARY_ROWS(mapBinaryAvx2)},
+#endif
+            {0, MAI_BINARY_ROWS(mapBinaryGeneric)},
+        };
+#undef MAI_BINARY_ROWS
+        for (const BinaryKernel<float, float, F>& kernel : kernels) {
+            if ((kernel.cpuFeatures & cpuFeatures) == kernel.cpuFeatures) {
+                return kernel;
+            }
         }
+        return kernels[sizeof(kernels) / sizeof(kernels[0]) - 1];
+    }
+};
+
+template<typename TI, typename TO, typename F>
+void broadcast(const F& f, const BroadcastPlan& plan, const TI* a, const TI* b, TO* output,
+        uint32 cpuFeatures) {
+    const typename BinaryKernel<TI, TO, F>::Row map =
+        BinaryKernels<TI, TO, F>::select(cpuFeatures).rows[plan.row];
+    const bool rowA = plan.row != BROADCAST_ROW_SCALAR_VECTOR;
+    const bool rowB = plan.row != BROADCAST_ROW_VECTOR_SCALAR;
+    parallelFor(0, plan.size, grainSize(F::kCost), [&](int64 begin, int64 end) {
+        if (begin >= end) {
+            return;
+        }
+        BroadcastCursor cursor(plan, begin / plan.rowSize);
+        int64 column = begin % plan.rowSize;
+        for (int64 i = begin; i < end;) {
+            const int64 count = std::min(plan.rowSize - column, end - i);
+            map(f, a + cursor.offsetA + (rowA ? column : 0), b + cursor.offsetB + (rowB ? column : 0),
+                    count, output + i);
+            i += count;
+            column = 0;
+            cursor.next();
+        }
+    });
+}
 
-        RecursiveForFunc(inputA->data<TI>(), mStrideA,
-                    inputB->data<TI>(), mStrideB,
-                    output->mutableData<TO>(), mStrideO, output->shape(), func);
+template<class TI, class TO, class F>
+class Broadcast : public Operator {
+public:
+    Broadcast() {}
+    ~Broadcast() = default;
+
+    MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-
     MAI_STATUS run() override {
         const Tensor* inputA = getInputTensor(0);
         const Tensor* inputB = getInputTensor(1);
@@ -130,70 +231,23 @@ public:
         MAI_CHECK_NULL(inputA);
         MAI_CHECK_NULL(inputB);
         MAI_CHECK_NULL(output);
-        auto outputShape = broadcastShape(inputA->shape(), inputB->shape());
-        output->resize(outputShape);
-        mStrideA.resize(outputShape.size());
-        mStrideB.resize(outputShape.size());
-        mStrideO.resize(outputShape.size());
-        ALOGI("inputA Shape:%s", shapeToString(inputA->shape()).c_str());
-        ALOGI("inputB Shape:%s", shapeToString(inputB->shape()).c_str());
-        ALOGI("output Shape:%s", shapeToString(output->shape()).c_str());
-        computeStride(inputA, inputB, output);
-        ALOGI("strideA:%s", shapeToString(mStrideA).c_str());
-        ALOGI("strideB:%s", shapeToString(mStrideB).c_str());
-        ALOGI("strideO:%s", shapeToString(mStrideO).c_str());
+        mPlan = makeBroadcastPlan(inputA->shape(), inputB->shape());
+        output->resize(broadcastShape(inputA->shape(), inputB->shape()));
         MAI_OP_RUN_FIRST_END
 
-        if (isShapeSame(inputA->shape(), inputB->shape())) {
-            onCommonCompute(inputA, inputB, output);
-        } else if (inputA->elementSize() == 1) {
-            onScalarCompute(inputB, *(inputA->data<TI>()), output, true);
-        } else if (inputB->elementSize() == 1) {
-            onScalarCompute(inputA, *(inputB->data<TI>()), output);
-        } else {
-            onBroadcastCompute();
-        }
-
+        broadcast(F(), mPlan, inputA->data<TI>(), inputB->data<TI>(),
+                output->mutableData<TO>(), opContext().cpuFeatures);
         return MAI_SUCCESS;
     }
 
-    void computeStride(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) {
-        const auto& outputShape = output->shape();
-        shape_t strideA = 1;
-        shape_t strideB = 1;
-        shape_t strideO = 1;
-        int32 dDeltA = outputShape.size() - inputA->dimSize();
-        int32 dDeltB = outputShape.size() - inputB->dimSize();
-        mStrideA[outputShape.size() - 1] = inputA->dim(inputA->dimSize() - 1) != 1 ? 1 : 0;
-        mStrideB[outputShape.size() - 1] = inputB->dim(inputB->dimSize() - 1) != 1 ? 1 : 0;
-        mStrideO[outputShape.size() - 1] = 1;
-        for (int32 i = outputShape.size() - 2; i >= 0; --i) {
-            if (i >= dDeltA) {
-                int32 dimA = inputA->dim(i - dDeltA + 1);
-                strideA *= dimA;
-                mStrideA[i] = inputA->dim(i - dDeltA) != 1 ? strideA : 0;
-            } else {
-                mStrideA[i] = 0;
-            }
-            if (i >= dDeltB) {
-                int32 dimB = inputB->dim(i - dDeltB + 1);
-                strideB *= dimB;
-                mStrideB[i] = inputB->dim(i - dDeltB) != 1 ? strideB : 0;
-            } else {
-                mStrideB[i] = 0;
-            }
-            strideO *= output->dim(i + 1);
-            mStrideO[i] = strideO;
-        }
-    }
 private:
-    bool mRunFirst;
-    std::vector<shape_t> mStrideA;
-    std::vector<shape_t> mStrideB;
-    std::vector<shape_t> mStrideO;
+    BroadcastPlan mPlan;
 };
 
 } // namespace CPU
 } // namespace Op
 } // namespace MAI
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
@@ -36,6 +36,7 @@ DECLARE_REGISTER_OP(CRelu);
 DECLARE_REGISTER_OP(LeakyRelu);
 DECLARE_REGISTER_OP(Sigmoid);
 DECLARE_REGISTER_OP(Softmax);
+DECLARE_REGISTER_OP(LogSoftmax);
 DECLARE_REGISTER_OP(FusedBatchNorm);
 DECLARE_REGISTER_OP(Cast);
 DECLARE_REGISTER_OP(Floor);
@@ -112,6 +113,7 @@ private:
         REGISTER_OP(LeakyRelu);
         REGISTER_OP(Sigmoid);
         REGISTER_OP(Softmax);
+        REGISTER_OP(LogSoftmax);
         REGISTER_OP(FusedBatchNorm);
         REGISTER_OP(Cast);
         REGISTER_OP(Floor);
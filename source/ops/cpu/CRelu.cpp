@@ -22,7 +22,7 @@ namespace CPU {
 template<typename T>
 class CRelu : public Operator {
 public:
-    CRelu() : mRunFirst(true) {}
+    CRelu() {}
     ~CRelu() = default;
 
     MAI_STATUS init() override {
@@ -58,8 +58,6 @@ public:
         }
         return MAI_SUCCESS;
     }
-private:
-    bool mRunFirst;
 };
 
 void registerCRelu() {
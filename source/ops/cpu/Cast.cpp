@@ -47,7 +47,7 @@ void cast(const Tensor* input, Tensor* output) {
 
 class Cast : public Operator {
 public:
-    Cast() : mRunFirst(true) {}
+    Cast() {}
     ~Cast() = default;
 
     MAI_STATUS init() override {
@@ -85,8 +85,6 @@ public:
                 getNameFromDataType(output->dataType()).c_str());
         return MAI_FAILED;
     }
-private:
-    bool mRunFirst;
 };
 
 void registerCast() {
@@ -22,14 +22,14 @@ namespace CPU {
 
 class Concat : public Operator {
 public:
-    Concat() : mNum(0), mAxis(0), mOuterSize(1), mInnerSize(1), mRunFirst(true) {}
+    Concat() : mNum(0), mAxis(0), mOuterSize(1), mInnerSize(1) {}
     ~Concat() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         ConcatParam* concatParam = reinterpret_cast<ConcatParam*>(param);
         if (concatParam) {
             mNum = concatParam->num;
@@ -67,6 +67,8 @@ public:
         MAI_CHECK_NULL(output);
         output->resize(outputShape);
 
+        mOuterSize = 1;
+        mInnerSize = 1;
         for (shape_t i = 0; i < outputShape.size(); ++i) {
             if (i < (shape_t)mAxis) {
                 mOuterSize *= outputShape[i];
@@ -95,7 +97,6 @@ private:
     int32 mAxis;
     shape_t mOuterSize;
     shape_t mInnerSize;
-    bool mRunFirst;
 };
 
 void registerConcat() {
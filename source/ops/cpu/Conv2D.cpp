@@ -12,23 +12,36 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string.h>
 #include <algorithm>
+#include <limits>
 #include "core/OperatorRegister.h"
 #include "util/MAIUtil.h"
-//#ifdef MAI_NEON_ENABLED
-//#include "neon/TransposeNeon.h"
-//#else
+#include "core/ComputeThreadPool.h"
 #include "ref/Conv2DRef.h"
-//#endif
+#include "Sgemm.h"
+#include "Winograd.h"
 
 namespace MAI {
 namespace Op {
 namespace CPU {
 
+// Elements of the im2col matrix built at once, the output is computed in
+// steps of as many rows(NHWC) or columns(NCHW) as fit.
+const int64 kIm2colBufferSize = 1 << 18;
+// Channels below which Winograd transforms cost more than they save
+const int32 kWinogradMinChannels = 16;
+
+// Each group is lowered to im2col and a GEMM with the filter(HWIO and OIHW
+// already are the GEMM operand in place), bias and activation are applied
+// in the GEMM epilogue. 1x1 convs skip im2col, 3x3 stride 1 NHWC convs with
+// enough channels run Winograd instead. Grouped convs run one GEMM per image
+// and group on filters packed at the first run.
 template<typename T>
 class Conv2D : public Operator {
 public:
-    Conv2D() : mParam(NULL), mRunFirst(true) {}
+    Conv2D() : mParam(NULL), mPreferredKernel(KERNEL_GEMM), mKernel(KERNEL_GEMM),
+        mWinogradTile(0), mTransformedFilter(NULL), mGroupFilterSize(0) {}
     ~Conv2D() {
         if (mParam != NULL) {
             delete mParam;
@@ -40,7 +53,10 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
+        if (mParam != NULL && mParam != param) {
+            delete mParam;
+        }
         mParam = reinterpret_cast<Conv2DParam*>(param);
     }
 
@@ -56,13 +72,7 @@ public:
         MAI_CHECK_NULL(mParam);
         MAI_CHECK(mInput->shape().size() == 4, "Input shape must be 4-d");
         MAI_CHECK(checkVectorValues(mParam->dilations, 1), "Cannot support dilations greater than 1 now");
-        if (mParam->paddingMode != INVALID) {
-            MAI_CHECK(mParam->paddings.size() == 0,
-                "Cannot use explicit padding when paddingMode is :%d, size:%d", mParam->paddingMode, mParam->paddings.size());
-        } else {
-            MAI_CHECK(mParam->paddings.size() == 4,
-                "Explicit padding size must be 4 but not: %d", mParam->paddings.size());
-        }
+        derivePaddings(mParam->paddingMode, {mFilter->dimH(), mFilter->dimW()}, mParam->paddings);
 
         std::vector<shape_t> outputShape(4);
         MAI_CHECK(mInput->dimC() == (mFilter->dimI() * mParam->group),
@@ -83,10 +93,6 @@ public:
             if (mFilter->getDataFormat() == HWIO) {
                 mFunction = Ref::Conv2D<T, NHWC, HWIO>::conv2d;
             }
-            if (mParam->paddingMode != INVALID) {
-                mParam->paddings = calcPaddings(mParam->paddingMode,
-                        {mFilter->dimH(), mFilter->dimW()});
-            }
         } else if (mInput->getDataFormat() == NCHW) {
             if (mFilter->getDataFormat() == OIHW) {
                 mFunction = Ref::Conv2D<T, NCHW, OIHW>::conv2d;
@@ -100,24 +106,421 @@ public:
 
         mOutput->resize(outputShape);
 
-        if (mFunction == NULL) {
-            MAI_CHECK(false, "Unsupported input data format: %s, with filter data format:%s",
-                    getNameFromDataFormat(mInput->getDataFormat()).c_str(),
-                    getNameFromDataFormat(mFilter->getDataFormat()).c_str());
+        mKernel = mPreferredKernel;
+        if (mKernel == KERNEL_GEMM && mParam->group > 1) {
+            mKernel = KERNEL_GROUPED;
+        } else if (mKernel == KERNEL_GEMM && isPointwise()) {
+            mKernel = KERNEL_POINTWISE;
+        } else if (mKernel == KERNEL_WINOGRAD) {
+            MAI_CHECK(isWinogradSupported(), "Winograd needs a 3x3 stride 1 NHWC/HWIO conv2d without group");
+        } else if (mKernel == KERNEL_GEMM && isWinogradSupported()
+                && mInput->dimC() >= kWinogradMinChannels && mOutput->dimC() >= kWinogradMinChannels) {
+            mKernel = KERNEL_WINOGRAD;
+        }
+        if (mKernel == KERNEL_WINOGRAD) {
+            prepareWinograd();
+        } else if (mKernel == KERNEL_GROUPED) {
+            prepareGrouped();
         }
         MAI_OP_RUN_FIRST_END
 
+        if (mKernel == KERNEL_REF) {
+            runRef();
+        } else if (mKernel == KERNEL_WINOGRAD) {
+            runWinograd();
+        } else if (mKernel == KERNEL_POINTWISE) {
+            runPointwise();
+        } else if (mKernel == KERNEL_GROUPED) {
+            runGrouped();
+        } else if (mInput->getDataFormat() == NHWC) {
+            runNHWC();
+        } else {
+            runNCHW();
+        }
+        return MAI_SUCCESS;
+    }
+
+protected:
+    enum Kernel {
+        KERNEL_REF,
+        KERNEL_GEMM,
+        KERNEL_WINOGRAD,
+        KERNEL_POINTWISE,
+        KERNEL_GROUPED,
+    };
+
+private:
+    // 1x1 which reads no padding: output pixel (oh, ow) is input pixel
+    // (oh * strideH, ow * strideW) times the filter
+    bool isPointwise() const {
+        return mFilter->dimH() == 1 && mFilter->dimW() == 1
+            && mParam->paddings[0] == 0 && mParam->paddings[2] == 0
+            && (mOutput->dimH() - 1) * mParam->strides[mInput->h()] < mInput->dimH()
+            && (mOutput->dimW() - 1) * mParam->strides[mInput->w()] < mInput->dimW();
+    }
+
+    // The input of a 1x1 conv2d is the GEMM operand in place(rows of C
+    // channels in NHWC, planes of H*W in NCHW), strided ones are gathered
+    // first.
+    const T* pointwiseInput() {
+        const shape_t batch = mInput->dimN();
+        const shape_t inH = mInput->dimH();
+        const shape_t inW = mInput->dimW();
+        const shape_t inC = mInput->dimC();
+        const shape_t outH = mOutput->dimH();
+        const shape_t outW = mOutput->dimW();
+        const shape_t strideH = mParam->strides[mInput->h()];
+        const shape_t strideW = mParam->strides[mInput->w()];
+        const shape_t size = outH * outW;
+        const T* input = mInput->data<T>();
+        if (outH != inH || outW != inW) {
+            mColumns.resize(batch * size * inC);
+            T* gathered = mColumns.data();
+            if (mInput->getDataFormat() == NHWC) {
+                parallelFor(0, batch * size, grainSize(inC), [&](int64 begin, int64 end) {
+                    for (int64 p = begin; p < end; ++p) {
+                        const shape_t n = p / size;
+                        const shape_t ih = p % size / outW * strideH;
+                        const shape_t iw = p % outW * strideW;
+                        memcpy(gathered + p * inC, input + ((n * inH + ih) * inW + iw) * inC,
+                                inC * sizeof(T));
+                    }
+                });
+            } else {
+                parallelFor(0, batch * inC, grainSize(size), [&](int64 begin, int64 end) {
+                    for (int64 plane = begin; plane < end; ++plane) {
+                        const T* in = input + plane * inH * inW;
+                        T* out = gathered + plane * size;
+                        for (shape_t p = 0; p < size; ++p) {
+                            out[p] = in[p / outW * strideH * inW + p % outW * strideW];
+                        }
+                    }
+                });
+            }
+            input = gathered;
+        }
+        return input;
+    }
+
+    void runPointwise() {
+        const shape_t batch = mInput->dimN();
+        const shape_t inC = mInput->dimC();
+        const shape_t outC = mOutput->dimC();
+        const shape_t groupInC = inC / mParam->group;
+        const shape_t groupOutC = outC / mParam->group;
+        const shape_t size = mOutput->dimH() * mOutput->dimW();
+        const bool nhwc = mInput->getDataFormat() == NHWC;
+        const T* input = pointwiseInput();
+        const T* filter = mFilter->data<T>();
+        const T* bias = mBias == NULL ? NULL : mBias->data<T>();
+        T* output = mOutput->mutableData<T>();
+        for (int32 g = 0; g < mParam->group; ++g) {
+            const SgemmEpilogue epilogue = {
+                bias == NULL ? NULL : bias + g * groupOutC, !nhwc, mParam->activation};
+            if (nhwc) {
+                // output(N*OH*OW x O/g) = input(N*OH*OW x I/g) * filter(I/g x O/g)
+                sgemm(false, false, batch * size, groupOutC, groupInC,
+                        1.f, input + g * groupInC, inC,
+                        filter + g * groupOutC, outC,
+                        0.f, output + g * groupOutC, outC,
+                        opContext().cpuFeatures, &epilogue);
+                continue;
+            }
+            // output(O/g x OH*OW) = filter(O/g x I/g) * input(I/g x OH*OW) per batch
+            for (shape_t n = 0; n < batch; ++n) {
+                sgemm(false, false, groupOutC, size, groupInC,
+                        1.f, filter + g * groupOutC * groupInC, groupInC,
+                        input + (n * inC + g * groupInC) * size, size,
+                        0.f, output + (n * outC + g * groupOutC) * size, size,
+                        opContext().cpuFeatures, &epilogue);
+            }
+        }
+    }
+
+    bool isWinogradSupported() const {
+        return mInput->getDataFormat() == NHWC && mFilter->getDataFormat() == HWIO
+            && mFilter->dimH() == 3 && mFilter->dimW() == 3
+            && mParam->strides[mInput->h()] == 1 && mParam->strides[mInput->w()] == 1
+            && mParam->group == 1;
+    }
+
+    // The transformed filter is a constant: found in the constant cache of
+    // the network, or transformed once and put there.
+    void prepareWinograd() {
+        mWinogradTile = winogradTileSize(mOutput->dimH(), mOutput->dimW());
+        const int64 size = winogradFilterSize(mWinogradTile, mInput->dimC(), mOutput->dimC());
+        mTransformedFilter = cachedConstant<T>(":winograd_f" + std::to_string(mWinogradTile), size,
+                mFilterConstant, [this](T* transformed) {
+            winogradTransformFilter(mWinogradTile, mFilter->data<T>(), mInput->dimC(), mOutput->dimC(),
+                    transformed);
+        });
+    }
+
+    // The filter of every group packed as the constant GEMM operand: B in
+    // NHWC(KH*KW*I/g x O/g columns of HWIO), A in NCHW(O/g rows of OIHW).
+    void prepareGrouped() {
+        const bool nhwc = mInput->getDataFormat() == NHWC;
+        const int32 group = mParam->group;
+        const shape_t groupOutC = mOutput->dimC() / group;
+        const shape_t K = mFilter->dimH() * mFilter->dimW() * (mInput->dimC() / group);
+        const uint32 cpuFeatures = opContext().cpuFeatures;
+        mGroupFilterSize = nhwc ? sgemmPackedBSize(K, groupOutC, cpuFeatures)
+            : sgemmPackedASize(groupOutC, K, cpuFeatures);
+        mTransformedFilter = cachedConstant<T>(":grouped", group * mGroupFilterSize,
+                mFilterConstant, [&](T* packed) {
+            const T* filter = mFilter->data<T>();
+            for (int32 g = 0; g < group; ++g) {
+                if (nhwc) {
+                    sgemmPackB(false, K, groupOutC, filter + g * groupOutC, mOutput->dimC(),
+                            packed + g * mGroupFilterSize, cpuFeatures);
+                } else {
+                    sgemmPackA(false, groupOutC, K, filter + g * groupOutC * K, K,
+                            packed + g * mGroupFilterSize, cpuFeatures);
+                }
+            }
+        });
+    }
+
+    // One GEMM per image and group on its packed filter. There are many
+    // small GEMMs, so with enough of them to keep the threads busy they go
+    // to the threads whole, one GEMM per task, instead of being split. The
+    // tasks run in one slice per thread, each with its own columns in mColumns.
+    void runGrouped() {
+        const shape_t batch = mInput->dimN();
+        const int32 group = mParam->group;
+        const shape_t inC = mInput->dimC();
+        const shape_t outC = mOutput->dimC();
+        const shape_t groupInC = inC / group;
+        const shape_t groupOutC = outC / group;
+        const shape_t inSize = mInput->dimH() * mInput->dimW();
+        const shape_t M = mOutput->dimH() * mOutput->dimW();
+        const shape_t K = mFilter->dimH() * mFilter->dimW() * groupInC;
+        const bool nhwc = mInput->getDataFormat() == NHWC;
+        const bool pointwise = isPointwise();
+        const T* input = pointwise ? pointwiseInput() : mInput->data<T>();
+        const T* bias = mBias == NULL ? NULL : mBias->data<T>();
+        T* output = mOutput->mutableData<T>();
+        const uint32 cpuFeatures = opContext().cpuFeatures;
+        const shape_t step = pointwise ? M : std::max<shape_t>(1, std::min(M, kIm2colBufferSize / K));
+
+        const int64 tasks = batch * group;
+        ComputeThreadPool* pool = ComputeThreadPool::current();
+        const int64 slices = pool != NULL && tasks >= pool->numThreads() ? pool->numThreads() : 1;
+        if (!pointwise) {
+            mColumns.resize(slices * step * K);
+        }
+
+        auto runTask = [&](int64 task, T* columns) {
+            const shape_t n = task / group;
+            const int32 g = task % group;
+            const T* filter = mTransformedFilter + g * mGroupFilterSize;
+            const SgemmEpilogue epilogue = {
+                bias == NULL ? NULL : bias + g * groupOutC, !nhwc, mParam->activation};
+            for (shape_t p0 = 0; p0 < M; p0 += step) {
+                const shape_t count = std::min(step, M - p0);
+                if (nhwc) {
+                    // output(OH*OW x O/g) = im2col(OH*OW x KH*KW*I/g) * filter(KH*KW*I/g x O/g)
+                    const T* a = input + (n * M + p0) * inC + g * groupInC;
+                    if (!pointwise) {
+                        im2colRows(input + n * inSize * inC, g, p0, count, columns);
+                        a = columns;
+                    }
+                    sgemmPacked(false, false, false, true, count, groupOutC, K,
+                            1.f, a, pointwise ? inC : K,
+                            filter, 0,
+                            0.f, output + (n * M + p0) * outC + g * groupOutC, outC,
+                            cpuFeatures, &epilogue);
+                } else {
+                    // output(O/g x OH*OW) = filter(O/g x I/g*KH*KW) * im2col(I/g*KH*KW x OH*OW)
+                    const T* b = input + (n * inC + g * groupInC) * M + p0;
+                    if (!pointwise) {
+                        im2colColumns(input + (n * inC + g * groupInC) * inSize, p0, count, columns);
+                        b = columns;
+                    }
+                    sgemmPacked(false, true, false, false, groupOutC, count, K,
+                            1.f, filter, 0,
+                            b, pointwise ? M : count,
+                            0.f, output + (n * outC + g * groupOutC) * M + p0, M,
+                            cpuFeatures, &epilogue);
+                }
+            }
+        };
+        auto runSlice = [&](int64 slice) {
+            T* columns = pointwise ? NULL : mColumns.data() + slice * step * K;
+            for (int64 task = slice * tasks / slices; task < (slice + 1) * tasks / slices; ++task) {
+                runTask(task, columns);
+            }
+        };
+        if (slices > 1) {
+            parallelFor(0, slices, 1, [&](int64 begin, int64 end) {
+                for (int64 slice = begin; slice < end; ++slice) {
+                    runSlice(slice);
+                }
+            });
+        } else {
+            runSlice(0);
+        }
+    }
+
+    void runWinograd() {
+        const SgemmEpilogue epilogue = {
+            mBias == NULL ? NULL : mBias->data<T>(), false, mParam->activation};
+        winogradConv2D(mWinogradTile, mInput->data<T>(), mInput->dimN(),
+                mInput->dimH(), mInput->dimW(), mInput->dimC(),
+                mTransformedFilter, mOutput->dimC(),
+                mParam->paddings[0], mParam->paddings[2], mOutput->dimH(), mOutput->dimW(),
+                epilogue, mOutput->mutableData<T>(), opContext().cpuFeatures);
+    }
+
+    void runRef() {
         mOutput->zero();
         std::vector<shape_t> biasShape;
         if (mBias != NULL) {
             biasShape = mBias->shape();
         }
+        T* output = mOutput->mutableData<T>();
         mFunction(mInput->data<T>(), mInput->shape(),
                 mFilter->data<T>(), mFilter->shape(),
                 mBias == NULL ? NULL : mBias->data<T>(), biasShape,
                 mParam,
-                mOutput->mutableData<T>(), mOutput->shape());
-        return MAI_SUCCESS;
+                output, mOutput->shape());
+        if (mParam->activation != FUSED_ACTIVATION_NONE) {
+            const T upper = mParam->activation == FUSED_ACTIVATION_RELU6
+                ? 6 : std::numeric_limits<T>::max();
+            for (uint64 i = 0; i < mOutput->elementSize(); ++i) {
+                output[i] = std::min(std::max(output[i], static_cast<T>(0)), upper);
+            }
+        }
+    }
+
+    // Rows [p0, p0 + rows) of the im2col matrix of group g of an NHWC image,
+    // one row of KH*KW*I/g per output pixel
+    void im2colRows(const T* image, int32 g, shape_t p0, shape_t rows, T* columns) {
+        const shape_t inH = mInput->dimH();
+        const shape_t inW = mInput->dimW();
+        const shape_t inC = mInput->dimC();
+        const shape_t outW = mOutput->dimW();
+        const shape_t kH = mFilter->dimH();
+        const shape_t kW = mFilter->dimW();
+        const shape_t groupInC = inC / mParam->group;
+        const shape_t strideH = mParam->strides[mInput->h()];
+        const shape_t strideW = mParam->strides[mInput->w()];
+        const shape_t padTop = mParam->paddings[0];
+        const shape_t padLeft = mParam->paddings[2];
+        const shape_t K = kH * kW * groupInC;
+        parallelFor(p0, p0 + rows, grainSize(K), [&](int64 begin, int64 end) {
+            for (int64 p = begin; p < end; ++p) {
+                const shape_t oh = p / outW;
+                const shape_t ow = p % outW;
+                T* column = columns + (p - p0) * K;
+                for (shape_t kh = 0; kh < kH; ++kh) {
+                    const shape_t ih = oh * strideH - padTop + kh;
+                    for (shape_t kw = 0; kw < kW; ++kw) {
+                        const shape_t iw = ow * strideW - padLeft + kw;
+                        if (ih >= 0 && ih < inH && iw >= 0 && iw < inW) {
+                            memcpy(column, image + (ih * inW + iw) * inC + g * groupInC,
+                                    groupInC * sizeof(T));
+                        } else {
+                            memset(column, 0, groupInC * sizeof(T));
+                        }
+                        column += groupInC;
+                    }
+                }
+            }
+        });
+    }
+
+    // Columns [p0, p0 + cols) of the im2col matrix of the I/g NCHW planes of
+    // a group, one row of cols per (i, kh, kw)
+    void im2colColumns(const T* planes, shape_t p0, shape_t cols, T* columns) {
+        const shape_t inH = mInput->dimH();
+        const shape_t inW = mInput->dimW();
+        const shape_t outW = mOutput->dimW();
+        const shape_t kH = mFilter->dimH();
+        const shape_t kW = mFilter->dimW();
+        const shape_t strideH = mParam->strides[mInput->h()];
+        const shape_t strideW = mParam->strides[mInput->w()];
+        const shape_t padTop = mParam->paddings[0];
+        const shape_t padLeft = mParam->paddings[2];
+        const shape_t K = mInput->dimC() / mParam->group * kH * kW;
+        parallelFor(0, K, grainSize(cols), [&](int64 begin, int64 end) {
+            for (int64 r = begin; r < end; ++r) {
+                const shape_t i = r / (kH * kW);
+                const shape_t kh = r / kW % kH;
+                const shape_t kw = r % kW;
+                const T* plane = planes + i * inH * inW;
+                T* column = columns + r * cols;
+                for (shape_t p = p0; p < p0 + cols; ++p) {
+                    const shape_t ih = p / outW * strideH - padTop + kh;
+                    const shape_t iw = p % outW * strideW - padLeft + kw;
+                    column[p - p0] = (ih >= 0 && ih < inH && iw >= 0 && iw < inW)
+                        ? plane[ih * inW + iw] : 0;
+                }
+            }
+        });
+    }
+
+    // output(OH*OW x O) of group g = im2col(OH*OW x KH*KW*I/g) * filter(KH*KW*I/g x O/g)
+    void runNHWC() {
+        const shape_t inC = mInput->dimC();
+        const shape_t outC = mOutput->dimC();
+        const shape_t groupOutC = outC / mParam->group;
+        const shape_t M = mOutput->dimH() * mOutput->dimW();
+        const shape_t K = mFilter->dimH() * mFilter->dimW() * (inC / mParam->group);
+        const shape_t stepRows = std::max<shape_t>(1, std::min(M, kIm2colBufferSize / K));
+        mColumns.resize(stepRows * K);
+        T* columns = mColumns.data();
+        const T* filter = mFilter->data<T>();
+        const T* bias = mBias == NULL ? NULL : mBias->data<T>();
+        T* output = mOutput->mutableData<T>();
+        for (shape_t n = 0; n < mInput->dimN(); ++n) {
+            const T* input = mInput->data<T>() + n * mInput->dimH() * mInput->dimW() * inC;
+            for (int32 g = 0; g < mParam->group; ++g) {
+                const SgemmEpilogue epilogue = {
+                    bias == NULL ? NULL : bias + g * groupOutC, false, mParam->activation};
+                for (shape_t p0 = 0; p0 < M; p0 += stepRows) {
+                    const shape_t rows = std::min(stepRows, M - p0);
+                    im2colRows(input, g, p0, rows, columns);
+                    sgemm(false, false, rows, groupOutC, K,
+                            1.f, columns, K,
+                            filter + g * groupOutC, outC,
+                            0.f, output + (n * M + p0) * outC + g * groupOutC, outC,
+                            opContext().cpuFeatures, &epilogue);
+                }
+            }
+        }
+    }
+
+    // output(O/g x OH*OW) of group g = filter(O/g x I/g*KH*KW) * im2col(I/g*KH*KW x OH*OW)
+    void runNCHW() {
+        const shape_t inC = mInput->dimC();
+        const shape_t outC = mOutput->dimC();
+        const shape_t groupInC = inC / mParam->group;
+        const shape_t groupOutC = outC / mParam->group;
+        const shape_t M = mOutput->dimH() * mOutput->dimW();
+        const shape_t K = groupInC * mFilter->dimH() * mFilter->dimW();
+        const shape_t stepColumns = std::max<shape_t>(1, std::min(M, kIm2colBufferSize / K));
+        mColumns.resize(stepColumns * K);
+        T* columns = mColumns.data();
+        const T* filter = mFilter->data<T>();
+        const T* bias = mBias == NULL ? NULL : mBias->data<T>();
+        T* output = mOutput->mutableData<T>();
+        for (shape_t n = 0; n < mInput->dimN(); ++n) {
+            for (int32 g = 0; g < mParam->group; ++g) {
+                const T* input = mInput->data<T>() + (n * inC + g * groupInC) * mInput->dimH() * mInput->dimW();
+                const SgemmEpilogue epilogue = {
+                    bias == NULL ? NULL : bias + g * groupOutC, true, mParam->activation};
+                for (shape_t p0 = 0; p0 < M; p0 += stepColumns) {
+                    const shape_t cols = std::min(stepColumns, M - p0);
+                    im2colColumns(input, p0, cols, columns);
+                    sgemm(false, false, groupOutC, cols, K,
+                            1.f, filter + g * groupOutC * K, K,
+                            columns, cols,
+                            0.f, output + (n * outC + g * groupOutC) * M + p0, M,
+                            opContext().cpuFeatures, &epilogue);
+                }
+            }
+        }
     }
 
 private:
@@ -131,12 +534,47 @@ private:
             const T*, const std::vector<shape_t>&,
             const Conv2DParam*,
             T*, const std::vector<shape_t>&)> mFunction;
+    std::vector<T> mColumns;
     Conv2DParam* mParam;
-    bool mRunFirst;
+
+protected:
+    Kernel mPreferredKernel;
+
+private:
+    Kernel mKernel;
+    int32 mWinogradTile;
+    const T* mTransformedFilter;// winograd or grouped filter
+    int64 mGroupFilterSize;
+    std::vector<T> mFilterConstant;
+};
+
+template<typename T>
+class Conv2DRef : public Conv2D<T> {
+public:
+    Conv2DRef() : Conv2D<T>() {
+        this->mPreferredKernel = Conv2D<T>::KERNEL_REF;
+    }
+};
+
+// Winograd whatever the channels, the conv2d must be eligible.
+template<typename T>
+class Conv2DWinograd : public Conv2D<T> {
+public:
+    Conv2DWinograd() : Conv2D<T>() {
+        this->mPreferredKernel = Conv2D<T>::KERNEL_WINOGRAD;
+    }
 };
 
 void registerConv2D() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(CONV2D).build()), float, Conv2D);
+    for (uint32 cpuFeatures : sgemmCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(CONV2D).setCpuFeatures(cpuFeatures).build()),
+                float, Conv2D);
+    }
+    for (uint32 cpuFeatures : sgemmCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(CONV2D).setExtraInfo("winograd")
+                    .setCpuFeatures(cpuFeatures).build()), float, Conv2DWinograd);
+    }
+    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(CONV2D).setExtraInfo("ref").build()), float, Conv2DRef);
 }
 
 } // namespace CPU
@@ -13,17 +13,24 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <limits>
 #include "core/OperatorRegister.h"
 #include "util/MAIUtil.h"
+#include "core/ComputeThreadPool.h"
+#include "DepthwiseConv3x3.h"
 
 namespace MAI {
 namespace Op {
 namespace CPU {
 
+// 3x3 filters with stride 1 or 2 run the vectorized kernels of
+// DepthwiseConv3x3.h, other shapes the reference loops below.
 template<typename T>
 class DepthwiseConv2d : public Operator {
 public:
-    DepthwiseConv2d() : mParam(NULL), mRunFirst(true) {}
+    enum Kernel {KERNEL_REF, KERNEL_3X3};
+
+    DepthwiseConv2d() : mParam(NULL), mPreferredKernel(KERNEL_3X3), mKernel(KERNEL_3X3) {}
     ~DepthwiseConv2d() {
         if (mParam != NULL) {
             delete mParam;
@@ -35,7 +42,10 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
+        if (mParam != NULL && mParam != param) {
+            delete mParam;
+        }
         mParam = reinterpret_cast<DepthwiseConv2dParam*>(param);
     }
 
@@ -48,9 +58,12 @@ public:
             const DepthwiseConv2dParam* param,
             T* output,
             const std::vector<shape_t>& outputShape) {
-        #pragma omp parallel for collapse(4)
-        for(shape_t n = 0; n < outputShape[0]; ++n) {
-            for(shape_t h = 0; h < outputShape[1]; ++h) {
+        parallelFor(0, outputShape[0] * outputShape[1],
+                grainSize(outputShape[2] * outputShape[3] * filterShape[0] * filterShape[1]),
+                [&](int64 begin, int64 end) {
+            for (int64 index = begin; index < end; ++index) {
+                const shape_t n = index / outputShape[1];
+                const shape_t h = index % outputShape[1];
                 for(shape_t w = 0; w < outputShape[2]; ++w) {
                     for(shape_t o = 0; o < outputShape[3]; ++o) {
                         T* outputV = output + offset4D(outputShape, n, h, w, o);
@@ -76,7 +89,7 @@ public:
                     }
                 }
             }
-        }
+        });
     }
     static void depthwiseConv2dNCHW_IOHW(const T* input,
             const std::vector<shape_t>& inputShape,
@@ -87,9 +100,12 @@ public:
             const DepthwiseConv2dParam* param,
             T* output,
             const std::vector<shape_t>& outputShape) {
-        #pragma omp parallel for collapse(2)
-        for(shape_t n = 0; n < outputShape[0]; ++n) {
-            for(shape_t o = 0; o < outputShape[1]; ++o) {
+        parallelFor(0, outputShape[0] * outputShape[1],
+                grainSize(outputShape[2] * outputShape[3] * filterShape[2] * filterShape[3]),
+                [&](int64 begin, int64 end) {
+            for (int64 index = begin; index < end; ++index) {
+                const shape_t n = index / outputShape[1];
+                const shape_t o = index % outputShape[1];
                 for(shape_t h = 0; h < outputShape[2]; ++h) {
                     for(shape_t w = 0; w < outputShape[3]; ++w) {
                         T* outputV = output + offset4D(outputShape, n, o, h, w);
@@ -115,7 +131,7 @@ public:
                     }
                 }
             }
-        }
+        });
     }
 
 
@@ -131,13 +147,7 @@ public:
         MAI_CHECK_NULL(mParam);
         MAI_CHECK(mInput->shape().size() == 4, "Input shape must be 4-d");
         MAI_CHECK(checkVectorValues(mParam->dilations, 1), "Cannot support dilations greater than 1 now");
-        if (mParam->paddingMode != INVALID) {
-            MAI_CHECK(mParam->paddings.size() == 0,
-                "Cannot use explicit padding when paddingMode is :%d", mParam->paddingMode);
-        } else {
-            MAI_CHECK(mParam->paddings.size() == 4,
-                "Explicit padding size must be 4 but not: %d", mParam->paddings.size());
-        }
+        derivePaddings(mParam->paddingMode, {mFilter->dimH(), mFilter->dimW()}, mParam->paddings);
 
         std::vector<shape_t> outputShape(4);
         outputShape[mInput->n()] = mInput->dimN();
@@ -149,10 +159,6 @@ public:
                 mParam->paddings, mParam->paddingMode);
         outputShape[mInput->h()] = outputHW[0];
         outputShape[mInput->w()] = outputHW[1];
-        if (mParam->paddingMode != INVALID) {
-            mParam->paddings = calcPaddings(mParam->paddingMode,
-                {mFilter->dimH(), mFilter->dimW()});
-        }
         if (mInput->getDataFormat() == NHWC) {
             if (mFilter->getDataFormat() == HWIO) {
                 mFunction = depthwiseConv2dNHWC_HWIO;
@@ -170,22 +176,61 @@ public:
             MAI_CHECK(false, "Unsupported input data format: %d, with filter data format:%d", mInput->getDataFormat(),
                     mFilter->getDataFormat());
         }
+        mKernel = mPreferredKernel == KERNEL_3X3 && is3x3Supported() ? KERNEL_3X3 : KERNEL_REF;
         MAI_OP_RUN_FIRST_END
 
+        if (mKernel == KERNEL_3X3) {
+            run3x3();
+        } else {
+            runRef();
+        }
+        return MAI_SUCCESS;
+    }
+
+private:
+    bool is3x3Supported() const {
+        const int32 stride = mParam->strides[mInput->h()];
+        return mFilter->dimH() == 3 && mFilter->dimW() == 3
+            && mFilter->dimI() == mInput->dimC() && mFilter->dimO() == 1
+            && stride == mParam->strides[mInput->w()] && (stride == 1 || stride == 2);
+    }
+
+    void run3x3() {
+        const T* bias = mBias == NULL ? NULL : mBias->data<T>();
+        if (mInput->getDataFormat() == NHWC) {
+            depthwiseConv3x3NHWC(mInput->data<T>(), mInput->dimN(), mInput->dimH(), mInput->dimW(),
+                    mInput->dimC(), mFilter->data<T>(), bias, mParam->strides[mInput->h()],
+                    mParam->paddings[0], mParam->paddings[2], mOutput->dimH(), mOutput->dimW(),
+                    mParam->activation, mOutput->mutableData<T>(), opContext().cpuFeatures);
+        } else {
+            depthwiseConv3x3NCHW(mInput->data<T>(), mInput->dimN(), mInput->dimH(), mInput->dimW(),
+                    mInput->dimC(), mFilter->data<T>(), bias, mParam->strides[mInput->h()],
+                    mParam->paddings[0], mParam->paddings[2], mOutput->dimH(), mOutput->dimW(),
+                    mParam->activation, mOutput->mutableData<T>(), opContext().cpuFeatures);
+        }
+    }
+
+    void runRef() {
         mOutput->zero();
         std::vector<shape_t> biasShape;
         if (mBias != NULL) {
             biasShape = mBias->shape();
         }
+        T* output = mOutput->mutableData<T>();
         mFunction(mInput->data<T>(), mInput->shape(),
                 mFilter->data<T>(), mFilter->shape(),
                 mBias == NULL ? NULL : mBias->data<T>(), biasShape,
                 mParam,
-                mOutput->mutableData<T>(), mOutput->shape());
-        return MAI_SUCCESS;
+                output, mOutput->shape());
+        if (mParam->activation != FUSED_ACTIVATION_NONE) {
+            const T upper = mParam->activation == FUSED_ACTIVATION_RELU6
+                ? 6 : std::numeric_limits<T>::max();
+            for (uint64 i = 0; i < mOutput->elementSize(); ++i) {
+                output[i] = std::min(std::max(output[i], static_cast<T>(0)), upper);
+            }
+        }
     }
 
-private:
     enum FLAG {INPUT, FILTER, BIAS, OUTPUT = 0,};
     const Tensor* mInput;
     const Tensor* mFilter;
@@ -197,13 +242,29 @@ private:
             const DepthwiseConv2dParam*,
             T*, const std::vector<shape_t>&)> mFunction;
     DepthwiseConv2dParam* mParam;
-    bool mRunFirst;
+
+protected:
+    Kernel mPreferredKernel;
+
+private:
+    Kernel mKernel;
+};
+
+template<typename T>
+class DepthwiseConv2dRef : public DepthwiseConv2d<T> {
+public:
+    DepthwiseConv2dRef() : DepthwiseConv2d<T>() {
+        this->mPreferredKernel = DepthwiseConv2d<T>::KERNEL_REF;
+    }
 };
 
 void registerDepthwiseConv2d() {
-    MAI_REGISTER_OP((OpContextBuilder()
-                .setOperatorType(DEPTHWISE_CONV2D)
-                .build()), float, DepthwiseConv2d);
+    for (uint32 cpuFeatures : depthwiseConv3x3CpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(DEPTHWISE_CONV2D).setCpuFeatures(cpuFeatures).build()),
+                float, DepthwiseConv2d);
+    }
+    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(DEPTHWISE_CONV2D).setExtraInfo("ref").build()),
+            float, DepthwiseConv2dRef);
 }
 
 } // namespace CPU
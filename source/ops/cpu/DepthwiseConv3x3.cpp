@@ -0,0 +1,331 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "DepthwiseConv3x3.h"
+#include "Simd.h"
+#include "core/ComputeThreadPool.h"
+#include "util/MAIType.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+namespace {
+
+using namespace Simd;
+
+struct DepthwiseArgs {
+    const float* input;
+    int64 inH;
+    int64 inW;
+    int64 channels;
+    const float* filter;
+    const float* bias;// zeros if there is no bias(NHWC)
+    bool hasBias;
+    int64 padTop;
+    int64 padLeft;
+    int64 outH;
+    int64 outW;
+    int64 interiorBegin;// columns whose window lies inside the input
+    int64 interiorEnd;
+    bool activate;
+    float upper;// clamped to [0, upper] if activate
+    const float* zeros;// a row of zeros
+    float* output;
+};
+
+template<typename V>
+MAI_SIMD_INLINE V activate(const DepthwiseArgs& args, const V& v) {
+    if (args.activate) {
+        return minimum(maximum(v, splat<V>(0.f)), splat<V>(args.upper));
+    }
+    return v;
+}
+
+// One block of channels [c, c + Lanes<V>::value) of an output row
+template<typename V, int S>
+MAI_SIMD_INLINE void channelsNHWC(const DepthwiseArgs& args, const float* const rows[3],
+        int64 c, float* output) {
+    const int64 C = args.channels;
+    V f[9];
+    for (int32 k = 0; k < 9; ++k) {
+        f[k] = load<V>(args.filter + k * C + c);
+    }
+    const V bias = load<V>(args.bias + c);
+    const float* r0 = rows[0] + c;
+    const float* r1 = rows[1] + c;
+    const float* r2 = rows[2] + c;
+
+    int64 ow = 0;
+    for (int64 end = args.interiorBegin, pass = 0; pass < 2; ++pass, end = args.outW) {
+        for (; ow < end; ++ow) {
+            const int64 iw0 = ow * S - args.padLeft;
+            V acc = bias;
+            for (int32 fw = 0; fw < 3; ++fw) {
+                const int64 iw = iw0 + fw;
+                if (iw >= 0 && iw < args.inW) {
+                    acc += f[fw] * load<V>(r0 + iw * C);
+                    acc += f[3 + fw] * load<V>(r1 + iw * C);
+                    acc += f[6 + fw] * load<V>(r2 + iw * C);
+                }
+            }
+            store(output + ow * C + c, activate(args, acc));
+        }
+        if (pass == 0) {
+            for (; ow < args.interiorEnd; ++ow) {
+                const int64 offset = (ow * S - args.padLeft) * C;
+                V acc = bias;
+                acc += f[0] * load<V>(r0 + offset);
+                acc += f[1] * load<V>(r0 + offset + C);
+                acc += f[2] * load<V>(r0 + offset + 2 * C);
+                acc += f[3] * load<V>(r1 + offset);
+                acc += f[4] * load<V>(r1 + offset + C);
+                acc += f[5] * load<V>(r1 + offset + 2 * C);
+                acc += f[6] * load<V>(r2 + offset);
+                acc += f[7] * load<V>(r2 + offset + C);
+                acc += f[8] * load<V>(r2 + offset + 2 * C);
+                store(output + ow * C + c, activate(args, acc));
+            }
+        }
+    }
+}
+
+template<typename V, int S>
+MAI_SIMD_INLINE void rowsNHWC(const DepthwiseArgs& args, int64 begin, int64 end) {
+    const int64 C = args.channels;
+    const int64 lanes = Lanes<V>::value;
+    for (int64 row = begin; row < end; ++row) {
+        const int64 n = row / args.outH;
+        const int64 oh = row % args.outH;
+        const float* rows[3];
+        for (int32 fh = 0; fh < 3; ++fh) {
+            const int64 ih = oh * S - args.padTop + fh;
+            rows[fh] = (ih >= 0 && ih < args.inH)
+                ? args.input + (n * args.inH + ih) * args.inW * C : args.zeros;
+        }
+        float* output = args.output + row * args.outW * C;
+        int64 c = 0;
+        for (; c + lanes <= C; c += lanes) {
+            channelsNHWC<V, S>(args, rows, c, output);
+        }
+        for (; c < C; ++c) {
+            channelsNHWC<float, S>(args, rows, c, output);
+        }
+    }
+}
+
+// Output columns [ow, ow + Lanes<V>::value), all interior
+template<typename V, int S>
+MAI_SIMD_INLINE V interiorNCHW(const float* const rows[3], const V f[9], const V& bias, int64 iw) {
+    V acc = bias;
+    acc += f[0] * loadStrided<V, S>(rows[0] + iw);
+    acc += f[1] * loadStrided<V, S>(rows[0] + iw + 1);
+    acc += f[2] * loadStrided<V, S>(rows[0] + iw + 2);
+    acc += f[3] * loadStrided<V, S>(rows[1] + iw);
+    acc += f[4] * loadStrided<V, S>(rows[1] + iw + 1);
+    acc += f[5] * loadStrided<V, S>(rows[1] + iw + 2);
+    acc += f[6] * loadStrided<V, S>(rows[2] + iw);
+    acc += f[7] * loadStrided<V, S>(rows[2] + iw + 1);
+    acc += f[8] * loadStrided<V, S>(rows[2] + iw + 2);
+    return acc;
+}
+
+template<int S>
+MAI_SIMD_INLINE float borderNCHW(const DepthwiseArgs& args, const float* const rows[3],
+        const float f[9], float bias, int64 ow) {
+    const int64 iw0 = ow * S - args.padLeft;
+    float acc = bias;
+    for (int32 fw = 0; fw < 3; ++fw) {
+        const int64 iw = iw0 + fw;
+        if (iw >= 0 && iw < args.inW) {
+            acc += f[fw] * rows[0][iw];
+            acc += f[3 + fw] * rows[1][iw];
+            acc += f[6 + fw] * rows[2][iw];
+        }
+    }
+    return activate(args, acc);
+}
+
+template<typename V, int S>
+MAI_SIMD_INLINE void rowsNCHW(const DepthwiseArgs& args, int64 begin, int64 end) {
+    const int64 lanes = Lanes<V>::value;
+    const int64 planeSize = args.inH * args.inW;
+    for (int64 row = begin; row < end; ++row) {
+        const int64 plane = row / args.outH;// n * C + c
+        const int64 c = plane % args.channels;
+        const int64 oh = row % args.outH;
+        const float* rows[3];
+        for (int32 fh = 0; fh < 3; ++fh) {
+            const int64 ih = oh * S - args.padTop + fh;
+            rows[fh] = (ih >= 0 && ih < args.inH)
+                ? args.input + plane * planeSize + ih * args.inW : args.zeros;
+        }
+        const float* f = args.filter + c * 9;
+        const float bias = args.hasBias ? args.bias[c] : 0.f;
+        V fv[9];
+        for (int32 k = 0; k < 9; ++k) {
+            fv[k] = splat<V>(f[k]);
+        }
+        const V biasV = splat<V>(bias);
+        float* output = args.output + row * args.outW;
+
+        int64 ow = 0;
+        for (; ow < args.interiorBegin; ++ow) {
+            output[ow] = borderNCHW<S>(args, rows, f, bias, ow);
+        }
+        for (; ow + lanes <= args.interiorEnd; ow += lanes) {
+            store(output + ow, activate(args,
+                        interiorNCHW<V, S>(rows, fv, biasV, ow * S - args.padLeft)));
+        }
+        for (; ow < args.interiorEnd; ++ow) {
+            output[ow] = activate(args,
+                    interiorNCHW<float, S>(rows, f, bias, ow * S - args.padLeft));
+        }
+        for (; ow < args.outW; ++ow) {
+            output[ow] = borderNCHW<S>(args, rows, f, bias, ow);
+        }
+    }
+}
+
+typedef void (*RowsFunc)(const DepthwiseArgs& args, int64 begin, int64 end);
+
+struct DepthwiseKernel {
+    uint32 cpuFeatures;
+    RowsFunc nhwc[2];// stride 1, 2
+    RowsFunc nchw[2];
+};
+
+#define MAI_DEPTHWISE_KERNELS(SUFFIX, TARGET, V)                                      \
+    TARGET void rowsNHWC1##SUFFIX(const DepthwiseArgs& args, int64 begin, int64 end) { \
+        rowsNHWC<V, 1>(args, begin, end);                                             \
+    }                                                                                 \
+    TARGET void rowsNHWC2##SUFFIX(const DepthwiseArgs& args, int64 begin, int64 end) { \
+        rowsNHWC<V, 2>(args, begin, end);                                             \
+    }                                                                                 \
+    TARGET void rowsNCHW1##SUFFIX(const DepthwiseArgs& args, int64 begin, int64 end) { \
+        rowsNCHW<V, 1>(args, begin, end);                                             \
+    }                                                                                 \
+    TARGET void rowsNCHW2##SUFFIX(const DepthwiseArgs& args, int64 begin, int64 end) { \
+        rowsNCHW<V, 2>(args, begin, end);                                             \
+    }
+
+MAI_DEPTHWISE_KERNELS(Generic, , Float4)
+#ifdef MAI_SIMD_X86
+MAI_DEPTHWISE_KERNELS(Avx2, MAI_SIMD_TARGET_AVX2, Float8)
+MAI_DEPTHWISE_KERNELS(Avx512, MAI_SIMD_TARGET_AVX512, Float16)
+#endif
+
+#undef MAI_DEPTHWISE_KERNELS
+
+// widest first
+const DepthwiseKernel kDepthwiseKernels[] = {
+#ifdef MAI_SIMD_X86
+    {CPU_FEATURE_AVX512F, {rowsNHWC1Avx512, rowsNHWC2Avx512}, {rowsNCHW1Avx512, rowsNCHW2Avx512}},
+    {CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, {rowsNHWC1Avx2, rowsNHWC2Avx2}, {rowsNCHW1Avx2, rowsNCHW2Avx2}},
+#endif
+    {0, {rowsNHWC1Generic, rowsNHWC2Generic}, {rowsNCHW1Generic, rowsNCHW2Generic}},
+};
+
+const DepthwiseKernel& selectKernel(uint32 cpuFeatures) {
+    for (const DepthwiseKernel& kernel : kDepthwiseKernels) {
+        if ((kernel.cpuFeatures & cpuFeatures) == kernel.cpuFeatures) {
+            return kernel;
+        }
+    }
+    return kDepthwiseKernels[sizeof(kDepthwiseKernels) / sizeof(kDepthwiseKernels[0]) - 1];
+}
+
+DepthwiseArgs makeArgs(const float* input, int64 inH, int64 inW, int64 channels,
+        const float* filter, const float* bias, int32 stride,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        FusedActivation activation, float* output) {
+    DepthwiseArgs args;
+    args.input = input;
+    args.inH = inH;
+    args.inW = inW;
+    args.channels = channels;
+    args.filter = filter;
+    args.bias = bias;
+    args.hasBias = bias != NULL;
+    args.padTop = padTop;
+    args.padLeft = padLeft;
+    args.outH = outH;
+    args.outW = outW;
+    // iw0 = ow * stride - padLeft, interior if iw0 >= 0 and iw0 + 2 < inW
+    args.interiorBegin = std::min(outW, (padLeft + stride - 1) / stride);
+    args.interiorEnd = inW + padLeft >= 3 ? std::min(outW, (inW + padLeft - 3) / stride + 1) : 0;
+    args.interiorEnd = std::max(args.interiorEnd, args.interiorBegin);
+    args.activate = activation != FUSED_ACTIVATION_NONE;
+    args.upper = activation == FUSED_ACTIVATION_RELU6 ? 6.f : std::numeric_limits<float>::max();
+    args.output = output;
+    return args;
+}
+
+} // namespace
+
+void depthwiseConv3x3NHWC(const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, const float* filter, const float* bias, int32 stride,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        FusedActivation activation, float* output, uint32 cpuFeatures) {
+    MAI_CHECK(stride == 1 || stride == 2, "Unsupported stride:%d", stride);
+    std::vector<float> zeros(inW * channels, 0.f);
+    DepthwiseArgs args = makeArgs(input, inH, inW, channels, filter, bias, stride,
+            padTop, padLeft, outH, outW, activation, output);
+    args.zeros = zeros.data();
+    if (bias == NULL) {
+        args.bias = zeros.data();
+    }
+    RowsFunc rows = selectKernel(cpuFeatures).nhwc[stride - 1];
+    parallelFor(0, batch * outH, grainSize(outW * channels * 9),
+            [&](int64 begin, int64 end) {
+        rows(args, begin, end);
+    });
+}
+
+void depthwiseConv3x3NCHW(const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, const float* filter, const float* bias, int32 stride,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        FusedActivation activation, float* output, uint32 cpuFeatures) {
+    MAI_CHECK(stride == 1 || stride == 2, "Unsupported stride:%d", stride);
+    std::vector<float> zeros(inW, 0.f);
+    DepthwiseArgs args = makeArgs(input, inH, inW, channels, filter, bias, stride,
+            padTop, padLeft, outH, outW, activation, output);
+    args.zeros = zeros.data();
+    RowsFunc rows = selectKernel(cpuFeatures).nchw[stride - 1];
+    parallelFor(0, batch * channels * outH, grainSize(outW * 9),
+            [&](int64 begin, int64 end) {
+        rows(args, begin, end);
+    });
+}
+
+std::vector<uint32> depthwiseConv3x3CpuFeatureLevels() {
+    std::vector<uint32> levels;
+    for (const DepthwiseKernel& kernel : kDepthwiseKernels) {
+        levels.insert(levels.begin(), kernel.cpuFeatures);
+    }
+    return levels;
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
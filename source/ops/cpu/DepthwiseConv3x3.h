@@ -0,0 +1,55 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+// Depthwise 3x3 convolution with a channel multiplier of 1 and stride 1 or
+// 2 in both dimensions, bias and activation fused.
+//
+// The output rows are spread over the threads of the current
+// ComputeThreadPool. Every row is split into the columns whose 3x3 window
+// lies inside the input(interior, no bound checks, the stride is a compile
+// time constant) and the padded ones on both sides(border, taps out of the
+// input skipped). Rows above and below the input read a row of zeros. NHWC
+// is vectorized over the channels, with the 9 taps of a block of channels
+// kept in registers along the row, NCHW over the output columns.
+//
+// The vector width is the widest cpuFeatures allow: 16 floats with AVX-512,
+// 8 with AVX2/FMA, 4(SSE/NEON) otherwise.
+
+// input is NHWC, filter HWIO 3x3xCx1, bias C floats or NULL.
+void depthwiseConv3x3NHWC(const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, const float* filter, const float* bias, int32 stride,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        FusedActivation activation, float* output, uint32 cpuFeatures);
+
+// input is NCHW, filter IOHW Cx1x3x3, bias C floats or NULL.
+void depthwiseConv3x3NCHW(const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, const float* filter, const float* bias, int32 stride,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        FusedActivation activation, float* output, uint32 cpuFeatures);
+
+// cpuFeatures of every vector width compiled in, portable first.
+std::vector<uint32> depthwiseConv3x3CpuFeatureLevels();
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
@@ -21,7 +21,7 @@ namespace CPU {
 
 class Dropout : public Operator {
 public:
-    Dropout() : mRunFirst(true) {}
+    Dropout() {}
     ~Dropout() = default;
 
     MAI_STATUS init() override {
@@ -39,11 +39,9 @@ public:
         output->reshape(input->shape());
         MAI_OP_RUN_FIRST_END
 
-        return MAI_FAILED;
+        return MAI_SUCCESS;
     }
 
-private:
-    bool mRunFirst;
 };
 
 void registerDropout() {
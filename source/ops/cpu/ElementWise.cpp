@@ -0,0 +1,216 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ElementWise.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+namespace {
+
+struct AbsFunctor {
+    static const int64 kCost = 1;
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        return Simd::absolute(x);
+    }
+
+    MAI_SIMD_INLINE int32 operator()(int32 x) const {
+        return x < 0 ? -x : x;
+    }
+
+    MAI_SIMD_INLINE int64 operator()(int64 x) const {
+        return x < 0 ? -x : x;
+    }
+};
+
+struct NegFunctor {
+    static const int64 kCost = 1;
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        return -x;
+    }
+};
+
+struct SquareFunctor {
+    static const int64 kCost = 1;
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        return x * x;
+    }
+};
+
+struct FloorFunctor {
+    static const int64 kCost = 1;
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        return Simd::floor(x);
+    }
+};
+
+// NaN stays NaN like std::max(x, 0)
+struct ReluFunctor {
+    static const int64 kCost = 1;
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        const V zero = Simd::splat<V>(0.f);
+        return Simd::select(x < zero, zero, x);
+    }
+};
+
+// x clamped to [LOW, HIGH], NaN stays NaN
+template<int LOW, int HIGH>
+struct ClampFunctor {
+    static const int64 kCost = 1;
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        const V low = Simd::splat<V>(LOW);
+        const V high = Simd::splat<V>(HIGH);
+        return Simd::select(x < low, low, Simd::select(x > high, high, x));
+    }
+};
+
+struct LeakyReluFunctor {
+    static const int64 kCost = 1;
+
+    explicit LeakyReluFunctor(float alpha = 0.f) : alpha(alpha) {}
+
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& x) const {
+        return Simd::select(x >= Simd::splat<V>(0.f), x, x * alpha);
+    }
+
+    float alpha;
+};
+
+struct LogicalNotFunctor {
+    static const int64 kCost = 1;
+
+    template<typename T>
+    MAI_SIMD_INLINE T operator()(const T& x) const {
+        return !x;
+    }
+};
+
+} // namespace
+
+template<typename T> using Abs = ElementWise<T, AbsFunctor>;
+template<typename T> using Neg = ElementWise<T, NegFunctor>;
+template<typename T> using Square = ElementWise<T, SquareFunctor>;
+template<typename T> using Floor = ElementWise<T, FloorFunctor>;
+template<typename T> using Relu = ElementWise<T, ReluFunctor>;
+template<typename T> using Relu1 = ElementWise<T, ClampFunctor<-1, 1> >;
+template<typename T> using Relu6 = ElementWise<T, ClampFunctor<0, 6> >;
+template<typename T> using LogicalNot = ElementWise<T, LogicalNotFunctor>;
+template<typename T> using Exp = ElementWise<T, ExpFunctor>;
+template<typename T> using ExpFast = ElementWise<T, ExpFastFunctor>;
+template<typename T> using Sin = ElementWise<T, SinFunctor>;
+template<typename T> using Cos = ElementWise<T, CosFunctor>;
+template<typename T> using Tan = ElementWise<T, TanFunctor>;
+template<typename T> using ASin = ElementWise<T, ASinFunctor>;
+template<typename T> using ACos = ElementWise<T, ACosFunctor>;
+template<typename T> using ATan = ElementWise<T, ATanFunctor>;
+template<typename T> using Sinh = ElementWise<T, SinhFunctor>;
+template<typename T> using Cosh = ElementWise<T, CoshFunctor>;
+template<typename T> using Tanh = ElementWise<T, TanhFunctor>;
+template<typename T> using TanhFast = ElementWise<T, TanhFastFunctor>;
+template<typename T> using ASinh = ElementWise<T, ASinhFunctor>;
+template<typename T> using ACosh = ElementWise<T, ACoshFunctor>;
+template<typename T> using ATanh = ElementWise<T, ATanhFunctor>;
+template<typename T> using Sigmoid = ElementWise<T, SigmoidFunctor>;
+template<typename T> using SigmoidFast = ElementWise<T, SigmoidFastFunctor>;
+
+template<typename T>
+class LeakyRelu : public ElementWise<T, LeakyReluFunctor> {
+public:
+    LeakyRelu() : mParam(NULL) {}
+    ~LeakyRelu() {
+        MAI_DELETE_PTR(mParam);
+    }
+
+    void onSetParam(Param* param) override {
+        mParam = reinterpret_cast<LeakyReluParam*>(param);
+    }
+
+protected:
+    LeakyReluFunctor functor() const override {
+        MAI_CHECK_NULL(mParam);
+        return LeakyReluFunctor(mParam->alpha);
+    }
+
+private:
+    LeakyReluParam* mParam;
+};
+
+#define MAI_REGISTER_ELEMENT_WISE_OP(NAME, TYPE, ...)                               \
+    void register##NAME() {                                                        \
+        registerElementWise<NAME, __VA_ARGS__>(                                    \
+                OpContextBuilder().setOperatorType(TYPE).build());                 \
+    }
+
+MAI_REGISTER_ELEMENT_WISE_OP(Abs, ABS, float, int32, int64)
+MAI_REGISTER_ELEMENT_WISE_OP(Neg, NEG, float, int32, int64)
+MAI_REGISTER_ELEMENT_WISE_OP(Square, SQUARE, float, int32, int64)
+MAI_REGISTER_ELEMENT_WISE_OP(Floor, FLOOR, float)
+MAI_REGISTER_ELEMENT_WISE_OP(Relu, RELU, float, int32)
+MAI_REGISTER_ELEMENT_WISE_OP(Relu1, RELU1, float)
+MAI_REGISTER_ELEMENT_WISE_OP(Relu6, RELU6, float, int32)
+MAI_REGISTER_ELEMENT_WISE_OP(LeakyRelu, LEAKY_RELU, float)
+MAI_REGISTER_ELEMENT_WISE_OP(LogicalNot, LOGICAL_NOT, int8, bool)
+MAI_REGISTER_ELEMENT_WISE_OP(Sin, SIN, float)
+MAI_REGISTER_ELEMENT_WISE_OP(Cos, COS, float)
+MAI_REGISTER_ELEMENT_WISE_OP(Tan, TAN, float)
+MAI_REGISTER_ELEMENT_WISE_OP(ASin, ASIN, float)
+MAI_REGISTER_ELEMENT_WISE_OP(ACos, ACOS, float)
+MAI_REGISTER_ELEMENT_WISE_OP(ATan, ATAN, float)
+MAI_REGISTER_ELEMENT_WISE_OP(Sinh, SINH, float)
+MAI_REGISTER_ELEMENT_WISE_OP(Cosh, COSH, float)
+MAI_REGISTER_ELEMENT_WISE_OP(ASinh, ASINH, float)
+MAI_REGISTER_ELEMENT_WISE_OP(ACosh, ACOSH, float)
+MAI_REGISTER_ELEMENT_WISE_OP(ATanh, ATANH, float)
+
+#undef MAI_REGISTER_ELEMENT_WISE_OP
+
+// "fast": within 3e-6 relative error
+void registerExp() {
+    registerElementWise<Exp, float>(OpContextBuilder().setOperatorType(EXP).build());
+    registerElementWise<ExpFast, float>(OpContextBuilder().setOperatorType(EXP).setExtraInfo("fast").build());
+}
+
+void registerTanh() {
+    registerElementWise<Tanh, float>(OpContextBuilder().setOperatorType(TANH).build());
+    registerElementWise<TanhFast, float>(OpContextBuilder().setOperatorType(TANH).setExtraInfo("fast").build());
+}
+
+void registerSigmoid() {
+    registerElementWise<Sigmoid, float>(OpContextBuilder().setOperatorType(SIGMOID).build());
+    registerElementWise<SigmoidFast, float>(
+            OpContextBuilder().setOperatorType(SIGMOID).setExtraInfo("fast").build());
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
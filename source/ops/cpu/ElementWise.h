@@ -0,0 +1,220 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "Simd.h"
+#include "SimdMath.h"
+#include "core/ComputeThreadPool.h"
+#include "core/OperatorRegister.h"
+#include "util/MAIUtil.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+// Unary element-wise operators: output[i] = f(input[i]) with a functor
+//
+//     struct F {
+//         static const int64 kCost = 1;// work of one element, see grainSize()
+//         template<typename V>
+//         MAI_SIMD_INLINE V operator()(const V& x) const;
+//     };
+//
+// operator() is instantiated for the data type of the tensor and, if that is
+// float, for every Simd vector, so a float functor is written once with the
+// helpers Simd.h and SimdMath.h provide for both. The array is split in
+// chunks of grainSize(F::kCost) elements over the threads of the current
+// ComputeThreadPool; arrays up to one chunk run inline. output may be input.
+
+template<typename V, typename F>
+MAI_SIMD_INLINE void mapElementWise(const F& f, const float* input, int64 begin, int64 end,
+        float* output) {
+    int64 i = begin;
+    for (; i + Simd::Lanes<V>::value <= end; i += Simd::Lanes<V>::value) {
+        Simd::store(output + i, f(Simd::load<V>(input + i)));
+    }
+    for (; i < end; ++i) {
+        output[i] = f(input[i]);
+    }
+}
+
+#define MAI_ELEMENT_WISE_KERNEL(SUFFIX, TARGET, V)                                   \
+    template<typename F>                                                             \
+    TARGET void mapElementWise##SUFFIX(const F& f, const float* input, int64 begin,  \
+            int64 end, float* output) {                                              \
+        mapElementWise<V>(f, input, begin, end, output);                             \
+    }
+
+MAI_ELEMENT_WISE_KERNEL(Generic, , Simd::Float4)
+#ifdef MAI_SIMD_X86
+MAI_ELEMENT_WISE_KERNEL(Avx2, MAI_SIMD_TARGET_AVX2, Simd::Float8)
+MAI_ELEMENT_WISE_KERNEL(Avx512, MAI_SIMD_TARGET_AVX512, Simd::Float16)
+#endif
+
+#undef MAI_ELEMENT_WISE_KERNEL
+
+template<typename F>
+struct ElementWiseKernel {
+    typedef void (*Map)(const F& f, const float* input, int64 begin, int64 end, float* output);
+
+    uint32 cpuFeatures;
+    Map map;
+};
+
+template<typename F>
+const ElementWiseKernel<F>& selectElementWiseKernel(uint32 cpuFeatures) {
+    // widest first
+    static const ElementWiseKernel<F> kernels[] = {
+#ifdef MAI_SIMD_X86
+        {CPU_FEATURE_AVX512F, mapElementWiseAvx512<F>},
+        {CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, mapElementWiseAvx2<F>},
+#endif
+        {0, mapElementWiseGeneric<F>},
+    };
+    for (const ElementWiseKernel<F>& kernel : kernels) {
+        if ((kernel.cpuFeatures & cpuFeatures) == kernel.cpuFeatures) {
+            return kernel;
+        }
+    }
+    return kernels[sizeof(kernels) / sizeof(kernels[0]) - 1];
+}
+
+// cpuFeatures of every vector width compiled in, portable first.
+inline std::vector<uint32> elementWiseCpuFeatureLevels() {
+    std::vector<uint32> levels = {0};
+#ifdef MAI_SIMD_X86
+    levels.push_back(CPU_FEATURE_AVX2 | CPU_FEATURE_FMA);
+    levels.push_back(CPU_FEATURE_AVX512F);
+#endif
+    return levels;
+}
+
+template<typename T, typename F>
+void elementWise(const F& f, const T* input, int64 size, T* output, uint32 /*cpuFeatures*/) {
+    parallelFor(0, size, grainSize(F::kCost), [&](int64 begin, int64 end) {
+        for (int64 i = begin; i < end; ++i) {
+            output[i] = f(input[i]);
+        }
+    });
+}
+
+template<typename F>
+void elementWise(const F& f, const float* input, int64 size, float* output, uint32 cpuFeatures) {
+    typename ElementWiseKernel<F>::Map map = selectElementWiseKernel<F>(cpuFeatures).map;
+    parallelFor(0, size, grainSize(F::kCost), [&](int64 begin, int64 end) {
+        map(f, input, begin, end, output);
+    });
+}
+
+template<typename T, typename F>
+class ElementWise : public Operator {
+public:
+    ElementWise() {}
+    ~ElementWise() = default;
+
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        const Tensor* input = getInputTensor(0);
+        Tensor* output = getOutputTensor(0);
+
+        MAI_OP_RUN_FIRST_START
+        MAI_CHECK_NULL(input);
+        MAI_CHECK_NULL(output);
+        if (output != input) {
+            output->resize(input->shape());
+        }
+        MAI_OP_RUN_FIRST_END
+
+        elementWise(functor(), input->data<T>(), input->elementSize(),
+                output->mutableData<T>(), opContext().cpuFeatures);
+        return MAI_SUCCESS;
+    }
+
+protected:
+    // The functor of this run, operators with a Param build it from there.
+    virtual F functor() const {
+        return F();
+    }
+};
+
+template<template<typename> class OP>
+void registerElementWise(const OpContext& /*opContext*/) {
+}
+
+// Registers OP<T> for every data type T, float once per vector width.
+template<template<typename> class OP, typename T, typename... Ts>
+void registerElementWise(const OpContext& opContext) {
+    OpContext typedContext = opContext;
+    typedContext.dataType = DataTypeToEnum<T>::value;
+    const std::vector<uint32> levels = typedContext.dataType == DT_FLOAT
+        ? elementWiseCpuFeatureLevels() : std::vector<uint32>(1, 0);
+    for (uint32 cpuFeatures : levels) {
+        typedContext.cpuFeatures = cpuFeatures;
+        OperatorRegister::getInstance()->registerOperator(typedContext,
+                OperatorRegister::opDefaultCreator<OP<T> >);
+    }
+    registerElementWise<OP, Ts...>(opContext);
+}
+
+// Functors of the functions in SimdMath.h
+#define MAI_MATH_FUNCTOR(NAME, FUNCTION)                        \
+    struct NAME {                                               \
+        static const int64 kCost = 16;                          \
+        template<typename V>                                    \
+        MAI_SIMD_INLINE V operator()(const V& x) const {        \
+            return Simd::FUNCTION(x);                           \
+        }                                                       \
+    };
+
+MAI_MATH_FUNCTOR(ExpFunctor, exp)
+MAI_MATH_FUNCTOR(ExpFastFunctor, expFast)
+MAI_MATH_FUNCTOR(LogFunctor, log)
+MAI_MATH_FUNCTOR(Log1pFunctor, log1p)
+MAI_MATH_FUNCTOR(SinFunctor, sin)
+MAI_MATH_FUNCTOR(CosFunctor, cos)
+MAI_MATH_FUNCTOR(TanFunctor, tan)
+MAI_MATH_FUNCTOR(ASinFunctor, asin)
+MAI_MATH_FUNCTOR(ACosFunctor, acos)
+MAI_MATH_FUNCTOR(ATanFunctor, atan)
+MAI_MATH_FUNCTOR(SinhFunctor, sinh)
+MAI_MATH_FUNCTOR(CoshFunctor, cosh)
+MAI_MATH_FUNCTOR(TanhFunctor, tanh)
+MAI_MATH_FUNCTOR(TanhFastFunctor, tanhFast)
+MAI_MATH_FUNCTOR(ASinhFunctor, asinh)
+MAI_MATH_FUNCTOR(ACoshFunctor, acosh)
+MAI_MATH_FUNCTOR(ATanhFunctor, atanh)
+MAI_MATH_FUNCTOR(SigmoidFunctor, sigmoid)
+MAI_MATH_FUNCTOR(SigmoidFastFunctor, sigmoidFast)
+MAI_MATH_FUNCTOR(ErfFunctor, erf)
+
+#undef MAI_MATH_FUNCTOR
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
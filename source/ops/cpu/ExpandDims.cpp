@@ -22,14 +22,14 @@ namespace CPU {
 
 class ExpandDims : public Operator {
 public:
-    ExpandDims() : mRunFirst(true) {}
+    ExpandDims() {}
     ~ExpandDims() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         ExpandDimsParam* expandDimsParam = reinterpret_cast<ExpandDimsParam*>(param);
         if (expandDimsParam) {
             mAxes = expandDimsParam->axes;
@@ -66,7 +66,6 @@ public:
     }
 private:
     std::vector<int32> mAxes;
-    bool mRunFirst;
 };
 
 void registerExpandDims() {
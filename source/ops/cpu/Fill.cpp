@@ -23,7 +23,7 @@ namespace CPU {
 template<typename T>
 class Fill : public Operator {
 public:
-    Fill() : mRunFirst(true) {}
+    Fill() {}
     ~Fill() = default;
 
     MAI_STATUS init() override {
@@ -56,7 +56,6 @@ public:
     }
 private:
     enum FLAG {DIMS, INPUT, OUTPUT = 0};
-    bool mRunFirst;
 };
 
 void registerFill() {
@@ -12,59 +12,34 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <math.h>
-#include "core/OperatorRegister.h"
-#include "util/MAIUtil.h"
 #include "Broadcast.h"
 
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 namespace MAI {
 namespace Op {
 namespace CPU {
 
-template<class T>
-class FloorMod : public Broadcast<T, T> {
-public:
-    MAI_STATUS onCommonCompute(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) {
-        ALOGI("FloorMod::onCommonCompute=============");
-        const T* inputAData = inputA->data<T>();
-        const T* inputBData = inputB->data<T>();
-        T* outputData = output->mutableData<T>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < output->elementSize(); ++i) {
-            outputData[i] = inputAData[i] - floor(inputAData[i] / inputBData[i]) * inputBData[i];
-        }
-        return MAI_SUCCESS;
-    }
+namespace {
 
-    MAI_STATUS onScalarCompute(const Tensor* input, const T inputScalar,
-            Tensor* output, bool convertInput) {
-        const T* inputData = input->data<T>();
-        T* outputData = output->mutableData<T>();
-        if (convertInput) {
-            #pragma omp parallel for
-            for (int32 i = 0; i < input->elementSize(); ++i) {
-                outputData[i] = inputScalar - floor(inputScalar / inputData[i]) * inputData[i];
-            }
-        } else {
-            #pragma omp parallel for
-            for (int32 i = 0; i < input->elementSize(); ++i) {
-                outputData[i] = inputData[i] - floor(inputData[i] / inputScalar) * inputScalar;
-            }
-        }
-        return MAI_SUCCESS;
-    }
+struct FloorModFunctor {
+    static const int64 kCost = 1;
 
-    MAI_STATUS onBroadcastCompute() {
-        auto addFunc = [](const T* x, const T* y, T* o) {
-            *o = *x - floor(*x / *y) * *y;
-        };
-        return this->broadcastCompute(addFunc);
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& a, const V& b) const {
+        return a - Simd::floor(a / b) * b;
     }
 };
 
+} // namespace
+
+template<typename T> using FloorMod = Broadcast<T, T, FloorModFunctor>;
+
 void registerFloorMod() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(FLOOR_MOD).build()), float, FloorMod);
+    registerElementWise<FloorMod, float>(OpContextBuilder().setOperatorType(FLOOR_MOD).build());
 }
 
 } // namespace CPU
@@ -15,6 +15,7 @@
 #include <cmath>
 #include "core/OperatorRegister.h"
 #include "util/MAIUtil.h"
+#include "core/ComputeThreadPool.h"
 
 namespace MAI {
 namespace Op {
@@ -23,7 +24,7 @@ namespace CPU {
 template<typename T>
 class FusedBatchNorm : public Operator {
 public:
-    FusedBatchNorm() : mEpsilon(0.001f), mRunFirst(true), mParam(NULL) {
+    FusedBatchNorm() : mEpsilon(0.001f), mNewScale(NULL), mNewOffset(NULL), mParam(NULL) {
     }
 
     ~FusedBatchNorm() {
@@ -38,40 +39,39 @@ public:
     }
 
     static void fusedBatchNormNHWC(const T* input, const std::vector<shape_t>& inputShape,
-            const std::vector<T>& scale, const std::vector<T>& offset, T* output) {
-        int idx = 0;
-        // use openmp will cost more time?
-        //#pragma omp parallel for collapse(2)
-        for (shape_t b = 0; b < inputShape[0]; ++b) {
-            for (shape_t h = 0; h < inputShape[1]; ++h) {
+            const T* scale, const T* offset, T* output) {
+        const shape_t channels = inputShape[3];
+        const shape_t rowSize = inputShape[2] * channels;
+        parallelFor(0, inputShape[0] * inputShape[1], grainSize(rowSize), [&](int64 begin, int64 end) {
+            for (int64 row = begin; row < end; ++row) {
+                const T* inputRow = input + row * rowSize;
+                T* outputRow = output + row * rowSize;
                 for (shape_t w = 0; w < inputShape[2]; ++w) {
-                    for (shape_t c = 0; c < inputShape[3]; ++c) {
-                        output[idx] = input[idx] * scale[c] + offset[c];
-                        idx++;
+                    for (shape_t c = 0; c < channels; ++c) {
+                        outputRow[w * channels + c] = inputRow[w * channels + c] * scale[c] + offset[c];
                     }
                 }
             }
-        }
+        });
     }
 
     static void fusedBatchNormNCHW(const T* input, const std::vector<shape_t>& inputShape,
-            const std::vector<T>& scale, const std::vector<T>& offset, T* output) {
-        int idx = 0;
-        // use openmp will cost more time?
-        //#pragma omp parallel for collapse(2)
-        for (shape_t b = 0; b < inputShape[0]; ++b) {
-            for (shape_t c = 0; c < inputShape[1]; ++c) {
-                for (shape_t h = 0; h < inputShape[2]; ++h) {
-                    for (shape_t w = 0; w < inputShape[3]; ++w) {
-                        output[idx] = input[idx] * scale[c] + offset[c];
-                        idx++;
-                    }
+            const T* scale, const T* offset, T* output) {
+        const shape_t channels = inputShape[1];
+        const shape_t planeSize = inputShape[2] * inputShape[3];
+        parallelFor(0, inputShape[0] * channels, grainSize(planeSize), [&](int64 begin, int64 end) {
+            for (int64 plane = begin; plane < end; ++plane) {
+                const shape_t c = plane % channels;
+                const T* inputPlane = input + plane * planeSize;
+                T* outputPlane = output + plane * planeSize;
+                for (shape_t i = 0; i < planeSize; ++i) {
+                    outputPlane[i] = inputPlane[i] * scale[c] + offset[c];
                 }
             }
-        }
+        });
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<FusedBatchNormParam*>(param);
         mEpsilon = mParam->epsilon;
     }
@@ -113,19 +113,19 @@ public:
             MAI_CHECK(false, "Unsupported data format: %d", mInput->getDataFormat());
         }
 
-        mNewScale.resize(channel);
-        mNewOffset.resize(channel);
-
-        const T* scaleData = scale->data<T>();
-        const T* offsetData = offset->data<T>();
-        const T* meanData = mean->data<T>();
-        const T* varData = var->data<T>();
-
-        // z = gamma * (y - mean) / sqrt(variance + epsilon) + beta
-        for (shape_t c = 0; c < channel; ++c) {
-            mNewScale[c] = scaleData[c] / std::sqrt(varData[c] + mEpsilon);
-            mNewOffset[c] = offsetData[c] - mNewScale[c] * meanData[c];
-        }
+        // the new scale of every channel followed by the new offset
+        mNewScale = cachedConstant<T>(":folded", channel * 2, mFoldedData, [&](T* folded) {
+            const T* scaleData = scale->data<T>();
+            const T* offsetData = offset->data<T>();
+            const T* meanData = mean->data<T>();
+            const T* varData = var->data<T>();
+            // z = gamma * (y - mean) / sqrt(variance + epsilon) + beta
+            for (shape_t c = 0; c < channel; ++c) {
+                folded[c] = scaleData[c] / std::sqrt(varData[c] + mEpsilon);
+                folded[channel + c] = offsetData[c] - folded[c] * meanData[c];
+            }
+        });
+        mNewOffset = mNewScale + channel;
         MAI_OP_RUN_FIRST_END
 
         mFunction(mInput->data<T>(), mInput->shape(), mNewScale,
@@ -134,14 +134,14 @@ public:
     }
 private:
     enum Flags {INPUT = 0, SCALE, OFFSET, MEAN, VAR = 4, OUTPUT = 0};
-    std::function<void(const T*, const std::vector<shape_t>&, const std::vector<T>&,
-                const std::vector<T>&, T*)> mFunction;
+    std::function<void(const T*, const std::vector<shape_t>&, const T*,
+                const T*, T*)> mFunction;
     float mEpsilon;
-    std::vector<T> mNewScale;
-    std::vector<T> mNewOffset;
+    std::vector<T> mFoldedData;
+    const T* mNewScale;
+    const T* mNewOffset;
     const Tensor* mInput;
     Tensor* mOutput;
-    bool mRunFirst;
     FusedBatchNormParam* mParam;
 };
 
@@ -23,14 +23,14 @@ namespace CPU {
 template<typename T>
 class Gather : public Operator {
 public:
-    Gather() : mAxis(0), mRunFirst(true) {}
+    Gather() : mAxis(0) {}
     ~Gather() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         GatherParam* gatherParam = reinterpret_cast<GatherParam*>(param);
         if (gatherParam) {
             mAxis = gatherParam->axis;
@@ -121,7 +121,6 @@ private:
     std::vector<int32> mIndex;
     shape_t mInnerSize;
     shape_t mOuterSize;
-    bool mRunFirst;
 };
 
 void registerGather() {
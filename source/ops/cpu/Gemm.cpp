@@ -19,6 +19,7 @@
 #include "neon/GemmNeon.h"
 #endif
 #include "ref/GemmRef.h"
+#include "Sgemm.h"
 
 namespace MAI {
 namespace Op {
@@ -29,96 +30,12 @@ namespace CPU {
 
 #define GEMM_FUNC_DECALRE void(GEMM_FUNC_PARAM)
 
-template<typename T, bool transpose_a, bool transpose_b>
-class GemmImpl {
-public:
-     static void gemm(const std::vector<shape_t>& aShape, const T* a,
-            const std::vector<shape_t>& bShape, const T* b,
-            const std::vector<shape_t>& cShape, const T* c,
-            const std::vector<shape_t>& outputShape, T* output);
-};
-
-template<typename T>
-class GemmImpl<T, false, false> {
-public:
-     static void gemm(const std::vector<shape_t>& aShape, const T* a,
-            const std::vector<shape_t>& bShape, const T* b,
-            const std::vector<shape_t>& cShape, const T* c,
-            const std::vector<shape_t>& outputShape, T* output) {
-        for(shape_t i = 0; i < outputShape[0]; ++i) {
-            for(shape_t j = 0; j < outputShape[1]; ++j) {
-                for(shape_t k = 0; k < aShape[1]; ++k) {
-                    output[i * outputShape[1] + j] += *(a + (i * aShape[1] + k)) * *(b + k * bShape[1] + j);
-                }
-                output[i * outputShape[1] + j] += c[j];
-            }
-        }
-    }
-};
-
-template<typename T>
-class GemmImpl<T, true, false> {
-public:
-     static void gemm(const std::vector<shape_t>& aShape, const T* a,
-            const std::vector<shape_t>& bShape, const T* b,
-            const std::vector<shape_t>& cShape, const T* c,
-            const std::vector<shape_t>& outputShape, T* output) {
-        for(shape_t i = 0; i < outputShape[0]; ++i) {
-            for(shape_t j = 0; j < outputShape[1]; ++j) {
-                for(shape_t k = 0; k < aShape[0]; ++k) {
-                    output[i * outputShape[1] + j] += *(a + (k * aShape[1] + i)) * *(b + k * bShape[1] + j);
-                }
-                output[i * outputShape[1] + j] += c[j];
-            }
-        }
-    }
-};
-
-template<typename T>
-class GemmImpl<T, false, true> {
-public:
-     static void gemm(const std::vector<shape_t>& aShape, const T* a,
-            const std::vector<shape_t>& bShape, const T* b,
-            const std::vector<shape_t>& cShape, const T* c,
-            const std::vector<shape_t>& outputShape, T* output) {
-        for(shape_t i = 0; i < outputShape[0]; ++i) {
-            for(shape_t j = 0; j < outputShape[1]; ++j) {
-                for(shape_t k = 0; k < aShape[1]; ++k) {
-                    output[i * outputShape[1] + j] += *(a + (i * aShape[1] + k)) * *(b + j * bShape[1] + k);
-                }
-                output[i * outputShape[1] + j] += c[j];
-            }
-        }
-    }
-};
-
-template<typename T>
-class GemmImpl<T, true, true> {
-public:
-     static void gemm(const std::vector<shape_t>& aShape, const T* a,
-            const std::vector<shape_t>& bShape, const T* b,
-            const std::vector<shape_t>& cShape, const T* c,
-            const std::vector<shape_t>& outputShape, T* output) {
-        for(shape_t i = 0; i < outputShape[0]; ++i) {
-            for(shape_t j = 0; j < outputShape[1]; ++j) {
-                for(shape_t k = 0; k < aShape[0]; ++k) {
-                    output[i * outputShape[1] + j] += *(a + (k * aShape[1] + i)) * *(b + j * bShape[1] + k);
-                }
-                output[i * outputShape[1] + j] += c[j];
-            }
-        }
-    }
-};
-
-
 template<typename T>
 class Gemm : public Operator {
 public:
-    Gemm() : mGemmParam(NULL), mRunFirst(true) {
+    Gemm() : mGemmParam(NULL) {
 #ifdef MAI_NEON_ENABLED
         mNoTransANoTransBFunc = NEON::Gemm<T, false, false>::gemm;
-#else
-        mNoTransANoTransBFunc = Ref::Gemm<T, false, false>::gemm;
 #endif
     }
 
@@ -133,12 +50,11 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mGemmParam = reinterpret_cast<GemmParam*>(param);
     }
 
     MAI_STATUS run() override {
-        //TODO:(gavinchen) support broadcast
         const Tensor* tensorA = getInputTensor(0);
         const Tensor* tensorB = getInputTensor(1);
         const Tensor* tensorC = getInputTensor(2);
@@ -146,54 +62,68 @@ public:
         MAI_OP_RUN_FIRST_START
         MAI_CHECK_NULL(tensorA);
         MAI_CHECK_NULL(tensorB);
-        MAI_CHECK(tensorC != NULL, "Gemm mat c must be exists");// TODO:(gavinchen) c can be NULL
         MAI_CHECK_NULL(output);
         MAI_CHECK_NULL(mGemmParam);
         MAI_CHECK(tensorA->dimSize() == 2, "Gemm mat a must be 2-d");
         MAI_CHECK(tensorB->dimSize() == 2, "Gemm mat b must be 2-d");
         MAI_OP_RUN_FIRST_END
-        const T* t1Data = tensorA->data<T>();
-        const T* t2Data = tensorB->data<T>();
-        const T* t3Data = tensorC->data<T>();
-
-        std::vector<shape_t> outputShape(tensorA->dimSize());
-        if (!mGemmParam->transA && !mGemmParam->transB) {
-            outputShape[0] = tensorA->dim(0);
-            outputShape[1] = tensorB->dim(1);
-            output->resize(outputShape);
-            output->zero();
-            T* outputData = output->mutableData<T>();
-            //GemmImpl<T, false,false>::gemm(tensorA->shape(), t1Data, tensorB->shape(), t2Data,
-            //        tensorC->shape(), t3Data, outputShape, outputData);
-            mNoTransANoTransBFunc(t1Data, t2Data, t3Data, outputData, tensorA->dim(0),
-                    tensorB->dim(1), tensorA->dim(1));
-        } else if (!mGemmParam->transA && mGemmParam->transB) {
-            outputShape[0] = tensorA->dim(0);
-            outputShape[1] = tensorB->dim(0);
-            output->resize(outputShape);
-            output->zero();
-            T* outputData = output->mutableData<T>();
-            GemmImpl<T, false,true>::gemm(tensorA->shape(), t1Data, tensorB->shape(), t2Data,
-                    tensorC->shape(), t3Data, outputShape, outputData);
-        } else if (mGemmParam->transA && !mGemmParam->transB) {
-            outputShape[0] = tensorA->dim(1);
-            outputShape[1] = tensorB->dim(1);
-            output->resize(outputShape);
+        const bool transA = mGemmParam->transA;
+        const bool transB = mGemmParam->transB;
+        const shape_t M = transA ? tensorA->dim(1) : tensorA->dim(0);
+        const shape_t K = transA ? tensorA->dim(0) : tensorA->dim(1);
+        const shape_t N = transB ? tensorB->dim(0) : tensorB->dim(1);
+        MAI_CHECK((transB ? tensorB->dim(1) : tensorB->dim(0)) == K,
+                "Gemm inner dims mismatch: %d vs %d", (int)K,
+                (int)(transB ? tensorB->dim(1) : tensorB->dim(0)));
+
+        std::vector<shape_t> outputShape = {M, N};
+        output->resize(outputShape);
+        T* outputData = output->mutableData<T>();
+        if (mNoTransANoTransBFunc && !transA && !transB
+                && mGemmParam->alpha == 1.f && mGemmParam->beta == 1.f
+                && tensorC != NULL && tensorC->dimSize() == 1 && tensorC->dim(0) == N) {
             output->zero();
-            T* outputData = output->mutableData<T>();
-            GemmImpl<T, true,false>::gemm(tensorA->shape(), t1Data, tensorB->shape(), t2Data,
-                    tensorC->shape(), t3Data, outputShape, outputData);
-        } else if (mGemmParam->transA && mGemmParam->transB) {
-            outputShape[0] = tensorA->dim(1);
-            outputShape[1] = tensorB->dim(0);
-            output->resize(outputShape);
-            output->zero();
-            T* outputData = output->mutableData<T>();
-            GemmImpl<T, true,true>::gemm(tensorA->shape(), t1Data, tensorB->shape(), t2Data,
-                    tensorC->shape(), t3Data, outputShape, outputData);
+            mNoTransANoTransBFunc(tensorA->data<T>(), tensorB->data<T>(), tensorC->data<T>(),
+                    outputData, M, N, K);
+            return MAI_SUCCESS;
+        }
+
+        // output = C first, then output = alpha * op(A) * op(B) + beta * output
+        if (tensorC != NULL) {
+            broadcastC(tensorC, M, N, outputData);
         }
+        sgemm(transA, transB, M, N, K,
+                mGemmParam->alpha, tensorA->data<T>(), tensorA->dim(1),
+                tensorB->data<T>(), tensorB->dim(1),
+                tensorC != NULL ? mGemmParam->beta : 0.f, outputData, N,
+                opContext().cpuFeatures);
         return MAI_SUCCESS;
     }
+
+private:
+    // C may be a scalar, a row({N} or {1,N}), a column({M,1}) or MxN
+    static void broadcastC(const Tensor* tensorC, shape_t M, shape_t N, T* output) {
+        shape_t rows = 1;
+        shape_t cols = 1;
+        if (tensorC->dimSize() == 2) {
+            rows = tensorC->dim(0);
+            cols = tensorC->dim(1);
+        } else if (tensorC->dimSize() == 1) {
+            cols = tensorC->dim(0);
+        }
+        MAI_CHECK((rows == 1 || rows == M) && (cols == 1 || cols == N),
+                "Gemm mat c(%d,%d) cannot broadcast to (%d,%d)",
+                (int)rows, (int)cols, (int)M, (int)N);
+        const T* c = tensorC->data<T>();
+        for (shape_t m = 0; m < M; ++m) {
+            const T* cRow = c + (rows == 1 ? 0 : m * cols);
+            T* oRow = output + m * N;
+            for (shape_t n = 0; n < N; ++n) {
+                oRow[n] = cRow[cols == 1 ? 0 : n];
+            }
+        }
+    }
+
 protected:
     std::function<GEMM_FUNC_DECALRE> mNoTransANoTransBFunc;
 
@@ -201,7 +131,6 @@ protected:
 
 private:
     GemmParam* mGemmParam;
-    bool mRunFirst;
 };
 
 template<typename T>
@@ -223,7 +152,6 @@ class GemmRef : public Gemm<T> {
 public:
     GemmRef() : Gemm<T>(){
         this->mNoTransANoTransBFunc = Ref::Gemm<T, false, false>::gemm;
-        ALOGI("GemmRef11 mNoTransANoTransBFunc: == NULL =%d", this->mNoTransANoTransBFunc == NULL);
     }
 
     ~GemmRef(){}
@@ -232,7 +160,10 @@ public:
 
 void registerGemm() {
     ALOGI("registerGemm");
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GEMM).build()), float, Gemm);
+    for (uint32 cpuFeatures : sgemmCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GEMM).setCpuFeatures(cpuFeatures).build()),
+                float, Gemm);
+    }
     MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GEMM).setExtraInfo("ref").build()), float, GemmRef);
     MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GEMM).setExtraInfo("b_morden").build()), float, GemmBMorden);
 }
@@ -12,60 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "core/OperatorRegister.h"
-#include "util/MAIUtil.h"
 #include "Broadcast.h"
 
 namespace MAI {
 namespace Op {
 namespace CPU {
 
-template<class T>
-class Greater : public Broadcast<T, int8> {
-public:
-    MAI_STATUS onCommonCompute(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) {
-        ALOGI("Greater::onCommonCompute");
-        const T* inputAData = inputA->data<T>();
-        const T* inputBData = inputB->data<T>();
-        int8* outputData = output->mutableData<int8>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < output->elementSize(); ++i) {
-            outputData[i] = inputAData[i] > inputBData[i] ? 1 : 0;
-        }
-        return MAI_SUCCESS;
-    }
+namespace {
 
-    MAI_STATUS onScalarCompute(const Tensor* input, const T inputScalar,
-            Tensor* output, bool convertInput) {
-        ALOGI("Greater::onScalarCompute");
-        const T* inputData = input->data<T>();
-        int8* outputData = output->mutableData<int8>();
-        if (convertInput) {
-            //#pragma omp parallel for
-            for (int32 i = 0; i < input->elementSize(); ++i) {
-                outputData[i] = (inputScalar > inputData[i]) ? 1 : 0;
-            }
-        } else {
-            //#pragma omp parallel for
-            for (int32 i = 0; i < input->elementSize(); ++i) {
-                outputData[i] = (inputData[i] > inputScalar) ? 1 : 0;
-            }
-        }
-        return MAI_SUCCESS;
-    }
+struct GreaterFunctor {
+    static const int64 kCost = 1;
 
-    MAI_STATUS onBroadcastCompute() {
-        ALOGI("Greater::onBroadcastCompute");
-        auto addFunc = [](const T* x, const T* y, int8* o) {
-            *o = *x > *y ? 1 : 0;
-        };
-        return this->broadcastCompute(addFunc);
+    template<typename T>
+    MAI_SIMD_INLINE int8 operator()(const T& a, const T& b) const {
+        return a > b ? 1 : 0;
     }
 };
 
+} // namespace
+
+template<typename T> using Greater = Broadcast<T, int8, GreaterFunctor>;
+
 void registerGreater() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GREATER).build()), float, Greater);
+    registerElementWise<Greater, float>(OpContextBuilder().setOperatorType(GREATER).build());
 }
 
 } // namespace CPU
@@ -22,7 +22,7 @@ namespace CPU {
 
 class Identity : public Operator {
 public:
-    Identity() : mRunFirst(true) {}
+    Identity() {}
     ~Identity() = default;
 
     MAI_STATUS init() override {
@@ -41,8 +41,6 @@ public:
 
         return MAI_SUCCESS;
     }
-private:
-    bool mRunFirst;
 };
 
 void registerIdentity() {
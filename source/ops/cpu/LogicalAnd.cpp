@@ -12,50 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "core/OperatorRegister.h"
-#include "util/MAIUtil.h"
 #include "Broadcast.h"
 
 namespace MAI {
 namespace Op {
 namespace CPU {
 
-template<class T>
-class LogicalAnd : public Broadcast<T, int8> {
-public:
-    MAI_STATUS onCommonCompute(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) {
-        const T* inputAData = inputA->data<T>();
-        const T* inputBData = inputB->data<T>();
-        int8* outputData = output->mutableData<int8>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < output->elementSize(); ++i) {
-            outputData[i] = inputAData[i] && inputBData[i];
-        }
-        return MAI_SUCCESS;
-    }
+namespace {
 
-    MAI_STATUS onScalarCompute(const Tensor* input, const T inputScalar,
-            Tensor* output, bool convertInput) {
-        const T* inputData = input->data<T>();
-        int8* outputData = output->mutableData<int8>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < input->elementSize(); ++i) {
-            outputData[i] = inputData[i] && inputScalar;
-        }
-        return MAI_SUCCESS;
-    }
+struct LogicalAndFunctor {
+    static const int64 kCost = 1;
 
-    MAI_STATUS onBroadcastCompute() {
-        auto addFunc = [](const T* x, const T* y, int8* o) {
-            *o = *x && *y;
-        };
-        return this->broadcastCompute(addFunc);
+    template<typename T>
+    MAI_SIMD_INLINE int8 operator()(const T& a, const T& b) const {
+        return a && b ? 1 : 0;
     }
 };
 
+} // namespace
+
+template<typename T> using LogicalAnd = Broadcast<T, int8, LogicalAndFunctor>;
+
 void registerLogicalAnd() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(LOGICAL_AND).build()), int8, LogicalAnd);
+    registerElementWise<LogicalAnd, int8>(OpContextBuilder().setOperatorType(LOGICAL_AND).build());
 }
 
 } // namespace CPU
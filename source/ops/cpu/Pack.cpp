@@ -22,7 +22,7 @@ namespace CPU {
 
 class Pack : public Operator {
 public:
-    Pack() : mNum(0), mAxis(0), mOuterSize(1), mInnerSize(1), mParam(NULL), mRunFirst(true) {}
+    Pack() : mNum(0), mAxis(0), mOuterSize(1), mInnerSize(1), mParam(NULL) {}
     ~Pack() {
         MAI_DELETE_PTR(mParam);
     }
@@ -31,7 +31,7 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<PackParam*>(param);
         if (mParam) {
             mNum = mParam->num;
@@ -75,6 +75,8 @@ public:
         MAI_CHECK_NULL(output);
         output->resize(outputShape);
 
+        mOuterSize = 1;
+        mInnerSize = 1;
         for (shape_t i = 0; i < outputShape.size(); ++i) {
             if (i < (shape_t)mAxis) {
                 mOuterSize *= outputShape[i];
@@ -105,7 +107,6 @@ private:
     shape_t mOuterSize;
     shape_t mInnerSize;
     PackParam* mParam;
-    bool mRunFirst;
 };
 
 void registerPack() {
@@ -92,14 +92,14 @@ static void pad(const T* input, const std::vector<shape_t>& inputShape,
 template<typename T>
 class Pad : public Operator {
 public:
-    Pad() : mConstantValue(0), mRunFirst(true) {}
+    Pad() : mConstantValue(0) {}
     ~Pad() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         PadParam* padParam = reinterpret_cast<PadParam*>(param);
         if (padParam) {
             mConstantValue = static_cast<T>(padParam->constantValue);
@@ -162,7 +162,6 @@ private:
     std::vector<int32> mPaddings;
     const Tensor* mInput;
     Tensor* mOutput;
-    bool mRunFirst;
 };
 
 void registerPad() {
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <limits>
+#include "Pooling.h"
 #include "core/OperatorRegister.h"
 #include "util/MAIUtil.h"
 
@@ -23,11 +25,13 @@ namespace CPU {
 template<typename T>
 class Pool : public Operator {
 public:
+    enum Kernel {KERNEL_REF, KERNEL_SIMD};
     typedef std::function<void(const T*, const std::vector<shape_t>&,
             const PoolParam*,
             T*, const std::vector<shape_t>&)> PoolFunction;
     Pool(MAIOperator poolType, PoolFunction fNHWC, PoolFunction fNCHW)
-        : mPoolType(poolType), mFunctionNHWC(fNHWC), mFunctionNCHW(fNCHW), mParam(NULL), mRunFirst(true) {
+        : mPoolType(poolType), mFunctionNHWC(fNHWC), mFunctionNCHW(fNCHW), mParam(NULL),
+          mPreferredKernel(KERNEL_SIMD), mKernel(KERNEL_SIMD) {
     }
     ~Pool() {
         if (mParam) {
@@ -40,7 +44,7 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<PoolParam*>(param);
     }
 
@@ -51,22 +55,17 @@ public:
         MAI_CHECK_NULL(mInput);
         MAI_CHECK_NULL(mOutput);
         if (mPoolType == GLOBAL_AVG_POOL) {
-            if (mParam != NULL) {
-                delete mParam;
+            // the whole plane, whatever param was passed in
+            if (mParam == NULL) {
+                mParam = new PoolParam();
             }
-            mParam = new PoolParam();
             mParam->paddingMode = PADDING_VALID;
             mParam->strides = {1,1,1,1};
+            mParam->paddings.clear();
         }
         MAI_CHECK_NULL(mParam);
         MAI_CHECK(mInput->shape().size() == 4, "Input shape must be 4-d");
-        if (mParam->paddingMode != INVALID) {
-            MAI_CHECK(mParam->paddings.size() == 0,
-                "Cannot use explicit padding when paddingMode is :%d", mParam->paddingMode);
-        } else {
-            MAI_CHECK(mParam->paddings.size() == 4,
-                "Explicit padding size must be 4 but not: %d", mParam->paddings.size());
-        }
+        derivePaddings(mParam->paddingMode, mParam->kernelSizes, mParam->paddings);
 
         std::vector<shape_t> outputShape(4);
         if (mInput->getDataFormat() == NHWC) {
@@ -95,21 +94,59 @@ public:
         outputShape[mInput->h()] = outputHW[0];
         outputShape[mInput->w()] = outputHW[1];
         mOutput->resize(outputShape);
-        if (mParam->paddingMode != INVALID) {
-            mParam->paddings = calcPaddings(mParam->paddingMode, mParam->kernelSizes);
-        }
 
         if (mFunction == NULL) {
             MAI_CHECK(false, "Unsupported input data format: %s", getNameFromDataFormat(mInput->getDataFormat()).c_str());
         }
 
+        mKernel = mPreferredKernel;
         MAI_OP_RUN_FIRST_END
 
+        if (mKernel == KERNEL_SIMD) {
+            runSimd();
+        } else {
+            runRef();
+        }
+        return MAI_SUCCESS;
+    }
+
+private:
+    void runSimd() {
+        const uint32 cpuFeatures = opContext().cpuFeatures;
+        const T* input = mInput->data<T>();
+        T* output = mOutput->mutableData<T>();
+        const shape_t size = mInput->dimH() * mInput->dimW();
+        const bool nhwc = mInput->getDataFormat() == NHWC;
+        if (mPoolType == GLOBAL_AVG_POOL) {
+            if (nhwc) {
+                globalAvgPoolNHWC(input, mInput->dimN(), size, mInput->dimC(), output, cpuFeatures);
+            } else {
+                globalAvgPoolNCHW(input, mInput->dimN() * mInput->dimC(), size, output, cpuFeatures);
+            }
+            return;
+        }
+        const std::vector<int32>& kernelSizes = mParam->kernelSizes;
+        const std::vector<int32>& strides = mParam->strides;
+        if (nhwc) {
+            pool2DNHWC(mPoolType, input, mInput->dimN(), mInput->dimH(), mInput->dimW(),
+                    mInput->dimC(), kernelSizes[mInput->h()], kernelSizes[mInput->w()],
+                    strides[mInput->h()], strides[mInput->w()],
+                    mParam->paddings[0], mParam->paddings[2],
+                    mOutput->dimH(), mOutput->dimW(), output, cpuFeatures);
+        } else {
+            pool2DNCHW(mPoolType, input, mInput->dimN(), mInput->dimH(), mInput->dimW(),
+                    mInput->dimC(), kernelSizes[mInput->h()], kernelSizes[mInput->w()],
+                    strides[mInput->h()], strides[mInput->w()],
+                    mParam->paddings[0], mParam->paddings[2],
+                    mOutput->dimH(), mOutput->dimW(), output, cpuFeatures);
+        }
+    }
+
+    void runRef() {
         mOutput->zero();
         mFunction(mInput->data<T>(), mInput->shape(),
                 mParam,
                 mOutput->mutableData<T>(), mOutput->shape());
-        return MAI_SUCCESS;
     }
 
 private:
@@ -121,7 +158,12 @@ private:
     PoolFunction mFunctionNHWC;
     PoolFunction mFunctionNCHW;
     PoolParam* mParam;
-    bool mRunFirst;
+
+protected:
+    Kernel mPreferredKernel;
+
+private:
+    Kernel mKernel;
 };
 
 template<typename T>
@@ -282,16 +324,55 @@ public:
     }
 };
 
+template<typename T>
+class MaxPoolRef : public MaxPool<T> {
+public:
+    MaxPoolRef() : MaxPool<T>() {
+        this->mPreferredKernel = Pool<T>::KERNEL_REF;
+    }
+};
+
+template<typename T>
+class AvgPoolRef : public AvgPool<T> {
+public:
+    AvgPoolRef() : AvgPool<T>() {
+        this->mPreferredKernel = Pool<T>::KERNEL_REF;
+    }
+};
+
+template<typename T>
+class GlobalAvgPoolRef : public GlobalAvgPool<T> {
+public:
+    GlobalAvgPoolRef() : GlobalAvgPool<T>() {
+        this->mPreferredKernel = Pool<T>::KERNEL_REF;
+    }
+};
+
 void registerMaxPool() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(MAX_POOL).build()), float, MaxPool);
+    for (uint32 cpuFeatures : poolCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(MAX_POOL).setCpuFeatures(cpuFeatures).build()),
+                float, MaxPool);
+    }
+    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(MAX_POOL).setExtraInfo("ref").build()),
+            float, MaxPoolRef);
 }
 
 void registerAvgPool() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(AVG_POOL).build()), float, AvgPool);
+    for (uint32 cpuFeatures : poolCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(AVG_POOL).setCpuFeatures(cpuFeatures).build()),
+                float, AvgPool);
+    }
+    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(AVG_POOL).setExtraInfo("ref").build()),
+            float, AvgPoolRef);
 }
 
 void registerGlobalAvgPool() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GLOBAL_AVG_POOL).build()), float, GlobalAvgPool);
+    for (uint32 cpuFeatures : poolCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GLOBAL_AVG_POOL).setCpuFeatures(cpuFeatures).build()),
+                float, GlobalAvgPool);
+    }
+    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GLOBAL_AVG_POOL).setExtraInfo("ref").build()),
+            float, GlobalAvgPoolRef);
 }
 
 } // namespace CPU
@@ -0,0 +1,470 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "Pooling.h"
+#include "Simd.h"
+#include "core/ComputeThreadPool.h"
+#include "util/MAIType.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+namespace {
+
+using namespace Simd;
+
+struct MaxOp {
+    template<typename V>
+    static MAI_SIMD_INLINE V init() {
+        return splat<V>(std::numeric_limits<float>::lowest());
+    }
+
+    template<typename V>
+    static MAI_SIMD_INLINE V combine(const V& acc, const V& value) {
+        return maximum(acc, value);
+    }
+
+    template<typename V>
+    static MAI_SIMD_INLINE V finish(const V& acc, int64 count) {
+        return count == 0 ? splat<V>(0.f) : acc;
+    }
+};
+
+struct AvgOp {
+    template<typename V>
+    static MAI_SIMD_INLINE V init() {
+        return splat<V>(0.f);
+    }
+
+    template<typename V>
+    static MAI_SIMD_INLINE V combine(const V& acc, const V& value) {
+        return acc + value;
+    }
+
+    template<typename V>
+    static MAI_SIMD_INLINE V finish(const V& acc, int64 count) {
+        return count == 0 ? splat<V>(0.f) : acc / splat<V>(static_cast<float>(count));
+    }
+};
+
+struct PoolArgs {
+    const float* input;
+    int64 inH;
+    int64 inW;
+    int64 channels;// 1 for NCHW, the planes are rows of the batch
+    int64 kernelH;
+    int64 kernelW;
+    int64 strideH;
+    int64 strideW;
+    int64 padTop;
+    int64 padLeft;
+    int64 outH;
+    int64 outW;
+    int64 interiorBegin;// output columns [interiorBegin, interiorEnd) read no padding
+    int64 interiorEnd;
+    float* output;
+};
+
+// Rows of the window which are inside the input
+struct WindowRows {
+    int64 begin;
+    int64 count;
+    bool full;
+};
+
+MAI_SIMD_INLINE WindowRows windowRows(const PoolArgs& args, int64 oh, int64 kernelH, int64 strideH) {
+    const int64 ih0 = oh * strideH - args.padTop;
+    WindowRows rows;
+    rows.begin = std::max<int64>(ih0, 0);
+    rows.count = std::max<int64>(std::min(ih0 + kernelH, args.inH) - rows.begin, 0);
+    rows.full = rows.begin == ih0 && rows.count == kernelH;
+    return rows;
+}
+
+// rows x cols taps of Lanes<V> channels, p at the first one
+template<typename V, typename Op>
+MAI_SIMD_INLINE V windowNHWC(const float* p, int64 rows, int64 cols,
+        int64 rowStride, int64 channels) {
+    V acc = Op::template init<V>();
+    for (int64 r = 0; r < rows; ++r) {
+        for (int64 c = 0; c < cols; ++c) {
+            acc = Op::combine(acc, load<V>(p + r * rowStride + c * channels));
+        }
+    }
+    return Op::finish(acc, rows * cols);
+}
+
+template<typename V, typename Op>
+MAI_SIMD_INLINE void channelsNHWC(const float* p, int64 rows, int64 cols,
+        int64 rowStride, int64 channels, float* output) {
+    int64 c = 0;
+    for (; c + Lanes<V>::value <= channels; c += Lanes<V>::value) {
+        store(output + c, windowNHWC<V, Op>(p + c, rows, cols, rowStride, channels));
+    }
+    for (; c < channels; ++c) {
+        output[c] = windowNHWC<float, Op>(p + c, rows, cols, rowStride, channels);
+    }
+}
+
+// Rows n * outH + oh of the output, KH/KW/S are 0 if only known at run time
+template<typename V, typename Op, int KH, int KW, int S>
+MAI_SIMD_INLINE void rowsNHWC(const PoolArgs& args, int64 begin, int64 end) {
+    const int64 kernelH = KH > 0 ? KH : args.kernelH;
+    const int64 kernelW = KW > 0 ? KW : args.kernelW;
+    const int64 strideH = S > 0 ? S : args.strideH;
+    const int64 strideW = S > 0 ? S : args.strideW;
+    const int64 channels = args.channels;
+    const int64 rowStride = args.inW * channels;
+    for (int64 row = begin; row < end; ++row) {
+        const int64 n = row / args.outH;
+        const WindowRows rows = windowRows(args, row % args.outH, kernelH, strideH);
+        const float* input = args.input + (n * args.inH + rows.begin) * rowStride;
+        float* output = args.output + row * args.outW * channels;
+        for (int64 ow = 0; ow < args.outW; ++ow) {
+            const int64 iw0 = ow * strideW - args.padLeft;
+            if (KH > 0 && rows.full && ow >= args.interiorBegin && ow < args.interiorEnd) {
+                channelsNHWC<V, Op>(input + iw0 * channels, KH, KW,
+                        rowStride, channels, output + ow * channels);
+            } else {
+                const int64 colBegin = std::max<int64>(iw0, 0);
+                const int64 cols = std::max<int64>(
+                        std::min(iw0 + kernelW, args.inW) - colBegin, 0);
+                channelsNHWC<V, Op>(input + colBegin * channels, rows.count, cols,
+                        rowStride, channels, output + ow * channels);
+            }
+        }
+    }
+}
+
+// Lanes<V> columns stride apart
+template<typename V, int S>
+MAI_SIMD_INLINE V loadColumns(const float* p, int64 stride) {
+    if (S > 0) {
+        return loadStrided<V, S>(p);
+    }
+    return stride == 1 ? load<V>(p) : loadStrided<V>(p, stride);
+}
+
+// Windows of Lanes<V> consecutive output columns which read no padding
+template<typename V, typename Op, int S>
+MAI_SIMD_INLINE V interiorNCHW(const float* p, int64 rows, int64 cols,
+        int64 inW, int64 strideW) {
+    V acc = Op::template init<V>();
+    for (int64 r = 0; r < rows; ++r) {
+        for (int64 c = 0; c < cols; ++c) {
+            acc = Op::combine(acc, loadColumns<V, S>(p + r * inW + c, strideW));
+        }
+    }
+    return Op::finish(acc, rows * cols);
+}
+
+template<typename Op>
+MAI_SIMD_INLINE float borderNCHW(const PoolArgs& args, const float* input, int64 rows,
+        int64 kernelW, int64 strideW, int64 ow) {
+    const int64 iw0 = ow * strideW - args.padLeft;
+    const int64 colBegin = std::max<int64>(iw0, 0);
+    const int64 cols = std::max<int64>(std::min(iw0 + kernelW, args.inW) - colBegin, 0);
+    float acc = Op::template init<float>();
+    for (int64 r = 0; r < rows; ++r) {
+        for (int64 c = 0; c < cols; ++c) {
+            acc = Op::combine(acc, input[r * args.inW + colBegin + c]);
+        }
+    }
+    return Op::finish(acc, rows * cols);
+}
+
+template<typename V, typename Op, int KH, int KW, int S>
+MAI_SIMD_INLINE void interiorRowNCHW(const float* input, int64 rows, int64 cols,
+        const PoolArgs& args, int64 strideW, float* output) {
+    int64 ow = args.interiorBegin;
+    for (; ow + Lanes<V>::value <= args.interiorEnd; ow += Lanes<V>::value) {
+        store(output + ow, interiorNCHW<V, Op, S>(input + ow * strideW - args.padLeft,
+                rows, cols, args.inW, strideW));
+    }
+    for (; ow < args.interiorEnd; ++ow) {
+        output[ow] = interiorNCHW<float, Op, S>(input + ow * strideW - args.padLeft,
+                rows, cols, args.inW, strideW);
+    }
+}
+
+// Rows (n * C + c) * outH + oh of the output
+template<typename V, typename Op, int KH, int KW, int S>
+MAI_SIMD_INLINE void rowsNCHW(const PoolArgs& args, int64 begin, int64 end) {
+    const int64 kernelH = KH > 0 ? KH : args.kernelH;
+    const int64 kernelW = KW > 0 ? KW : args.kernelW;
+    const int64 strideH = S > 0 ? S : args.strideH;
+    const int64 strideW = S > 0 ? S : args.strideW;
+    for (int64 row = begin; row < end; ++row) {
+        const int64 plane = row / args.outH;
+        const WindowRows rows = windowRows(args, row % args.outH, kernelH, strideH);
+        const float* input = args.input + (plane * args.inH + rows.begin) * args.inW;
+        float* output = args.output + row * args.outW;
+        for (int64 ow = 0; ow < args.interiorBegin; ++ow) {
+            output[ow] = borderNCHW<Op>(args, input, rows.count, kernelW, strideW, ow);
+        }
+        if (KH > 0 && rows.full) {
+            interiorRowNCHW<V, Op, KH, KW, S>(input, KH, KW, args, strideW, output);
+        } else {
+            interiorRowNCHW<V, Op, KH, KW, S>(input, rows.count, kernelW, args, strideW, output);
+        }
+        for (int64 ow = args.interiorEnd; ow < args.outW; ++ow) {
+            output[ow] = borderNCHW<Op>(args, input, rows.count, kernelW, strideW, ow);
+        }
+    }
+}
+
+// Channels summed by one task of the NHWC global average pooling
+const int64 kGlobalChannelBlock = 64;
+
+struct GlobalArgs {
+    const float* input;
+    int64 size;
+    int64 channels;
+    int64 blocks;// channel blocks per image
+    float* output;
+};
+
+// Tasks n * blocks + block
+template<typename V>
+MAI_SIMD_INLINE void globalNHWC(const GlobalArgs& args, int64 begin, int64 end) {
+    float sums[kGlobalChannelBlock];
+    for (int64 task = begin; task < end; ++task) {
+        const int64 n = task / args.blocks;
+        const int64 c0 = task % args.blocks * kGlobalChannelBlock;
+        const int64 count = std::min(kGlobalChannelBlock, args.channels - c0);
+        const float* input = args.input + n * args.size * args.channels + c0;
+        std::fill(sums, sums + count, 0.f);
+        for (int64 s = 0; s < args.size; ++s) {
+            const float* pixel = input + s * args.channels;
+            int64 c = 0;
+            for (; c + Lanes<V>::value <= count; c += Lanes<V>::value) {
+                store(sums + c, load<V>(sums + c) + load<V>(pixel + c));
+            }
+            for (; c < count; ++c) {
+                sums[c] += pixel[c];
+            }
+        }
+        float* output = args.output + n * args.channels + c0;
+        for (int64 c = 0; c < count; ++c) {
+            output[c] = sums[c] / args.size;
+        }
+    }
+}
+
+// Planes [begin, end), blocks is unused
+template<typename V>
+MAI_SIMD_INLINE void globalNCHW(const GlobalArgs& args, int64 begin, int64 end) {
+    for (int64 plane = begin; plane < end; ++plane) {
+        const float* input = args.input + plane * args.size;
+        V acc = splat<V>(0.f);
+        int64 s = 0;
+        for (; s + Lanes<V>::value <= args.size; s += Lanes<V>::value) {
+            acc += load<V>(input + s);
+        }
+        float sum = reduceSum(acc);
+        for (; s < args.size; ++s) {
+            sum += input[s];
+        }
+        args.output[plane] = sum / args.size;
+    }
+}
+
+typedef void (*RowsFunc)(const PoolArgs& args, int64 begin, int64 end);
+typedef void (*GlobalFunc)(const GlobalArgs& args, int64 begin, int64 end);
+
+enum Window {WINDOW_2X2S2, WINDOW_3X3S2, WINDOW_ANY, WINDOW_COUNT};
+
+struct PoolKernel {
+    uint32 cpuFeatures;
+    RowsFunc nhwc[2][WINDOW_COUNT];// MAX_POOL, AVG_POOL
+    RowsFunc nchw[2][WINDOW_COUNT];
+    GlobalFunc globalNHWC;
+    GlobalFunc globalNCHW;
+};
+
+#define MAI_POOL_KERNELS(SUFFIX, TARGET, V)                                         \
+    template<typename Op, int KH, int KW, int S>                                    \
+    TARGET void rowsNHWC##SUFFIX(const PoolArgs& args, int64 begin, int64 end) {     \
+        rowsNHWC<V, Op, KH, KW, S>(args, begin, end);                               \
+    }                                                                               \
+    template<typename Op, int KH, int KW, int S>                                    \
+    TARGET void rowsNCHW##SUFFIX(const PoolArgs& args, int64 begin, int64 end) {     \
+        rowsNCHW<V, Op, KH, KW, S>(args, begin, end);                               \
+    }                                                                               \
+    TARGET void globalNHWC##SUFFIX(const GlobalArgs& args, int64 begin, int64 end) { \
+        globalNHWC<V>(args, begin, end);                                            \
+    }                                                                               \
+    TARGET void globalNCHW##SUFFIX(const GlobalArgs& args, int64 begin, int64 end) { \
+        globalNCHW<V>(args, begin, end);                                            \
+    }
+
+MAI_POOL_KERNELS(Generic, , Float4)
+#ifdef MAI_SIMD_X86
+MAI_POOL_KERNELS(Avx2, MAI_SIMD_TARGET_AVX2, Float8)
+MAI_POOL_KERNELS(Avx512, MAI_SIMD_TARGET_AVX512, Float16)
+#endif
+
+#undef MAI_POOL_KERNELS
+
+#define MAI_POOL_WINDOWS(ROWS, OP) \
+    {ROWS<OP, 2, 2, 2>, ROWS<OP, 3, 3, 2>, ROWS<OP, 0, 0, 0>}
+
+#define MAI_POOL_KERNEL(FEATURES, SUFFIX)                                                 \
+    {FEATURES,                                                                            \
+        {MAI_POOL_WINDOWS(rowsNHWC##SUFFIX, MaxOp), MAI_POOL_WINDOWS(rowsNHWC##SUFFIX, AvgOp)}, \
+        {MAI_POOL_WINDOWS(rowsNCHW##SUFFIX, MaxOp), MAI_POOL_WINDOWS(rowsNCHW##SUFFIX, AvgOp)}, \
+        globalNHWC##SUFFIX, globalNCHW##SUFFIX}
+
+// widest first
+const PoolKernel kPoolKernels[] = {
+#ifdef MAI_SIMD_X86
+    MAI_POOL_KERNEL(CPU_FEATURE_AVX512F, Avx512),
+    MAI_POOL_KERNEL(CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, Avx2),
+#endif
+    MAI_POOL_KERNEL(0, Generic),
+};
+
+#undef MAI_POOL_KERNEL
+#undef MAI_POOL_WINDOWS
+
+const PoolKernel& selectKernel(uint32 cpuFeatures) {
+    for (const PoolKernel& kernel : kPoolKernels) {
+        if ((kernel.cpuFeatures & cpuFeatures) == kernel.cpuFeatures) {
+            return kernel;
+        }
+    }
+    return kPoolKernels[sizeof(kPoolKernels) / sizeof(kPoolKernels[0]) - 1];
+}
+
+RowsFunc selectRows(RowsFunc const (&rows)[2][WINDOW_COUNT], MAIOperator poolType,
+        int32 kernelH, int32 kernelW, int32 strideH, int32 strideW) {
+    MAI_CHECK(poolType == MAX_POOL || poolType == AVG_POOL,
+            "Unsupported pool type:%s", getNameFromOperator(poolType).c_str());
+    const int32 op = poolType == MAX_POOL ? 0 : 1;
+    if (strideH == 2 && strideW == 2 && kernelH == kernelW) {
+        if (kernelH == 2) {
+            return rows[op][WINDOW_2X2S2];
+        }
+        if (kernelH == 3) {
+            return rows[op][WINDOW_3X3S2];
+        }
+    }
+    return rows[op][WINDOW_ANY];
+}
+
+PoolArgs makeArgs(const float* input, int64 inH, int64 inW, int64 channels,
+        int32 kernelH, int32 kernelW, int32 strideH, int32 strideW,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW, float* output) {
+    MAI_CHECK(kernelH > 0 && kernelW > 0 && strideH > 0 && strideW > 0,
+            "Invalid pool window:%dx%d stride:%dx%d", kernelH, kernelW, strideH, strideW);
+    PoolArgs args;
+    args.input = input;
+    args.inH = inH;
+    args.inW = inW;
+    args.channels = channels;
+    args.kernelH = kernelH;
+    args.kernelW = kernelW;
+    args.strideH = strideH;
+    args.strideW = strideW;
+    args.padTop = padTop;
+    args.padLeft = padLeft;
+    args.outH = outH;
+    args.outW = outW;
+    // iw0 = ow * strideW - padLeft, interior if iw0 >= 0 and iw0 + kernelW <= inW
+    args.interiorBegin = std::min(outW, std::max<int64>(padLeft + strideW - 1, 0) / strideW);
+    args.interiorEnd = inW + padLeft >= kernelW
+        ? std::min(outW, (inW + padLeft - kernelW) / strideW + 1) : 0;
+    args.interiorEnd = std::max(args.interiorEnd, args.interiorBegin);
+    args.output = output;
+    return args;
+}
+
+} // namespace
+
+void pool2DNHWC(MAIOperator poolType, const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, int32 kernelH, int32 kernelW, int32 strideH, int32 strideW,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW, float* output, uint32 cpuFeatures) {
+    PoolArgs args = makeArgs(input, inH, inW, channels, kernelH, kernelW, strideH, strideW,
+            padTop, padLeft, outH, outW, output);
+    RowsFunc rows = selectRows(selectKernel(cpuFeatures).nhwc, poolType,
+            kernelH, kernelW, strideH, strideW);
+    parallelFor(0, batch * outH, grainSize(outW * channels * kernelH * kernelW),
+            [&](int64 begin, int64 end) {
+        rows(args, begin, end);
+    });
+}
+
+void pool2DNCHW(MAIOperator poolType, const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, int32 kernelH, int32 kernelW, int32 strideH, int32 strideW,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW, float* output, uint32 cpuFeatures) {
+    PoolArgs args = makeArgs(input, inH, inW, 1, kernelH, kernelW, strideH, strideW,
+            padTop, padLeft, outH, outW, output);
+    RowsFunc rows = selectRows(selectKernel(cpuFeatures).nchw, poolType,
+            kernelH, kernelW, strideH, strideW);
+    parallelFor(0, batch * channels * outH, grainSize(outW * kernelH * kernelW),
+            [&](int64 begin, int64 end) {
+        rows(args, begin, end);
+    });
+}
+
+void globalAvgPoolNHWC(const float* input, int64 batch, int64 size, int64 channels,
+        float* output, uint32 cpuFeatures) {
+    GlobalArgs args;
+    args.input = input;
+    args.size = size;
+    args.channels = channels;
+    args.blocks = (channels + kGlobalChannelBlock - 1) / kGlobalChannelBlock;
+    args.output = output;
+    GlobalFunc global = selectKernel(cpuFeatures).globalNHWC;
+    parallelFor(0, batch * args.blocks, grainSize(size * kGlobalChannelBlock),
+            [&](int64 begin, int64 end) {
+        global(args, begin, end);
+    });
+}
+
+void globalAvgPoolNCHW(const float* input, int64 planes, int64 size,
+        float* output, uint32 cpuFeatures) {
+    GlobalArgs args;
+    args.input = input;
+    args.size = size;
+    args.channels = 1;
+    args.blocks = 1;
+    args.output = output;
+    GlobalFunc global = selectKernel(cpuFeatures).globalNCHW;
+    parallelFor(0, planes, grainSize(size),
+            [&](int64 begin, int64 end) {
+        global(args, begin, end);
+    });
+}
+
+std::vector<uint32> poolCpuFeatureLevels() {
+    std::vector<uint32> levels;
+    for (const PoolKernel& kernel : kPoolKernels) {
+        levels.insert(levels.begin(), kernel.cpuFeatures);
+    }
+    return levels;
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
@@ -0,0 +1,61 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+// Max and average pooling(average over the taps inside the input), global
+// average pooling.
+//
+// The output rows are spread over the threads of the current
+// ComputeThreadPool. In every row the columns whose window lies inside the
+// input(interior) run without bounds, the others clip their window. 2x2 and
+// 3x3 windows with stride 2 have their taps unrolled at compile time. NHWC
+// is vectorized over the channels, NCHW over the output columns. Global
+// average pooling sums every (image, block of channels) in NHWC, every
+// plane in NCHW, as a parallel reduction.
+//
+// The vector width is the widest cpuFeatures allow: 16 floats with AVX-512,
+// 8 with AVX2/FMA, 4(SSE/NEON) otherwise.
+
+// poolType is MAX_POOL or AVG_POOL, input is NHWC.
+void pool2DNHWC(MAIOperator poolType, const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, int32 kernelH, int32 kernelW, int32 strideH, int32 strideW,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW, float* output, uint32 cpuFeatures);
+
+// poolType is MAX_POOL or AVG_POOL, input is NCHW.
+void pool2DNCHW(MAIOperator poolType, const float* input, int64 batch, int64 inH, int64 inW,
+        int64 channels, int32 kernelH, int32 kernelW, int32 strideH, int32 strideW,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW, float* output, uint32 cpuFeatures);
+
+// output(N x C) = mean of input(N x size x C)
+void globalAvgPoolNHWC(const float* input, int64 batch, int64 size, int64 channels,
+        float* output, uint32 cpuFeatures);
+
+// output(planes) = mean of input(planes x size)
+void globalAvgPoolNCHW(const float* input, int64 planes, int64 size,
+        float* output, uint32 cpuFeatures);
+
+// cpuFeatures of every vector width compiled in, portable first.
+std::vector<uint32> poolCpuFeatureLevels();
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
@@ -23,7 +23,7 @@ namespace CPU {
 template<typename T>
 class Pow : public Operator {
 public:
-    Pow() : mRunFirst(true) {}
+    Pow() {}
     ~Pow() = default;
 
     MAI_STATUS init() override {
@@ -55,8 +55,6 @@ public:
         }
         return MAI_SUCCESS;
     }
-private:
-    bool mRunFirst;
 };
 
 void registerPow() {
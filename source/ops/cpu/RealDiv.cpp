@@ -12,59 +12,34 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <math.h>
-#include "core/OperatorRegister.h"
-#include "util/MAIUtil.h"
 #include "Broadcast.h"
 
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 namespace MAI {
 namespace Op {
 namespace CPU {
 
-template<class T>
-class RealDiv : public Broadcast<T, T> {
-public:
-    MAI_STATUS onCommonCompute(const Tensor* inputA, const Tensor* inputB,
-            Tensor* output) {
-        ALOGI("RealDiv::onCommonCompute=============");
-        const T* inputAData = inputA->data<T>();
-        const T* inputBData = inputB->data<T>();
-        T* outputData = output->mutableData<T>();
-        #pragma omp parallel for
-        for (int32 i = 0; i < output->elementSize(); ++i) {
-            outputData[i] = inputAData[i] / inputBData[i];
-        }
-        return MAI_SUCCESS;
-    }
+namespace {
 
-    MAI_STATUS onScalarCompute(const Tensor* input, const T inputScalar,
-            Tensor* output, bool convertInput) {
-        const T* inputData = input->data<T>();
-        T* outputData = output->mutableData<T>();
-        if (convertInput) {
-            #pragma omp parallel for
-            for (int32 i = 0; i < input->elementSize(); ++i) {
-                outputData[i] = inputScalar / inputData[i];
-            }
-        } else {
-            #pragma omp parallel for
-            for (int32 i = 0; i < input->elementSize(); ++i) {
-                outputData[i] = inputData[i] / inputScalar;
-            }
-        }
-        return MAI_SUCCESS;
-    }
+struct RealDivFunctor {
+    static const int64 kCost = 1;
 
-    MAI_STATUS onBroadcastCompute() {
-        auto addFunc = [](const T* x, const T* y, T* o) {
-            *o = *x / *y;
-        };
-        return this->broadcastCompute(addFunc);
+    template<typename V>
+    MAI_SIMD_INLINE V operator()(const V& a, const V& b) const {
+        return a / b;
     }
 };
 
+} // namespace
+
+template<typename T> using RealDiv = Broadcast<T, T, RealDivFunctor>;
+
 void registerRealDiv() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(REAL_DIV).build()), float, RealDiv);
+    registerElementWise<RealDiv, float>(OpContextBuilder().setOperatorType(REAL_DIV).build());
 }
 
 } // namespace CPU
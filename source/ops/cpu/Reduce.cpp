@@ -22,7 +22,7 @@ namespace CPU {
 
 class Reduce : public Operator {
 public:
-    Reduce() : mParam(NULL), mRunFirst(true) {}
+    Reduce() : mParam(NULL) {}
     ~Reduce() {
         if (mParam != NULL) {
             delete mParam;
@@ -34,7 +34,7 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<ReduceParam*>(param);
     }
 
@@ -139,7 +139,6 @@ public:
 private:
     ReduceParam* mParam;
     std::vector<int32> mReducedAxis;
-    bool mRunFirst;
     std::shared_ptr<Tensor> mTmp1Tensor;
     std::shared_ptr<Tensor> mTmp2Tensor;
 };
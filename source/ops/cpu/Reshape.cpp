@@ -23,7 +23,7 @@ namespace CPU {
 template<typename T>
 class Reshape : public Operator {
 public:
-    Reshape() : mRunFirst(true) {}
+    Reshape() {}
     ~Reshape() = default;
 
     MAI_STATUS init() override {
@@ -87,8 +87,6 @@ public:
 
         return MAI_SUCCESS;
     }
-private:
-    bool mRunFirst;
 };
 
 void registerReshape() {
@@ -23,14 +23,14 @@ namespace CPU {
 template<typename T>
 class ResizeBilinear : public Operator {
 public:
-    ResizeBilinear() : mRunFirst(true) {}
+    ResizeBilinear() {}
     ~ResizeBilinear() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
     }
 
     static void resizeNHWC(const std::vector<shape_t>& inputShape, const T* input,
@@ -106,8 +106,6 @@ public:
 
         return MAI_SUCCESS;
     }
-private:
-    bool mRunFirst;
 };
 
 void registerResizeBilinear() {
@@ -0,0 +1,448 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MAI_SGEMM_X86
+#endif
+#include "Sgemm.h"
+#include "core/ComputeThreadPool.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+namespace {
+
+const int64 kMR = 6;
+const int64 kNR = 16;
+const int64 kMaxMR = 12;
+const int64 kMaxNR = 32;
+const int64 kMC = 144;// multiple of every MR, a packed A block(144x256) stays in L2
+const int64 kKC = 256;
+const int64 kNC = 4096;// multiple of every NR
+const int64 kPanelsPerTask = 8;// NR panels of B one task runs over
+
+// c(MRxNR) = alpha * a * b + beta * c, a is a packed panel of A(kc x MR),
+// b a packed panel of B(kc x NR).
+typedef void (*MicroKernelFunc)(int64 kc, const float* a, const float* b,
+        float alpha, float beta, float* c, int64 ldc);
+
+struct MicroKernel {
+    uint32 cpuFeatures;
+    int64 mr;
+    int64 nr;
+    MicroKernelFunc func;
+};
+
+void microKernelGeneric(int64 kc, const float* a, const float* b,
+        float alpha, float beta, float* c, int64 ldc) {
+    float acc[kMR * kNR] = {0};
+    for (int64 k = 0; k < kc; ++k) {
+        for (int64 i = 0; i < kMR; ++i) {
+            const float aValue = a[i];
+            for (int64 j = 0; j < kNR; ++j) {
+                acc[i * kNR + j] += aValue * b[j];
+            }
+        }
+        a += kMR;
+        b += kNR;
+    }
+    for (int64 i = 0; i < kMR; ++i) {
+        for (int64 j = 0; j < kNR; ++j) {
+            c[i * ldc + j] = alpha * acc[i * kNR + j] + (beta == 0.f ? 0.f : beta * c[i * ldc + j]);
+        }
+    }
+}
+
+#ifdef MAI_SGEMM_X86
+#define MAI_SGEMM_FMA_ROW(i)                                \
+    aValue = _mm256_broadcast_ss(a + i);                    \
+    c##i##0 = _mm256_fmadd_ps(aValue, b0Value, c##i##0);    \
+    c##i##1 = _mm256_fmadd_ps(aValue, b1Value, c##i##1);    \
+
+#define MAI_SGEMM_STORE_ROW(i)                                              \
+    {                                                                       \
+        float* row = c + i * ldc;                                           \
+        __m256 o0Value = _mm256_mul_ps(c##i##0, alphaValue);                \
+        __m256 o1Value = _mm256_mul_ps(c##i##1, alphaValue);                \
+        if (beta != 0.f) {                                                  \
+            o0Value = _mm256_fmadd_ps(betaValue, _mm256_loadu_ps(row), o0Value);     \
+            o1Value = _mm256_fmadd_ps(betaValue, _mm256_loadu_ps(row + 8), o1Value); \
+        }                                                                   \
+        _mm256_storeu_ps(row, o0Value);                                     \
+        _mm256_storeu_ps(row + 8, o1Value);                                 \
+    }                                                                       \
+
+// 12 accumulators, 2 for B and 1 for A out of the 16 ymm registers
+__attribute__((target("avx2,fma")))
+void microKernelAvx2Fma(int64 kc, const float* a, const float* b,
+        float alpha, float beta, float* c, int64 ldc) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+    __m256 aValue;
+    for (int64 k = 0; k < kc; ++k) {
+        const __m256 b0Value = _mm256_loadu_ps(b);
+        const __m256 b1Value = _mm256_loadu_ps(b + 8);
+        MAI_SGEMM_FMA_ROW(0)
+        MAI_SGEMM_FMA_ROW(1)
+        MAI_SGEMM_FMA_ROW(2)
+        MAI_SGEMM_FMA_ROW(3)
+        MAI_SGEMM_FMA_ROW(4)
+        MAI_SGEMM_FMA_ROW(5)
+        a += kMR;
+        b += kNR;
+    }
+    const __m256 alphaValue = _mm256_set1_ps(alpha);
+    const __m256 betaValue = _mm256_set1_ps(beta);
+    MAI_SGEMM_STORE_ROW(0)
+    MAI_SGEMM_STORE_ROW(1)
+    MAI_SGEMM_STORE_ROW(2)
+    MAI_SGEMM_STORE_ROW(3)
+    MAI_SGEMM_STORE_ROW(4)
+    MAI_SGEMM_STORE_ROW(5)
+}
+
+#undef MAI_SGEMM_FMA_ROW
+#undef MAI_SGEMM_STORE_ROW
+
+#define MAI_SGEMM_FMA_ROW(i)                                \
+    aValue = _mm512_set1_ps(a[i]);                          \
+    c##i##0 = _mm512_fmadd_ps(aValue, b0Value, c##i##0);    \
+    c##i##1 = _mm512_fmadd_ps(aValue, b1Value, c##i##1);    \
+
+#define MAI_SGEMM_STORE_ROW(i)                                              \
+    {                                                                       \
+        float* row = c + i * ldc;                                           \
+        __m512 o0Value = _mm512_mul_ps(c##i##0, alphaValue);                \
+        __m512 o1Value = _mm512_mul_ps(c##i##1, alphaValue);                \
+        if (beta != 0.f) {                                                  \
+            o0Value = _mm512_fmadd_ps(betaValue, _mm512_loadu_ps(row), o0Value);      \
+            o1Value = _mm512_fmadd_ps(betaValue, _mm512_loadu_ps(row + 16), o1Value); \
+        }                                                                   \
+        _mm512_storeu_ps(row, o0Value);                                     \
+        _mm512_storeu_ps(row + 16, o1Value);                                \
+    }                                                                       \
+
+#define MAI_SGEMM_ZERO_ROW(i)                                               \
+    __m512 c##i##0 = _mm512_setzero_ps(), c##i##1 = _mm512_setzero_ps();    \
+
+// 12x32, 24 accumulators, 2 for B and 1 for A out of the 32 zmm registers
+__attribute__((target("avx512f")))
+void microKernelAvx512(int64 kc, const float* a, const float* b,
+        float alpha, float beta, float* c, int64 ldc) {
+    MAI_SGEMM_ZERO_ROW(0) MAI_SGEMM_ZERO_ROW(1) MAI_SGEMM_ZERO_ROW(2)
+    MAI_SGEMM_ZERO_ROW(3) MAI_SGEMM_ZERO_ROW(4) MAI_SGEMM_ZERO_ROW(5)
+    MAI_SGEMM_ZERO_ROW(6) MAI_SGEMM_ZERO_ROW(7) MAI_SGEMM_ZERO_ROW(8)
+    MAI_SGEMM_ZERO_ROW(9) MAI_SGEMM_ZERO_ROW(10) MAI_SGEMM_ZERO_ROW(11)
+    __m512 aValue;
+    for (int64 k = 0; k < kc; ++k) {
+        const __m512 b0Value = _mm512_loadu_ps(b);
+        const __m512 b1Value = _mm512_loadu_ps(b + 16);
+        MAI_SGEMM_FMA_ROW(0) MAI_SGEMM_FMA_ROW(1) MAI_SGEMM_FMA_ROW(2)
+        MAI_SGEMM_FMA_ROW(3) MAI_SGEMM_FMA_ROW(4) MAI_SGEMM_FMA_ROW(5)
+        MAI_SGEMM_FMA_ROW(6) MAI_SGEMM_FMA_ROW(7) MAI_SGEMM_FMA_ROW(8)
+        MAI_SGEMM_FMA_ROW(9) MAI_SGEMM_FMA_ROW(10) MAI_SGEMM_FMA_ROW(11)
+        a += 12;
+        b += 32;
+    }
+    const __m512 alphaValue = _mm512_set1_ps(alpha);
+    const __m512 betaValue = _mm512_set1_ps(beta);
+    MAI_SGEMM_STORE_ROW(0) MAI_SGEMM_STORE_ROW(1) MAI_SGEMM_STORE_ROW(2)
+    MAI_SGEMM_STORE_ROW(3) MAI_SGEMM_STORE_ROW(4) MAI_SGEMM_STORE_ROW(5)
+    MAI_SGEMM_STORE_ROW(6) MAI_SGEMM_STORE_ROW(7) MAI_SGEMM_STORE_ROW(8)
+    MAI_SGEMM_STORE_ROW(9) MAI_SGEMM_STORE_ROW(10) MAI_SGEMM_STORE_ROW(11)
+}
+
+#undef MAI_SGEMM_FMA_ROW
+#undef MAI_SGEMM_STORE_ROW
+#undef MAI_SGEMM_ZERO_ROW
+#endif
+
+// widest first
+const MicroKernel kMicroKernels[] = {
+#ifdef MAI_SGEMM_X86
+    {kSgemmAvx512, 12, 32, microKernelAvx512},
+    {kSgemmAvx2, kMR, kNR, microKernelAvx2Fma},
+#endif
+    {0, kMR, kNR, microKernelGeneric},
+};
+
+const MicroKernel& selectMicroKernel(uint32 cpuFeatures) {
+    for (const MicroKernel& kernel : kMicroKernels) {
+        if ((kernel.cpuFeatures & cpuFeatures) == kernel.cpuFeatures) {
+            return kernel;
+        }
+    }
+    return kMicroKernels[sizeof(kMicroKernels) / sizeof(kMicroKernels[0]) - 1];
+}
+
+// Rows [i0, i0 + mc) and depth [k0, k0 + kc) of op(A) into panels of mr
+// rows, k major inside a panel, missing rows are zero.
+void packA(bool transA, const float* A, int64 lda,
+        int64 i0, int64 mc, int64 k0, int64 kc, int64 mr, float* packed) {
+    for (int64 p = 0; p < mc; p += mr) {
+        const int64 rows = std::min(mr, mc - p);
+        if (transA) {
+            for (int64 k = 0; k < kc; ++k) {
+                const float* src = A + (k0 + k) * lda + i0 + p;
+                for (int64 r = 0; r < rows; ++r) {
+                    packed[r] = src[r];
+                }
+                for (int64 r = rows; r < mr; ++r) {
+                    packed[r] = 0.f;
+                }
+                packed += mr;
+            }
+        } else {
+            for (int64 r = 0; r < mr; ++r) {
+                const float* src = A + (i0 + p + r) * lda + k0;
+                for (int64 k = 0; k < kc; ++k) {
+                    packed[k * mr + r] = r < rows ? src[k] : 0.f;
+                }
+            }
+            packed += kc * mr;
+        }
+    }
+}
+
+// Columns [j0, j0 + cols) and depth [k0, k0 + kc) of op(B) into one panel
+// of nr columns, k major, missing columns are zero.
+void packBPanel(bool transB, const float* B, int64 ldb,
+        int64 k0, int64 kc, int64 j0, int64 cols, int64 nr, float* packed) {
+    if (transB) {
+        for (int64 j = 0; j < nr; ++j) {
+            const float* src = B + (j0 + j) * ldb + k0;
+            for (int64 k = 0; k < kc; ++k) {
+                packed[k * nr + j] = j < cols ? src[k] : 0.f;
+            }
+        }
+    } else {
+        for (int64 k = 0; k < kc; ++k) {
+            memcpy(packed, B + (k0 + k) * ldb + j0, cols * sizeof(float));
+            for (int64 j = cols; j < nr; ++j) {
+                packed[j] = 0.f;
+            }
+            packed += nr;
+        }
+    }
+}
+
+void scale(int64 M, int64 N, float beta, float* C, int64 ldc) {
+    for (int64 i = 0; i < M; ++i) {
+        float* row = C + i * ldc;
+        for (int64 j = 0; j < N; ++j) {
+            row[j] = beta == 0.f ? 0.f : beta * row[j];
+        }
+    }
+}
+
+// Block of C at(i0, j0) after its last KC step, still in L1
+void applyEpilogue(const SgemmEpilogue& epilogue, int64 i0, int64 j0,
+        int64 rows, int64 cols, float* c, int64 ldc) {
+    const float upper = epilogue.activation == FUSED_ACTIVATION_RELU6
+        ? 6.f : std::numeric_limits<float>::infinity();
+    for (int64 r = 0; r < rows; ++r) {
+        float* row = c + r * ldc;
+        if (epilogue.bias != NULL && epilogue.biasPerRow) {
+            const float bias = epilogue.bias[i0 + r];
+            for (int64 j = 0; j < cols; ++j) {
+                row[j] += bias;
+            }
+        } else if (epilogue.bias != NULL) {
+            const float* bias = epilogue.bias + j0;
+            for (int64 j = 0; j < cols; ++j) {
+                row[j] += bias[j];
+            }
+        }
+        if (epilogue.activation != FUSED_ACTIVATION_NONE) {
+            for (int64 j = 0; j < cols; ++j) {
+                row[j] = std::min(std::max(row[j], 0.f), upper);
+            }
+        }
+    }
+}
+
+int64 roundUp(int64 value, int64 multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+int64 sgemmPackedASize(int64 M, int64 K, uint32 cpuFeatures) {
+    return roundUp(M, selectMicroKernel(cpuFeatures).mr) * K;
+}
+
+// The MCxKC blocks in the order sgemm() steps through them. Every block but
+// the last of a column is full, MC being a multiple of every MR, so block
+// (i0, k0) starts at i0 * K + roundUp(mc, mr) * k0.
+void sgemmPackA(bool transA, int64 M, int64 K, const float* A, int64 lda,
+        float* packed, uint32 cpuFeatures) {
+    const int64 mr = selectMicroKernel(cpuFeatures).mr;
+    const int64 mBlocks = (M + kMC - 1) / kMC;
+    parallelFor(0, mBlocks, 1, [&](int64 begin, int64 end) {
+        for (int64 mBlock = begin; mBlock < end; ++mBlock) {
+            const int64 i0 = mBlock * kMC;
+            const int64 mc = std::min(kMC, M - i0);
+            for (int64 k0 = 0; k0 < K; k0 += kKC) {
+                packA(transA, A, lda, i0, mc, k0, std::min(kKC, K - k0), mr,
+                        packed + i0 * K + roundUp(mc, mr) * k0);
+            }
+        }
+    });
+}
+
+int64 sgemmPackedBSize(int64 K, int64 N, uint32 cpuFeatures) {
+    return roundUp(N, selectMicroKernel(cpuFeatures).nr) * K;
+}
+
+// The KCxNC blocks the same way, block (k0, j0) starts at
+// j0 * K + roundUp(nc, nr) * k0.
+void sgemmPackB(bool transB, int64 K, int64 N, const float* B, int64 ldb,
+        float* packed, uint32 cpuFeatures) {
+    const int64 nr = selectMicroKernel(cpuFeatures).nr;
+    const int64 panels = (N + nr - 1) / nr;
+    parallelFor(0, panels, grainSize(K * nr), [&](int64 begin, int64 end) {
+        for (int64 q = begin; q < end; ++q) {
+            const int64 j0 = q * nr / kNC * kNC;
+            const int64 paddedNc = roundUp(std::min(kNC, N - j0), nr);
+            for (int64 k0 = 0; k0 < K; k0 += kKC) {
+                const int64 kc = std::min(kKC, K - k0);
+                packBPanel(transB, B, ldb, k0, kc, q * nr, std::min(nr, N - q * nr), nr,
+                        packed + j0 * K + paddedNc * k0 + (q * nr - j0) * kc);
+            }
+        }
+    });
+}
+
+void sgemm(bool transA, bool transB, int64 M, int64 N, int64 K,
+        float alpha, const float* A, int64 lda,
+        const float* B, int64 ldb,
+        float beta, float* C, int64 ldc, uint32 cpuFeatures,
+        const SgemmEpilogue* epilogue) {
+    sgemmPacked(transA, false, transB, false, M, N, K, alpha, A, lda, B, ldb,
+            beta, C, ldc, cpuFeatures, epilogue);
+}
+
+void sgemmPacked(bool transA, bool packedA, bool transB, bool packedB,
+        int64 M, int64 N, int64 K,
+        float alpha, const float* A, int64 lda,
+        const float* B, int64 ldb,
+        float beta, float* C, int64 ldc, uint32 cpuFeatures,
+        const SgemmEpilogue* epilogue) {
+    if (M <= 0 || N <= 0) {
+        return;
+    }
+    if (K <= 0 || alpha == 0.f) {
+        scale(M, N, beta, C, ldc);
+        if (epilogue != NULL) {
+            applyEpilogue(*epilogue, 0, 0, M, N, C, ldc);
+        }
+        return;
+    }
+    const MicroKernel& kernel = selectMicroKernel(cpuFeatures);
+    const int64 mr = kernel.mr;
+    const int64 nr = kernel.nr;
+    // packed B of the calling thread, shared by the tasks of one KC step
+    thread_local std::vector<float> packedBBuffer;
+    const int64 mBlocks = (M + kMC - 1) / kMC;
+    for (int64 j0 = 0; j0 < N; j0 += kNC) {
+        const int64 nc = std::min(kNC, N - j0);
+        const int64 panels = (nc + nr - 1) / nr;
+        const int64 nChunks = (panels + kPanelsPerTask - 1) / kPanelsPerTask;
+        for (int64 k0 = 0; k0 < K; k0 += kKC) {
+            const int64 kc = std::min(kKC, K - k0);
+            // beta applies to the first KC step, the later ones accumulate
+            const float stepBeta = k0 == 0 ? beta : 1.f;
+            const bool lastStep = k0 + kc >= K;
+            const float* packedBData = B + j0 * K + panels * nr * k0;
+            if (!packedB) {
+                packedBBuffer.resize(panels * kc * nr);
+                float* buffer = packedBBuffer.data();
+                parallelFor(0, panels, grainSize(kc * nr), [&](int64 begin, int64 end) {
+                    for (int64 q = begin; q < end; ++q) {
+                        packBPanel(transB, B, ldb, k0, kc, j0 + q * nr,
+                                std::min(nr, nc - q * nr), nr, buffer + q * kc * nr);
+                    }
+                });
+                packedBData = buffer;
+            }
+
+            parallelFor(0, mBlocks * nChunks, 1, [&](int64 begin, int64 end) {
+                thread_local std::vector<float> packedABuffer;
+                packedABuffer.resize(kMC * kKC);
+                const float* packedAData = packedABuffer.data();
+                int64 packedBlock = -1;
+                for (int64 task = begin; task < end; ++task) {
+                    const int64 mBlock = task / nChunks;
+                    const int64 nChunk = task % nChunks;
+                    const int64 i0 = mBlock * kMC;
+                    const int64 mc = std::min(kMC, M - i0);
+                    if (packedA) {
+                        packedAData = A + i0 * K + roundUp(mc, mr) * k0;
+                    } else if (mBlock != packedBlock) {
+                        packA(transA, A, lda, i0, mc, k0, kc, mr, packedABuffer.data());
+                        packedBlock = mBlock;
+                    }
+                    const int64 qEnd = std::min(panels, (nChunk + 1) * kPanelsPerTask);
+                    for (int64 q = nChunk * kPanelsPerTask; q < qEnd; ++q) {
+                        const int64 cols = std::min(nr, nc - q * nr);
+                        const float* bPanel = packedBData + q * kc * nr;
+                        for (int64 p = 0; p < mc; p += mr) {
+                            const int64 rows = std::min(mr, mc - p);
+                            const float* aPanel = packedAData + p * kc;
+                            float* c = C + (i0 + p) * ldc + j0 + q * nr;
+                            if (rows == mr && cols == nr) {
+                                kernel.func(kc, aPanel, bPanel, alpha, stepBeta, c, ldc);
+                            } else {
+                                // edge tile
+                                float tile[kMaxMR * kMaxNR];
+                                kernel.func(kc, aPanel, bPanel, alpha, 0.f, tile, nr);
+                                for (int64 r = 0; r < rows; ++r) {
+                                    for (int64 j = 0; j < cols; ++j) {
+                                        c[r * ldc + j] = tile[r * nr + j]
+                                            + (stepBeta == 0.f ? 0.f : stepBeta * c[r * ldc + j]);
+                                    }
+                                }
+                            }
+                            if (lastStep && epilogue != NULL) {
+                                applyEpilogue(*epilogue, i0 + p, j0 + q * nr, rows, cols, c, ldc);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+    }
+}
+
+std::vector<uint32> sgemmCpuFeatureLevels() {
+    std::vector<uint32> levels;
+    for (const MicroKernel& kernel : kMicroKernels) {
+        levels.insert(levels.begin(), kernel.cpuFeatures);
+    }
+    return levels;
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
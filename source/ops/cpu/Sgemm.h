@@ -0,0 +1,84 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+// Applied to each block of C once its product is done, while it is still in
+// cache: C += bias(one value per row or per column), then activation.
+struct SgemmEpilogue {
+    const float* bias;// NULL if none
+    bool biasPerRow;
+    FusedActivation activation;
+};
+
+// Single precision GEMM in the style of BLIS/GotoBLAS, row major:
+//   C = alpha * op(A) * op(B) + beta * C
+// op(A) is MxK, op(B) is KxN and C is MxN, op(X) is X transposed if transX.
+// lda/ldb/ldc are the row strides of A, B and C as they are stored.
+//
+// The loops around the microkernel block C by NC columns and K by KC, pack
+// the KCxNC block of B into panels of NR columns, then block the rows by MC
+// and pack each MCxKC block of A into panels of MR rows, so the microkernel
+// streams both operands from contiguous memory(A block in L2, B panel in
+// L1). The MC blocks and NR panel chunks of every KC step are spread over
+// the threads of the current ComputeThreadPool.
+//
+// The microkernel is the widest cpuFeatures allow: 12x32 with AVX-512,
+// 6x16 with AVX2/FMA, portable 6x16 code otherwise. Operators pass the
+// cpuFeatures of their opContext(). beta == 0 never reads C. epilogue, if
+// any, is applied after alpha/beta.
+void sgemm(bool transA, bool transB, int64 M, int64 N, int64 K,
+        float alpha, const float* A, int64 lda,
+        const float* B, int64 ldb,
+        float beta, float* C, int64 ldc, uint32 cpuFeatures,
+        const SgemmEpilogue* epilogue = NULL);
+
+// Operands packed ahead, e.g. constant weights at init: op(A)(MxK) or
+// op(B)(KxN) in the layout sgemm() packs them into on every call, for the
+// microkernel cpuFeatures select. The Size functions give the floats
+// needed.
+int64 sgemmPackedASize(int64 M, int64 K, uint32 cpuFeatures);
+void sgemmPackA(bool transA, int64 M, int64 K, const float* A, int64 lda,
+        float* packed, uint32 cpuFeatures);
+int64 sgemmPackedBSize(int64 K, int64 N, uint32 cpuFeatures);
+void sgemmPackB(bool transB, int64 K, int64 N, const float* B, int64 ldb,
+        float* packed, uint32 cpuFeatures);
+
+// sgemm() where A if packedA, B if packedB, is the output of sgemmPackA/B
+// with the same M/N/K and cpuFeatures(transX and ldX are ignored then).
+void sgemmPacked(bool transA, bool packedA, bool transB, bool packedB,
+        int64 M, int64 N, int64 K,
+        float alpha, const float* A, int64 lda,
+        const float* B, int64 ldb,
+        float beta, float* C, int64 ldc, uint32 cpuFeatures,
+        const SgemmEpilogue* epilogue = NULL);
+
+const uint32 kSgemmAvx2 = CPU_FEATURE_AVX2 | CPU_FEATURE_FMA;
+const uint32 kSgemmAvx512 = CPU_FEATURE_AVX512F;
+
+// cpuFeatures of every microkernel compiled in, portable first. An operator
+// built on sgemm registers one variant per level, OperatorRegister picks
+// the widest.
+std::vector<uint32> sgemmCpuFeatureLevels();
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
@@ -22,7 +22,7 @@ namespace CPU {
 template<typename T>
 class Shape : public Operator {
 public:
-    Shape() : mRunFirst(true) {}
+    Shape() {}
     ~Shape() = default;
 
     MAI_STATUS init() override {
@@ -45,8 +45,10 @@ public:
         MAI_OP_RUN_FIRST_END
         return MAI_SUCCESS;
     }
-private:
-    bool mRunFirst;
+
+    bool writesOutputsOnce() const override {
+        return true;
+    }
 };
 
 void registerShape() {
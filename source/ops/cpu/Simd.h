@@ -0,0 +1,153 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string.h>
+#include "include/Type.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// the vectors never cross a call, every helper is inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// Generic vectors(GCC/clang vector extensions) for the kernels which are
+// written once for every vector width: templates over the vector(or float
+// for the leftovers), always inlined into one function per target, which
+// decides the instructions they compile to. Kernels keep a table of those
+// functions, widest first, and pick the first one cpuFeatures allow.
+#define MAI_SIMD_INLINE inline __attribute__((always_inline))
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MAI_SIMD_X86
+#define MAI_SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define MAI_SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+namespace Simd {
+
+typedef float Float4 __attribute__((vector_size(16)));// SSE, NEON and portable
+typedef int32 Int4 __attribute__((vector_size(16)));
+#ifdef MAI_SIMD_X86
+typedef float Float8 __attribute__((vector_size(32)));// AVX2
+typedef int32 Int8 __attribute__((vector_size(32)));
+typedef float Float16 __attribute__((vector_size(64)));// AVX-512
+typedef int32 Int16 __attribute__((vector_size(64)));
+#endif
+
+template<typename V>
+struct Lanes {
+    static const int64 value = sizeof(V) / sizeof(float);
+};
+
+// int32 lanes of a float vector, the type comparisons of V give
+template<typename V>
+struct IntOf;
+
+template<>
+struct IntOf<float> {
+    typedef int32 type;
+};
+
+template<>
+struct IntOf<Float4> {
+    typedef Int4 type;
+};
+
+#ifdef MAI_SIMD_X86
+template<>
+struct IntOf<Float8> {
+    typedef Int8 type;
+};
+
+template<>
+struct IntOf<Float16> {
+    typedef Int16 type;
+};
+#endif
+
+template<typename V>
+MAI_SIMD_INLINE V load(const float* p) {
+    V v;
+    memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+template<typename V>
+MAI_SIMD_INLINE void store(float* p, const V& v) {
+    memcpy(p, &v, sizeof(V));
+}
+
+template<typename V>
+MAI_SIMD_INLINE V splat(float value) {
+    return V() + value;
+}
+
+// Lanes<V> floats S apart
+template<typename V, int S>
+MAI_SIMD_INLINE V loadStrided(const float* p) {
+    if (S == 1) {
+        return load<V>(p);
+    }
+    float lanes[Lanes<V>::value];
+    for (int64 i = 0; i < Lanes<V>::value; ++i) {
+        lanes[i] = p[i * S];
+    }
+    return load<V>(lanes);
+}
+
+// Lanes<V> floats stride apart, stride known at run time
+template<typename V>
+MAI_SIMD_INLINE V loadStrided(const float* p, int64 stride) {
+    float lanes[Lanes<V>::value];
+    for (int64 i = 0; i < Lanes<V>::value; ++i) {
+        lanes[i] = p[i * stride];
+    }
+    return load<V>(lanes);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V maximum(const V& a, const V& b) {
+    return a > b ? a : b;
+}
+
+template<typename V>
+MAI_SIMD_INLINE V minimum(const V& a, const V& b) {
+    return a < b ? a : b;
+}
+
+// Sum of the lanes
+template<typename V>
+MAI_SIMD_INLINE float reduceSum(const V& v) {
+    float lanes[Lanes<V>::value];
+    store(lanes, v);
+    float sum = 0.f;
+    for (int64 i = 0; i < Lanes<V>::value; ++i) {
+        sum += lanes[i];
+    }
+    return sum;
+}
+
+} // namespace Simd
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
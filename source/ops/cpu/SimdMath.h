@@ -0,0 +1,503 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include "Simd.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// Elementary functions on Simd vectors, and on float for the leftovers.
+//
+// Range reduction plus polynomials(Cephes-style minimax fits) without
+// lookup tables, so every lane runs the same instructions. Special values
+// follow libm: NaN gives NaN, out of domain gives NaN, overflow gives +-inf,
+// subnormal results stay subnormal. Max error against the correctly rounded
+// result over the whole float range(VectorMathTest checks the bounds at every
+// vector width):
+//
+//   exp, log, sin, cos, acos, tanh                              2 ulp
+//   log1p, asin, atan, sinh, cosh, asinh, acosh, atanh,
+//   sigmoid, erf                                                3 ulp
+//   tan                                                         4 ulp
+//   expFast, sigmoidFast, tanhFast                              3e-6 relative
+//
+// The Fast variants use a degree 4 instead of a degree 6 polynomial for e^r.
+// sin, cos and tan reduce |x| <= 8192 themselves and call libm for the
+// lanes beyond; close to the zeros of the result their error is 2^-24
+// absolute rather than relative. The bounds assume round-to-nearest and no
+// -ffast-math.
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+namespace Simd {
+
+template<typename To, typename From>
+MAI_SIMD_INLINE To bitCast(const From& from) {
+    To to;
+    memcpy(&to, &from, sizeof(To));
+    return to;
+}
+
+// mask is a comparison of V values(a bool for float)
+template<typename M, typename V>
+MAI_SIMD_INLINE V select(const M& mask, const V& a, const V& b) {
+    return mask ? a : b;
+}
+
+template<typename V>
+struct Convert {
+    typedef typename IntOf<V>::type Int;
+
+    // toward zero, |v| < 2^31
+    static MAI_SIMD_INLINE Int toInt(const V& v) {
+        return __builtin_convertvector(v, Int);
+    }
+
+    static MAI_SIMD_INLINE V toFloat(const Int& i) {
+        return __builtin_convertvector(i, V);
+    }
+};
+
+template<>
+struct Convert<float> {
+    typedef int32 Int;
+
+    static MAI_SIMD_INLINE Int toInt(float v) {
+        return static_cast<Int>(v);
+    }
+
+    static MAI_SIMD_INLINE float toFloat(Int i) {
+        return static_cast<float>(i);
+    }
+};
+
+const int32 kSignBit = static_cast<int32>(0x80000000u);
+
+template<typename V>
+MAI_SIMD_INLINE V absolute(const V& x) {
+    return bitCast<V>(bitCast<typename IntOf<V>::type>(x) & ~kSignBit);
+}
+
+// x with its sign flipped where sign is negative
+template<typename V>
+MAI_SIMD_INLINE V mulSign(const V& x, const V& sign) {
+    typedef typename IntOf<V>::type Int;
+    return bitCast<V>(bitCast<Int>(x) ^ (bitCast<Int>(sign) & kSignBit));
+}
+
+template<typename V>
+MAI_SIMD_INLINE V quietNaN() {
+    return splat<V>(std::numeric_limits<float>::quiet_NaN());
+}
+
+// Nearest integer(ties to even), |x| < 2^22
+template<typename V>
+MAI_SIMD_INLINE V roundNearest(const V& x) {
+    const V magic = splat<V>(12582912.f);// 1.5 * 2^23
+    return (x + magic) - magic;
+}
+
+// Largest integer not above x, exact for every float
+template<typename V>
+MAI_SIMD_INLINE V floor(const V& x) {
+    const V rounded = roundNearest(x);
+    const V down = select(rounded > x, rounded - 1.f, rounded);
+    // |x| >= 2^22(and inf, NaN) is integral already, -0.5 gives -0
+    return select(absolute(x) < splat<V>(4194304.f), mulSign(absolute(down), x), x);
+}
+
+// Newton's iteration on 1 / sqrt(x) from the classic initial guess plus one
+// correction of x * (1 / sqrt(x)), within 1 ulp. x is +-0, a normal float,
+// inf or NaN. x < 0 gives NaN like libm, the masked-out lanes of asin, acos
+// and acosh pass it. The guess is taken from |x|, so the subtraction cannot
+// overflow.
+template<typename V>
+MAI_SIMD_INLINE V squareRoot(const V& x) {
+    typedef typename IntOf<V>::type Int;
+    V y = bitCast<V>(0x5f3759df - (bitCast<Int>(absolute(x)) >> 1));
+    const V halfX = x * 0.5f;
+    y = y * (1.5f - halfX * y * y);
+    y = y * (1.5f - halfX * y * y);
+    y = y * (1.5f - halfX * y * y);
+    // -0 stays -0
+    const V s = x * y;
+    const V root = s + (x - s * s) * (y * 0.5f);
+    const V result = select(x < splat<V>(std::numeric_limits<float>::infinity()), root, x + x);
+    return select(x < splat<V>(0.f), quietNaN<V>(), result);
+}
+
+// x * 2^n for integer valued n in [-150, 128]. 2^n is split in two factors
+// which are normal floats, so the product rounds once even if it is
+// subnormal or overflows.
+template<typename V>
+MAI_SIMD_INLINE V scaleByPowerOf2(const V& x, const V& n) {
+    typedef typename IntOf<V>::type Int;
+    const Int ni = Convert<V>::toInt(n);
+    const Int half = ni >> 1;
+    return x * bitCast<V>((half + 127) << 23) * bitCast<V>((ni - half + 127) << 23);
+}
+
+// e^r, |r| <= ln(2) / 2
+template<typename V>
+MAI_SIMD_INLINE V expReduced(const V& r) {
+    const V p = ((((1.9875691500E-4f * r + 1.3981999507E-3f) * r + 8.3334519073E-3f) * r
+            + 4.1665795894E-2f) * r + 1.6666665459E-1f) * r + 5.0000001201E-1f;
+    return p * (r * r) + r + 1.f;
+}
+
+template<typename V>
+MAI_SIMD_INLINE V expFastReduced(const V& r) {
+    return (((4.1458585496E-2f * r + 1.6790907092E-1f) * r + 5.0004358931E-1f) * r
+            + 9.9996340496E-1f) * r + 9.9999926141E-1f;
+}
+
+// x = n * ln(2) + r, ln(2) in two parts, e^x = 2^n * e^r
+template<typename V, bool Fast>
+MAI_SIMD_INLINE V expImpl(const V& x) {
+    const V clamped = minimum(maximum(x, splat<V>(-104.f)), splat<V>(89.f));
+    const V n = roundNearest(clamped * 1.44269504088896341f);
+    const V r = (clamped - n * 0.693359375f) - n * -2.12194440E-4f;
+    const V result = scaleByPowerOf2(Fast ? expFastReduced(r) : expReduced(r), n);
+    return select(x == x, result, x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V exp(const V& x) {
+    return expImpl<V, false>(x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V expFast(const V& x) {
+    return expImpl<V, true>(x);
+}
+
+// x = 2^e * (1 + m), sqrt(1/2) <= 1 + m < sqrt(2), log(x) = e * ln(2) + log(1 + m)
+template<typename V>
+MAI_SIMD_INLINE V log(const V& x) {
+    typedef typename IntOf<V>::type Int;
+    const V zero = splat<V>(0.f);
+    const V inf = splat<V>(std::numeric_limits<float>::infinity());
+    // subnormals are scaled into the normal range first
+    const auto subnormal = x < splat<V>(std::numeric_limits<float>::min());
+    const Int bits = bitCast<Int>(select(subnormal, x * 33554432.f, x));// 2^25
+    V e = Convert<V>::toFloat(((bits >> 23) & 0xff) - 126) - select(subnormal, splat<V>(25.f), zero);
+    V m = bitCast<V>((bits & 0x807fffff) | 0x3f000000);// [0.5, 1)
+    const auto small = m < splat<V>(0.707106781186547524f);
+    e = select(small, e - 1.f, e);
+    m = select(small, m + m, m) - 1.f;
+    const V z = m * m;
+    V y = ((((((((7.0376836292E-2f * m - 1.1514610310E-1f) * m + 1.1676998740E-1f) * m
+            - 1.2420140846E-1f) * m + 1.4249322787E-1f) * m - 1.6668057665E-1f) * m
+            + 2.0000714765E-1f) * m - 2.4999993993E-1f) * m + 3.3333331174E-1f) * m * z;
+    y = y + e * -2.12194440E-4f;
+    y = y - z * 0.5f;
+    V result = (m + y) + e * 0.693359375f;
+    result = select(x > zero, result, select(x == zero, -inf, quietNaN<V>()));
+    return select(x < inf, result, x + x);
+}
+
+// log(1 + x), accurate for small x
+template<typename V>
+MAI_SIMD_INLINE V log1p(const V& x) {
+    const V u = x + 1.f;
+    const V d = u - 1.f;
+    const V logU = log(u);
+    // x / d corrects for the rounding of 1 + x
+    const V result = select(d == splat<V>(0.f), x, logU * (x / d));
+    return select(u < splat<V>(std::numeric_limits<float>::infinity()), result, logU);
+}
+
+// |x| = j * pi/4 + r, j even and |r| <= pi/4. pi/4 is split in four parts,
+// the first three short enough for y * part to be exact up to kTrigLimit.
+// The lanes beyond get libm.
+const float kTrigLimit = 8192.f;
+
+template<typename V>
+struct TrigReduced {
+    V r;
+    typename IntOf<V>::type j;
+};
+
+template<typename V>
+MAI_SIMD_INLINE TrigReduced<V> trigReduce(const V& x) {
+    const V a = minimum(absolute(x), splat<V>(kTrigLimit));
+    TrigReduced<V> reduced;
+    reduced.j = (Convert<V>::toInt(a * 1.27323954473516f) + 1) & ~1;
+    const V y = Convert<V>::toFloat(reduced.j);
+    reduced.r = (((a - y * 0.78515625f) - y * 2.4187564849853515625E-4f)
+        - y * 3.7747668102383613586E-8f) - y * 1.2816720341285448e-12f;
+    return reduced;
+}
+
+// sin(r), z = r^2
+template<typename V>
+MAI_SIMD_INLINE V sinPoly(const V& r, const V& z) {
+    return ((-1.9515295891E-4f * z + 8.3321608736E-3f) * z - 1.6666654611E-1f) * z * r + r;
+}
+
+// cos(r), z = r^2
+template<typename V>
+MAI_SIMD_INLINE V cosPoly(const V& z) {
+    return ((2.443315711809948E-5f * z - 1.388731625493765E-3f) * z + 4.166664568298827E-2f)
+        * z * z - z * 0.5f + 1.f;
+}
+
+// result with the lanes where |x| > kTrigLimit(or x is NaN) from f
+template<typename V>
+MAI_SIMD_INLINE V patchLargeLanes(const V& x, const V& result, float (*f)(float)) {
+    const V large = select(absolute(x) <= splat<V>(kTrigLimit), splat<V>(0.f), splat<V>(1.f));
+    if (reduceSum(large) == 0.f) {
+        return result;
+    }
+    float lanes[Lanes<V>::value];
+    float xs[Lanes<V>::value];
+    store(lanes, result);
+    store(xs, x);
+    for (int64 i = 0; i < Lanes<V>::value; ++i) {
+        if (!(std::fabs(xs[i]) <= kTrigLimit)) {
+            lanes[i] = f(xs[i]);
+        }
+    }
+    return load<V>(lanes);
+}
+
+inline float libmSin(float x) {
+    return std::sin(x);
+}
+
+inline float libmCos(float x) {
+    return std::cos(x);
+}
+
+inline float libmTan(float x) {
+    return std::tan(x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V sin(const V& x) {
+    typedef typename IntOf<V>::type Int;
+    const TrigReduced<V> reduced = trigReduce(x);
+    const V z = reduced.r * reduced.r;
+    const V result = select((reduced.j & 2) == 0, sinPoly(reduced.r, z), cosPoly(z));
+    // negative from pi on(j & 4), odd in x
+    const Int sign = ((reduced.j & 4) << 29) ^ (bitCast<Int>(x) & kSignBit);
+    return patchLargeLanes(x, bitCast<V>(bitCast<Int>(result) ^ sign), libmSin);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V cos(const V& x) {
+    typedef typename IntOf<V>::type Int;
+    const TrigReduced<V> reduced = trigReduce(x);
+    const V z = reduced.r * reduced.r;
+    const V result = select((reduced.j & 2) == 0, cosPoly(z), sinPoly(reduced.r, z));
+    // negative from pi/2 to 3pi/2, (j & 2) != (j & 4)
+    const Int sign = ((reduced.j ^ (reduced.j << 1)) & 4) << 29;
+    return patchLargeLanes(x, bitCast<V>(bitCast<Int>(result) ^ sign), libmCos);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V tan(const V& x) {
+    const TrigReduced<V> reduced = trigReduce(x);
+    const V r = reduced.r;
+    const V z = r * r;
+    const V t = (((((9.38540185543E-3f * z + 3.11992232697E-3f) * z + 2.44301354525E-2f) * z
+            + 5.34112807005E-2f) * z + 1.33387994085E-1f) * z + 3.33331568548E-1f) * z * r + r;
+    // tan(r + pi/2) = -1 / tan(r)
+    const V result = select((reduced.j & 2) == 0, t, -1.f / t);
+    return patchLargeLanes(x, mulSign(result, x), libmTan);
+}
+
+// pi and its fractions in two parts, hi + lo
+const float kPiHi = 3.14159274101257324f;
+const float kPiLo = -8.74227801E-8f;
+const float kPiOver2Hi = 1.57079637050628662f;
+const float kPiOver2Lo = -4.37113901E-8f;
+const float kPiOver4Hi = 0.785398185253143311f;
+const float kPiOver4Lo = -2.18556950E-8f;
+
+// asin(t), |t| <= 1/2
+template<typename V>
+MAI_SIMD_INLINE V asinPoly(const V& t) {
+    const V z = t * t;
+    return ((((4.2163199048E-2f * z + 2.4181311049E-2f) * z + 4.5470025998E-2f) * z
+            + 7.4953002686E-2f) * z + 1.6666752422E-1f) * z * t + t;
+}
+
+// asin(x) = pi/2 - 2 * asin(sqrt((1 - x) / 2)) for x > 1/2
+template<typename V>
+MAI_SIMD_INLINE V asin(const V& x) {
+    const V a = absolute(x);
+    const auto large = a > splat<V>(0.5f);
+    const V p = asinPoly(select(large, squareRoot((1.f - a) * 0.5f), a));
+    const V result = select(large, kPiOver2Hi - ((p + p) - kPiOver2Lo), p);
+    return select(a <= splat<V>(1.f), mulSign(result, x), quietNaN<V>());
+}
+
+// acos(x) = 2 * asin(sqrt((1 - x) / 2)) for x > 1/2,
+// pi - 2 * asin(sqrt((1 + x) / 2)) for x < -1/2, pi/2 - asin(x) otherwise
+template<typename V>
+MAI_SIMD_INLINE V acos(const V& x) {
+    const V a = absolute(x);
+    const auto large = a > splat<V>(0.5f);
+    const V p = asinPoly(select(large, squareRoot((1.f - a) * 0.5f), x));
+    const V result = select(large,
+            select(x > splat<V>(0.f), p + p, kPiHi - ((p + p) - kPiLo)),
+            kPiOver2Hi - (p - kPiOver2Lo));
+    return select(a <= splat<V>(1.f), result, quietNaN<V>());
+}
+
+// atan(x) = pi/2 + atan(-1/x) for x > tan(3pi/8),
+// pi/4 + atan((x - 1) / (x + 1)) for x > tan(pi/8)
+template<typename V>
+MAI_SIMD_INLINE V atan(const V& x) {
+    const V zero = splat<V>(0.f);
+    const V a = absolute(x);
+    const auto large = a > splat<V>(2.414213562373095f);
+    const auto medium = a > splat<V>(0.4142135623730950f);
+    const V t = select(large, -1.f / a, select(medium, (a - 1.f) / (a + 1.f), a));
+    const V hi = select(large, splat<V>(kPiOver2Hi), select(medium, splat<V>(kPiOver4Hi), zero));
+    const V lo = select(large, splat<V>(kPiOver2Lo), select(medium, splat<V>(kPiOver4Lo), zero));
+    const V z = t * t;
+    const V p = (((8.05374449538E-2f * z - 1.38776856032E-1f) * z + 1.99777106478E-1f) * z
+            - 3.33329491539E-1f) * z * t + t;
+    return mulSign(hi + (p + lo), x);
+}
+
+// e^|x| / 2, finite up to |x| = 89.41(sinh and cosh overflow there too).
+// |x| - 0.693359375 is exact, e^(0.693359375 - ln(2)) is a constant.
+template<typename V>
+MAI_SIMD_INLINE V halfExp(const V& a) {
+    return exp(a - 0.693359375f) * 1.00021221695f;
+}
+
+template<typename V>
+MAI_SIMD_INLINE V sinh(const V& x) {
+    const V a = absolute(x);
+    const V z = a * a;
+    const V small = ((2.03721912945E-4f * z + 8.33028376239E-3f) * z + 1.66667160211E-1f) * z * a + a;
+    const V h = halfExp(a);
+    const V result = select(a <= splat<V>(1.f), small, h - 0.25f / h);
+    return mulSign(result, x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V cosh(const V& x) {
+    const V h = halfExp(absolute(x));
+    return h + 0.25f / h;
+}
+
+// tanh(x) = 1 - 2 / (e^2x + 1)
+template<typename V, bool Fast>
+MAI_SIMD_INLINE V tanhImpl(const V& x) {
+    const V a = absolute(x);
+    const V z = a * a;
+    const V small = ((((-5.70498872745E-3f * z + 2.06390887954E-2f) * z - 5.37397155531E-2f) * z
+            + 1.33314422036E-1f) * z - 3.33332819422E-1f) * z * a + a;
+    const V e = Fast ? expFast(a + a) : exp(a + a);
+    const V result = select(a < splat<V>(0.625f), small, 1.f - 2.f / (e + 1.f));
+    return mulSign(result, x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V tanh(const V& x) {
+    return tanhImpl<V, false>(x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V tanhFast(const V& x) {
+    return tanhImpl<V, true>(x);
+}
+
+// asinh(x) = log1p(|x| + x^2 / (1 + sqrt(1 + x^2))), log(|x|) + ln(2) when
+// 1 + x^2 rounds to x^2
+template<typename V>
+MAI_SIMD_INLINE V asinh(const V& x) {
+    const V a = absolute(x);
+    const V z = a * a;
+    const V small = log1p(a + z / (1.f + squareRoot(z + 1.f)));
+    const V large = log(a) + 0.693147180559945309f;
+    return mulSign(select(a < splat<V>(4096.f), small, large), x);
+}
+
+// acosh(x) = log1p(t + sqrt(t * (t + 2))), t = x - 1
+template<typename V>
+MAI_SIMD_INLINE V acosh(const V& x) {
+    const V t = x - 1.f;
+    const V small = log1p(t + squareRoot(t * (t + 2.f)));
+    const V large = log(x) + 0.693147180559945309f;
+    const V result = select(x < splat<V>(4096.f), small, large);
+    return select(x >= splat<V>(1.f), result, quietNaN<V>());
+}
+
+// atanh(x) = log1p(2|x| / (1 - |x|)) / 2
+template<typename V>
+MAI_SIMD_INLINE V atanh(const V& x) {
+    const V a = absolute(x);
+    const V result = log1p((a + a) / (1.f - a)) * 0.5f;
+    return select(a <= splat<V>(1.f), mulSign(result, x), quietNaN<V>());
+}
+
+// 1 / (1 + e^-x) = e^x / (1 + e^x), from e^-|x| which cannot overflow
+template<typename V, bool Fast>
+MAI_SIMD_INLINE V sigmoidImpl(const V& x) {
+    const V e = Fast ? expFast(-absolute(x)) : exp(-absolute(x));
+    const V r = 1.f / (1.f + e);
+    return select(x >= splat<V>(0.f), r, e * r);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V sigmoid(const V& x) {
+    return sigmoidImpl<V, false>(x);
+}
+
+template<typename V>
+MAI_SIMD_INLINE V sigmoidFast(const V& x) {
+    return sigmoidImpl<V, true>(x);
+}
+
+// erf(x) = x * P(x^2) for |x| < 1, 1 - e^(-x^2) * Q(|x| - 1) up to 3.92
+// where erf rounds to 1
+template<typename V>
+MAI_SIMD_INLINE V erf(const V& x) {
+    const V a = absolute(x);
+    const V z = a * a;
+    const V small = ((((((7.8540252545E-5f * z - 8.0102473236E-4f) * z + 5.1883344624E-3f) * z
+            - 2.6853816048E-2f) * z + 1.1283585270E-1f) * z - 3.7612625840E-1f) * z
+            + 1.1283791657f) * a;
+    const V t = minimum(a, splat<V>(3.92f)) - 1.f;
+    const V q = ((((((((-2.5919752559E-5f * t + 3.0287013163E-4f) * t - 1.6519501561E-3f) * t
+            + 5.8461351904E-3f) * t - 1.5929338620E-2f) * t + 3.7276537986E-2f) * t
+            - 7.9157974499E-2f) * t + 1.5436335753E-1f) * t - 2.7321163363E-1f) * t
+            + 4.2758357319E-1f;
+    const V large = 1.f - exp(-z) * q;
+    const V result = select(a < splat<V>(1.f), small, select(a < splat<V>(3.92f), large, splat<V>(1.f)));
+    return select(x == x, mulSign(result, x), x);
+}
+
+} // namespace Simd
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
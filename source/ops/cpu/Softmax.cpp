@@ -12,18 +12,211 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include "SimdMath.h"
+#include "VectorMath.h"
+#include "core/ComputeThreadPool.h"
 #include "core/OperatorRegister.h"
 #include "util/MAIUtil.h"
 
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 namespace MAI {
 namespace Op {
 namespace CPU {
 
+namespace {
+
+// Softmax(or log softmax) of x * beta along an axis of size elements.
+//
+// Rows: the axis is innermost, the vectors run along it.
+// Columns: the axis has a stride(the inner dimensions, e.g. channels of
+// NCHW), the vectors run across Lanes<V> neighbouring columns and every
+// pass over the axis reads whole vectors, so the tile stays in cache.
+template<typename V, bool LOG>
+MAI_SIMD_INLINE void softmaxRow(const float* input, int64 size, float beta, float* output) {
+    const int64 lanes = Simd::Lanes<V>::value;
+    V maxV = Simd::splat<V>(-std::numeric_limits<float>::infinity());
+    float max = -std::numeric_limits<float>::infinity();
+    int64 i = 0;
+    for (; i + lanes <= size; i += lanes) {
+        maxV = Simd::maximum(maxV, Simd::load<V>(input + i) * beta);
+    }
+    for (; i < size; ++i) {
+        max = Simd::maximum(max, input[i] * beta);
+    }
+    float maxLanes[lanes];
+    Simd::store(maxLanes, maxV);
+    for (int64 l = 0; l < lanes; ++l) {
+        max = Simd::maximum(max, maxLanes[l]);
+    }
+
+    V sumV = Simd::splat<V>(0.f);
+    float sum = 0.f;
+    for (i = 0; i + lanes <= size; i += lanes) {
+        const V e = Simd::exp(Simd::load<V>(input + i) * beta - max);
+        if (!LOG) {
+            Simd::store(output + i, e);
+        }
+        sumV += e;
+    }
+    for (; i < size; ++i) {
+        const float e = Simd::exp(input[i] * beta - max);
+        if (!LOG) {
+            output[i] = e;
+        }
+        sum += e;
+    }
+    sum += Simd::reduceSum(sumV);
+
+    if (LOG) {
+        const float logSum = Simd::log(sum);
+        for (i = 0; i + lanes <= size; i += lanes) {
+            Simd::store(output + i, (Simd::load<V>(input + i) * beta - max) - logSum);
+        }
+        for (; i < size; ++i) {
+            output[i] = (input[i] * beta - max) - logSum;
+        }
+    } else {
+        const float reciprocalSum = 1.f / sum;
+        for (i = 0; i + lanes <= size; i += lanes) {
+            Simd::store(output + i, Simd::load<V>(output + i) * reciprocalSum);
+        }
+        for (; i < size; ++i) {
+            output[i] *= reciprocalSum;
+        }
+    }
+}
+
+template<typename V, bool LOG>
+MAI_SIMD_INLINE void softmaxColumns(const float* input, int64 size, int64 stride, float beta,
+        float* output) {
+    V max = Simd::load<V>(input) * beta;
+    for (int64 i = 1; i < size; ++i) {
+        max = Simd::maximum(max, Simd::load<V>(input + i * stride) * beta);
+    }
+
+    V sum = Simd::splat<V>(0.f);
+    for (int64 i = 0; i < size; ++i) {
+        const V e = Simd::exp(Simd::load<V>(input + i * stride) * beta - max);
+        if (!LOG) {
+            Simd::store(output + i * stride, e);
+        }
+        sum += e;
+    }
+
+    if (LOG) {
+        const V logSum = Simd::log(sum);
+        for (int64 i = 0; i < size; ++i) {
+            Simd::store(output + i * stride, (Simd::load<V>(input + i * stride) * beta - max) - logSum);
+        }
+    } else {
+        const V reciprocalSum = 1.f / sum;
+        for (int64 i = 0; i < size; ++i) {
+            Simd::store(output + i * stride, Simd::load<V>(output + i * stride) * reciprocalSum);
+        }
+    }
+}
+
+// rows [begin, end) of size elements
+template<typename V, bool LOG>
+MAI_SIMD_INLINE void softmaxRows(const float* input, int64 begin, int64 end, int64 size,
+        int64 /*stride*/, float beta, float* output) {
+    for (int64 row = begin; row < end; ++row) {
+        softmaxRow<V, LOG>(input + row * size, size, beta, output + row * size);
+    }
+}
+
+// columns [begin, end) of outer * stride columns, stride(inner size) apart
+template<typename V, bool LOG>
+MAI_SIMD_INLINE void softmaxStrided(const float* input, int64 begin, int64 end, int64 size,
+        int64 stride, float beta, float* output) {
+    while (begin < end) {
+        const int64 outer = begin / stride;
+        const int64 columnEnd = std::min(end, (outer + 1) * stride);
+        int64 column = begin - outer * stride;
+        const int64 offset = outer * size * stride;
+        for (; column + Simd::Lanes<V>::value <= columnEnd - outer * stride;
+                column += Simd::Lanes<V>::value) {
+            softmaxColumns<V, LOG>(input + offset + column, size, stride, beta, output + offset + column);
+        }
+        for (; column < columnEnd - outer * stride; ++column) {
+            softmaxColumns<float, LOG>(input + offset + column, size, stride, beta,
+                    output + offset + column);
+        }
+        begin = columnEnd;
+    }
+}
+
+typedef void (*SoftmaxFunc)(const float* input, int64 begin, int64 end, int64 size,
+        int64 stride, float beta, float* output);
+
+struct SoftmaxKernel {
+    uint32 cpuFeatures;
+    SoftmaxFunc rows[2];// softmax, log softmax
+    SoftmaxFunc strided[2];
+};
+
+#define MAI_SOFTMAX_KERNELS(SUFFIX, TARGET, V)                                            \
+    template<bool LOG>                                                                   \
+    TARGET void softmaxRows##SUFFIX(const float* input, int64 begin, int64 end,          \
+            int64 size, int64 stride, float beta, float* output) {                       \
+        softmaxRows<V, LOG>(input, begin, end, size, stride, beta, output);              \
+    }                                                                                    \
+    template<bool LOG>                                                                   \
+    TARGET void softmaxStrided##SUFFIX(const float* input, int64 begin, int64 end,       \
+            int64 size, int64 stride, float beta, float* output) {                       \
+        softmaxStrided<V, LOG>(input, begin, end, size, stride, beta, output);           \
+    }
+
+MAI_SOFTMAX_KERNELS(Generic, , Simd::Float4)
+#ifdef MAI_SIMD_X86
+MAI_SOFTMAX_KERNELS(Avx2, MAI_SIMD_TARGET_AVX2, Simd::Float8)
+MAI_SOFTMAX_KERNELS(Avx512, MAI_SIMD_TARGET_AVX512, Simd::Float16)
+#endif
+
+#undef MAI_SOFTMAX_KERNELS
+
+#define MAI_SOFTMAX_KERNEL(FEATURES, SUFFIX)                                              \
+    {FEATURES, {softmaxRows##SUFFIX<false>, softmaxRows##SUFFIX<true>},                  \
+        {softmaxStrided##SUFFIX<false>, softmaxStrided##SUFFIX<true>}}
+
+// widest first
+const SoftmaxKernel kSoftmaxKernels[] = {
+#ifdef MAI_SIMD_X86
+    MAI_SOFTMAX_KERNEL(CPU_FEATURE_AVX512F, Avx512),
+    MAI_SOFTMAX_KERNEL(CPU_FEATURE_AVX2 | CPU_FEATURE_FMA, Avx2),
+#endif
+    MAI_SOFTMAX_KERNEL(0, Generic),
+};
+
+#undef MAI_SOFTMAX_KERNEL
+
+const SoftmaxKernel& selectKernel(uint32 cpuFeatures) {
+    for (const SoftmaxKernel& kernel : kSoftmaxKernels) {
+        if ((kernel.cpuFeatures & cpuFeatures) == kernel.cpuFeatures) {
+            return kernel;
+        }
+    }
+    return kSoftmaxKernels[sizeof(kSoftmaxKernels) / sizeof(kSoftmaxKernels[0]) - 1];
+}
+
+// Work of one element of the axis: three passes, one exp
+const int64 kSoftmaxCost = 16;
+
+} // namespace
+
+// Softmax along any axis of any rank. The slices along the axis are split
+// over the threads of the current ComputeThreadPool.
 template<typename T>
 class Softmax : public Operator {
 public:
-    Softmax() : mAxis(-1), mBeta(1.f), mRunFirst(true) {
+    Softmax() : mAxis(-1), mBeta(1.f), mLog(false) {
     }
     ~Softmax() = default;
 
@@ -31,7 +224,7 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         SoftmaxParam* softmaxParam = reinterpret_cast<SoftmaxParam*>(param);
         if (softmaxParam) {
             mBeta = softmaxParam->beta;
@@ -39,78 +232,72 @@ public:
         }
     }
 
-    void softmax2D(const T* input, int32 batch, int32 inSize, T* output) {
-        for (int32 b = 0; b < batch; ++b) {
-            //1. find the max value
-            T max = input[0];
-            for (int32 i = 1; i < inSize; ++i) {
-                if (max < input[i]) {
-                    max = input[i];
-                }
-            }
-
-            //2. calculate sum of a batch
-            T sum = 0.f;
-            for (int32 i = 0; i < inSize; ++i) {
-                output[i] = std::exp((input[i] - max) * mBeta);
-                sum += output[i];
-            }
-
-            //3. calculate tf.exp(logits) / sum
-            T reciprocalSum = 1.f / sum;
-            for (int32 i = 0; i < inSize; ++i) {
-                output[i] *= reciprocalSum;
-            }
-            input += inSize;
-            output += inSize;
-        }
-    }
-
     MAI_STATUS run() override {
         const Tensor* input = getInputTensor(0);
         Tensor* output = getOutputTensor(0);
 
         MAI_OP_RUN_FIRST_START
-        if (mAxis < 0) {
-            mAxis += input->shape().size();
-        }
         MAI_CHECK_NULL(input);
         MAI_CHECK_NULL(output);
+        const int32 rank = static_cast<int32>(input->dimSize());
+        if (mAxis < 0) {
+            mAxis += rank;
+        }
+        MAI_CHECK(mAxis >= 0 && mAxis < rank, "axis(%d) out of range for rank %d", mAxis, rank);
         output->resize(input->shape());
         MAI_OP_RUN_FIRST_END
 
-        const T* inputData = input->data<T>();
-        T* outputData = output->mutableData<T>();
-
-        if (input->shape().size() == 1) {
-            MAI_CHECK((mAxis == 0), "axis must be 0 when rank of input is 1, but not : %d", mAxis);
-
-            softmax2D(inputData, 1, input->dim(0), outputData);
-        } else if (input->shape().size() == 2) {
-            MAI_CHECK((mAxis == 0 || mAxis == 1), "axis must be 0 or 1 when rank of input is 2, \
-                    but not : %d", mAxis);
-            softmax2D(inputData, input->dim(0), input->dim(1), outputData);
-        } else if (input->shape().size() == 4) {
-            if (mAxis == 1 && input->dim(2) == 1 && input->dim(3) == 1) {
-                softmax2D(inputData, input->dim(0), input->dim(1), outputData);
-            } else {
-                MAI_ABORT("Unsupport shape size");
-            }
-        } else {
-            MAI_ABORT("Unsupport shape size");
+        shape_t outer = 1;
+        shape_t inner = 1;
+        for (int32 i = 0; i < mAxis; ++i) {
+            outer *= input->dim(i);
+        }
+        for (int32 i = mAxis + 1; i < input->dimSize(); ++i) {
+            inner *= input->dim(i);
+        }
+        const shape_t size = input->dim(mAxis);
+        if (size == 0) {
+            return MAI_SUCCESS;
         }
 
+        const T* inputData = input->data<T>();
+        T* outputData = output->mutableData<T>();
+        const SoftmaxKernel& kernel = selectKernel(opContext().cpuFeatures);
+        const SoftmaxFunc function = inner == 1 ? kernel.rows[mLog] : kernel.strided[mLog];
+        const float beta = mBeta;
+        parallelFor(0, outer * inner, grainSize(size * kSoftmaxCost), [&](int64 begin, int64 end) {
+            function(inputData, begin, end, size, inner, beta, outputData);
+        });
         return MAI_SUCCESS;
     }
 
-private:
-    int32 mAxis;// TODO: gavinchen axis is not support now
+protected:
+    int32 mAxis;
     float mBeta;
-    bool mRunFirst;
+    bool mLog;
+};
+
+// x * beta - max - log(sum(exp(x * beta - max)))
+template<typename T>
+class LogSoftmax : public Softmax<T> {
+public:
+    LogSoftmax() : Softmax<T>() {
+        this->mLog = true;
+    }
 };
 
 void registerSoftmax() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(SOFTMAX).build()), float, Softmax);
+    for (uint32 cpuFeatures : vectorMathCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(SOFTMAX).setCpuFeatures(cpuFeatures).build()),
+                float, Softmax);
+    }
+}
+
+void registerLogSoftmax() {
+    for (uint32 cpuFeatures : vectorMathCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(LOG_SOFTMAX).setCpuFeatures(cpuFeatures).build()),
+                float, LogSoftmax);
+    }
 }
 
 } // namespace CPU
@@ -23,14 +23,14 @@ namespace CPU {
 template<typename T>
 class Split : public Operator {
 public:
-    Split() : mNumSplit(0), mAxis(0), mRunFirst(true) {}
+    Split() : mNumSplit(0), mAxis(0) {}
     ~Split() = default;
 
     MAI_STATUS init() override {
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         SplitParam* splitParam = reinterpret_cast<SplitParam*>(param);
         if (splitParam) {
             mNumSplit = splitParam->numSplit;
@@ -75,14 +75,13 @@ public:
                 memcpy(outputData + outputIdx, inputData + inputIdx + i * output->dim(mAxis) * mInnerSize, mInnerSize * output->dim(mAxis) * sizeof(T));
             }
         }
-        return MAI_FAILED;
+        return MAI_SUCCESS;
     }
 private:
     int32 mNumSplit;
     int32 mAxis;
     shape_t mInnerSize;
     shape_t mOuterSize;
-    bool mRunFirst;
 };
 
 void registerSplit() {
@@ -23,7 +23,7 @@ namespace CPU {
 template<typename T>
 class Squeeze : public Operator {
 public:
-    Squeeze() : mParam(NULL), mRunFirst(true) {}
+    Squeeze() : mParam(NULL) {}
     ~Squeeze() {
         if (mParam) {
             delete mParam;
@@ -35,7 +35,7 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<SqueezeParam*>(param);
     }
 
@@ -77,7 +77,6 @@ public:
     }
 private:
     SqueezeParam* mParam;
-    bool mRunFirst;
 };
 
 void registerSqueeze() {
@@ -23,7 +23,7 @@ namespace CPU {
 template<typename T>
 class StridedSlice : public Operator {
 public:
-    StridedSlice() : mParam(NULL), mRunFirst(true) {}
+    StridedSlice() : mParam(NULL) {}
 
     ~StridedSlice() {
         MAI_DELETE_PTR(mParam);
@@ -33,7 +33,7 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
         mParam = reinterpret_cast<StridedSliceParam*>(param);
     }
 
@@ -169,7 +169,6 @@ public:
 private:
     enum FLAG {INPUT, BEGIN, END, STRIDES, OUTPUT = 0};
     StridedSliceParam* mParam;
-    bool mRunFirst;
     std::vector<int32> mStridesV;
     std::vector<int32> mBeginIndicesV;
     std::vector<int32> mEndIndicesV;
@@ -28,7 +28,7 @@ namespace CPU {
 
 class Transpose : public Operator {
 public:
-    Transpose() : mRunFirst(true) {}
+    Transpose() {}
     ~Transpose() = default;
 
     MAI_STATUS init() override {
@@ -126,7 +126,6 @@ public:
     }
 private:
     enum FLAG {INPUT, PERM, OUTPUT = 0};
-    bool mRunFirst;
 };
 
 void registerTranspose() {
@@ -15,16 +15,28 @@
 #include <algorithm>
 #include <string.h>
 #include "core/OperatorRegister.h"
+#include "core/ComputeThreadPool.h"
 #include "util/MAIUtil.h"
+#include "Sgemm.h"
 
 namespace MAI {
 namespace Op {
 namespace CPU {
 
+// Elements of the GEMM output(columns) computed at once, the input is
+// processed in steps of as many rows as fit.
+const int64 kCol2imBufferSize = 1 << 20;
+
+// Every input pixel times the filter is a FHxFWxOC patch of the output:
+// columns(H*W x FH*FW*OC) = input(H*W x IC) * filter^T(IC x FH*FW*OC), the
+// HWOI filter being packed as the GEMM operand at the first run. col2im then
+// adds the patches up into the output, one output row per task, each output
+// row gathering the patches which overlap it.
 template<typename T>
 class TransposeConv2d : public Operator {
 public:
-    TransposeConv2d() : mParam(NULL), mStrides(2), mRunFirst(true) {}
+    TransposeConv2d() : mParam(NULL), mStrides(2), mPreferredKernel(KERNEL_GEMM),
+        mKernel(KERNEL_GEMM), mPackedFilter(NULL) {}
     ~TransposeConv2d() {
         MAI_DELETE_PTR(mParam);
     }
@@ -33,7 +45,10 @@ public:
         return MAI_SUCCESS;
     }
 
-    void setParam(Param* param) override {
+    void onSetParam(Param* param) override {
+        if (mParam != NULL && mParam != param) {
+            delete mParam;
+        }
         mParam = reinterpret_cast<TransposeConv2dParam*>(param);
         mStrides[0] = mParam->strides[1];
         mStrides[1] = mParam->strides[2];
@@ -62,11 +77,108 @@ public:
             outputShape[i] = outputShapeData[i];
         }
         mOutput->resize(outputShape);
+        MAI_CHECK(mOutput->dimC() == mFilter->dimO(), "Output channel(%d) must be filter output channel(%d)",
+                mOutput->dimC(), mFilter->dimO());
+        mPaddings = calcPaddings(mParam->paddingMode, {mFilter->dimH(), mFilter->dimW()});
+        mKernel = mPreferredKernel;
+        if (mKernel == KERNEL_GEMM) {
+            prepareFilter();
+        }
         MAI_OP_RUN_FIRST_END
 
-        std::vector<int32> paddingTBLR = calcPaddings(
-                mParam->paddingMode,
-                {mFilter->dimH(), mFilter->dimW()});
+        if (mKernel == KERNEL_REF) {
+            runRef();
+        } else {
+            runGemm();
+        }
+        return MAI_SUCCESS;
+    }
+
+protected:
+    enum Kernel {KERNEL_REF, KERNEL_GEMM};
+
+private:
+    // filter(FH*FW*OC x IC) transposed, found in the constant cache of the
+    // network or packed once and put there
+    void prepareFilter() {
+        const int64 N = mFilter->dimH() * mFilter->dimW() * mFilter->dimO();
+        const int64 K = mFilter->dimI();
+        const uint32 cpuFeatures = opContext().cpuFeatures;
+        const int64 size = sgemmPackedBSize(K, N, cpuFeatures);
+        mPackedFilter = cachedConstant<T>(":packed", size, mPackedFilterData, [&](T* packed) {
+            sgemmPackB(true, K, N, mFilter->data<T>(), K, packed, cpuFeatures);
+        });
+    }
+
+    void runGemm() {
+        const shape_t inH = mInput->dimH();
+        const shape_t inW = mInput->dimW();
+        const shape_t inC = mInput->dimC();
+        const shape_t outH = mOutput->dimH();
+        const shape_t outW = mOutput->dimW();
+        const shape_t outC = mOutput->dimC();
+        const shape_t FH = mFilter->dimH();
+        const shape_t FW = mFilter->dimW();
+        const shape_t strideH = mStrides[0];
+        const shape_t strideW = mStrides[1];
+        const shape_t padTop = mPaddings[0];
+        const shape_t padLeft = mPaddings[2];
+        const shape_t N = FH * FW * outC;
+        const shape_t stepRows = std::max<shape_t>(1, std::min(inH, kCol2imBufferSize / (inW * N)));
+        mColumns.resize(stepRows * inW * N);
+        T* columns = mColumns.data();
+        for (shape_t b = 0; b < mInput->dimN(); ++b) {
+            const T* input = mInput->data<T>() + b * inH * inW * inC;
+            T* output = mOutput->mutableData<T>() + b * outH * outW * outC;
+            // output rows [0, zeroed) have been zeroed or accumulated into
+            shape_t zeroed = 0;
+            for (shape_t h0 = 0; h0 < inH; h0 += stepRows) {
+                const shape_t h1 = std::min(inH, h0 + stepRows);
+                sgemmPacked(false, false, false, true, (h1 - h0) * inW, N, inC,
+                        1.f, input + h0 * inW * inC, inC,
+                        mPackedFilter, 0,
+                        0.f, columns, N, opContext().cpuFeatures);
+                // output rows the patches of input rows [h0, h1) overlap
+                const shape_t ohBegin = std::max<shape_t>(0, h0 * strideH - padTop);
+                const shape_t ohEnd = std::min(outH, (h1 - 1) * strideH - padTop + FH);
+                const shape_t firstZeroed = zeroed;
+                parallelFor(std::min(ohBegin, firstZeroed), std::max(ohEnd, firstZeroed),
+                        grainSize(inW * FW * outC), [&](int64 begin, int64 end) {
+                    for (int64 oh = begin; oh < end; ++oh) {
+                        T* outRow = output + oh * outW * outC;
+                        if (oh >= firstZeroed) {
+                            memset(outRow, 0, outW * outC * sizeof(T));
+                        }
+                        for (shape_t fh = 0; fh < FH; ++fh) {
+                            const shape_t t = oh + padTop - fh;
+                            if (t < 0 || t % strideH != 0 || t / strideH < h0 || t / strideH >= h1) {
+                                continue;
+                            }
+                            const T* inRow = columns + (t / strideH - h0) * inW * N + fh * FW * outC;
+                            for (shape_t w = 0; w < inW; ++w) {
+                                const shape_t ow0 = w * strideW - padLeft;
+                                const shape_t fwBegin = std::max<shape_t>(0, -ow0);
+                                const shape_t fwEnd = std::min(FW, outW - ow0);
+                                for (shape_t fw = fwBegin; fw < fwEnd; ++fw) {
+                                    const T* patch = inRow + w * N + fw * outC;
+                                    T* out = outRow + (ow0 + fw) * outC;
+                                    for (shape_t oc = 0; oc < outC; ++oc) {
+                                        out[oc] += patch[oc];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                });
+                zeroed = std::max(zeroed, ohEnd);
+            }
+            if (zeroed < outH) {
+                memset(output + zeroed * outW * outC, 0, (outH - zeroed) * outW * outC * sizeof(T));
+            }
+        }
+    }
+
+    void runRef() {
         T* outputData = mOutput->mutableData<T>();
         memset(outputData, 0, mOutput->size());
         const T* inputData = mInput->data<T>();
@@ -76,22 +188,19 @@ public:
         const shape_t IWidth = mInput->dimW();
         const shape_t IChannel = mInput->dimC();
 
-        const shape_t OBatch = mOutput->dimN();
         const shape_t OHeight = mOutput->dimH();
         const shape_t OWidth = mOutput->dimW();
         const shape_t OChannel = mOutput->dimC();
 
         const shape_t FH = mFilter->dimH();
         const shape_t FW = mFilter->dimW();
-        const shape_t FI = mFilter->dimI();
-        const shape_t FO = mFilter->dimO();
 
         for (shape_t b = 0; b < IBatch; ++b) {
             for (shape_t h = 0; h < IHeight; ++h) {
                 for (shape_t w = 0; w < IWidth; ++w) {
                     for (shape_t c = 0; c < IChannel; ++c) {
-                        const shape_t outHIndexBase = h * mStrides[0] - paddingTBLR[0];
-                        const shape_t outWIndexBase = w * mStrides[1] - paddingTBLR[2];
+                        const shape_t outHIndexBase = h * mStrides[0] - mPaddings[0];
+                        const shape_t outWIndexBase = w * mStrides[1] - mPaddings[2];
                         for (shape_t fh = 0; fh < FH; ++fh) {
                             for (shape_t fw = 0; fw < FW; ++fw) {
                                 for (shape_t oc = 0; oc < OChannel; ++oc) {
@@ -110,7 +219,6 @@ public:
                 }
             }
         }
-        return MAI_SUCCESS;
     }
 
 private:
@@ -121,11 +229,33 @@ private:
     Tensor* mOutput;
     TransposeConv2dParam* mParam;
     std::vector<int32> mStrides;
-    bool mRunFirst;
+    std::vector<int32> mPaddings;
+    std::vector<T> mColumns;
+
+protected:
+    Kernel mPreferredKernel;
+
+private:
+    Kernel mKernel;
+    std::vector<T> mPackedFilterData;
+    const T* mPackedFilter;
+};
+
+template<typename T>
+class TransposeConv2dRef : public TransposeConv2d<T> {
+public:
+    TransposeConv2dRef() : TransposeConv2d<T>() {
+        this->mPreferredKernel = TransposeConv2d<T>::KERNEL_REF;
+    }
 };
 
 void registerTransposeConv2d() {
-    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(TRANSPOSE_CONV2D).build()), float, TransposeConv2d);
+    for (uint32 cpuFeatures : sgemmCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(TRANSPOSE_CONV2D).setCpuFeatures(cpuFeatures).build()),
+                float, TransposeConv2d);
+    }
+    MAI_REGISTER_OP((OpContextBuilder().setOperatorType(TRANSPOSE_CONV2D).setExtraInfo("ref").build()),
+            float, TransposeConv2dRef);
 }
 
 } // namespace CPU
@@ -0,0 +1,69 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "VectorMath.h"
+#include "ElementWise.h"
+#include "util/MAIType.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// see Simd.h
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+void vectorMath(MathFunction function, const float* input, int64 size,
+        float* output, uint32 cpuFeatures) {
+#define MAI_MATH_CASE(FUNCTION, FUNCTOR)                                \
+    case FUNCTION:                                                      \
+        elementWise(FUNCTOR(), input, size, output, cpuFeatures);       \
+        break;
+
+    switch (function) {
+    MAI_MATH_CASE(MATH_EXP, ExpFunctor)
+    MAI_MATH_CASE(MATH_EXP_FAST, ExpFastFunctor)
+    MAI_MATH_CASE(MATH_LOG, LogFunctor)
+    MAI_MATH_CASE(MATH_LOG1P, Log1pFunctor)
+    MAI_MATH_CASE(MATH_SIN, SinFunctor)
+    MAI_MATH_CASE(MATH_COS, CosFunctor)
+    MAI_MATH_CASE(MATH_TAN, TanFunctor)
+    MAI_MATH_CASE(MATH_ASIN, ASinFunctor)
+    MAI_MATH_CASE(MATH_ACOS, ACosFunctor)
+    MAI_MATH_CASE(MATH_ATAN, ATanFunctor)
+    MAI_MATH_CASE(MATH_SINH, SinhFunctor)
+    MAI_MATH_CASE(MATH_COSH, CoshFunctor)
+    MAI_MATH_CASE(MATH_TANH, TanhFunctor)
+    MAI_MATH_CASE(MATH_TANH_FAST, TanhFastFunctor)
+    MAI_MATH_CASE(MATH_ASINH, ASinhFunctor)
+    MAI_MATH_CASE(MATH_ACOSH, ACoshFunctor)
+    MAI_MATH_CASE(MATH_ATANH, ATanhFunctor)
+    MAI_MATH_CASE(MATH_SIGMOID, SigmoidFunctor)
+    MAI_MATH_CASE(MATH_SIGMOID_FAST, SigmoidFastFunctor)
+    MAI_MATH_CASE(MATH_ERF, ErfFunctor)
+    default:
+        MAI_ABORT("Unknown math function:%d", function);
+    }
+
+#undef MAI_MATH_CASE
+}
+
+std::vector<uint32> vectorMathCpuFeatureLevels() {
+    return elementWiseCpuFeatureLevels();
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
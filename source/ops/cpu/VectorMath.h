@@ -0,0 +1,60 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "include/Type.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+// Element-wise functions of SimdMath.h(see there for their error bounds)
+enum MathFunction {
+    MATH_EXP,
+    MATH_EXP_FAST,
+    MATH_LOG,
+    MATH_LOG1P,
+    MATH_SIN,
+    MATH_COS,
+    MATH_TAN,
+    MATH_ASIN,
+    MATH_ACOS,
+    MATH_ATAN,
+    MATH_SINH,
+    MATH_COSH,
+    MATH_TANH,
+    MATH_TANH_FAST,
+    MATH_ASINH,
+    MATH_ACOSH,
+    MATH_ATANH,
+    MATH_SIGMOID,
+    MATH_SIGMOID_FAST,
+    MATH_ERF,
+    MATH_FUNCTION_COUNT,
+};
+
+// output[i] = function(input[i]), output may be input. Chunks of the array
+// run on the threads of the current ComputeThreadPool, each one vectorized
+// with the widest vectors cpuFeatures allow.
+void vectorMath(MathFunction function, const float* input, int64 size,
+        float* output, uint32 cpuFeatures);
+
+// cpuFeatures of every vector width compiled in, portable first.
+std::vector<uint32> vectorMathCpuFeatureLevels();
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
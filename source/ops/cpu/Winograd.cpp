@@ -0,0 +1,249 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "Winograd.h"
+#include "core/ComputeThreadPool.h"
+#include "util/MAIType.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+namespace {
+
+const int32 kMaxAlpha = 6;
+// Floats of the transformed tiles and products of one step
+const int64 kStepBufferSize = 1 << 20;
+
+// Transform matrices of F(2x2, 3x3) and F(4x4, 3x3), row major
+const float kBT2[4 * 4] = {
+    1,  0, -1,  0,
+    0,  1,  1,  0,
+    0, -1,  1,  0,
+    0,  1,  0, -1,
+};
+
+const float kG2[4 * 3] = {
+    1,     0,    0,
+    0.5f,  0.5f, 0.5f,
+    0.5f, -0.5f, 0.5f,
+    0,     0,    1,
+};
+
+const float kAT2[2 * 4] = {
+    1, 1,  1,  0,
+    0, 1, -1, -1,
+};
+
+const float kBT4[6 * 6] = {
+    4,  0, -5,  0, 1, 0,
+    0, -4, -4,  1, 1, 0,
+    0,  4, -4, -1, 1, 0,
+    0, -2, -1,  2, 1, 0,
+    0,  2, -1, -2, 1, 0,
+    0,  4,  0, -5, 0, 1,
+};
+
+const float kG4[6 * 3] = {
+    1.f / 4,        0,        0,
+    -1.f / 6,  -1.f / 6, -1.f / 6,
+    -1.f / 6,   1.f / 6, -1.f / 6,
+    1.f / 24,  1.f / 12,  1.f / 6,
+    1.f / 24, -1.f / 12,  1.f / 6,
+    0,               0,        1,
+};
+
+const float kAT4[4 * 6] = {
+    1, 1,  1, 1,  1, 0,
+    0, 1, -1, 2, -2, 0,
+    0, 1,  1, 4,  4, 0,
+    0, 1, -1, 8, -8, 1,
+};
+
+struct WinogradMatrices {
+    const float* BT;// alpha x alpha
+    const float* G;// alpha x 3
+    const float* AT;// m x alpha
+};
+
+WinogradMatrices winogradMatrices(int32 m) {
+    MAI_CHECK(m == 2 || m == 4, "Winograd tile size must be 2 or 4 but not %d", m);
+    if (m == 2) {
+        return {kBT2, kG2, kAT2};
+    }
+    return {kBT4, kG4, kAT4};
+}
+
+// dst[i] = sum_j matrix[i][j] * src[j], rows x cols matrix, src[j] and dst[i]
+// are vectors of size elements size apart.
+inline void transformVectors(const float* matrix, int32 rows, int32 cols,
+        const float* src, int64 srcStride, float* dst, int64 dstStride, int64 size) {
+    for (int32 i = 0; i < rows; ++i) {
+        float* out = dst + i * dstStride;
+        memset(out, 0, size * sizeof(float));
+        for (int32 j = 0; j < cols; ++j) {
+            const float coefficient = matrix[i * cols + j];
+            if (coefficient == 0.f) {
+                continue;
+            }
+            const float* in = src + j * srcStride;
+            for (int64 c = 0; c < size; ++c) {
+                out[c] += coefficient * in[c];
+            }
+        }
+    }
+}
+
+// out = matrix * in * matrix^T on tiles of vectors: in is cols x cols
+// vectors, out rows x rows, tmp rows x cols, vectors are size floats.
+inline void transformTile(const float* matrix, int32 rows, int32 cols,
+        const float* in, float* tmp, float* out, int64 outStride, int64 size) {
+    // tmp[i][x] = sum_j matrix[i][j] * in[j][x]
+    for (int32 x = 0; x < cols; ++x) {
+        transformVectors(matrix, rows, cols, in + x * size, cols * size,
+                tmp + x * size, cols * size, size);
+    }
+    // out[i][k] = sum_j tmp[i][j] * matrix[k][j]
+    for (int32 i = 0; i < rows; ++i) {
+        transformVectors(matrix, rows, cols, tmp + i * cols * size, size,
+                out + i * rows * outStride, outStride, size);
+    }
+}
+
+} // namespace
+
+int32 winogradTileSize(int64 outH, int64 outW) {
+    // F(4x4) wastes too much on padded tiles below 8x8
+    return outH >= 8 && outW >= 8 ? 4 : 2;
+}
+
+int64 winogradFilterSize(int32 m, int64 inC, int64 outC) {
+    const int64 alpha = m + 2;
+    return alpha * alpha * inC * outC;
+}
+
+void winogradTransformFilter(int32 m, const float* filter, int64 inC, int64 outC,
+        float* transformed) {
+    const WinogradMatrices matrices = winogradMatrices(m);
+    const int32 alpha = m + 2;
+    const int64 size = inC * outC;
+    // HWIO: filter[a][b] is a vector of inC x outC, so is transformed[xi][nu]
+    std::vector<float> tmp(alpha * 3 * size);
+    for (int32 b = 0; b < 3; ++b) {
+        transformVectors(matrices.G, alpha, 3, filter + b * size, 3 * size,
+                tmp.data() + b * size, 3 * size, size);
+    }
+    for (int32 xi = 0; xi < alpha; ++xi) {
+        transformVectors(matrices.G, alpha, 3, tmp.data() + xi * 3 * size, size,
+                transformed + xi * alpha * size, size, size);
+    }
+}
+
+void winogradConv2D(int32 m, const float* input, int64 batch, int64 inH, int64 inW,
+        int64 inC, const float* transformedFilter, int64 outC,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        const SgemmEpilogue& epilogue, float* output, uint32 cpuFeatures) {
+    const WinogradMatrices matrices = winogradMatrices(m);
+    const int32 alpha = m + 2;
+    const int64 tilesH = (outH + m - 1) / m;
+    const int64 tilesW = (outW + m - 1) / m;
+    const int64 tiles = batch * tilesH * tilesW;
+    const int64 stepTiles = std::max<int64>(1,
+            std::min(tiles, kStepBufferSize / (alpha * alpha * (inC + outC))));
+    const float upper = epilogue.activation == FUSED_ACTIVATION_RELU6
+        ? 6.f : std::numeric_limits<float>::infinity();
+
+    // V[e] is stepTiles x inC, M[e] is stepTiles x outC, e = xi * alpha + nu
+    thread_local std::vector<float> transformedInput;
+    thread_local std::vector<float> products;
+    transformedInput.resize(alpha * alpha * stepTiles * inC);
+    products.resize(alpha * alpha * stepTiles * outC);
+    float* V = transformedInput.data();
+    float* M = products.data();
+    for (int64 t0 = 0; t0 < tiles; t0 += stepTiles) {
+        const int64 count = std::min(stepTiles, tiles - t0);
+        parallelFor(t0, t0 + count, grainSize(alpha * alpha * alpha * inC), [&](int64 begin, int64 end) {
+            thread_local std::vector<float> scratch;
+            scratch.resize(2 * kMaxAlpha * kMaxAlpha * inC);
+            float* d = scratch.data();
+            float* tmp = d + kMaxAlpha * kMaxAlpha * inC;
+            for (int64 t = begin; t < end; ++t) {
+                const int64 n = t / (tilesH * tilesW);
+                const int64 ih0 = t / tilesW % tilesH * m - padTop;
+                const int64 iw0 = t % tilesW * m - padLeft;
+                const float* image = input + n * inH * inW * inC;
+                for (int32 y = 0; y < alpha; ++y) {
+                    for (int32 x = 0; x < alpha; ++x) {
+                        const int64 ih = ih0 + y;
+                        const int64 iw = iw0 + x;
+                        float* pixel = d + (y * alpha + x) * inC;
+                        if (ih >= 0 && ih < inH && iw >= 0 && iw < inW) {
+                            memcpy(pixel, image + (ih * inW + iw) * inC, inC * sizeof(float));
+                        } else {
+                            memset(pixel, 0, inC * sizeof(float));
+                        }
+                    }
+                }
+                transformTile(matrices.BT, alpha, alpha, d, tmp,
+                        V + (t - t0) * inC, stepTiles * inC, inC);
+            }
+        });
+
+        for (int32 e = 0; e < alpha * alpha; ++e) {
+            sgemm(false, false, count, outC, inC,
+                    1.f, V + e * stepTiles * inC, inC,
+                    transformedFilter + e * inC * outC, outC,
+                    0.f, M + e * stepTiles * outC, outC, cpuFeatures);
+        }
+
+        parallelFor(t0, t0 + count, grainSize(alpha * alpha * m * outC), [&](int64 begin, int64 end) {
+            thread_local std::vector<float> scratch;
+            scratch.resize((kMaxAlpha * kMaxAlpha + 2 * kMaxAlpha * kMaxAlpha) * outC);
+            float* product = scratch.data();
+            float* tmp = product + kMaxAlpha * kMaxAlpha * outC;
+            float* y = tmp + kMaxAlpha * kMaxAlpha * outC;
+            for (int64 t = begin; t < end; ++t) {
+                for (int32 e = 0; e < alpha * alpha; ++e) {
+                    memcpy(product + e * outC, M + (e * stepTiles + t - t0) * outC,
+                            outC * sizeof(float));
+                }
+                transformTile(matrices.AT, m, alpha, product, tmp, y, outC, outC);
+                const int64 n = t / (tilesH * tilesW);
+                const int64 oh0 = t / tilesW % tilesH * m;
+                const int64 ow0 = t % tilesW * m;
+                for (int32 i = 0; i < m && oh0 + i < outH; ++i) {
+                    for (int32 k = 0; k < m && ow0 + k < outW; ++k) {
+                        const float* value = y + (i * m + k) * outC;
+                        float* out = output + ((n * outH + oh0 + i) * outW + ow0 + k) * outC;
+                        for (int64 o = 0; o < outC; ++o) {
+                            float v = value[o] + (epilogue.bias == NULL ? 0.f : epilogue.bias[o]);
+                            if (epilogue.activation != FUSED_ACTIVATION_NONE) {
+                                v = std::min(std::max(v, 0.f), upper);
+                            }
+                            out[o] = v;
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
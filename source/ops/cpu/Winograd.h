@@ -0,0 +1,53 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "include/Type.h"
+#include "Sgemm.h"
+
+namespace MAI {
+namespace Op {
+namespace CPU {
+
+// Winograd F(mxm, 3x3) convolution, stride 1, NHWC input with HWIO filter,
+// m is 2 or 4(tiles of (m + 2)x(m + 2) inputs, 2.25x and 4x fewer
+// multiplies than direct convolution).
+//
+// The filter is transformed once(U = G g G^T) into (m + 2)^2 matrices of
+// CxO. Each step takes a batch of tiles, transforms them(V = B^T d B) into
+// (m + 2)^2 matrices of tiles x C, multiplies each with its U by sgemm and
+// transforms the products back(Y = A^T M A), applying bias and activation
+// on the way out. The transforms run over the channels innermost, which
+// are contiguous in NHWC, so they vectorize.
+
+// Output tile size for an output of outH x outW.
+int32 winogradTileSize(int64 outH, int64 outW);
+
+// Size in floats of the transformed filter.
+int64 winogradFilterSize(int32 m, int64 inC, int64 outC);
+
+// filter is HWIO 3x3xinCxoutC, transformed gets winogradFilterSize() floats.
+void winogradTransformFilter(int32 m, const float* filter, int64 inC, int64 outC,
+        float* transformed);
+
+// bias/activation of epilogue are applied to the output.
+void winogradConv2D(int32 m, const float* input, int64 batch, int64 inH, int64 inW,
+        int64 inC, const float* transformedFilter, int64 outC,
+        int64 padTop, int64 padLeft, int64 outH, int64 outW,
+        const SgemmEpilogue& epilogue, float* output, uint32 cpuFeatures);
+
+} // namespace CPU
+} // namespace Op
+} // namespace MAI
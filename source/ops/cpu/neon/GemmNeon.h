@@ -15,6 +15,7 @@
 #pragma once
 
 #include <arm_neon.h>
+#include "core/ComputeThreadPool.h"
 
 namespace MAI {
 namespace Op {
@@ -247,9 +248,11 @@ struct Gemm<float, false, false> {
         const int kBlockSize = K / tileSize + (K % tileSize == 0 ? 0 : 1);
         int remainSize[3] = {M % tileSize, N % tileSize, K % tileSize};
         memset(oPtr, 0, M * N * sizeof(float));
-#pragma omp parallel for schedule(dynamic) collapse(2)
-        for (int m = 0; m < mBlockSize; m++) {
-            for (int n = 0; n < nBlockSize; n++) {
+        // one tile of the output per index, tiles cost about tileSize^2 * K
+        parallelFor(0, mBlockSize * nBlockSize, grainSize(tileSize * tileSize * K), [&](int64 begin, int64 end) {
+            for (int64 index = begin; index < end; ++index) {
+                const int m = static_cast<int>(index / nBlockSize);
+                const int n = static_cast<int>(index % nBlockSize);
                 for (int k = 0; k < kBlockSize; k++) {
                     int mTileSize = (m == mBlockSize - 1 && remainSize[0] > 0) ? remainSize[0] : tileSize;
                     int nTileSize = (n == nBlockSize - 1 && remainSize[1] > 0) ? remainSize[1] : tileSize;
@@ -260,7 +263,7 @@ struct Gemm<float, false, false> {
                             mTileSize, nTileSize, kTileSize, M, N, K);
                 }
             }
-        }
+        });
     }
 
     static void gemm_tile_884_a_morden_88_b_morden_84(const float* aPtr, const float* bPtr, float* oPtr, int M, int N, int K) {
@@ -456,14 +459,10 @@ struct Gemm<float, false, false> {
         //ALOGI("mBlockSize=%d, nBlockSize=%d, kBlockSize=%d", mBlockSize, nBlockSize, kBlockSize);
         int remainSize[3] = {M % tileSize, N % tileSize, K % tileSize};
         memset(oPtr, 0, M * N * sizeof(float));
-        //#pragma omp parallel for schedule(dynamic)
-#pragma omp parallel for schedule(dynamic) collapse(2)
-        for (int m = 0; m < mBlockSize; m++) {
-            //memcpy(oPtr + m * N, cPtr, N * sizeof(float));
-            //memcpy(oPtr + (m + 1) * N, cPtr, N * sizeof(float));
-            //memcpy(oPtr + (m + 2) * N, cPtr, N * sizeof(float));
-            //memcpy(oPtr + (m + 3) * N, cPtr, N * sizeof(float));
-            for (int n = 0; n < nBlockSize; n++) {
+        parallelFor(0, mBlockSize * nBlockSize, grainSize(tileSize * tileSize * K), [&](int64 begin, int64 end) {
+            for (int64 index = begin; index < end; ++index) {
+                const int m = static_cast<int>(index / nBlockSize);
+                const int n = static_cast<int>(index % nBlockSize);
                 for (int k = 0; k < kBlockSize; k++) {
                     int mTileSize = (m == mBlockSize - 1 && remainSize[0] > 0) ? remainSize[0] : tileSize;
                     int nTileSize = (n == nBlockSize - 1 && remainSize[1] > 0) ? remainSize[1] : tileSize;
@@ -475,7 +474,7 @@ struct Gemm<float, false, false> {
                             mTileSize, nTileSize, kTileSize, M, N, K);
                 }
             }
-        }
+        });
     }
 
 };
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "include/Type.h"
+#include "core/ComputeThreadPool.h"
 
 namespace MAI {
 namespace Op {
@@ -47,9 +48,12 @@ struct Conv2D<T, NCHW, OIHW> {
             const std::vector<shape_t>& outputShape) {
         int32 outputGroupChannelSize = outputShape[1] / param->group;
         int32 inputGroupChannelSize = inputShape[1] / param->group;
-        #pragma omp parallel for collapse(2)
-        for(shape_t n = 0; n < outputShape[0]; ++n) {
-            for(shape_t o = 0; o < outputShape[1]; ++o) {
+        parallelFor(0, outputShape[0] * outputShape[1],
+                grainSize(outputShape[2] * outputShape[3] * inputGroupChannelSize * filterShape[2] * filterShape[3]),
+                [&](int64 begin, int64 end) {
+            for (int64 index = begin; index < end; ++index) {
+                const shape_t n = index / outputShape[1];
+                const shape_t o = index % outputShape[1];
                 for(shape_t h = 0; h < outputShape[2]; ++h) {
                     for(shape_t w = 0; w < outputShape[3]; ++w) {
                         T* outputV = output + offset4D(outputShape, n, o, h, w);
@@ -78,7 +82,7 @@ struct Conv2D<T, NCHW, OIHW> {
                     }
                 }
             }
-        }
+        });
     }
 };
 
@@ -95,9 +99,12 @@ struct Conv2D<T, NHWC, HWIO> {
             const std::vector<shape_t>& outputShape) {
         int32 outputGroupChannelSize = outputShape[DataFormatIndex<NHWC>::C] / param->group;
         int32 inputGroupChannelSize = inputShape[DataFormatIndex<NHWC>::C] / param->group;
-        #pragma omp parallel for collapse(4)
-        for(shape_t n = 0; n < outputShape[0]; ++n) {
-            for(shape_t h = 0; h < outputShape[1]; ++h) {
+        parallelFor(0, outputShape[0] * outputShape[1],
+                grainSize(outputShape[2] * outputShape[3] * inputGroupChannelSize * filterShape[0] * filterShape[1]),
+                [&](int64 begin, int64 end) {
+            for (int64 index = begin; index < end; ++index) {
+                const shape_t n = index / outputShape[1];
+                const shape_t h = index % outputShape[1];
                 for(shape_t w = 0; w < outputShape[2]; ++w) {
                     for(shape_t o = 0; o < outputShape[3]; ++o) {
                         T* outputV = output + offset4D(outputShape, n, h, w, o);
@@ -106,7 +113,7 @@ struct Conv2D<T, NHWC, HWIO> {
                         int32 group = o / outputGroupChannelSize;// The group th of output channel
                         for(shape_t i = group * inputGroupChannelSize; i < (group + 1) * inputGroupChannelSize; ++i) {
                             for(shape_t fh = 0; fh < filterShape[DataFormatIndex<HWIO>::H]; ++fh) {
-                                for(shape_t fw = 0; fw < filterShape[DataFormatIndex<HWIO>::H]; ++fw) {
+                                for(shape_t fw = 0; fw < filterShape[DataFormatIndex<HWIO>::W]; ++fw) {
                                     shape_t inHOffset = inHBase + fh;
                                     shape_t inWOffset = inWBase + fw;
                                     if (inHOffset >= 0 && inHOffset < inputShape[DataFormatIndex<NHWC>::H]
@@ -126,7 +133,7 @@ struct Conv2D<T, NHWC, HWIO> {
                     }
                 }
             }
-        }
+        });
     }
 };
 } // namespace Ref
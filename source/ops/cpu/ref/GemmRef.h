@@ -27,7 +27,6 @@ struct Gemm {
     // O = C + A * B;
     // A: MxK B: KxN C: MxN
     static void gemm(const T* aPtr, const T* bPtr, const T* cPtr, T* oPtr, int M, int N, int K) {
-        ALOGI("Ref::Gemm");
         for (int m = 0; m < M; ++m) {
             memcpy(oPtr + m * N, cPtr, sizeof(T) * N);
             for (int k = 0; k < K; ++k) {
@@ -28,7 +28,7 @@ Buffer* CPUAllocator::allocateBuffer(uint64 bytes) {
 }
 
 MemoryInfo CPUAllocator::allocate(uint64 bytes) {
-    MemoryInfo memInfo;
+    MemoryInfo memInfo = {NULL, 0, 0};
     if (0 == bytes) {
         return memInfo;
     }
@@ -41,7 +41,10 @@ MemoryInfo CPUAllocator::allocate(uint64 bytes) {
 }
 
 void CPUAllocator::deallocate(MemoryInfo& memInfo) {
-    MAI_DELETE_PTR(memInfo.ptr);
+    if (memInfo.ptr != NULL) {
+        free(memInfo.ptr);
+        memInfo.ptr = NULL;
+    }
 }
 
 } // namespace MAI
@@ -26,7 +26,7 @@ namespace GPU {
 template<typename T>
 class Relu : public Operator {
 public:
-    Relu() : mRunFirst(true) {}
+    Relu() {}
     ~Relu() = default;
 
     MAI_STATUS init() override {
@@ -68,7 +68,6 @@ public:
         return MAI_SUCCESS;
     }
 private:
-    bool mRunFirst;
     cl::Kernel mKernel;
 };
 
@@ -53,6 +53,10 @@ void OpenCLBuffer::setBufferAddr(uint8* buffer, uint32 offset) {
     MAI_ABORT("setBufferAddr");
 }
 
+void OpenCLBuffer::setBufferAddr(uint8* buffer, uint32 offset, uint64 size) {
+    MAI_ABORT("setBufferAddr");
+}
+
 void OpenCLBuffer::copy(const uint8* src, int32 offset, int64 len) {
     mapBuffer();
     memcpy(mMappedBuffer, src + offset, len);
@@ -83,6 +87,10 @@ void OpenCLBuffer::zero() {
     MAI_ABORT("zero");
 }
 
+void OpenCLBuffer::release() {
+    MAI_ABORT("release");
+}
+
 void OpenCLBuffer::mapBuffer() {
     MAI_CHECK_NULL(mBuffer);
     if (mMappedBuffer == NULL) {
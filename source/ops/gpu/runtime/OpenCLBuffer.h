@@ -28,6 +28,7 @@ public:
 
     virtual void setBufferAddr(const uint8* buffer, uint32 offset = 0);
     virtual void setBufferAddr(uint8* buffer, uint32 offset = 0);
+    virtual void setBufferAddr(uint8* buffer, uint32 offset, uint64 size);
     virtual void copy(const uint8* src, int32 offset, int64 len);
 
     virtual const uint8* data();
@@ -35,6 +36,7 @@ public:
     virtual void resize(uint64 len);
     virtual uint64 size();
     virtual void zero();
+    virtual void release();
 
 private:
     void mapBuffer();
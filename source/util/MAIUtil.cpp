@@ -59,6 +59,19 @@ std::vector<int32> calcPaddings(PaddingMode paddingMode, const std::vector<int32
     return paddings;
 }
 
+void derivePaddings(PaddingMode paddingMode, const std::vector<int32>& kSize,
+        std::vector<int32>& paddings) {
+    if (paddingMode != PADDING_INVALID) {
+        const std::vector<int32> derived = calcPaddings(paddingMode, kSize);
+        MAI_CHECK(paddings.size() == 0 || paddings == derived,
+            "Cannot use explicit padding when paddingMode is :%d, size:%d", paddingMode, paddings.size());
+        paddings = derived;
+    } else {
+        MAI_CHECK(paddings.size() == 4,
+            "Explicit padding size must be 4 but not: %d", paddings.size());
+    }
+}
+
 std::vector<int32> calculateHW(const std::vector<int32>& hw,
         const std::vector<int32>& kSize,
         const std::vector<int32>& strides,
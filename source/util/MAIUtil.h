@@ -19,6 +19,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <vector>
 #include <numeric>
 #include <stdlib.h>
@@ -149,6 +150,32 @@ inline const T* mapFile(const std::string& path) {
     return modelData;
 }
 
+// Maps the whole file copy-on-write: pages are shared with the page cache
+// until they are written. Returns NULL if the file cannot be mapped, size is
+// set to the size of the file, unmap it with unmapFile().
+template<class T>
+inline T* mapFile(const std::string& path, uint64& size) {
+    struct stat fileInfo;
+    if (stat(path.c_str(), &fileInfo) < 0 || fileInfo.st_size == 0) {
+        return NULL;
+    }
+    int fileHandle = open(path.c_str(), O_RDONLY);
+    if (fileHandle < 0) {
+        return NULL;
+    }
+    void* data = mmap(nullptr, fileInfo.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileHandle, 0);
+    close(fileHandle);// the mapping stays valid
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    size = static_cast<uint64>(fileInfo.st_size);
+    return static_cast<T*>(data);
+}
+
+inline void unmapFile(const void* data, uint64 size) {
+    munmap(const_cast<void*>(data), size);
+}
+
 template<class T>
 inline void fillRandomValue(T* ptr, const std::vector<shape_t>& shape, const std::function<T()>& randomFunc) {
     if (shape.size() == 0) {
@@ -170,6 +197,11 @@ void replace(std::string& str, const std::string& src, const std::string& dst);
 
 std::vector<int32> calcPaddings(PaddingMode paddingMode, const std::vector<int32>& kSize);
 
+// Checks paddings against paddingMode and derives them from it unless it is INVALID,
+// paddings derived by an earlier run(before the input was resized) are fine
+void derivePaddings(PaddingMode paddingMode, const std::vector<int32>& kSize,
+        std::vector<int32>& paddings);
+
 std::vector<int32> calculateHW(const std::vector<int32>& hw,
         const std::vector<int32>& kSize,
         const std::vector<int32>& strides,
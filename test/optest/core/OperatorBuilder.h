@@ -25,6 +25,11 @@ public:
 
     OperatorBuilder() : mOpContext(OpContextBuilder().build()), mParam(NULL) {}
 
+    inline OperatorBuilder& setName(const std::string& name) {
+        mName = name;
+        return *this;
+    }
+
     inline OperatorBuilder& setType(MAIOperator opType) {
         mOpContext.opType = opType;
         return *this;
@@ -62,6 +67,7 @@ public:
 
     inline std::unique_ptr<Operator> build() {
         std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator(mOpContext);
+        op->setName(mName);
         op->addInputNames(mInputNames);
         op->addOutputNames(mOutputNames);
         if (mParam != NULL) {
@@ -76,6 +82,7 @@ public:
     }
 
 private:
+    std::string mName;
     OpContext mOpContext;
     std::vector<std::string> mInputNames;
     std::vector<std::string> mOutputNames;
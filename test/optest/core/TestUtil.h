@@ -14,6 +14,11 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+#include "core/NetworkBuilder.h"
+#include "core/OperatorBuilder.h"
+
 namespace MAI {
 namespace Test {
 
@@ -51,10 +56,70 @@ inline void ExpectTensorEQ(const Tensor* x, const Tensor* y) {
     ExpectDimsEQ(x, y);
     auto a = x->data<X_TYPE>();
     auto b = y->data<Y_TYPE>();
-    for (int i = 0; i < x->elementSize(); ++i) {
+    for (uint64 i = 0; i < x->elementSize(); ++i) {
         ExpectEQ(a[i], b[i]);
     }
 }
 
+template<typename T>
+inline void ExpectTensorNear(const Tensor* x, const Tensor* y, T absError) {
+    ASSERT_TRUE(x->dataType() == y->dataType()) << "dataType of " << x->name()
+        << " is " << x->dataType() << " while dataType of " << y->name()
+        << " is " << y->dataType();
+    ExpectDimsEQ(x, y);
+    auto a = x->data<T>();
+    auto b = y->data<T>();
+    for (uint64 i = 0; i < x->elementSize(); ++i) {
+        EXPECT_NEAR(a[i], b[i], absError) << "at " << i;
+    }
+}
+
+// Small values of both signs, exact in float
+inline std::vector<float> makeData(shape_t size, int32 seed = 0) {
+    std::vector<float> data(size);
+    for (shape_t i = 0; i < size; ++i) {
+        data[i] = ((i * 37 + seed * 11) % 17 - 8) / 8.f;
+    }
+    return data;
+}
+
+// Runs the variant extraInfo of an operator against the reference one on the inputs
+// added to builder, the outputs are output and output_ref
+inline void ExpectNearRef(NetworkBuilder& builder, MAIOperator type, Param* param,
+        const std::vector<std::string>& inputNames, DataFormat outputFormat = NHWC,
+        const std::string& extraInfo = "", float absError = 1e-4f, int32 numThreads = 1,
+        int32 runs = 1) {
+    Param* refParam = param->clone();
+    std::unique_ptr<NeuralNetwork> network = builder
+        .addOperator(OperatorBuilder()
+            .setName("op")
+            .setType(type)
+            .setDataType(DT_FLOAT)
+            .setInputNames(inputNames)
+            .setOutputNames({"output"})
+            .setParam(param)
+            .setExtra(extraInfo)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setName("op_ref")
+            .setType(type)
+            .setDataType(DT_FLOAT)
+            .setInputNames(inputNames)
+            .setOutputNames({"output_ref"})
+            .setParam(refParam)
+            .setExtra("ref")
+            .build())
+        .addTensor<float>("output", {}, {}, outputFormat)
+        .addTensor<float>("output_ref", {}, {}, outputFormat)
+        .build();
+    network->setNumThreads(numThreads);
+    network->init();
+    for (int32 i = 0; i < runs; ++i) {
+        network->run();
+    }
+
+    ExpectTensorNear<float>(network->getTensor("output"), network->getTensor("output_ref"), absError);
+}
+
 } // namespace Test
 } // namespace MAI
@@ -0,0 +1,123 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/OperatorTest.h"
+
+namespace MAI {
+namespace Test {
+
+class BindMemoryTest : public OperatorTest {
+};
+
+// input -> CONV2D(VALID) -> conv -> RELU -> relu -> RESHAPE -> reshaped
+//                                          relu -> output
+static std::unique_ptr<NeuralNetwork> buildNetwork() {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv"})
+            .setParam(param)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv"})
+            .setOutputNames({"output"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RESHAPE)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"output", "shape"})
+            .setOutputNames({"reshaped"})
+            .build())
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<int32>("shape", {2}, {-1, 3})
+        .addTensor<float>("conv", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("reshaped", {}, {})
+        .addTensor<float>("check", {2,1,3,3}, {
+                    0,2,8,0,2,8,0,2,8,
+                    12,2,8,14,2,8,16,2,8,
+                })
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {2,2,4,1});
+    network->addModelOutput("output");
+    network->addModelOutput("reshaped");
+    network->init();
+    return network;
+}
+
+static void expectEQ(const std::vector<float>& data, Tensor* check) {
+    ASSERT_GE(data.size(), check->elementSize());
+    for (uint64 i = 0; i < check->elementSize(); ++i) {
+        EXPECT_FLOAT_EQ(check->data<float>()[i], data[i]);
+    }
+}
+
+TEST_F(BindMemoryTest, ReadAndWriteCallerBuffers) {
+    std::unique_ptr<NeuralNetwork> network = buildNetwork();
+    std::vector<float> input(16);
+    std::vector<float> output(18, -1.f);
+    std::vector<float> reshaped(18, -1.f);
+    network->bindInput("input", input.data(), input.size() * sizeof(float));
+    network->bindOutput("output", output.data(), output.size() * sizeof(float));
+    network->bindOutput("reshaped", reshaped.data(), reshaped.size() * sizeof(float));
+    for (int32 run = 0; run < 3; ++run) {
+        for (int32 i = 0; i < 16; ++i) {
+            input[i] = i + 1;
+        }
+        network->run();
+        // the last writer writes straight into the caller's buffer
+        EXPECT_EQ(output.data(), network->getTensor("output")->data<float>());
+        expectEQ(output, network->getTensor("check"));
+        // Reshape shares the buffer of its input, the result is copied
+        expectEQ(reshaped, network->getTensor("check"));
+        std::fill(output.begin(), output.end(), -1.f);
+        std::fill(reshaped.begin(), reshaped.end(), -1.f);
+    }
+
+    // unbound outputs go back to memory of the network
+    network->bindOutput("output", NULL, 0);
+    network->run();
+    EXPECT_NE(output.data(), network->getTensor("output")->data<float>());
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+}
+
+TEST_F(BindMemoryTest, BindAfterPlanning) {
+    std::unique_ptr<NeuralNetwork> network = buildNetwork();
+    for (int32 i = 0; i < 16; ++i) {
+        network->getTensor("input")->mutableData<float>()[i] = i + 1;
+    }
+    network->run();
+    std::vector<float> input(16);
+    std::vector<float> output(18, -1.f);
+    for (int32 i = 0; i < 16; ++i) {
+        input[i] = i + 1;
+    }
+    network->bindInput("input", input.data(), input.size() * sizeof(float));
+    network->bindOutput("output", output.data(), output.size() * sizeof(float));
+    network->run();
+    EXPECT_EQ(input.data(), network->getTensor("input")->data<float>());
+    expectEQ(output, network->getTensor("check"));
+}
+
+} // namespace Test
+} // namespace MAI
@@ -0,0 +1,127 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include "core/OperatorTest.h"
+#include "source/core/CpuFeatures.h"
+#include "source/ops/cpu/ElementWise.h"
+
+namespace MAI {
+namespace Test {
+
+class BroadcastTest : public OperatorTest {
+protected:
+    static std::vector<float> makeData(const std::vector<shape_t>& shape, float offset) {
+        shape_t size = 1;
+        for (shape_t dim : shape) {
+            size *= dim;
+        }
+        std::vector<float> data(size);
+        for (shape_t i = 0; i < size; ++i) {
+            data[i] = ((i * 7) % 23) * 0.25f - offset;
+        }
+        return data;
+    }
+
+    // Offset into a tensor of shape for index of the(higher rank) output
+    static shape_t offsetOf(const std::vector<shape_t>& shape, const std::vector<shape_t>& index) {
+        const size_t delta = index.size() - shape.size();
+        shape_t offset = 0;
+        for (size_t i = 0; i < shape.size(); ++i) {
+            offset = offset * shape[i] + (shape[i] == 1 ? 0 : index[i + delta]);
+        }
+        return offset;
+    }
+
+    template<typename TO, typename F>
+    static void check(MAIOperator op, const std::vector<shape_t>& shapeA,
+            const std::vector<shape_t>& shapeB, F reference, int numThreads = 1) {
+        const std::vector<float> a = makeData(shapeA, 2.f);
+        const std::vector<float> b = makeData(shapeB, 2.1f);
+        std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+            .addOperator(OperatorBuilder()
+                .setType(op)
+                .setDataType(DT_FLOAT)
+                .setInputNames({"a", "b"})
+                .setOutputNames({"output"})
+                .build())
+            .addTensor<float>("a", shapeA, a)
+            .addTensor<float>("b", shapeB, b)
+            .template addTensor<TO>("output", {}, {})
+            .build();
+        network->setNumThreads(numThreads);
+        network->init();
+        network->run();
+
+        const Tensor* output = network->getTensor("output");
+        const std::vector<shape_t> shape = broadcastShape(shapeA, shapeB);
+        ASSERT_EQ(shape, output->shape());
+        std::vector<shape_t> index(shape.size(), 0);
+        for (uint64 i = 0; i < output->elementSize(); ++i) {
+            const TO expected = reference(a[offsetOf(shapeA, index)], b[offsetOf(shapeB, index)]);
+            ASSERT_EQ(expected, output->data<TO>()[i]) << "at " << i << " of "
+                << shapeToString(shapeA) << " and " << shapeToString(shapeB);
+            for (int64 d = static_cast<int64>(shape.size()) - 1; d >= 0 && ++index[d] == shape[d]; --d) {
+                index[d] = 0;
+            }
+        }
+    }
+
+    static void checkShapes(const std::vector<shape_t>& shapeA, const std::vector<shape_t>& shapeB,
+            int numThreads = 1) {
+        check<float>(ADD, shapeA, shapeB, [](float x, float y) { return x + y; }, numThreads);
+        check<float>(MUL, shapeA, shapeB, [](float x, float y) { return x * y; }, numThreads);
+        check<float>(REAL_DIV, shapeA, shapeB, [](float x, float y) { return x / y; }, numThreads);
+        check<float>(FLOOR_MOD, shapeA, shapeB,
+                [](float x, float y) { return x - std::floor(x / y) * y; }, numThreads);
+        check<int8>(GREATER, shapeA, shapeB,
+                [](float x, float y) -> int8 { return x > y ? 1 : 0; }, numThreads);
+    }
+
+    static void checkAllShapes(int numThreads = 1) {
+        checkShapes({2, 3, 5, 7}, {2, 3, 5, 7}, numThreads);// vector-vector
+        checkShapes({2, 3, 5, 19}, {19}, numThreads);// bias
+        checkShapes({19}, {2, 3, 5, 19}, numThreads);
+        checkShapes({2, 3, 5, 19}, {2, 3, 5, 1}, numThreads);// vector-scalar
+        checkShapes({2, 1, 5, 1}, {2, 3, 5, 19}, numThreads);// scalar-vector
+        checkShapes({4, 1, 17}, {1, 6, 1}, numThreads);
+        checkShapes({1}, {3, 17}, numThreads);
+        checkShapes({3, 17}, {1, 1}, numThreads);
+        checkShapes({1, 1, 1}, {1}, numThreads);
+        checkShapes({2, 3, 1, 4, 1, 21}, {3, 5, 4, 2, 1}, numThreads);// rank 6
+        checkShapes({2, 1, 3, 1, 5}, {1, 4, 1, 6, 5}, numThreads);
+    }
+};
+
+TEST_F(BroadcastTest, everyCpuFeatureLevel) {
+    for (uint32 level : Op::CPU::elementWiseCpuFeatureLevels()) {
+        if (!cpuSupports(level)) {
+            continue;
+        }
+        setCpuFeatureMask(level);
+        checkAllShapes();
+        setCpuFeatureMask(~0u);
+    }
+}
+
+TEST_F(BroadcastTest, multiThread) {
+    checkAllShapes(3);
+    // chunks which start and end within rows of different patterns
+    checkShapes({37, 3, 1301}, {3, 1301}, 4);
+    checkShapes({37, 1, 1301}, {37, 3, 1}, 4);
+    checkShapes({129, 517}, {129, 1}, 4);
+}
+
+} // namespace Test
+} // namespace MAI
@@ -0,0 +1,114 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <thread>
+#include "core/OperatorTest.h"
+#include "core/ComputeThreadPool.h"
+
+namespace MAI {
+namespace Test {
+
+class ComputeThreadPoolTest : public OperatorTest {
+};
+
+static void expectEachIndexOnce(ComputeThreadPool& pool, int64 size, int64 grain) {
+    std::vector<std::atomic<int32> > counts(size);
+    for (int64 i = 0; i < size; ++i) {
+        counts[i].store(0);
+    }
+    pool.parallelFor(0, size, grain, [&counts, grain, size](int64 begin, int64 end) {
+        EXPECT_LT(begin, end);
+        EXPECT_TRUE(end - begin >= grain || end == size);
+        for (int64 i = begin; i < end; ++i) {
+            ++counts[i];
+        }
+    });
+    for (int64 i = 0; i < size; ++i) {
+        EXPECT_EQ(1, counts[i].load());
+    }
+}
+
+TEST_F(ComputeThreadPoolTest, ParallelFor) {
+    ComputeThreadPool pool(4);
+    EXPECT_EQ(4, pool.numThreads());
+    for (int32 round = 0; round < 50; ++round) {
+        expectEachIndexOnce(pool, 1000, 1);
+        expectEachIndexOnce(pool, 1000, 64);
+        expectEachIndexOnce(pool, 7, 100);
+        expectEachIndexOnce(pool, 1, 1);
+    }
+}
+
+TEST_F(ComputeThreadPoolTest, NestedAndConcurrentLoops) {
+    ComputeThreadPool pool(3);
+    ComputeThreadPool::Scope scope(&pool);
+    std::atomic<int64> sum(0);
+    parallelFor(0, 16, 1, [&sum](int64 begin, int64 end) {
+        for (int64 i = begin; i < end; ++i) {
+            // runs inline as the pool is busy
+            parallelFor(0, 100, 1, [&sum](int64 innerBegin, int64 innerEnd) {
+                sum += innerEnd - innerBegin;
+            });
+        }
+    });
+    EXPECT_EQ(1600, sum.load());
+
+    sum = 0;
+    std::thread threads[2];
+    for (int32 t = 0; t < 2; ++t) {
+        threads[t] = std::thread([&pool, &sum]() {
+            ComputeThreadPool::Scope threadScope(&pool);
+            for (int32 round = 0; round < 100; ++round) {
+                parallelFor(0, 1000, 10, [&sum](int64 begin, int64 end) {
+                    sum += end - begin;
+                });
+            }
+        });
+    }
+    for (int32 t = 0; t < 2; ++t) {
+        threads[t].join();
+    }
+    EXPECT_EQ(2 * 100 * 1000, sum.load());
+}
+
+TEST_F(ComputeThreadPoolTest, NetworkThreads) {
+    std::vector<float> inputData(1 << 16);
+    std::vector<float> checkData(inputData.size());
+    for (int32 i = 0; i < static_cast<int32>(inputData.size()); ++i) {
+        inputData[i] = static_cast<float>(i % 13) - 5.f;
+        checkData[i] = std::min(std::max(inputData[i], 0.f), 6.f);
+    }
+    const shape_t size = static_cast<shape_t>(inputData.size());
+    for (int32 threads = 1; threads <= 3; ++threads) {
+        std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+            .addOperator(OperatorBuilder()
+                .setType(RELU6)
+                .setDataType(DT_FLOAT)
+                .setInputNames({"input"})
+                .setOutputNames({"output"})
+                .build())
+            .addTensor<float>("input", {size}, inputData)
+            .addTensor<float>("output", {}, {})
+            .addTensor<float>("check", {size}, checkData)
+            .build();
+        network->setNumThreads(threads, threads == 2);
+        network->init();
+        network->run();
+        ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    }
+}
+
+} // namespace Test
+} // namespace MAI
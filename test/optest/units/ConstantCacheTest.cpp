@@ -0,0 +1,152 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include "core/OperatorTest.h"
+#include "source/core/ConstantCache.h"
+#include "source/core/MaiModel.h"
+
+namespace MAI {
+namespace Test {
+
+class ConstantCacheTest : public OperatorTest {
+};
+
+static const std::string kModelPath = "ConstantCacheTest.mai";
+static const std::string kCachePath = "ConstantCacheTest.cache";
+
+// conv2d -> fused_batch_norm, written as an unoptimized MAI model
+static void writeModel(float scale0) {
+    Conv2DParam* convParam = new Conv2DParam();
+    convParam->dilations = {1,1,1,1};
+    convParam->strides = {1,1,1,1};
+    convParam->paddingMode = PADDING_VALID;
+    convParam->group = 1;
+    FusedBatchNormParam* fusedParam = new FusedBatchNormParam();
+    fusedParam->epsilon = 0.001f;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setName("conv2d")
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv_output"})
+            .setParam(convParam)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setName("fused_batch_norm")
+            .setType(FUSED_BATCH_NORM)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv_output", "scale", "offset", "mean", "var"})
+            .setOutputNames({"fused_output"})
+            .setParam(fusedParam)
+            .build())
+        .addTensor<float>("input", {2,2,4,1}, {1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16})
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv_output", {}, {})
+        .addTensor<float>("scale", {3}, {scale0,0.4f,0.3f})
+        .addTensor<float>("offset", {3}, {0.1f,0.2f,0.3f})
+        .addTensor<float>("mean", {3}, {0.5f,0.4f,0.3f})
+        .addTensor<float>("var", {3}, {0.3f,0.4f,0.5f})
+        .addTensor<float>("fused_output", {}, {})
+        .build();
+    network->addModelOutput("fused_output");
+    ASSERT_EQ(MAI_SUCCESS, MaiModelWriter::write(network.get(), kModelPath));
+}
+
+static std::vector<float> runModel(NeuralNetwork* network) {
+    network->init();
+    network->run();
+    Tensor* output = network->getTensor("fused_output");
+    return std::vector<float>(output->data<float>(), output->data<float>() + output->elementSize());
+}
+
+TEST_F(ConstantCacheTest, PutFindAndSave) {
+    const std::vector<float> packed = {1.f, 2.f, 3.f};
+    {
+        ConstantCache cache(kCachePath, "key");
+        EXPECT_FALSE(cache.load());
+        EXPECT_TRUE(cache.find("packed") == NULL);
+        cache.put("packed", packed.data(), packed.size() * sizeof(float));
+        EXPECT_TRUE(cache.isDirty());
+        ASSERT_EQ(MAI_SUCCESS, cache.save());
+        EXPECT_FALSE(cache.isDirty());
+    }
+    {
+        ConstantCache cache(kCachePath, "key");
+        ASSERT_TRUE(cache.load());
+        uint64 size = 0;
+        const float* data = reinterpret_cast<const float*>(cache.find("packed", &size));
+        ASSERT_TRUE(data != NULL);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(data) % 64);
+        ASSERT_EQ(packed.size() * sizeof(float), size);
+        EXPECT_EQ(packed, std::vector<float>(data, data + packed.size()));
+    }
+    {
+        // another model, engine or CPU
+        ConstantCache cache(kCachePath, "other key");
+        EXPECT_FALSE(cache.load());
+        EXPECT_TRUE(cache.find("packed") == NULL);
+    }
+    remove(kCachePath.c_str());
+}
+
+TEST_F(ConstantCacheTest, PutKeepsEntryFoundBefore) {
+    const std::vector<float> first = {1.f, 2.f, 3.f};
+    const std::vector<float> second = {4.f, 5.f, 6.f, 7.f};
+    ConstantCache cache(kCachePath, "key");
+    cache.put("packed", first.data(), first.size() * sizeof(float));
+    const float* data = reinterpret_cast<const float*>(cache.find("packed"));
+    ASSERT_TRUE(data != NULL);
+    // e.g. another session which missed on the same constant
+    cache.put("packed", second.data(), second.size() * sizeof(float));
+    uint64 size = 0;
+    EXPECT_EQ(data, reinterpret_cast<const float*>(cache.find("packed", &size)));
+    EXPECT_EQ(first.size() * sizeof(float), size);
+    EXPECT_EQ(first, std::vector<float>(data, data + first.size()));
+}
+
+TEST_F(ConstantCacheTest, ReuseOptimizedNetwork) {
+    remove(kCachePath.c_str());
+    writeModel(0.5f);
+    std::unique_ptr<NeuralNetwork> network = NeuralNetwork::getOptimizedNeuralNetwork(
+            NeuralNetwork::MAI, kModelPath, kCachePath);
+    ASSERT_TRUE(network != NULL);
+    ASSERT_TRUE(network->getConstantCache() != NULL);
+    EXPECT_FALSE(network->getConstantCache()->isLoaded());
+    EXPECT_EQ(1, network->getOperatorNames().size());
+    std::vector<float> output = runModel(network.get());
+
+    std::unique_ptr<NeuralNetwork> cached = NeuralNetwork::getOptimizedNeuralNetwork(
+            NeuralNetwork::MAI, kModelPath, kCachePath);
+    ASSERT_TRUE(cached != NULL);
+    EXPECT_TRUE(cached->getConstantCache()->isLoaded());
+    EXPECT_EQ(1, cached->getOperatorNames().size());
+    EXPECT_TRUE(cached->getTensor("scale") == NULL);
+    EXPECT_EQ(output, runModel(cached.get()));
+
+    // the model changes, the cache is derived again
+    writeModel(0.6f);
+    std::unique_ptr<NeuralNetwork> changed = NeuralNetwork::getOptimizedNeuralNetwork(
+            NeuralNetwork::MAI, kModelPath, kCachePath);
+    ASSERT_TRUE(changed != NULL);
+    EXPECT_FALSE(changed->getConstantCache()->isLoaded());
+    EXPECT_NE(output, runModel(changed.get()));
+
+    remove(kModelPath.c_str());
+    remove(kCachePath.c_str());
+}
+
+} // namespace Test
+} // namespace MAI
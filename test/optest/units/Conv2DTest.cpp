@@ -12,12 +12,35 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdio.h>
 #include "core/OperatorTest.h"
+#include "source/core/ConstantCache.h"
+#include "source/core/MaiModel.h"
 
 namespace MAI {
 namespace Test {
 
 class Conv2DTest : public OperatorTest {
+protected:
+    // The conv2d variant extraInfo against the reference one on the same inputs
+    static void checkWithRef(Conv2DParam* param,
+            const std::vector<shape_t>& inputShape, DataFormat inputFormat,
+            const std::vector<shape_t>& filterShape, DataFormat filterFormat,
+            bool withBias, const std::string& extraInfo = "", float absError = 1e-4f,
+            int32 numThreads = 1) {
+        std::vector<std::string> inputNames = {"input", "filter"};
+        shape_t outputChannel = filterShape[filterFormat == HWIO ? 3 : 0];
+        if (withBias) {
+            inputNames.push_back("bias");
+        }
+        NetworkBuilder builder;
+        builder.addTensor<float>("input", inputShape,
+                    makeData(inputShape[0] * inputShape[1] * inputShape[2] * inputShape[3], 1), inputFormat)
+            .addTensor<float>("filter", filterShape,
+                    makeData(filterShape[0] * filterShape[1] * filterShape[2] * filterShape[3], 2), filterFormat)
+            .addTensor<float>("bias", {outputChannel}, makeData(outputChannel, 3));
+        ExpectNearRef(builder, CONV2D, param, inputNames, inputFormat, extraInfo, absError, numThreads);
+    }
 };
 
 TEST_F(Conv2DTest, floatWithSingleChannelValid_NHWC_HWIO) {
@@ -175,5 +198,253 @@ TEST_F(Conv2DTest, floatWithMultiChannelSameBias_NHWC_HWIO) {
     ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
 }
 
+TEST_F(Conv2DTest, GemmMatchesRefStrideGroupRelu6_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,2,2,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 2;
+    param->activation = FUSED_ACTIVATION_RELU6;
+    checkWithRef(param, {2,9,11,6}, NHWC, {3,3,3,8}, HWIO, true);
+}
+
+TEST_F(Conv2DTest, GemmMatchesRefNonSquareFilter_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    checkWithRef(param, {1,7,8,5}, NHWC, {3,2,5,20}, HWIO, false);
+}
+
+TEST_F(Conv2DTest, GemmMatchesRefExplicitPaddingRelu_NCHW_OIHW) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,2,2};
+    param->paddingMode = PADDING_INVALID;
+    param->paddings = {1,1,1,1};
+    param->group = 2;
+    param->activation = FUSED_ACTIVATION_RELU;
+    checkWithRef(param, {2,6,9,11}, NCHW, {8,3,3,3}, OIHW, true);
+}
+
+// More images and groups than threads, each thread runs its tasks on its own columns
+TEST_F(Conv2DTest, GemmMatchesRefGroupThreads_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 2;
+    checkWithRef(param, {3,9,11,6}, NHWC, {3,3,3,8}, HWIO, true, "", 1e-4f, 4);
+}
+
+// Larger than one im2col step
+TEST_F(Conv2DTest, GemmMatchesRefManySteps_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 1;
+    checkWithRef(param, {1,40,40,32}, NHWC, {3,3,32,24}, HWIO, true);
+}
+
+TEST_F(Conv2DTest, FoldRelu6IntoConv2D) {
+    const std::string path = "Conv2DTest.mai";
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setName("conv2d")
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv_output"})
+            .setParam(param)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setName("relu6")
+            .setType(RELU6)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv_output"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {2,2,4,1}, {1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16})
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv_output", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {2,1,3,3}, {
+                    0,2,6,0,2,6,0,2,6,
+                    6,2,6,6,2,6,6,2,6,
+                })
+        .build();
+    network->addModelOutput("output");
+    network->addOptimizer(NeuralNetwork::FOLD_ACTIVATION_INTO_CONV2D);
+    network->startOptimize();
+    EXPECT_EQ(1, network->getOperatorNames().size());
+    EXPECT_TRUE(network->getTensor("conv_output") == NULL);
+    ASSERT_EQ(MAI_SUCCESS, MaiModelWriter::write(network.get(), path));
+    network->init();
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+
+    // the activation is a param field, it survives a MAI model
+    std::unique_ptr<NeuralNetwork> loaded = NeuralNetwork::getNeuralNetwork(NeuralNetwork::MAI, path);
+    remove(path.c_str());
+    ASSERT_TRUE(loaded != NULL);
+    EXPECT_EQ(1, loaded->getOperatorNames().size());
+    loaded->init();
+    loaded->run();
+    ExpectTensorEQ<float, float>(loaded->getTensor("output"), network->getTensor("check"));
+}
+
+TEST_F(Conv2DTest, WinogradF2MatchesRefRelu_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 1;
+    param->activation = FUSED_ACTIVATION_RELU;
+    // 6x7 output, F(2x2, 3x3) with a partial tile
+    checkWithRef(param, {1,6,7,4}, NHWC, {3,3,4,5}, HWIO, true, "winograd");
+}
+
+TEST_F(Conv2DTest, WinogradF4MatchesRefRelu6_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 1;
+    param->activation = FUSED_ACTIVATION_RELU6;
+    // 13x17 output, F(4x4, 3x3) with partial tiles
+    checkWithRef(param, {2,13,17,8}, NHWC, {3,3,8,12}, HWIO, true, "winograd", 1e-3f);
+}
+
+TEST_F(Conv2DTest, WinogradF4MatchesRefValid_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    checkWithRef(param, {1,12,12,16}, NHWC, {3,3,16,16}, HWIO, false, "winograd", 1e-3f);
+}
+
+TEST_F(Conv2DTest, WinogradFilterFromConstantCache) {
+    const std::string path = "Conv2DTest.cache";
+    std::shared_ptr<ConstantCache> cache(new ConstantCache(path, "Conv2DTest"));
+    std::vector<float> outputs[2];
+    for (int32 i = 0; i < 2; ++i) {
+        Conv2DParam* param = new Conv2DParam();
+        param->dilations = {1,1,1,1};
+        param->strides = {1,1,1,1};
+        param->paddingMode = PADDING_SAME;
+        param->group = 1;
+        std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+            .addOperator(OperatorBuilder()
+                .setName("conv2d")
+                .setType(CONV2D)
+                .setDataType(DT_FLOAT)
+                .setInputNames({"input", "filter"})
+                .setOutputNames({"output"})
+                .setParam(param)
+                .setExtra("winograd")
+                .build())
+            .addTensor<float>("input", {1,8,8,4}, makeData(8 * 8 * 4, 1))
+            // the second network transforms nothing, it takes the cached filter
+            .addTensor<float>("filter", {3,3,4,4}, i == 0 ? makeData(3 * 3 * 4 * 4, 2)
+                    : std::vector<float>(3 * 3 * 4 * 4, 0.f), HWIO)
+            .addTensor<float>("output", {}, {})
+            .build();
+        network->setConstantCache(cache);
+        network->init();
+        network->run();
+        EXPECT_TRUE(cache->find("conv2d:winograd_f4") != NULL);
+        const Tensor* output = network->getTensor("output");
+        outputs[i].assign(output->data<float>(), output->data<float>() + output->elementSize());
+    }
+    EXPECT_EQ(outputs[0], outputs[1]);
+    remove(path.c_str());
+}
+
+TEST_F(Conv2DTest, PointwiseGroupRelu6_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 2;
+    param->activation = FUSED_ACTIVATION_RELU6;
+    checkWithRef(param, {2,7,9,12}, NHWC, {1,1,6,20}, HWIO, true);
+}
+
+TEST_F(Conv2DTest, PointwiseStrided_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,2,2,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    checkWithRef(param, {2,9,8,10}, NHWC, {1,1,10,17}, HWIO, true);
+}
+
+TEST_F(Conv2DTest, PointwiseGroupRelu_NCHW_OIHW) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 3;
+    param->activation = FUSED_ACTIVATION_RELU;
+    checkWithRef(param, {2,9,5,7}, NCHW, {12,3,1,1}, OIHW, true);
+}
+
+TEST_F(Conv2DTest, PointwiseStrided_NCHW_OIHW) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,2,3};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    checkWithRef(param, {1,8,9,10}, NCHW, {5,8,1,1}, OIHW, false);
+}
+
+// Shufflenet-like grouped 1x1, images and groups spread over the threads
+TEST_F(Conv2DTest, GroupedPointwiseAcrossThreads_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 3;
+    param->activation = FUSED_ACTIVATION_RELU;
+    checkWithRef(param, {2,10,11,24}, NHWC, {1,1,8,30}, HWIO, true, "", 1e-4f, 3);
+}
+
+TEST_F(Conv2DTest, Grouped3x3AcrossThreads_NHWC_HWIO) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,2,2,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 4;
+    checkWithRef(param, {1,9,10,16}, NHWC, {3,3,4,12}, HWIO, true, "", 1e-4f, 2);
+}
+
+TEST_F(Conv2DTest, Grouped3x3AcrossThreads_NCHW_OIHW) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_SAME;
+    param->group = 2;
+    param->activation = FUSED_ACTIVATION_RELU6;
+    checkWithRef(param, {3,6,7,9}, NCHW, {10,3,3,3}, OIHW, true, "", 1e-4f, 4);
+}
+
+// Fewer images and groups than threads: one at a time, each GEMM split
+TEST_F(Conv2DTest, GroupedFewerTasksThanThreads_NCHW_OIHW) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,2,2};
+    param->paddingMode = PADDING_VALID;
+    param->group = 2;
+    checkWithRef(param, {1,8,12,11}, NCHW, {6,4,1,1}, OIHW, false, "", 1e-4f, 4);
+}
+
 } // namespace Test
 } // namespace MAI
@@ -14,11 +14,44 @@
 
 #include <limits>
 #include "core/OperatorTest.h"
+#include "source/core/CpuFeatures.h"
+#include "source/ops/cpu/DepthwiseConv3x3.h"
 
 namespace MAI {
 namespace Test {
 
 class DepthwiseConv2dTest : public OperatorTest {
+protected:
+    // The default variant against the reference one on the same inputs
+    static void checkWithRef(DepthwiseConv2dParam* param,
+            const std::vector<shape_t>& inputShape, DataFormat inputFormat,
+            bool withBias) {
+        const bool nhwc = inputFormat == NHWC;
+        const shape_t channels = inputShape[nhwc ? 3 : 1];
+        std::vector<shape_t> filterShape = nhwc
+            ? std::vector<shape_t>({3, 3, channels, 1}) : std::vector<shape_t>({channels, 1, 3, 3});
+        std::vector<std::string> inputNames = {"input", "filter"};
+        if (withBias) {
+            inputNames.push_back("bias");
+        }
+        NetworkBuilder builder;
+        builder.addTensor<float>("input", inputShape,
+                    makeData(inputShape[0] * inputShape[1] * inputShape[2] * inputShape[3], 1), inputFormat)
+            .addTensor<float>("filter", filterShape, makeData(channels * 9, 2), nhwc ? HWIO : IOHW)
+            .addTensor<float>("bias", {channels}, makeData(channels, 3));
+        ExpectNearRef(builder, DEPTHWISE_CONV2D, param, inputNames, inputFormat);
+    }
+
+    static DepthwiseConv2dParam* makeParam(int32 stride, DataFormat inputFormat,
+            PaddingMode paddingMode, FusedActivation activation = FUSED_ACTIVATION_NONE) {
+        DepthwiseConv2dParam* param = new DepthwiseConv2dParam();
+        param->dilations = {1,1,1,1};
+        param->strides = inputFormat == NHWC
+            ? std::vector<int32>({1,stride,stride,1}) : std::vector<int32>({1,1,stride,stride});
+        param->paddingMode = paddingMode;
+        param->activation = activation;
+        return param;
+    }
 };
 
 TEST_F(DepthwiseConv2dTest, floatWithSingleChannelValid_NHWC_HWIO) {
@@ -158,5 +191,83 @@ TEST_F(DepthwiseConv2dTest, floatWithMultiChannelSameBias_NHWC_HWIO) {
     ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
 }
 
+// 19 channels: blocks of every vector width and leftovers
+TEST_F(DepthwiseConv2dTest, Conv3x3Stride1MatchesRef_NHWC_HWIO) {
+    checkWithRef(makeParam(1, NHWC, PADDING_SAME), {2,7,9,19}, NHWC, true);
+}
+
+TEST_F(DepthwiseConv2dTest, Conv3x3Stride2MatchesRef_NHWC_HWIO) {
+    checkWithRef(makeParam(2, NHWC, PADDING_SAME, FUSED_ACTIVATION_RELU6), {1,10,11,35}, NHWC, true);
+}
+
+TEST_F(DepthwiseConv2dTest, Conv3x3ValidMatchesRef_NHWC_HWIO) {
+    checkWithRef(makeParam(2, NHWC, PADDING_VALID), {1,9,8,16}, NHWC, false);
+}
+
+// 37 columns: vectors of every width, leftovers and both borders
+TEST_F(DepthwiseConv2dTest, Conv3x3Stride1MatchesRef_NCHW_IOHW) {
+    checkWithRef(makeParam(1, NCHW, PADDING_SAME, FUSED_ACTIVATION_RELU), {2,3,6,37}, NCHW, true);
+}
+
+TEST_F(DepthwiseConv2dTest, Conv3x3Stride2MatchesRef_NCHW_IOHW) {
+    checkWithRef(makeParam(2, NCHW, PADDING_SAME), {1,4,9,40}, NCHW, false);
+}
+
+TEST_F(DepthwiseConv2dTest, Conv3x3ExplicitPaddingMatchesRef_NCHW_IOHW) {
+    DepthwiseConv2dParam* param = makeParam(2, NCHW, PADDING_INVALID, FUSED_ACTIVATION_RELU6);
+    param->paddings = {2,0,1,2};
+    checkWithRef(param, {1,2,8,35}, NCHW, true);
+}
+
+// Narrower than the window: every column is a border one
+TEST_F(DepthwiseConv2dTest, Conv3x3NarrowInputMatchesRef_NHWC_HWIO) {
+    checkWithRef(makeParam(1, NHWC, PADDING_SAME), {1,2,2,5}, NHWC, true);
+}
+
+TEST_F(DepthwiseConv2dTest, Conv3x3EveryCpuFeatureLevel) {
+    for (uint32 level : Op::CPU::depthwiseConv3x3CpuFeatureLevels()) {
+        if (!cpuSupports(level)) {
+            continue;
+        }
+        setCpuFeatureMask(level);
+        checkWithRef(makeParam(1, NHWC, PADDING_SAME), {1,5,6,21}, NHWC, true);
+        checkWithRef(makeParam(2, NCHW, PADDING_SAME), {1,3,5,41}, NCHW, true);
+        setCpuFeatureMask(~0u);
+    }
+}
+
+TEST_F(DepthwiseConv2dTest, FoldReluIntoDepthwiseConv2d) {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setName("depthwise")
+            .setType(DEPTHWISE_CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv_output"})
+            .setParam(makeParam(1, NHWC, PADDING_VALID))
+            .build())
+        .addOperator(OperatorBuilder()
+            .setName("relu")
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv_output"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1,3,3,2}, {1,-1,2,-2,3,-3,4,-4,5,-5,6,-6,7,-7,8,-8,9,-9})
+        .addTensor<float>("filter", {3,3,2,1}, {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1}, HWIO)
+        .addTensor<float>("conv_output", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {1,1,1,2}, {45,0})
+        .build();
+    network->addModelOutput("output");
+    network->addOptimizer(NeuralNetwork::FOLD_ACTIVATION_INTO_CONV2D);
+    network->startOptimize();
+    EXPECT_EQ(1, network->getOperatorNames().size());
+    EXPECT_TRUE(network->getTensor("conv_output") == NULL);
+    network->init();
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+}
+
 } // namespace Test
 } // namespace MAI
@@ -0,0 +1,273 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "core/OperatorTest.h"
+#include "DynamicBatcher.h"
+#include "source/core/OperatorRegister.h"
+
+namespace MAI {
+namespace Test {
+
+class DynamicBatcherTest : public OperatorTest {
+};
+
+static std::unique_ptr<NeuralNetwork> buildNegNetwork(int32 batch) {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {batch, 2});
+    network->addModelOutput("output");
+    network->init();
+    return network;
+}
+
+static void submitAndCheck(DynamicBatcher* batcher, int32 first, int32 count) {
+    std::vector<std::future<DynamicBatcher::Outputs> > futures;
+    for (int32 i = first; i < first + count; ++i) {
+        float input[2] = {static_cast<float>(i), static_cast<float>(-2 * i)};
+        futures.emplace_back(batcher->submit({input}));
+    }
+    for (int32 i = 0; i < count; ++i) {
+        DynamicBatcher::Outputs outputs = futures[i].get();
+        ASSERT_EQ(1, outputs.size());
+        ASSERT_EQ(2 * sizeof(float), outputs[0].size());
+        const float* output = reinterpret_cast<const float*>(outputs[0].data());
+        EXPECT_FLOAT_EQ(-(first + i), output[0]);
+        EXPECT_FLOAT_EQ(2 * (first + i), output[1]);
+    }
+}
+
+TEST_F(DynamicBatcherTest, BatchRequests) {
+    std::unique_ptr<NeuralNetwork> network = buildNegNetwork(4);
+    DynamicBatcher::Options options;
+    options.maxBatchSize = 4;
+    options.maxWaitMicros = 10000;
+    DynamicBatcher batcher({network.get()}, options);
+    submitAndCheck(&batcher, 0, 10);
+
+    DynamicBatcher::Stats stats = batcher.stats();
+    EXPECT_EQ(10, stats.requests);
+    EXPECT_GE(stats.batches, 3);
+    EXPECT_LE(stats.batches, 10);
+    EXPECT_LE(stats.averageBatchSize, 4.);
+    EXPECT_GE(stats.maxQueueDelayMicros, stats.averageQueueDelayMicros);
+}
+
+TEST_F(DynamicBatcherTest, ConcurrentClientsAndSessions) {
+    std::unique_ptr<NeuralNetwork> network = buildNegNetwork(8);
+    std::unique_ptr<NeuralNetwork> session = network->createSession();
+    DynamicBatcher::Options options;
+    options.maxBatchSize = 8;
+    options.maxWaitMicros = 1000;
+    options.latencyBudgetMicros = 5000;
+    DynamicBatcher batcher({network.get(), session.get()}, options);
+    std::thread threads[4];
+    for (int32 i = 0; i < 4; ++i) {
+        threads[i] = std::thread(submitAndCheck, &batcher, i * 100, 25);
+    }
+    for (int32 i = 0; i < 4; ++i) {
+        threads[i].join();
+    }
+    EXPECT_EQ(100, batcher.stats().requests);
+}
+
+namespace {
+
+class FailingOp : public Operator {
+public:
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        return MAI_FAILED;
+    }
+};
+
+// Outputs one sample whatever dim 0 of the input is
+class OneSampleOp : public Operator {
+public:
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        getOutputTensor(0)->resize({1, 2});
+        return MAI_SUCCESS;
+    }
+};
+
+std::atomic<bool> gReleaseBlockingOp(false);
+
+// Keeps the dispatcher busy until gReleaseBlockingOp is set
+class BlockingOp : public Operator {
+public:
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        while (!gReleaseBlockingOp.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        getOutputTensor(0)->resize(getInputTensor(0)->shape());
+        return MAI_SUCCESS;
+    }
+};
+
+} // namespace
+
+TEST_F(DynamicBatcherTest, ResizeToBatchSize) {
+    std::unique_ptr<NeuralNetwork> network = buildNegNetwork(8);
+    DynamicBatcher::Options options;
+    options.maxBatchSize = 8;
+    options.maxWaitMicros = 0;
+    {
+        DynamicBatcher batcher({network.get()}, options);
+        submitAndCheck(&batcher, 0, 1);
+        EXPECT_EQ(1, network->getTensor("input")->dim(0));
+        EXPECT_EQ(1, network->getTensor("output")->dim(0));
+    }
+
+    options.batchSizes = {8, 3};
+    DynamicBatcher batcher({network.get()}, options);
+    submitAndCheck(&batcher, 5, 1);
+    EXPECT_EQ(3, network->getTensor("input")->dim(0));
+    EXPECT_EQ(3, network->getTensor("output")->dim(0));
+}
+
+TEST_F(DynamicBatcherTest, FailedRunThrowsFromFuture) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(NEG).setDataType(DT_FLOAT)
+                    .setExtraInfo("fail_test").build()),
+                FailingOp);
+    }
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"output"})
+            .setExtra("fail_test")
+            .build())
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {2, 2});
+    network->addModelOutput("output");
+    network->init();
+    DynamicBatcher::Options options;
+    options.maxBatchSize = 2;
+    DynamicBatcher batcher({network.get()}, options);
+    float input[2] = {1.f, 2.f};
+    std::future<DynamicBatcher::Outputs> future = batcher.submit({input});
+    EXPECT_THROW(future.get(), std::runtime_error);
+    EXPECT_EQ(0, batcher.stats().requests);
+}
+
+TEST_F(DynamicBatcherTest, OutputWithoutBatchDimThrowsFromFuture) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(NEG).setDataType(DT_FLOAT)
+                    .setExtraInfo("one_sample_test").build()),
+                OneSampleOp);
+    }
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"output"})
+            .setExtra("one_sample_test")
+            .build())
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {2, 2});
+    network->addModelOutput("output");
+    network->init();
+    DynamicBatcher::Options options;
+    options.maxBatchSize = 2;
+    // the batch always waits for its second request
+    options.maxWaitMicros = 60 * 1000 * 1000;
+    DynamicBatcher batcher({network.get()}, options);
+    float input[2] = {1.f, 2.f};
+    // the dispatcher keeps serving after a failed batch
+    for (int32 round = 0; round < 2; ++round) {
+        std::future<DynamicBatcher::Outputs> first = batcher.submit({input});
+        std::future<DynamicBatcher::Outputs> second = batcher.submit({input});
+        EXPECT_THROW(first.get(), std::runtime_error);
+        EXPECT_THROW(second.get(), std::runtime_error);
+    }
+    EXPECT_EQ(0, batcher.stats().requests);
+}
+
+TEST_F(DynamicBatcherTest, FullQueueThrowsFromFuture) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(NEG).setDataType(DT_FLOAT)
+                    .setExtraInfo("blocking_test").build()),
+                BlockingOp);
+    }
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"output"})
+            .setExtra("blocking_test")
+            .build())
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {1, 2});
+    network->addModelOutput("output");
+    network->init();
+    gReleaseBlockingOp.store(false);
+    DynamicBatcher::Options options;
+    options.maxBatchSize = 1;
+    options.queueCapacity = 2;
+    DynamicBatcher batcher({network.get()}, options);
+    // the blocked dispatcher holds at most one request, the queue two
+    float input[2] = {1.f, 2.f};
+    std::vector<std::future<DynamicBatcher::Outputs> > futures;
+    for (int32 i = 0; i < 4; ++i) {
+        futures.emplace_back(batcher.submit({input}));
+    }
+    gReleaseBlockingOp.store(true);
+    int32 failed = 0;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (const std::runtime_error&) {
+            ++failed;
+        }
+    }
+    EXPECT_GE(failed, 1);
+    EXPECT_EQ(static_cast<uint64>(4 - failed), batcher.stats().requests);
+}
+
+} // namespace Test
+} // namespace MAI
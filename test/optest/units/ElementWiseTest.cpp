@@ -0,0 +1,156 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include "core/OperatorTest.h"
+#include "source/core/CpuFeatures.h"
+#include "source/ops/cpu/ElementWise.h"
+
+namespace MAI {
+namespace Test {
+
+class ElementWiseTest : public OperatorTest {
+protected:
+    // Values around the branches of the functors, repeated past every
+    // vector width so that both the vector loop and the leftovers see them
+    static std::vector<float> makeData(shape_t size) {
+        const float special[] = {0.f, -0.f, 0.5f, -0.5f, 1.f, -1.f, 1.5f, -2.5f, 5.99f, 6.f, 6.5f,
+            -0.3f, 4194303.5f, -4194303.5f, 8388609.f, -1e30f,
+            std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::quiet_NaN()};
+        const shape_t specialSize = sizeof(special) / sizeof(special[0]);
+        std::vector<float> data(size);
+        for (shape_t i = 0; i < size; ++i) {
+            data[i] = i % 3 == 0 ? special[(i / 3) % specialSize] : (i % 37) * 0.37f - 6.8f;
+        }
+        return data;
+    }
+
+    // Same value, NaN equals NaN and 0 does not equal -0
+    static void expectSame(const Tensor* output, const std::vector<float>& expected) {
+        ASSERT_EQ(static_cast<shape_t>(expected.size()), output->elementSize());
+        const float* data = output->data<float>();
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (std::isnan(expected[i])) {
+                EXPECT_TRUE(std::isnan(data[i])) << "at " << i;
+            } else {
+                EXPECT_EQ(expected[i], data[i]) << "at " << i;
+                EXPECT_EQ(std::signbit(expected[i]), std::signbit(data[i])) << "at " << i;
+            }
+        }
+    }
+
+    template<typename F>
+    static void check(MAIOperator op, const std::vector<float>& input, F reference,
+            Param* param = NULL, int numThreads = 1) {
+        std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+            .addOperator(OperatorBuilder()
+                .setType(op)
+                .setDataType(DT_FLOAT)
+                .setInputNames({"input"})
+                .setOutputNames({"output"})
+                .setParam(param)
+                .build())
+            .addTensor<float>("input", {static_cast<shape_t>(input.size())}, input)
+            .addTensor<float>("output", {}, {})
+            .build();
+        network->setNumThreads(numThreads);
+        network->init();
+        network->run();
+
+        std::vector<float> expected(input.size());
+        for (size_t i = 0; i < input.size(); ++i) {
+            expected[i] = reference(input[i]);
+        }
+        expectSame(network->getTensor("output"), expected);
+    }
+
+    static void checkAll(const std::vector<float>& input, int numThreads) {
+        check(ABS, input, [](float x) { return std::abs(x); }, NULL, numThreads);
+        check(NEG, input, [](float x) { return -x; }, NULL, numThreads);
+        check(SQUARE, input, [](float x) { return x * x; }, NULL, numThreads);
+        check(FLOOR, input, [](float x) { return std::floor(x); }, NULL, numThreads);
+        check(RELU, input, [](float x) { return std::max(x, 0.f); }, NULL, numThreads);
+        check(RELU1, input, [](float x) { return std::isnan(x) ? x : std::min(1.f, std::max(x, -1.f)); },
+                NULL, numThreads);
+        check(RELU6, input, [](float x) { return std::min(std::max(x, 0.f), 6.f); }, NULL, numThreads);
+        LeakyReluParam* param = new LeakyReluParam();
+        param->alpha = 0.2f;
+        check(LEAKY_RELU, input, [](float x) { return x >= 0 ? x : x * 0.2f; }, param, numThreads);
+    }
+};
+
+TEST_F(ElementWiseTest, everyCpuFeatureLevel) {
+    const std::vector<float> input = makeData(1021);
+    for (uint32 level : Op::CPU::elementWiseCpuFeatureLevels()) {
+        if (!cpuSupports(level)) {
+            continue;
+        }
+        setCpuFeatureMask(level);
+        checkAll(input, 1);
+        setCpuFeatureMask(~0u);
+    }
+}
+
+TEST_F(ElementWiseTest, multiThread) {
+    checkAll(makeData(100003), 4);
+}
+
+TEST_F(ElementWiseTest, inPlace) {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(RELU6)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"data"})
+            .setOutputNames({"data"})
+            .build())
+        .addTensor<float>("data", {2, 4}, {-1.f, 0.5f, 3.f, 6.f, 7.5f, -8.f, 2.f, 100.f})
+        .addTensor<float>("check", {2, 4}, {0.f, 0.5f, 3.f, 6.f, 6.f, 0.f, 2.f, 6.f})
+        .build();
+    network->init();
+    network->run();
+
+    ExpectTensorEQ<float, float>(network->getTensor("data"), network->getTensor("check"));
+}
+
+TEST_F(ElementWiseTest, int32) {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(ABS)
+            .setDataType(DT_INT32)
+            .setInputNames({"input"})
+            .setOutputNames({"abs"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU6)
+            .setDataType(DT_INT32)
+            .setInputNames({"input"})
+            .setOutputNames({"relu6"})
+            .build())
+        .addTensor<int32>("input", {5}, {-7, -1, 0, 3, 9})
+        .addTensor<int32>("abs", {}, {})
+        .addTensor<int32>("relu6", {}, {})
+        .addTensor<int32>("abs_check", {5}, {7, 1, 0, 3, 9})
+        .addTensor<int32>("relu6_check", {5}, {0, 0, 0, 3, 6})
+        .build();
+    network->init();
+    network->run();
+
+    ExpectTensorEQ<int32, int32>(network->getTensor("abs"), network->getTensor("abs_check"));
+    ExpectTensorEQ<int32, int32>(network->getTensor("relu6"), network->getTensor("relu6_check"));
+}
+
+} // namespace Test
+} // namespace MAI
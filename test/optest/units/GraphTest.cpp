@@ -0,0 +1,183 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include "core/OperatorTest.h"
+#include "source/core/OperatorRegister.h"
+
+namespace MAI {
+namespace Test {
+
+class GraphTest : public OperatorTest {
+};
+
+// Two independent branches joined by ADD:
+//   input -> RELU -> x1 -> NEG -> x2
+//   input -> NEG -> y1 -> RELU -> y2
+//   ADD(x2, y2) -> output
+static std::unique_ptr<NeuralNetwork> buildTwoBranches() {
+    return NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"x1"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"x1"})
+            .setOutputNames({"x2"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"y1"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"y1"})
+            .setOutputNames({"y2"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(ADD)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"x2", "y2"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1, 2, 2, 2}, {0,2,3,4,-7,0,-8,-100})
+        .addTensor<float>("x1", {}, {})
+        .addTensor<float>("x2", {}, {})
+        .addTensor<float>("y1", {}, {})
+        .addTensor<float>("y2", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {1, 2, 2, 2}, {0,-2,-3,-4,7,0,8,100})
+        .build();
+}
+
+TEST_F(GraphTest, SequentialBranchesShareMemory) {
+    std::unique_ptr<NeuralNetwork> network = buildTwoBranches();
+    network->init();
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    // x1 is dead before y1 is produced
+    EXPECT_EQ(5 * 64, network->getNaiveMemorySize());
+    EXPECT_EQ(3 * 64, network->getPlannedMemorySize());
+}
+
+TEST_F(GraphTest, ParallelBranches) {
+    std::unique_ptr<NeuralNetwork> network = buildTwoBranches();
+    network->setNumInterOpThreads(2);
+    network->init();
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    // the branches may run at the same time, only output can reuse a slot
+    EXPECT_EQ(5 * 64, network->getNaiveMemorySize());
+    EXPECT_EQ(4 * 64, network->getPlannedMemorySize());
+
+    std::vector<float> input = {-1,-2,-3,-4,7,1,8,100};
+    std::vector<float> check = {1,2,3,4,-7,-1,-8,-100};
+    network->getTensor("input")->copy(input.data(), input.size() * sizeof(float));
+    network->getTensor("check")->copy(check.data(), check.size() * sizeof(float));
+    for (int32 i = 0; i < 20; ++i) {
+        network->run();
+        ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    }
+}
+
+TEST_F(GraphTest, DestroyRightAfterRun) {
+    // the last operator must not touch the network once run() returned
+    for (int32 i = 0; i < 200; ++i) {
+        std::unique_ptr<NeuralNetwork> network = buildTwoBranches();
+        network->setNumInterOpThreads(2);
+        network->init();
+        network->run();
+        EXPECT_EQ(MAI_SUCCESS, network->run());
+        ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    }
+}
+
+namespace {
+
+std::atomic<bool> gFailGraphOp(false);
+
+// Shapes its output like NEG in the first run, fails once gFailGraphOp is set
+class FailingGraphOp : public Operator {
+public:
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        if (gFailGraphOp.load()) {
+            return MAI_FAILED;
+        }
+        getOutputTensor(0)->resize(getInputTensor(0)->shape());
+        return MAI_SUCCESS;
+    }
+};
+
+} // namespace
+
+TEST_F(GraphTest, FailedOperatorFailsRun) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(NEG).setDataType(DT_FLOAT)
+                    .setExtraInfo("graph_fail_test").build()),
+                FailingGraphOp);
+    }
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"x1"})
+            .setExtra("graph_fail_test")
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"y1"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(ADD)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"x1", "y1"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1, 2, 2, 2}, {0,2,3,4,-7,0,-8,-100})
+        .addTensor<float>("x1", {}, {})
+        .addTensor<float>("y1", {}, {})
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->setNumInterOpThreads(2);
+    network->init();
+    gFailGraphOp.store(false);
+    EXPECT_EQ(MAI_SUCCESS, network->run());
+    EXPECT_EQ(MAI_SUCCESS, network->run());
+    // later runs go through the graph
+    gFailGraphOp.store(true);
+    for (int32 i = 0; i < 5; ++i) {
+        EXPECT_EQ(MAI_FAILED, network->run());
+    }
+    gFailGraphOp.store(false);
+    EXPECT_EQ(MAI_SUCCESS, network->run());
+}
+
+} // namespace Test
+} // namespace MAI
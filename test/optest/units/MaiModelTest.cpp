@@ -0,0 +1,198 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include "core/OperatorTest.h"
+#include "source/core/MaiModel.h"
+
+namespace MAI {
+namespace Test {
+
+class MaiModelTest : public OperatorTest {
+};
+
+static std::unique_ptr<NeuralNetwork> buildNetwork() {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddings = {0,0,0,0};
+    param->paddingMode = PADDING_SAME;
+    param->group = 1;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv"})
+            .setParam(param)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv", {}, {})
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {2,2,4,1});
+    network->addModelOutput("output");
+    return network;
+}
+
+static void fillInput(NeuralNetwork* network) {
+    Tensor* input = network->getTensor("input");
+    for (uint64 i = 0; i < input->elementSize(); ++i) {
+        input->mutableData<float>()[i] = static_cast<float>(i) - 7.f;
+    }
+}
+
+TEST_F(MaiModelTest, WriteAndLoad) {
+    const std::string path = "MaiModelTest.mai";
+    std::unique_ptr<NeuralNetwork> network = buildNetwork();
+    network->getTensor("filter")->setConst(true);
+    ASSERT_EQ(MAI_SUCCESS, MaiModelWriter::write(network.get(), path));
+    network->init();
+    fillInput(network.get());
+    network->run();
+
+    std::unique_ptr<NeuralNetwork> loaded = NeuralNetwork::getNeuralNetwork(NeuralNetwork::MAI, path);
+    remove(path.c_str());// the mapping stays valid
+    ASSERT_TRUE(loaded != NULL);
+    EXPECT_EQ(network->getModelInputs(), loaded->getModelInputs());
+    EXPECT_EQ(network->getModelOutputs(), loaded->getModelOutputs());
+    EXPECT_EQ(network->getOperatorNames(), loaded->getOperatorNames());
+
+    Tensor* filter = loaded->getTensor("filter");
+    ASSERT_TRUE(filter != NULL);
+    EXPECT_TRUE(filter->isConst());
+    EXPECT_EQ(HWIO, filter->getDataFormat());
+    EXPECT_EQ(network->getTensor("filter")->shape(), filter->shape());
+    // points into the mapped file
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(filter->data<float>()) % kMaiModelAlignment);
+    ExpectTensorEQ<float, float>(filter, network->getTensor("filter"));
+
+    const Conv2DParam* param = reinterpret_cast<const Conv2DParam*>(
+            loaded->getOperator(loaded->getOperatorNames()[0])->paramPrototype());
+    ASSERT_TRUE(param != NULL);
+    EXPECT_EQ(PADDING_SAME, param->paddingMode);
+    EXPECT_EQ(std::vector<int32>({1,1,1,1}), param->strides);
+    EXPECT_EQ(1, param->group);
+
+    loaded->init();
+    fillInput(loaded.get());
+    loaded->run();
+    ExpectTensorEQ<float, float>(loaded->getTensor("output"), network->getTensor("output"));
+}
+
+TEST_F(MaiModelTest, WriteOptimizedNetwork) {
+    const std::string path = "MaiModelTest.mai";
+    Conv2DParam* convParam = new Conv2DParam();
+    convParam->dilations = {1,1,1,1};
+    convParam->strides = {1,1,1,1};
+    convParam->paddingMode = PADDING_VALID;
+    convParam->group = 1;
+    FusedBatchNormParam* fusedParam = new FusedBatchNormParam();
+    fusedParam->epsilon = 0.001f;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setName("conv2d")
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv_output"})
+            .setParam(convParam)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setName("fused_batch_norm")
+            .setType(FUSED_BATCH_NORM)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv_output", "scale", "offset", "mean", "var"})
+            .setOutputNames({"fused_output"})
+            .setParam(fusedParam)
+            .build())
+        .addTensor<float>("input", {2,2,4,1}, {1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16})
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv_output", {}, {})
+        .addTensor<float>("scale", {3}, {0.5f,0.4f,0.3f})
+        .addTensor<float>("offset", {3}, {0.1f,0.2f,0.3f})
+        .addTensor<float>("mean", {3}, {0.5f,0.4f,0.3f})
+        .addTensor<float>("var", {3}, {0.3f,0.4f,0.5f})
+        .addTensor<float>("fused_output", {}, {})
+        .addTensor<float>("check", {2,1,3,3}, {
+                -4.00109,1.2106664,3.5635715,-2.1783848,1.2106658,3.5635715,-0.35567856,1.2106664, 3.5635715,
+                10.580563,1.2106658,3.5635715,12.403265,1.2106668,3.5635715,14.225976,1.2106664,3.5635715})
+        .build();
+    network->addModelOutput("fused_output");
+    network->addOptimizer(NeuralNetwork::FOLD_BN_INTO_CONV2D);
+    network->startOptimize();
+    ASSERT_EQ(MAI_SUCCESS, MaiModelWriter::write(network.get(), path));
+
+    std::unique_ptr<NeuralNetwork> loaded = NeuralNetwork::getNeuralNetwork(NeuralNetwork::MAI, path);
+    remove(path.c_str());
+    ASSERT_TRUE(loaded != NULL);
+    // batch norm is folded into the filter and bias, its other inputs are gone
+    EXPECT_EQ(1, loaded->getOperatorNames().size());
+    EXPECT_TRUE(loaded->getTensor("scale") == NULL);
+    EXPECT_TRUE(loaded->getTensor("check") == NULL);
+    loaded->init();
+    loaded->run();
+    // check is rounded as the reference conv2d sums
+    ExpectTensorNear<float>(loaded->getTensor("fused_output"), network->getTensor("check"), 1e-5f);
+}
+
+TEST_F(MaiModelTest, RejectsCorruptedFile) {
+    const std::string path = "MaiModelTest.mai";
+    std::unique_ptr<NeuralNetwork> network = buildNetwork();
+    ASSERT_EQ(MAI_SUCCESS, MaiModelWriter::write(network.get(), path));
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.write("NOTMAI", 6);
+    }
+    EXPECT_TRUE(NeuralNetwork::getNeuralNetwork(NeuralNetwork::MAI, path) == NULL);
+    remove(path.c_str());
+    EXPECT_TRUE(NeuralNetwork::getNeuralNetwork(NeuralNetwork::MAI, path) == NULL);
+
+    // opType, dataType, deviceType and extraInfo("") of the Relu operator
+    std::string bytes;
+    ASSERT_EQ(MAI_SUCCESS, MaiModelWriter::write(network.get(), bytes));
+    const int32 relu[4] = {RELU, DT_FLOAT, DEVICE_CPU, 0};
+    const std::string reluBytes(reinterpret_cast<const char*>(relu), sizeof(relu));
+    const size_t reluOffset = bytes.find(reluBytes);
+    ASSERT_NE(std::string::npos, reluOffset);
+    ASSERT_EQ(std::string::npos, bytes.find(reluBytes, reluOffset + 1));
+    const int32 badFields[][2] = {
+        {0, 100000},// unknown operator type
+        {0, -1},
+        {1, 12345},// unknown data type
+        {2, 99},// unknown device type
+    };
+    for (const auto& badField : badFields) {
+        std::string corrupted = bytes;
+        memcpy(&corrupted[reluOffset + badField[0] * sizeof(int32)], &badField[1], sizeof(int32));
+        {
+            std::ofstream file(path, std::ios::binary);
+            file.write(corrupted.data(), corrupted.size());
+        }
+        EXPECT_TRUE(NeuralNetwork::getNeuralNetwork(NeuralNetwork::MAI, path) == NULL)
+            << "field " << badField[0] << " is " << badField[1];
+        remove(path.c_str());
+    }
+}
+
+} // namespace Test
+} // namespace MAI
@@ -0,0 +1,121 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/OperatorTest.h"
+
+namespace MAI {
+namespace Test {
+
+class MemoryPlannerTest : public OperatorTest {
+};
+
+TEST_F(MemoryPlannerTest, ChainReuseBuffer) {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"t1"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"t1"})
+            .setOutputNames({"t2"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"t2"})
+            .setOutputNames({"t3"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"t3"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1, 2, 2, 2}, {0,2,3,4,-7,0,-8,-100})
+        .addTensor<float>("t1", {}, {})
+        .addTensor<float>("t2", {}, {})
+        .addTensor<float>("t3", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {1, 2, 2, 2}, {0,2,3,4,0,0,0,0})
+        .addTensor<float>("check2", {1, 2, 2, 2}, {0,0,0,0,7,1,8,100})
+        .build();
+    network->init();
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    // t1 and t3 share one slot, t2 and output share the other one
+    EXPECT_EQ(4 * 64, network->getNaiveMemorySize());
+    EXPECT_EQ(2 * 64, network->getPlannedMemorySize());
+
+    std::vector<float> input = {-1,-2,-3,-4,7,1,8,100};
+    network->getTensor("input")->copy(input.data(), input.size() * sizeof(float));
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check2"));
+}
+
+TEST_F(MemoryPlannerTest, OutputWrittenOnceKeepsBuffer) {
+    // Shape writes s in the first run only, n1 must not reuse its memory
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(SHAPE)
+            .setDataType(DT_INT32)
+            .setInputNames({"input"})
+            .setOutputNames({"s"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(ADD)
+            .setDataType(DT_INT32)
+            .setInputNames({"s", "s"})
+            .setOutputNames({"t"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"n1"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"n1"})
+            .setOutputNames({"n2"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"n2"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1, 2, 2, 1}, {1, -2, 3, -4})
+        .addTensor<int32>("s", {}, {})
+        .addTensor<int32>("t", {}, {})
+        .addTensor<float>("n1", {}, {})
+        .addTensor<float>("n2", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<int32>("checkT", {4}, {2, 4, 4, 2})
+        .addTensor<float>("check", {1, 2, 2, 1}, {-1, 2, -3, 4})
+        .build();
+    network->init();
+    for (int32 i = 0; i < 3; ++i) {
+        network->run();
+        ExpectTensorEQ<int32, int32>(network->getTensor("t"), network->getTensor("checkT"));
+        ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    }
+}
+
+} // namespace Test
+} // namespace MAI
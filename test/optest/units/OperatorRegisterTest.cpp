@@ -0,0 +1,131 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "core/OperatorTest.h"
+#include "source/core/CpuFeatures.h"
+#include "source/core/OperatorRegister.h"
+#include "source/ops/cpu/Sgemm.h"
+
+namespace MAI {
+namespace Test {
+
+class OperatorRegisterTest : public OperatorTest {
+protected:
+    void TearDown() override {
+        setCpuFeatureMask(~0u);
+    }
+};
+
+namespace {
+
+class DispatchTestOp : public Operator {
+public:
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        return MAI_SUCCESS;
+    }
+};
+
+using Op::CPU::kSgemmAvx2;
+using Op::CPU::kSgemmAvx512;
+
+void registerDispatchTestOps() {
+    static bool registered = false;
+    if (registered) {
+        return;
+    }
+    registered = true;
+    for (uint32 cpuFeatures : Op::CPU::sgemmCpuFeatureLevels()) {
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(GEMM).setExtraInfo("dispatch_test")
+                    .setCpuFeatures(cpuFeatures).build()), DispatchTestOp);
+    }
+}
+
+uint32 createdCpuFeatures(const std::string& extraInfo = "dispatch_test") {
+    return OperatorRegister::getInstance()->createOperator(OpContextBuilder()
+            .setOperatorType(GEMM)
+            .setDataType(DT_FLOAT)
+            .setExtraInfo(extraInfo)
+            .build())->opContext().cpuFeatures;
+}
+
+bool hasSgemmLevel(uint32 cpuFeatures) {
+    std::vector<uint32> levels = Op::CPU::sgemmCpuFeatureLevels();
+    return std::find(levels.begin(), levels.end(), cpuFeatures) != levels.end();
+}
+
+uint32 widestSgemmLevel() {
+    if (hasSgemmLevel(kSgemmAvx512) && cpuSupports(kSgemmAvx512)) {
+        return kSgemmAvx512;
+    }
+    if (hasSgemmLevel(kSgemmAvx2) && cpuSupports(kSgemmAvx2)) {
+        return kSgemmAvx2;
+    }
+    return 0;
+}
+
+} // namespace
+
+TEST_F(OperatorRegisterTest, CpuFeatureMask) {
+    const uint32 detected = cpuFeatures();
+    setCpuFeatureMask(CPU_FEATURE_AVX2);
+    EXPECT_EQ(detected & CPU_FEATURE_AVX2, cpuFeatures());
+    EXPECT_TRUE(cpuSupports(0));
+    EXPECT_FALSE(cpuSupports(CPU_FEATURE_FMA));
+    setCpuFeatureMask(~0u);
+    EXPECT_EQ(detected, cpuFeatures());
+}
+
+TEST_F(OperatorRegisterTest, PicksWidestSupportedVariant) {
+    registerDispatchTestOps();
+    const uint32 expected = widestSgemmLevel();
+    EXPECT_EQ(expected, createdCpuFeatures());
+    // The real sgemm based GEMM the same way
+    EXPECT_EQ(expected, createdCpuFeatures(""));
+
+    setCpuFeatureMask(kSgemmAvx2);
+    EXPECT_EQ(widestSgemmLevel(), createdCpuFeatures());
+    EXPECT_EQ(widestSgemmLevel(), createdCpuFeatures(""));
+
+    setCpuFeatureMask(0);
+    EXPECT_EQ(0u, createdCpuFeatures());
+    EXPECT_EQ(0u, createdCpuFeatures(""));
+}
+
+TEST_F(OperatorRegisterTest, PicksAvx512OverAvx2Fma) {
+    if (!hasSgemmLevel(kSgemmAvx512) || !cpuSupports(kSgemmAvx512 | kSgemmAvx2)) {
+        return;
+    }
+    registerDispatchTestOps();
+    // AVX512F alone has fewer feature bits than AVX2|FMA but is the higher ISA
+    EXPECT_EQ(kSgemmAvx512, createdCpuFeatures());
+    EXPECT_EQ(kSgemmAvx512, createdCpuFeatures(""));
+}
+
+TEST_F(OperatorRegisterTest, ExactMatchBeforeWiderCompatible) {
+    registerDispatchTestOps();
+    // Only the portable GEMM "ref" variant matches exactly
+    std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator(
+            OpContextBuilder().setOperatorType(GEMM).setDataType(DT_FLOAT).setExtraInfo("ref").build());
+    EXPECT_EQ("ref", op->opContext().extraInfo);
+    EXPECT_EQ(0u, op->opContext().cpuFeatures);
+}
+
+} // namespace Test
+} // namespace MAI
@@ -13,11 +13,34 @@
 // limitations under the License.
 
 #include "core/OperatorTest.h"
+#include "source/core/CpuFeatures.h"
+#include "source/ops/cpu/Pooling.h"
 
 namespace MAI {
 namespace Test {
 
 class PoolTest : public OperatorTest {
+protected:
+    static PoolParam* makeParam(int32 kernelH, int32 kernelW, int32 strideH, int32 strideW,
+            PaddingMode paddingMode, DataFormat inputFormat) {
+        PoolParam* param = new PoolParam();
+        param->kernelSizes = inputFormat == NHWC
+            ? std::vector<int32>({1,kernelH,kernelW,1}) : std::vector<int32>({1,1,kernelH,kernelW});
+        param->strides = inputFormat == NHWC
+            ? std::vector<int32>({1,strideH,strideW,1}) : std::vector<int32>({1,1,strideH,strideW});
+        param->paddingMode = paddingMode;
+        return param;
+    }
+
+    // The default variant against the reference one on the same input
+    static void checkWithRef(MAIOperator op, PoolParam* param,
+            const std::vector<shape_t>& inputShape, DataFormat inputFormat,
+            int32 numThreads = 1) {
+        NetworkBuilder builder;
+        builder.addTensor<float>("input", inputShape,
+                makeData(inputShape[0] * inputShape[1] * inputShape[2] * inputShape[3]), inputFormat);
+        ExpectNearRef(builder, op, param, {"input"}, inputFormat, "", 1e-5f, numThreads);
+    }
 };
 
 template<class T>
@@ -87,5 +110,67 @@ TEST_F(PoolTest, globalAveragePoolNCHW) {
             {1,2,1,1}, {5, 14}, NCHW);
 }
 
+TEST_F(PoolTest, maxPool2x2Stride2MatchesRef_NHWC) {
+    checkWithRef(MAX_POOL, makeParam(2, 2, 2, 2, PADDING_SAME, NHWC), {2,9,11,37}, NHWC);
+}
+
+TEST_F(PoolTest, avgPool3x3Stride2MatchesRef_NHWC) {
+    checkWithRef(AVG_POOL, makeParam(3, 3, 2, 2, PADDING_SAME, NHWC), {1,10,13,21}, NHWC);
+}
+
+TEST_F(PoolTest, maxPool3x3Stride2MatchesRef_NCHW) {
+    checkWithRef(MAX_POOL, makeParam(3, 3, 2, 2, PADDING_SAME, NCHW), {2,3,17,45}, NCHW);
+}
+
+TEST_F(PoolTest, avgPool2x2Stride2MatchesRef_NCHW) {
+    checkWithRef(AVG_POOL, makeParam(2, 2, 2, 2, PADDING_VALID, NCHW), {1,4,9,39}, NCHW);
+}
+
+TEST_F(PoolTest, anyWindowMatchesRef) {
+    checkWithRef(MAX_POOL, makeParam(3, 2, 1, 3, PADDING_SAME, NHWC), {1,7,20,19}, NHWC);
+    checkWithRef(AVG_POOL, makeParam(5, 4, 2, 1, PADDING_VALID, NHWC), {1,11,12,6}, NHWC);
+    checkWithRef(MAX_POOL, makeParam(2, 5, 3, 1, PADDING_SAME, NCHW), {1,2,8,41}, NCHW);
+    checkWithRef(AVG_POOL, makeParam(4, 3, 1, 2, PADDING_SAME, NCHW), {1,3,9,50}, NCHW);
+}
+
+TEST_F(PoolTest, explicitPaddingMatchesRef) {
+    PoolParam* param = makeParam(3, 3, 2, 2, PADDING_INVALID, NCHW);
+    param->paddings = {1,2,0,2};
+    checkWithRef(AVG_POOL, param, {1,2,9,40}, NCHW);
+    param = makeParam(3, 3, 2, 2, PADDING_INVALID, NHWC);
+    param->paddings = {2,0,1,1};
+    checkWithRef(MAX_POOL, param, {1,9,10,20}, NHWC);
+}
+
+TEST_F(PoolTest, windowLargerThanInputMatchesRef) {
+    checkWithRef(AVG_POOL, makeParam(5, 5, 1, 1, PADDING_SAME, NHWC), {1,2,3,5}, NHWC);
+    checkWithRef(MAX_POOL, makeParam(5, 5, 1, 1, PADDING_SAME, NCHW), {1,2,3,3}, NCHW);
+}
+
+TEST_F(PoolTest, globalAvgPoolMatchesRef) {
+    checkWithRef(GLOBAL_AVG_POOL, makeParam(1, 1, 1, 1, PADDING_VALID, NHWC), {2,7,7,150}, NHWC);
+    checkWithRef(GLOBAL_AVG_POOL, makeParam(1, 1, 1, 1, PADDING_VALID, NCHW), {2,5,9,11}, NCHW);
+}
+
+TEST_F(PoolTest, multiThreadMatchesRef) {
+    checkWithRef(MAX_POOL, makeParam(3, 3, 2, 2, PADDING_SAME, NHWC), {2,15,16,24}, NHWC, 4);
+    checkWithRef(AVG_POOL, makeParam(2, 2, 2, 2, PADDING_SAME, NCHW), {2,5,13,30}, NCHW, 4);
+    checkWithRef(GLOBAL_AVG_POOL, makeParam(1, 1, 1, 1, PADDING_VALID, NHWC), {3,4,5,200}, NHWC, 4);
+}
+
+TEST_F(PoolTest, everyCpuFeatureLevel) {
+    for (uint32 level : Op::CPU::poolCpuFeatureLevels()) {
+        if (!cpuSupports(level)) {
+            continue;
+        }
+        setCpuFeatureMask(level);
+        checkWithRef(MAX_POOL, makeParam(2, 2, 2, 2, PADDING_SAME, NHWC), {1,7,9,35}, NHWC);
+        checkWithRef(AVG_POOL, makeParam(3, 3, 2, 2, PADDING_SAME, NCHW), {1,3,9,45}, NCHW);
+        checkWithRef(MAX_POOL, makeParam(3, 2, 1, 2, PADDING_SAME, NCHW), {1,2,6,39}, NCHW);
+        checkWithRef(GLOBAL_AVG_POOL, makeParam(1, 1, 1, 1, PADDING_VALID, NHWC), {1,3,3,99}, NHWC);
+        setCpuFeatureMask(~0u);
+    }
+}
+
 } // namespace Test
 } // namespace MAI
@@ -0,0 +1,101 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/OperatorTest.h"
+
+namespace MAI {
+namespace Test {
+
+class ResizeInputsTest : public OperatorTest {
+};
+
+// input -> CONV2D(SAME) -> conv -> RELU -> relu -> AVG_POOL(2x2, VALID) -> output
+static std::unique_ptr<NeuralNetwork> buildNetwork(const std::vector<shape_t>& inputShape) {
+    Conv2DParam* convParam = new Conv2DParam();
+    convParam->dilations = {1,1,1,1};
+    convParam->strides = {1,1,1,1};
+    convParam->paddingMode = PADDING_SAME;
+    convParam->group = 1;
+    PoolParam* poolParam = new PoolParam();
+    poolParam->kernelSizes = {1,2,2,1};
+    poolParam->strides = {1,1,1,1};
+    poolParam->paddingMode = PADDING_VALID;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv"})
+            .setParam(convParam)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv"})
+            .setOutputNames({"relu"})
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(AVG_POOL)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"relu"})
+            .setOutputNames({"output"})
+            .setParam(poolParam)
+            .build())
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv", {}, {})
+        .addTensor<float>("relu", {}, {})
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, inputShape);
+    network->addModelOutput("output");
+    network->init();
+    return network;
+}
+
+static void fillInput(NeuralNetwork* network) {
+    Tensor* input = network->getTensor("input");
+    float* data = input->mutableData<float>();
+    for (uint64 i = 0; i < input->elementSize(); ++i) {
+        data[i] = static_cast<float>(i % 7) - 3.f;
+    }
+}
+
+static void runAndCompare(NeuralNetwork* network, const std::vector<shape_t>& inputShape) {
+    network->resizeInputs({{"input", inputShape}});
+    fillInput(network);
+    network->run();
+
+    std::unique_ptr<NeuralNetwork> expected = buildNetwork(inputShape);
+    fillInput(expected.get());
+    expected->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), expected->getTensor("output"));
+}
+
+TEST_F(ResizeInputsTest, ResizeBatchAndResolution) {
+    std::unique_ptr<NeuralNetwork> network = buildNetwork({1,4,4,1});
+    fillInput(network.get());
+    network->run();
+    const uint64 plannedSize = network->getPlannedMemorySize();
+
+    runAndCompare(network.get(), {2,4,4,1});
+    runAndCompare(network.get(), {1,7,5,1});
+    runAndCompare(network.get(), {1,3,3,1});
+    // the plan of a resolution used before is reused
+    runAndCompare(network.get(), {1,4,4,1});
+    EXPECT_EQ(plannedSize, network->getPlannedMemorySize());
+    runAndCompare(network.get(), {2,4,4,1});
+}
+
+} // namespace Test
+} // namespace MAI
@@ -0,0 +1,193 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include "core/OperatorTest.h"
+#include "source/core/OperatorRegister.h"
+
+namespace MAI {
+namespace Test {
+
+class RunAsyncTest : public OperatorTest {
+};
+
+static std::unique_ptr<NeuralNetwork> buildConvRelu(int32 interOpThreads) {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv"})
+            .setParam(param)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {2,1,3,3}, {
+                    0,2,8,0,2,8,0,2,8,
+                    12,2,8,14,2,8,16,2,8,
+                })
+        .addTensor<float>("check_neg", {2,1,3,3}, {
+                    4,0,0,2,0,0,0,0,0,
+                    0,0,0,0,0,0,0,0,0,
+                })
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {2,2,4,1});
+    network->addModelOutput("output");
+    network->setNumInterOpThreads(interOpThreads);
+    network->init();
+    return network;
+}
+
+static void setInput(NeuralNetwork* network, float sign) {
+    std::vector<float> input(16);
+    for (int32 i = 0; i < 16; ++i) {
+        input[i] = sign * (i + 1);
+    }
+    network->getTensor("input")->copy(input.data(), input.size() * sizeof(float));
+}
+
+TEST_F(RunAsyncTest, Future) {
+    for (int32 threads = 1; threads <= 2; ++threads) {
+        std::unique_ptr<NeuralNetwork> network = buildConvRelu(threads);
+        setInput(network.get(), 1.f);
+        // the first run goes in order, later ones run the graph
+        for (int32 i = 0; i < 3; ++i) {
+            EXPECT_EQ(MAI_SUCCESS, network->runAsync().get());
+            ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+        }
+    }
+}
+
+TEST_F(RunAsyncTest, CallbackStartsNextRun) {
+    std::unique_ptr<NeuralNetwork> network = buildConvRelu(2);
+    setInput(network.get(), 1.f);
+    network->run();
+    const int32 kRuns = 10;
+    std::atomic<int32> runs(0);
+    std::promise<void> done;
+    NeuralNetwork::RunCallback callback = [&](MAI_STATUS status) {
+        EXPECT_EQ(MAI_SUCCESS, status);
+        if (++runs == kRuns) {
+            done.set_value();
+        } else {
+            network->runAsync(callback);
+        }
+    };
+    network->runAsync(callback);
+    done.get_future().wait();
+    EXPECT_EQ(kRuns, runs.load());
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+}
+
+TEST_F(RunAsyncTest, PipelineSessions) {
+    std::unique_ptr<NeuralNetwork> network = buildConvRelu(2);
+    std::unique_ptr<NeuralNetwork> sessions[2] = {network->createSession(), network->createSession()};
+    const float signs[2] = {1.f, -1.f};
+    const char* checks[2] = {"check", "check_neg"};
+    for (int32 i = 0; i < 2; ++i) {
+        setInput(sessions[i].get(), signs[i]);
+    }
+    for (int32 round = 0; round < 20; ++round) {
+        // both requests are in flight on the shared inter-op threads
+        std::future<MAI_STATUS> futures[2] = {sessions[0]->runAsync(), sessions[1]->runAsync()};
+        for (int32 i = 0; i < 2; ++i) {
+            EXPECT_EQ(MAI_SUCCESS, futures[i].get());
+            ExpectTensorEQ<float, float>(sessions[i]->getTensor("output"), sessions[i]->getTensor(checks[i]));
+        }
+    }
+}
+
+TEST_F(RunAsyncTest, DestroyRightAfterFuture) {
+    // the last operator must not touch the network once the future is ready
+    for (int32 i = 0; i < 200; ++i) {
+        std::unique_ptr<NeuralNetwork> network = buildConvRelu(2);
+        setInput(network.get(), 1.f);
+        network->run();
+        EXPECT_EQ(MAI_SUCCESS, network->runAsync().get());
+    }
+}
+
+namespace {
+
+std::atomic<bool> gFailAsyncOp(false);
+
+// Shapes its output like NEG in the first run, fails once gFailAsyncOp is set
+class FailingAsyncOp : public Operator {
+public:
+    MAI_STATUS init() override {
+        return MAI_SUCCESS;
+    }
+
+    MAI_STATUS run() override {
+        if (gFailAsyncOp.load()) {
+            return MAI_FAILED;
+        }
+        getOutputTensor(0)->resize(getInputTensor(0)->shape());
+        return MAI_SUCCESS;
+    }
+};
+
+} // namespace
+
+TEST_F(RunAsyncTest, FailedGraphRunFailsCallback) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        MAI_REGISTER_OP((OpContextBuilder().setOperatorType(NEG).setDataType(DT_FLOAT)
+                    .setExtraInfo("async_fail_test").build()),
+                FailingAsyncOp);
+    }
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"x1"})
+            .setExtra("async_fail_test")
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"x1"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1, 2, 2, 2}, {0,2,3,4,-7,0,-8,-100})
+        .addTensor<float>("x1", {}, {})
+        .addTensor<float>("output", {}, {})
+        .build();
+    network->setNumInterOpThreads(2);
+    network->init();
+    gFailAsyncOp.store(false);
+    EXPECT_EQ(MAI_SUCCESS, network->runAsync().get());
+    // later runs go through the graph
+    gFailAsyncOp.store(true);
+    EXPECT_EQ(MAI_FAILED, network->runAsync().get());
+    gFailAsyncOp.store(false);
+    EXPECT_EQ(MAI_SUCCESS, network->runAsync().get());
+}
+
+} // namespace Test
+} // namespace MAI
@@ -0,0 +1,159 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include "core/OperatorTest.h"
+#include "source/core/ConstantCache.h"
+
+namespace MAI {
+namespace Test {
+
+class SessionTest : public OperatorTest {
+};
+
+static std::unique_ptr<NeuralNetwork> buildConvRelu() {
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 1;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(CONV2D)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"conv"})
+            .setParam(param)
+            .build())
+        .addOperator(OperatorBuilder()
+            .setType(RELU)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"conv"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("filter", {2,2,1,3}, {1,-1,-1,2,1,-1,3,-1,1,-4,1,1}, HWIO)
+        .addTensor<float>("conv", {}, {})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {2,1,3,3}, {
+                    0,2,8,0,2,8,0,2,8,
+                    12,2,8,14,2,8,16,2,8,
+                })
+        .addTensor<float>("check_neg", {2,1,3,3}, {
+                    4,0,0,2,0,0,0,0,0,
+                    0,0,0,0,0,0,0,0,0,
+                })
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {2,2,4,1});
+    network->addModelOutput("output");
+    return network;
+}
+
+static void setInput(NeuralNetwork* network, float sign) {
+    std::vector<float> input(16);
+    for (int32 i = 0; i < 16; ++i) {
+        input[i] = sign * (i + 1);
+    }
+    network->getTensor("input")->copy(input.data(), input.size() * sizeof(float));
+}
+
+TEST_F(SessionTest, ShareConstTensors) {
+    std::unique_ptr<NeuralNetwork> network = buildConvRelu();
+    network->init();
+    setInput(network.get(), 1.f);
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+
+    std::unique_ptr<NeuralNetwork> session = network->createSession();
+    EXPECT_EQ(network->getTensor("filter")->buffer(), session->getTensor("filter")->buffer());
+    EXPECT_NE(network->getTensor("input")->buffer(), session->getTensor("input")->buffer());
+    setInput(session.get(), -1.f);
+    session->run();
+    ExpectTensorEQ<float, float>(session->getTensor("output"), session->getTensor("check_neg"));
+    EXPECT_NE(network->getTensor("output")->buffer(), session->getTensor("output")->buffer());
+
+    // the network itself is not changed by its session
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+}
+
+TEST_F(SessionTest, ConcurrentSessions) {
+    std::unique_ptr<NeuralNetwork> network = buildConvRelu();
+    network->init();
+    std::unique_ptr<NeuralNetwork> sessions[2] = {network->createSession(), network->createSession()};
+    const float signs[2] = {1.f, -1.f};
+    const char* checks[2] = {"check", "check_neg"};
+    std::thread threads[2];
+    for (int32 i = 0; i < 2; ++i) {
+        NeuralNetwork* session = sessions[i].get();
+        const float sign = signs[i];
+        threads[i] = std::thread([session, sign]() {
+            setInput(session, sign);
+            for (int32 j = 0; j < 20; ++j) {
+                session->run();
+            }
+        });
+    }
+    for (int32 i = 0; i < 2; ++i) {
+        threads[i].join();
+        ExpectTensorEQ<float, float>(sessions[i]->getTensor("output"), sessions[i]->getTensor(checks[i]));
+    }
+}
+
+TEST_F(SessionTest, ShareDerivedConstants) {
+    // a grouped Conv2D packs its filter in the first run
+    Conv2DParam* param = new Conv2DParam();
+    param->dilations = {1,1,1,1};
+    param->strides = {1,1,1,1};
+    param->paddingMode = PADDING_VALID;
+    param->group = 2;
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(CONV2D)
+            .setName("grouped_conv")
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input", "filter"})
+            .setOutputNames({"output"})
+            .setParam(param)
+            .build())
+        .addTensor<float>("filter", {1,1,1,2}, {2,-3}, HWIO)
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {1,2,2,2}, {2,-6,6,-12,10,-18,14,-24})
+        .build();
+    network->addModelInput("input", DT_FLOAT, NHWC, {1,2,2,2});
+    network->addModelOutput("output");
+    network->init();
+    const std::vector<float> input = {1,2,3,4,5,6,7,8};
+    network->getTensor("input")->copy(input.data(), input.size() * sizeof(float));
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+    ConstantCache* cache = network->getConstantCache();
+    ASSERT_TRUE(cache != NULL);
+    const uint8* packed = cache->find("grouped_conv:grouped");
+    ASSERT_TRUE(packed != NULL);
+
+    std::unique_ptr<NeuralNetwork> sessions[2] = {network->createSession(), network->createSession()};
+    for (int32 i = 0; i < 2; ++i) {
+        // the sessions run on the packed filter of the network
+        EXPECT_EQ(cache, sessions[i]->getConstantCache());
+        sessions[i]->getTensor("input")->copy(input.data(), input.size() * sizeof(float));
+        sessions[i]->run();
+        ExpectTensorEQ<float, float>(sessions[i]->getTensor("output"), sessions[i]->getTensor("check"));
+        EXPECT_EQ(packed, cache->find("grouped_conv:grouped"));
+    }
+    // nothing is left to save for a cache in memory
+    EXPECT_FALSE(cache->isDirty());
+}
+
+} // namespace Test
+} // namespace MAI
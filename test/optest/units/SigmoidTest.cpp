@@ -39,5 +39,25 @@ TEST_F(SigmoidTest, SigmoidBasic) {
     ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
 }
 
+TEST_F(SigmoidTest, SigmoidFast) {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setType(SIGMOID)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"output"})
+            .setExtra("fast")
+            .build())
+        .addTensor<float>("input", {1, 3, 3, 1}, {-9,-5.5f,-3,-0.5f,0,1.25,3,7,8})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {1, 3, 3, 1}, {0.00012339458, 0.00407013763, 0.047425866, 0.37754071,
+                0.5, 0.77729988, 0.95257413, 0.999089, 0.99966466})
+        .build();
+    network->init();
+    network->run();
+
+    ExpectTensorNear<float>(network->getTensor("output"), network->getTensor("check"), 3e-6);
+}
+
 } // namespace Test
 } // namespace MAI
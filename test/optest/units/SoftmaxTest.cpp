@@ -12,12 +12,86 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
 #include "core/OperatorTest.h"
+#include "source/core/CpuFeatures.h"
+#include "source/ops/cpu/VectorMath.h"
 
 namespace MAI {
 namespace Test {
 
 class SoftmaxTest : public OperatorTest {
+protected:
+    // Softmax(or log softmax) of a made up tensor along axis against a
+    // double precision reference
+    static void checkAxis(MAIOperator op, const std::vector<shape_t>& shape, int32 axis,
+            float beta = 1.f, int numThreads = 1) {
+        shape_t size = 1;
+        for (shape_t dim : shape) {
+            size *= dim;
+        }
+        std::vector<float> input(size);
+        for (shape_t i = 0; i < size; ++i) {
+            input[i] = ((i * 37) % 101) * 0.125f - 6.f;
+        }
+        SoftmaxParam* param = new SoftmaxParam();
+        param->axis = axis;
+        param->beta = beta;
+        std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+            .addOperator(OperatorBuilder()
+                .setType(op)
+                .setDataType(DT_FLOAT)
+                .setInputNames({"input"})
+                .setOutputNames({"output"})
+                .setParam(param)
+                .build())
+            .addTensor<float>("input", shape, input)
+            .addTensor<float>("output", {}, {})
+            .addTensor<float>("check", shape, std::vector<float>(size))
+            .build();
+        network->setNumThreads(numThreads);
+        network->init();
+        network->run();
+
+        const int32 rank = static_cast<int32>(shape.size());
+        const int32 dim = axis < 0 ? axis + rank : axis;
+        shape_t outer = 1;
+        shape_t inner = 1;
+        for (int32 i = 0; i < dim; ++i) {
+            outer *= shape[i];
+        }
+        for (int32 i = dim + 1; i < rank; ++i) {
+            inner *= shape[i];
+        }
+        float* check = network->getTensor("check")->mutableData<float>();
+        for (shape_t o = 0; o < outer; ++o) {
+            for (shape_t j = 0; j < inner; ++j) {
+                const shape_t offset = o * shape[dim] * inner + j;
+                double max = -INFINITY;
+                for (shape_t k = 0; k < shape[dim]; ++k) {
+                    max = std::max(max, static_cast<double>(input[offset + k * inner]) * beta);
+                }
+                double sum = 0;
+                for (shape_t k = 0; k < shape[dim]; ++k) {
+                    sum += std::exp(input[offset + k * inner] * static_cast<double>(beta) - max);
+                }
+                for (shape_t k = 0; k < shape[dim]; ++k) {
+                    const double x = input[offset + k * inner] * static_cast<double>(beta) - max;
+                    check[offset + k * inner] = op == LOG_SOFTMAX ? x - std::log(sum) : std::exp(x) / sum;
+                }
+            }
+        }
+        ExpectTensorNear<float>(network->getTensor("output"), network->getTensor("check"),
+                op == LOG_SOFTMAX ? 1e-5f : 1e-6f);
+    }
+
+    static void checkAxes(MAIOperator op, int numThreads = 1) {
+        checkAxis(op, {2, 21, 9, 7}, 1, 1.f, numThreads);// NCHW channels
+        checkAxis(op, {2, 9, 7, 21}, -1, 1.f, numThreads);// NHWC channels
+        checkAxis(op, {3, 4, 5, 6, 7}, 2, 0.5f, numThreads);
+        checkAxis(op, {37, 3}, 0, 2.f, numThreads);
+        checkAxis(op, {1000}, 0, 1.f, numThreads);
+    }
 };
 
 TEST_F(SoftmaxTest, Softmax1DWithDefaultParam) {
@@ -79,7 +153,7 @@ TEST_F(SoftmaxTest, Softmax2DWithDefaultParam) {
     ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
 }
 
-TEST_F(SoftmaxTest, DISABLED_Softmax2DWithAxis0) {
+TEST_F(SoftmaxTest, Softmax2DWithAxis0) {
     SoftmaxParam* param = new SoftmaxParam();
     param->axis = 0;
     param->beta = 1.f;
@@ -124,5 +198,32 @@ TEST_F(SoftmaxTest, Softmax2DWithAxis1) {
 
     ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
 }
+
+TEST_F(SoftmaxTest, SoftmaxAnyAxis) {
+    checkAxes(SOFTMAX);
+}
+
+TEST_F(SoftmaxTest, LogSoftmaxAnyAxis) {
+    checkAxes(LOG_SOFTMAX);
+}
+
+TEST_F(SoftmaxTest, everyCpuFeatureLevel) {
+    for (uint32 level : Op::CPU::vectorMathCpuFeatureLevels()) {
+        if (!cpuSupports(level)) {
+            continue;
+        }
+        setCpuFeatureMask(level);
+        checkAxes(SOFTMAX);
+        checkAxes(LOG_SOFTMAX);
+        setCpuFeatureMask(~0u);
+    }
+}
+
+TEST_F(SoftmaxTest, multiThread) {
+    checkAxis(SOFTMAX, {1, 21, 64, 67}, 1, 1.f, 4);// segmentation head, one image
+    checkAxis(SOFTMAX, {1, 64, 67, 21}, 3, 1.f, 4);
+    checkAxis(LOG_SOFTMAX, {7, 3001}, 1, 1.f, 4);
+}
+
 } // namespace Test
 } // namespace MAI
@@ -0,0 +1,95 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/OperatorTest.h"
+
+namespace MAI {
+namespace Test {
+
+class TensorHandleTest : public OperatorTest {
+};
+
+static std::unique_ptr<NeuralNetwork> buildNegNetwork() {
+    std::unique_ptr<NeuralNetwork> network = NetworkBuilder()
+        .addOperator(OperatorBuilder()
+            .setName("neg")
+            .setType(NEG)
+            .setDataType(DT_FLOAT)
+            .setInputNames({"input"})
+            .setOutputNames({"output"})
+            .build())
+        .addTensor<float>("input", {1, 4}, {1, -2, 3, -4})
+        .addTensor<float>("input2", {1, 4}, {5, 6, -7, 8})
+        .addTensor<float>("output", {}, {})
+        .addTensor<float>("check", {1, 4}, {-1, 2, -3, 4})
+        .addTensor<float>("check2", {1, 4}, {-5, -6, 7, -8})
+        .build();
+    network->init();
+    return network;
+}
+
+TEST_F(TensorHandleTest, SlotsResolveThroughHandles) {
+    std::unique_ptr<NeuralNetwork> network = buildNegNetwork();
+    Operator* op = network->getOperator("neg");
+    ASSERT_TRUE(op != NULL);
+    const int32 inputHandle = network->getTensorHandle("input");
+    EXPECT_EQ(inputHandle, network->getTensorHandle("input"));
+    EXPECT_EQ(network->getTensor("input"), network->getTensorByHandle(inputHandle));
+    EXPECT_EQ(network->getTensor("input"), op->getInputTensor(0));
+    EXPECT_EQ(network->getTensor("output"), op->getOutputTensor(0));
+    EXPECT_TRUE(op->getInputTensor(1) == NULL);
+
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
+}
+
+TEST_F(TensorHandleTest, RenamedInputFallsBackToName) {
+    std::unique_ptr<NeuralNetwork> network = buildNegNetwork();
+    Operator* op = network->getOperator("neg");
+    ASSERT_TRUE(op != NULL);
+    op->replaceInputName("input", "input2");
+    EXPECT_EQ(network->getTensor("input2"), op->getInputTensor(0));
+
+    std::unique_ptr<Tensor> renamed(new Tensor(DT_FLOAT, network->getDevice()->allocator()));
+    renamed->setName("output2");
+    network->addTensor(renamed);
+    op->replaceOutputName("output", "output2");
+    EXPECT_EQ(network->getTensor("output2"), op->getOutputTensor(0));
+
+    network->run();
+    ExpectTensorEQ<float, float>(network->getTensor("output2"), network->getTensor("check2"));
+}
+
+TEST_F(TensorHandleTest, RemovedTensorClearsSlot) {
+    std::unique_ptr<NeuralNetwork> network = buildNegNetwork();
+    Operator* op = network->getOperator("neg");
+    ASSERT_TRUE(op != NULL);
+    const int32 outputHandle = network->getTensorHandle("output");
+    ASSERT_TRUE(op->getOutputTensor(0) != NULL);
+
+    network->removeTensor("output");
+    EXPECT_TRUE(network->getTensorByHandle(outputHandle) == NULL);
+    EXPECT_TRUE(op->getOutputTensor(0) == NULL);
+
+    // a tensor added again under the name takes the same handle
+    std::unique_ptr<Tensor> output(new Tensor(DT_FLOAT, network->getDevice()->allocator()));
+    output->setName("output");
+    Tensor* added = output.get();
+    network->addTensor(output);
+    EXPECT_EQ(outputHandle, network->getTensorHandle("output"));
+    EXPECT_EQ(added, op->getOutputTensor(0));
+}
+
+} // namespace Test
+} // namespace MAI
@@ -18,6 +18,25 @@ namespace MAI {
 namespace Test {
 
 class TransposeConv2dTest : public OperatorTest {
+protected:
+    // The default variant against the reference one on the same inputs
+    static void checkWithRef(int32 stride, PaddingMode paddingMode,
+            const std::vector<int32>& outputShape, const std::vector<shape_t>& filterShape,
+            const std::vector<shape_t>& inputShape) {
+        TransposeConv2dParam* param = new TransposeConv2dParam();
+        param->dilations = {1,1,1,1};
+        param->strides = {1,stride,stride,1};
+        param->paddingMode = paddingMode;
+        NetworkBuilder builder;
+        builder.addTensor<int32>("outputShape", {4}, outputShape)
+            .addTensor<float>("filter", filterShape,
+                    makeData(filterShape[0] * filterShape[1] * filterShape[2] * filterShape[3], 2), HWOI)
+            .addTensor<float>("input", inputShape,
+                    makeData(inputShape[0] * inputShape[1] * inputShape[2] * inputShape[3], 1));
+        // the output is zeroed by the kernel, a second run must not accumulate
+        ExpectNearRef(builder, TRANSPOSE_CONV2D, param, {"outputShape", "filter", "input"},
+                NHWC, "", 1e-4f, 1, 2);
+    }
 };
 
 TEST_F(TransposeConv2dTest, floatWithSingleChannelSame_NHWC_OHWI) {
@@ -47,5 +66,23 @@ TEST_F(TransposeConv2dTest, floatWithSingleChannelSame_NHWC_OHWI) {
     ExpectTensorEQ<float, float>(network->getTensor("output"), network->getTensor("check"));
 }
 
+TEST_F(TransposeConv2dTest, GemmMatchesRefStride2Same_NHWC_HWOI) {
+    checkWithRef(2, PADDING_SAME, {2,10,14,6}, {3,3,6,5}, {2,5,7,5});
+}
+
+TEST_F(TransposeConv2dTest, GemmMatchesRefStride2Kernel4_NHWC_HWOI) {
+    checkWithRef(2, PADDING_SAME, {1,12,8,3}, {4,4,3,7}, {1,6,4,7});
+}
+
+// Output larger than the patches reach: rows and columns nothing adds to
+TEST_F(TransposeConv2dTest, GemmMatchesRefValidLargerOutput_NHWC_HWOI) {
+    checkWithRef(3, PADDING_VALID, {1,15,13,4}, {2,2,4,3}, {1,4,3,3});
+}
+
+// More columns than one step holds, the input is processed in row steps
+TEST_F(TransposeConv2dTest, GemmMatchesRefRowSteps_NHWC_HWOI) {
+    checkWithRef(2, PADDING_SAME, {1,64,256,32}, {3,3,32,4}, {1,32,128,4});
+}
+
 } // namespace Test
 } // namespace MAI
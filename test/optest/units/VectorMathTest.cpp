@@ -0,0 +1,175 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include "core/OperatorTest.h"
+#include "source/core/ComputeThreadPool.h"
+#include "source/core/CpuFeatures.h"
+#include "source/ops/cpu/SimdMath.h"
+#include "source/ops/cpu/VectorMath.h"
+
+namespace MAI {
+namespace Test {
+
+using Op::CPU::MathFunction;
+
+class VectorMathTest : public OperatorTest {
+protected:
+    struct Bound {
+        MathFunction function;
+        const char* name;
+        double (*reference)(double);
+        double maxUlp;// 0 if the bound is relative
+        double maxRelative;
+    };
+
+    static double sigmoid(double x) {
+        return 1 / (1 + std::exp(-x));
+    }
+
+    // Every stride-th bit pattern(both signs, subnormals, inf and NaN) plus
+    // a few values worth hitting exactly
+    static std::vector<float> makeInputs(uint64 stride) {
+        std::vector<float> inputs = {0.f, -0.f, 1.f, -1.f, 0.5f, -0.5f, 0.625f, 3.92f,
+            88.7f, 89.5f, -87.5f, -104.f, 8192.f, 8193.f, 1e30f,
+            std::numeric_limits<float>::min(), std::numeric_limits<float>::denorm_min(),
+            std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::quiet_NaN()};
+        for (uint64 bits = 0; bits <= 0xffffffffull; bits += stride) {
+            const uint32 pattern = static_cast<uint32>(bits);
+            float value;
+            memcpy(&value, &pattern, sizeof(value));
+            inputs.push_back(value);
+        }
+        return inputs;
+    }
+
+    // |result - expected| in units in the last place of expected as a float
+    static double ulpError(float result, double expected) {
+        const float rounded = std::fabs(static_cast<float>(expected));
+        const float below = std::nextafter(rounded, 0.f);
+        double ulp = std::nextafter(rounded, std::numeric_limits<float>::infinity()) - rounded;
+        if (below > 0 && rounded - below < ulp) {
+            ulp = rounded - below;
+        }
+        ulp = std::max<double>(ulp, std::numeric_limits<float>::denorm_min());
+        return std::fabs(result - expected) / ulp;
+    }
+
+    static void checkBound(const Bound& bound, const std::vector<float>& inputs,
+            const std::vector<float>& outputs) {
+        const bool trig = bound.function == Op::CPU::MATH_SIN
+            || bound.function == Op::CPU::MATH_COS || bound.function == Op::CPU::MATH_TAN;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const double expected = bound.reference(inputs[i]);
+            const float result = outputs[i];
+            if (std::isnan(expected) || std::isnan(result)) {
+                ASSERT_EQ(std::isnan(expected), std::isnan(result))
+                    << bound.name << "(" << inputs[i] << ") = " << result << ", expected " << expected;
+                continue;
+            }
+            if (std::isinf(static_cast<float>(expected)) || std::isinf(result)) {
+                ASSERT_EQ(static_cast<float>(expected), result) << bound.name << "(" << inputs[i] << ")";
+                continue;
+            }
+            const double error = std::fabs(result - expected);
+            if (trig && error <= 5.9604644775390625E-8) {// 2^-24
+                continue;
+            }
+            if (bound.maxUlp > 0) {
+                ASSERT_LE(ulpError(result, expected), bound.maxUlp)
+                    << bound.name << "(" << inputs[i] << ") = " << result << ", expected " << expected;
+            } else {
+                ASSERT_LE(error, bound.maxRelative * std::max<double>(std::fabs(expected),
+                            std::numeric_limits<float>::min()))
+                    << bound.name << "(" << inputs[i] << ") = " << result << ", expected " << expected;
+            }
+        }
+    }
+
+    static std::vector<Bound> bounds() {
+        return {
+            {Op::CPU::MATH_EXP, "exp", std::exp, 2, 0},
+            {Op::CPU::MATH_EXP_FAST, "expFast", std::exp, 0, 3e-6},
+            {Op::CPU::MATH_LOG, "log", std::log, 2, 0},
+            {Op::CPU::MATH_LOG1P, "log1p", std::log1p, 3, 0},
+            {Op::CPU::MATH_SIN, "sin", std::sin, 2, 0},
+            {Op::CPU::MATH_COS, "cos", std::cos, 2, 0},
+            {Op::CPU::MATH_TAN, "tan", std::tan, 4, 0},
+            {Op::CPU::MATH_ASIN, "asin", std::asin, 3, 0},
+            {Op::CPU::MATH_ACOS, "acos", std::acos, 2, 0},
+            {Op::CPU::MATH_ATAN, "atan", std::atan, 3, 0},
+            {Op::CPU::MATH_SINH, "sinh", std::sinh, 3, 0},
+            {Op::CPU::MATH_COSH, "cosh", std::cosh, 3, 0},
+            {Op::CPU::MATH_TANH, "tanh", std::tanh, 2, 0},
+            {Op::CPU::MATH_TANH_FAST, "tanhFast", std::tanh, 0, 3e-6},
+            {Op::CPU::MATH_ASINH, "asinh", std::asinh, 3, 0},
+            {Op::CPU::MATH_ACOSH, "acosh", std::acosh, 3, 0},
+            {Op::CPU::MATH_ATANH, "atanh", std::atanh, 3, 0},
+            {Op::CPU::MATH_SIGMOID, "sigmoid", sigmoid, 3, 0},
+            {Op::CPU::MATH_SIGMOID_FAST, "sigmoidFast", sigmoid, 0, 3e-6},
+            {Op::CPU::MATH_ERF, "erf", std::erf, 3, 0},
+        };
+    }
+};
+
+TEST_F(VectorMathTest, ErrorBoundsAgainstLibm) {
+    const std::vector<float> inputs = makeInputs(16411);
+    std::vector<float> outputs(inputs.size());
+    for (uint32 level : Op::CPU::vectorMathCpuFeatureLevels()) {
+        if (!cpuSupports(level)) {
+            continue;
+        }
+        for (const Bound& bound : bounds()) {
+            Op::CPU::vectorMath(bound.function, inputs.data(), inputs.size(), outputs.data(), level);
+            checkBound(bound, inputs, outputs);
+        }
+    }
+}
+
+TEST_F(VectorMathTest, SquareRootSpecialValues) {
+    using Op::CPU::Simd::squareRoot;
+    EXPECT_EQ(2.f, squareRoot(4.f));
+    EXPECT_EQ(0.f, squareRoot(0.f));
+    EXPECT_FALSE(std::signbit(squareRoot(0.f)));
+    EXPECT_EQ(0.f, squareRoot(-0.f));
+    EXPECT_TRUE(std::signbit(squareRoot(-0.f)));
+    EXPECT_EQ(std::numeric_limits<float>::infinity(), squareRoot(std::numeric_limits<float>::infinity()));
+    EXPECT_TRUE(std::isnan(squareRoot(-4.f)));
+    EXPECT_TRUE(std::isnan(squareRoot(-std::numeric_limits<float>::infinity())));
+    EXPECT_TRUE(std::isnan(squareRoot(std::numeric_limits<float>::quiet_NaN())));
+}
+
+TEST_F(VectorMathTest, InPlaceAndMultiThreadMatchSingleThread) {
+    const std::vector<float> inputs = makeInputs(40009);
+    std::vector<float> expected(inputs.size());
+    Op::CPU::vectorMath(Op::CPU::MATH_TANH, inputs.data(), inputs.size(), expected.data(), cpuFeatures());
+
+    ComputeThreadPool pool(4);
+    ComputeThreadPool::Scope scope(&pool);
+    std::vector<float> outputs(inputs);
+    Op::CPU::vectorMath(Op::CPU::MATH_TANH, outputs.data(), outputs.size(), outputs.data(), cpuFeatures());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (std::isnan(expected[i])) {
+            EXPECT_TRUE(std::isnan(outputs[i]));
+        } else {
+            EXPECT_EQ(expected[i], outputs[i]) << "at " << i;
+        }
+    }
+}
+
+} // namespace Test
+} // namespace MAI
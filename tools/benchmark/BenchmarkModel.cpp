@@ -10,11 +10,17 @@ void BenchmarkModel::run() {
     run(mCmdParser->get<uint32>("num_runs"), NORMAL_RUN);
 
     mListener.onBenchmarkEnd();
+    printf("Activation memory: naive %llu bytes, planned %llu bytes\n",
+            mNetwork->getNaiveMemorySize(), mNetwork->getPlannedMemorySize());
 }
 
 void BenchmarkModel::init() {
     mNetwork = std::move(NeuralNetwork::getNeuralNetwork(strToFormat(mCmdParser->get<std::string>("model_format")),
                 mCmdParser->get<std::string>("model_path")));
+    if (mCmdParser->get<uint32>("num_threads") > 0) {
+        mNetwork->setNumThreads(mCmdParser->get<uint32>("num_threads"));
+    }
+    mNetwork->setNumInterOpThreads(mCmdParser->get<uint32>("inter_op_threads"));
     mNetwork->init();
     mNetwork->setProfiler(&mProfiler);
 }
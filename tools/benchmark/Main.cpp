@@ -24,6 +24,8 @@ namespace Benchmark {
            .add("help", 'h', "Help Info")
            .add<uint32>("num_runs", "Loop run times", false, 50)
            .add<uint32>("warm_up", "warm up run times", false, 1)
+           .add<uint32>("num_threads", "threads running one operator, 0 for the number of cores", false, 0)
+           .add<uint32>("inter_op_threads", "threads running independent operators", false, 1)
            .add<std::string>("model_path", "specified model path", true, "")
            .add<std::string>("model_format", "specified model format", true, "", OneOfReader<std::string>({"TENSORFLOW", "ONNX", "MAI"}));
        parser->parse(argc, argv);
@@ -0,0 +1,71 @@
+// Copyright 2019 MAI. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include "NeuralNetwork.h"
+#include "core/MaiModel.h"
+#include "source/util/CmdParser.h"
+
+namespace MAI {
+namespace Converter {
+
+// Converts a TF/ONNX model into an optimized MAI model offline, so the
+// protobuf parsing and the graph rewriting never run when it is deployed.
+int Main(int argc, char** argv) {
+    CmdParser parser;
+    parser
+        .add("help", 'h', "Help Info")
+        .add<std::string>("model_path", "model to convert", true, "")
+        .add<std::string>("model_format", "format of the model", true, "",
+                OneOfReader<std::string>({"TENSORFLOW", "ONNX", "MAI"}))
+        .add<std::string>("output_path", "path of the MAI model to write", true, "");
+    CmdStatus status = parser.parse(argc, argv);
+    if (status != CmdStatus::SUCCESS) {
+        printf("%s%s", parser.getErrorLog().c_str(), parser.getHelpInfo().c_str());
+        return status == CmdStatus::HELP ? 0 : 1;
+    }
+
+    const std::string format = parser.get<std::string>("model_format");
+    NeuralNetwork::NetworkFormat networkFormat = NeuralNetwork::MAI;
+    if (format == "TENSORFLOW") {
+        networkFormat = NeuralNetwork::TENSORFLOW;
+    } else if (format == "ONNX") {
+        networkFormat = NeuralNetwork::ONNX;
+    }
+    std::unique_ptr<NeuralNetwork> network = NeuralNetwork::getNeuralNetwork(networkFormat,
+            parser.get<std::string>("model_path"));
+    if (!network) {
+        ALOGE("Cannot load %s", parser.get<std::string>("model_path").c_str());
+        return 1;
+    }
+    uint64 operatorCount = network->getOperatorNames().size();
+    network->addAllOptimizers();
+    network->startOptimize();
+    ALOGI("Operators: %llu before optimizing, %llu after",
+            operatorCount, static_cast<uint64>(network->getOperatorNames().size()));
+
+    const std::string outputPath = parser.get<std::string>("output_path");
+    if (MaiModelWriter::write(network.get(), outputPath) != MAI_SUCCESS) {
+        return 1;
+    }
+    ALOGI("Wrote %s", outputPath.c_str());
+    return 0;
+}
+
+} // namespace Converter
+} // namespace MAI
+
+int main(int argc, char** argv) {
+    return MAI::Converter::Main(argc, argv);
+}
@@ -157,7 +157,8 @@ public:
     }
 
     static std::unique_ptr<Operator> createOperator(MAIOperator opType, DataType dataType) {
-        std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator({opType, dataType});
+        std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator(
+                OpContextBuilder().setOperatorType(opType).setDataType(dataType).build());
         return op;
     }
 
@@ -632,6 +633,24 @@ OP_PARSER(Softmax) {
     parseAttrs(parser, node, SOFTMAX, onnxDataType, param, attrParsers);
 }
 
+OP_PARSER(LogSoftmax) {
+    SoftmaxParam* param = new SoftmaxParam();
+    param->beta = 1.f;
+    param->axis = 1;//according to the onnx document, axis default is 1, as the 0th dim is batch
+    onnx::TensorProto::DataType onnxDataType = onnx::TensorProto::FLOAT;
+    std::map<std::string, std::vector<std::function<void(const onnx::AttributeProto&)>>> attrParsers = {
+        {"axis",
+            {
+                [&param](const onnx::AttributeProto& attr)
+                {
+                    param->axis = attr.i();
+                }
+            }
+        },
+    };
+    parseAttrs(parser, node, LOG_SOFTMAX, onnxDataType, param, attrParsers);
+}
+
 OP_PARSER(Cast) {
     onnx::TensorProto::DataType onnxDataType;
     std::map<std::string, std::vector<std::function<void(const onnx::AttributeProto&)>>> attrParsers = {
@@ -856,7 +875,8 @@ void OnnxParser::parse(const std::string& netPath) {
             std::vector<shape_t> inputShape(tensor.shape().dim_size());
             for (int32 d = 0; d < tensor.shape().dim_size(); ++d) {
                 int32 dim = tensor.shape().dim(d).dim_value();
-                inputShape[d] = (dim == 0 || dim == -1) ? 1 : dim; //TODO:(gavinchen) receive input size from command line
+                // unknown dims start as 1, NeuralNetwork::resizeInputs sets the real ones
+                inputShape[d] = (dim == 0 || dim == -1) ? 1 : dim;
             }
             mOnnxNetwork->addModelInput(input.name(),
                     onnx2MIDataType(tensor.elem_type()), NCHW, inputShape);
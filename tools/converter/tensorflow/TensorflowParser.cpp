@@ -21,7 +21,6 @@
 #include "Type.h"
 #include "source/core/Allocator.h"
 #include "source/core/OperatorRegister.h"
-#include "source/core/OpenMP.h"
 #include "source/util/MAIUtil.h"
 #include "tools/converter/tensorflow/protos/graph.pb.h"
 #include "tools/converter/tensorflow/protos/op_def.pb.h"
@@ -108,7 +107,8 @@ public:
     }
 
     static std::unique_ptr<Operator> createOperator(MAIOperator opType, DataType dataType) {
-        std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator({opType, dataType});
+        std::unique_ptr<Operator> op = OperatorRegister::getInstance()->createOperator(
+                OpContextBuilder().setOperatorType(opType).setDataType(dataType).build());
         return op;
     }
 
@@ -488,6 +488,18 @@ OP_PARSER(Softmax) {
     parseAttrs(parser, node, SOFTMAX, tfDataType, NULL/*param*/, attrParsers);
 }
 
+OP_PARSER(LogSoftmax) {
+    tensorflow::DataType tfDataType;
+    std::map<std::string, std::function<void(const tensorflow::AttrValue&)>> attrParsers = {
+        {"T", [&tfDataType](const tensorflow::AttrValue& attr)
+            {
+                tfDataType = attr.type();
+            }
+        },
+    };
+    parseAttrs(parser, node, LOG_SOFTMAX, tfDataType, NULL/*param*/, attrParsers);
+}
+
 OP_PARSER(Const) {
     //const tensorflow::OpDef& opDef = parser.mOpList.op(parser.mOpMap[node.op()]);
     const tensorflow::AttrValue& attr = node.attr().at("value");